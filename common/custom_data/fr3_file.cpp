@@ -0,0 +1,211 @@
+#include "fr3_file.h"
+
+#include <cstring>
+
+#include "common/util/Assert.h"
+#include "common/util/Serializer.h"
+#include "common/util/ThreadPool.h"
+
+#include "third-party/fmt/core.h"
+
+namespace tfrag3 {
+
+namespace {
+
+// textures are grouped into sections of around this many bytes.
+constexpr size_t TEXTURE_SECTION_SIZE = 4 * 1024 * 1024;
+
+struct Fr3Header {
+  u64 magic;
+  u32 version;
+  u32 section_count;
+};
+
+template <typename T>
+void serialize_size(Serializer& ser, std::vector<T>* vec) {
+  if (ser.is_saving()) {
+    ser.save<size_t>(vec->size());
+  } else {
+    vec->resize(ser.load<size_t>());
+  }
+}
+
+/*!
+ * Save or load a single section. Works like the serialize methods of the level data.
+ */
+void serialize_section(Serializer& ser, Level& level, const Fr3Section& section) {
+  switch (section.kind) {
+    case Fr3SectionKind::INFO:
+      ser.from_ptr(&level.version);
+      if (ser.is_loading() && level.version != TFRAG3_VERSION) {
+        ASSERT_MSG(false,
+                   fmt::format("version mismatch when loading tfrag3 data. Got {}, expected {}, "
+                               "did you forget to re-decompile?",
+                               level.version, TFRAG3_VERSION));
+      }
+      ser.from_str(&level.level_name);
+      serialize_size(ser, &level.textures);
+      for (auto& trees : level.tfrag_trees) {
+        serialize_size(ser, &trees);
+      }
+      for (auto& trees : level.tie_trees) {
+        serialize_size(ser, &trees);
+      }
+      serialize_size(ser, &level.shrub_trees);
+      break;
+    case Fr3SectionKind::TEXTURES:
+      for (u32 i = 0; i < section.count; i++) {
+        level.textures.at(section.first + i).serialize(ser);
+      }
+      break;
+    case Fr3SectionKind::TFRAG_TREE:
+      level.tfrag_trees.at(section.geom).at(section.first).serialize(ser);
+      break;
+    case Fr3SectionKind::TIE_TREE:
+      level.tie_trees.at(section.geom).at(section.first).serialize(ser);
+      break;
+    case Fr3SectionKind::SHRUB_TREE:
+      level.shrub_trees.at(section.first).serialize(ser);
+      break;
+    case Fr3SectionKind::COLLISION:
+      level.collision.serialize(ser);
+      break;
+    case Fr3SectionKind::MERC:
+      level.merc_data.serialize(ser);
+      break;
+    default:
+      ASSERT_NOT_REACHED();
+  }
+}
+
+std::vector<Fr3Section> make_sections(const Level& level) {
+  std::vector<Fr3Section> result;
+  result.push_back({Fr3SectionKind::INFO});
+
+  size_t texture_bytes = 0;
+  for (u32 i = 0; i < level.textures.size(); i++) {
+    if (texture_bytes == 0) {
+      result.push_back({Fr3SectionKind::TEXTURES, 0, i, 0});
+    }
+    result.back().count++;
+    texture_bytes += level.textures[i].data.size() * sizeof(u32);
+    if (texture_bytes >= TEXTURE_SECTION_SIZE) {
+      texture_bytes = 0;
+    }
+  }
+
+  for (u32 geom = 0; geom < level.tfrag_trees.size(); geom++) {
+    for (u32 i = 0; i < level.tfrag_trees[geom].size(); i++) {
+      result.push_back({Fr3SectionKind::TFRAG_TREE, geom, i, 1});
+    }
+  }
+  for (u32 geom = 0; geom < level.tie_trees.size(); geom++) {
+    for (u32 i = 0; i < level.tie_trees[geom].size(); i++) {
+      result.push_back({Fr3SectionKind::TIE_TREE, geom, i, 1});
+    }
+  }
+  for (u32 i = 0; i < level.shrub_trees.size(); i++) {
+    result.push_back({Fr3SectionKind::SHRUB_TREE, 0, i, 1});
+  }
+  result.push_back({Fr3SectionKind::COLLISION});
+  result.push_back({Fr3SectionKind::MERC});
+  return result;
+}
+}  // namespace
+
+std::vector<u8> write_fr3(Level& level,
+                          const compression::ZstdOptions& options,
+                          size_t* uncompressed_size) {
+  auto sections = make_sections(level);
+
+  std::vector<std::vector<u8>> compressed(sections.size());
+  std::vector<size_t> uncompressed_sizes(sections.size());
+  parallel_for("fr3-section", sections.size(), [&](int i) {
+    compression::ZstdStreamCompressor compressor(options);
+    Serializer ser([&](const u8* data, size_t size) { compressor.add(data, size); });
+    serialize_section(ser, level, sections[i]);
+    ser.flush();
+    uncompressed_sizes[i] = compressor.uncompressed_size();
+    compressed[i] = compressor.finish();
+  });
+
+  Fr3Header header;
+  header.magic = FR3_SECTIONED_MAGIC;
+  header.version = FR3_SECTIONED_VERSION;
+  header.section_count = sections.size();
+  size_t offset = sizeof(Fr3Header) + sizeof(Fr3Section) * sections.size();
+  for (size_t i = 0; i < sections.size(); i++) {
+    sections[i].offset = offset;
+    sections[i].size = compressed[i].size();
+    offset += compressed[i].size();
+  }
+
+  std::vector<u8> result(offset);
+  memcpy(result.data(), &header, sizeof(Fr3Header));
+  memcpy(result.data() + sizeof(Fr3Header), sections.data(), sizeof(Fr3Section) * sections.size());
+  for (size_t i = 0; i < sections.size(); i++) {
+    memcpy(result.data() + sections[i].offset, compressed[i].data(), compressed[i].size());
+  }
+
+  if (uncompressed_size) {
+    *uncompressed_size = 0;
+    for (auto size : uncompressed_sizes) {
+      *uncompressed_size += size;
+    }
+  }
+  return result;
+}
+
+Fr3Reader::Fr3Reader(const u8* data, size_t size) : m_data(data), m_size(size) {
+  Fr3Header header;
+  if (size < sizeof(Fr3Header)) {
+    return;
+  }
+  memcpy(&header, data, sizeof(Fr3Header));
+  if (header.magic != FR3_SECTIONED_MAGIC) {
+    return;
+  }
+  ASSERT_MSG(header.version == FR3_SECTIONED_VERSION,
+             fmt::format("Unsupported fr3 version {}, did you forget to re-decompile?",
+                         header.version));
+  ASSERT(header.section_count > 0);
+  ASSERT(sizeof(Fr3Header) + sizeof(Fr3Section) * header.section_count <= size);
+  m_sectioned = true;
+
+  m_sections.resize(header.section_count);
+  memcpy(m_sections.data(), data + sizeof(Fr3Header), sizeof(Fr3Section) * header.section_count);
+  for (auto& section : m_sections) {
+    ASSERT(section.offset + section.size <= size);
+  }
+  m_info = m_sections.front();
+  ASSERT(m_info.kind == Fr3SectionKind::INFO);
+  m_sections.erase(m_sections.begin());
+}
+
+void Fr3Reader::load_info(Level* level) const {
+  ASSERT(m_sectioned);
+  load_section(m_info, level);
+}
+
+void Fr3Reader::load_section(const Fr3Section& section, Level* level) const {
+  ASSERT(m_sectioned);
+  auto decompressed = compression::decompress_zstd(m_data + section.offset, section.size);
+  Serializer ser(decompressed.data(), decompressed.size(), Serializer::Ownership::BORROW);
+  serialize_section(ser, *level, section);
+  ASSERT(ser.get_load_finished());
+}
+
+void Fr3Reader::load_all(Level* level) const {
+  if (m_sectioned) {
+    load_info(level);
+    for (auto& section : m_sections) {
+      load_section(section, level);
+    }
+  } else {
+    auto decompressed = compression::decompress_zstd(m_data, m_size);
+    Serializer ser(decompressed.data(), decompressed.size(), Serializer::Ownership::BORROW);
+    level->serialize(ser);
+  }
+}
+
+}  // namespace tfrag3
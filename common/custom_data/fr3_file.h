@@ -0,0 +1,85 @@
+#pragma once
+
+/*!
+ * @file fr3_file.h
+ * The .fr3 file format, for tfrag3::Level data.
+ *
+ * Version 1 files are a Level::serialize'd level, compressed as a single compress_zstd blob.
+ * Version 2 files have a directory of sections, each compressed on its own, so the loader can
+ * decompress sections in parallel, or only the ones it needs, directly from a memory mapped file:
+ *
+ *   u64 magic, u32 version, u32 section count
+ *   Fr3Section[section count]
+ *   section data (compress_zstd format)
+ *
+ * The first section is always the INFO section, which has the level name and the number of
+ * textures and trees. It must be loaded before the other sections.
+ */
+
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/custom_data/Tfrag3Data.h"
+#include "common/util/compress.h"
+
+namespace tfrag3 {
+
+constexpr u64 FR3_SECTIONED_MAGIC = 0x3254434553335246;  // "FR3SECT2", never a valid v1 size.
+constexpr u32 FR3_SECTIONED_VERSION = 2;
+
+enum class Fr3SectionKind : u32 {
+  INFO,
+  TEXTURES,
+  TFRAG_TREE,
+  TIE_TREE,
+  SHRUB_TREE,
+  COLLISION,
+  MERC,
+};
+
+struct Fr3Section {
+  Fr3SectionKind kind;
+  u32 geom = 0;   // for tfrag and tie trees
+  u32 first = 0;  // index of the first texture or tree in this section
+  u32 count = 0;  // number of textures or trees
+  u64 offset = 0;
+  u64 size = 0;  // compressed size
+};
+
+/*!
+ * Create a version 2 .fr3 file. Sections are compressed in parallel when called from a ThreadPool.
+ */
+std::vector<u8> write_fr3(Level& level,
+                          const compression::ZstdOptions& options,
+                          size_t* uncompressed_size = nullptr);
+
+/*!
+ * Reader for either version of .fr3 file. Does not copy the file data, which must stay alive.
+ */
+class Fr3Reader {
+ public:
+  Fr3Reader(const u8* data, size_t size);
+  bool is_sectioned() const { return m_sectioned; }
+
+  // sections, not including the INFO section.
+  const std::vector<Fr3Section>& sections() const { return m_sections; }
+
+  // set the level name and size the level's texture and tree arrays. Version 2 only.
+  void load_info(Level* level) const;
+
+  // load a section into a level that has already had load_info run. Different sections can be
+  // loaded at the same time from different threads.
+  void load_section(const Fr3Section& section, Level* level) const;
+
+  // load everything.
+  void load_all(Level* level) const;
+
+ private:
+  const u8* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_sectioned = false;
+  Fr3Section m_info;
+  std::vector<Fr3Section> m_sections;
+};
+
+}  // namespace tfrag3
@@ -0,0 +1,713 @@
+/*!
+ * @file CodeCompiler.cpp
+ * Compiles the bodies of GOOS lambdas and macros to C++ closures.
+ *
+ * Lambdas and macros are called far more often than they are defined: the compiler expands
+ * macros like let, case and defstate tens of thousands of times in a build. Evaluating the body as
+ * a tree repeats the same work every time: finding the special form for each head symbol,
+ * splitting the arguments into Arguments, and checking the syntax of each form. Instead, the body
+ * is compiled the first time it is called, and the compiled code is reused by every later call.
+ *
+ * Each form is compiled to a closure that takes the environment and returns the value. Special
+ * forms that are commonly used in macros are compiled directly. Anything else, and any form with
+ * bad syntax, is compiled to a closure that evaluates the form with the interpreter, so errors
+ * happen at the same time and with the same message as they did before.
+ *
+ * A macro used inside a compiled body is expanded once for each place it is used, and the
+ * compiled expansion is reused as long as the name still refers to the same macro. Like in other
+ * Lisps, the expansion should only depend on the code passed to the macro.
+ *
+ * Top-level forms (and eval) are still evaluated by the interpreter, because they usually only
+ * run once.
+ */
+
+#include <map>
+
+#include "Interpreter.h"
+#include "ParseHelpers.h"
+
+namespace goos {
+
+/*!
+ * The compiled body of a lambda or macro, and the symbols its arguments are stored in.
+ */
+struct CompiledBody {
+  std::vector<HeapObject*> unnamed;
+  std::vector<std::pair<std::string, HeapObject*>> named;
+  HeapObject* rest = nullptr;
+  // false if the body isn't a proper list, the interpreter will report the error.
+  bool is_list = false;
+  std::vector<std::function<Object(const HeapPtr<EnvironmentObject>& env)>> forms;
+};
+
+namespace {
+/*!
+ * Split up the arguments of a form without evaluating them, if they are valid for the spec.
+ */
+std::optional<Arguments> try_get_args(Interpreter& interp,
+                                      const Object& form,
+                                      const ArgumentSpec& spec) {
+  try {
+    return interp.get_args(form, form.as_pair()->cdr, spec);
+  } catch (std::runtime_error&) {
+    return std::nullopt;
+  }
+}
+
+bool args_valid(
+    const std::optional<Arguments>& args,
+    const std::vector<std::optional<ObjectType>>& unnamed,
+    const std::unordered_map<std::string, std::pair<bool, std::optional<ObjectType>>>& named) {
+  std::string err;
+  return args && va_check(*args, unnamed, named, &err);
+}
+}  // namespace
+
+/*!
+ * Expand a macro: call it with the unevaluated arguments, in a new environment inside env.
+ */
+Object Interpreter::expand_macro(const Object& form,
+                                 const Object& macro_obj,
+                                 const Object& rest,
+                                 const HeapPtr<EnvironmentObject>& env) {
+  auto macro = macro_obj.as_macro();
+  Arguments args = get_args(form, rest, macro->args);
+  return call_body(form, args, macro->args, macro->body, &macro->compiled, env);
+}
+
+/*!
+ * Call a lambda with evaluated arguments.
+ */
+Object Interpreter::call_lambda(const Object& form, LambdaObject* lambda, const Arguments& args) {
+  return call_body(form, args, lambda->args, lambda->body, &lambda->compiled, lambda->parent_env);
+}
+
+/*!
+ * Run the body of a lambda or macro in a new environment with the arguments. The body is compiled
+ * the first time it runs.
+ */
+Object Interpreter::call_body(const Object& form,
+                              const Arguments& args,
+                              const ArgumentSpec& arg_spec,
+                              const Object& body,
+                              std::shared_ptr<CompiledBody>* compiled,
+                              const HeapPtr<EnvironmentObject>& parent_env) {
+  if (!*compiled) {
+    *compiled = compile_body(arg_spec, body);
+  }
+  const auto& code = **compiled;
+
+  check_arg_count(form, args, arg_spec);
+  auto env = make_heap<EnvironmentObject>();
+  env->parent_env = parent_env;
+  env->vars.reserve(code.unnamed.size() + code.named.size() + (code.rest ? 1 : 0));
+  for (size_t i = 0; i < code.unnamed.size(); i++) {
+    env->vars[code.unnamed[i]] = args.unnamed.at(i);
+  }
+  for (const auto& [name, sym] : code.named) {
+    env->vars[sym] = args.named.at(name);
+  }
+  if (code.rest) {
+    env->vars[code.rest] = build_list(args.rest);
+  }
+
+  if (!code.is_list) {
+    return eval_list_return_last(body, body, env);
+  }
+  Object result = Object::make_empty_list();
+  for (const auto& f : code.forms) {
+    result = f(env);
+  }
+  return result;
+}
+
+std::shared_ptr<CompiledBody> Interpreter::compile_body(const ArgumentSpec& arg_spec,
+                                                        const Object& body) {
+  auto result = std::make_shared<CompiledBody>();
+  for (const auto& name : arg_spec.unnamed) {
+    result->unnamed.push_back(intern_ptr(name));
+  }
+  for (const auto& [name, arg] : arg_spec.named) {
+    result->named.emplace_back(name, intern_ptr(name));
+  }
+  if (!arg_spec.rest.empty()) {
+    result->rest = intern_ptr(arg_spec.rest);
+  }
+  auto forms = compile_list(body);
+  if (forms) {
+    result->is_list = true;
+    result->forms = std::move(*forms);
+  }
+  return result;
+}
+
+/*!
+ * Wrap code that runs form, so errors print the form, like eval_with_rewind.
+ */
+template <typename F>
+Interpreter::CompiledCode Interpreter::with_rewind(const Object& form, F&& code) {
+  return [this, form, code = std::forward<F>(code)](
+             const HeapPtr<EnvironmentObject>& env) -> Object {
+    try {
+      return code(env);
+    } catch (std::runtime_error& e) {
+      print_eval_error_location(form);
+      throw e;
+    }
+  };
+}
+
+/*!
+ * Compile a form. This never fails: forms that can't be compiled are evaluated by the interpreter.
+ */
+Interpreter::CompiledCode Interpreter::compile(const Object& form) {
+  switch (form.type) {
+    case ObjectType::SYMBOL:
+      if (form.as_symbol() == m_true_sym || form.as_symbol() == m_false_sym) {
+        return [form](const auto&) { return form; };
+      }
+      return with_rewind(form, [this, form](const HeapPtr<EnvironmentObject>& env) {
+        return eval_symbol(form, env);
+      });
+    case ObjectType::INTEGER:
+    case ObjectType::FLOAT:
+    case ObjectType::STRING:
+    case ObjectType::CHAR:
+      return [form](const auto&) { return form; };
+    case ObjectType::PAIR:
+      return compile_pair(form);
+    default:
+      return compile_fallback(form);
+  }
+}
+
+/*!
+ * Evaluate the form with the interpreter.
+ */
+Interpreter::CompiledCode Interpreter::compile_fallback(const Object& form) {
+  return with_rewind(form, [this, form](const HeapPtr<EnvironmentObject>& env) {
+    return eval(form, env);
+  });
+}
+
+/*!
+ * Compile each form in a list, or return nothing if it isn't a proper list.
+ */
+std::optional<std::vector<Interpreter::CompiledCode>> Interpreter::compile_list(
+    const Object& list) {
+  std::vector<CompiledCode> result;
+  const Object* current = &list;
+  while (current->is_pair()) {
+    result.push_back(compile(current->as_pair()->car));
+    current = &current->as_pair()->cdr;
+  }
+  if (!current->is_empty_list()) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+Interpreter::CompiledCode Interpreter::compile_pair(const Object& form) {
+  const auto& head = form.as_pair()->car;
+  if (head.is_symbol()) {
+    auto kv = m_forms.find(head.as_symbol());
+    if (kv != m_forms.end()) {
+      if (kv->second.special) {
+        return compile_special(form, kv->second.special);
+      }
+      if (kv->second.builtin) {
+        return compile_builtin(form, kv->second.builtin);
+      }
+      return compile_fallback(form);
+    }
+  }
+  return compile_call(form);
+}
+
+Interpreter::CompiledCode Interpreter::compile_special(const Object& form, SpecialForm special) {
+  std::optional<CompiledCode> result;
+  if (special == &Interpreter::eval_quote) {
+    result = compile_quote(form);
+  } else if (special == &Interpreter::eval_quasiquote) {
+    result = compile_quasiquote(form);
+  } else if (special == &Interpreter::eval_cond) {
+    result = compile_cond(form);
+  } else if (special == &Interpreter::eval_or) {
+    result = compile_or_and(form, true);
+  } else if (special == &Interpreter::eval_and) {
+    result = compile_or_and(form, false);
+  } else if (special == &Interpreter::eval_while) {
+    result = compile_while(form);
+  } else if (special == &Interpreter::eval_define) {
+    result = compile_define(form);
+  } else if (special == &Interpreter::eval_set) {
+    result = compile_set(form);
+  } else if (special == &Interpreter::eval_lambda) {
+    result = compile_lambda(form, false);
+  } else if (special == &Interpreter::eval_macro) {
+    result = compile_lambda(form, true);
+  }
+
+  if (result) {
+    return std::move(*result);
+  }
+  // other special forms, or bad syntax: let the special form run (and report the error).
+  return with_rewind(form, [this, form, special](const HeapPtr<EnvironmentObject>& env) {
+    return ((*this).*special)(form, form.as_pair()->cdr, env);
+  });
+}
+
+/*!
+ * Built-in forms get all of their arguments evaluated, then called with them.
+ */
+Interpreter::CompiledCode Interpreter::compile_builtin(const Object& form, BuiltinForm builtin) {
+  auto args = try_get_args(*this, form, make_varargs());
+  if (!args) {
+    return compile_fallback(form);
+  }
+
+  std::vector<CompiledCode> unnamed;
+  for (const auto& arg : args->unnamed) {
+    unnamed.push_back(compile(arg));
+  }
+  std::vector<std::pair<std::string, CompiledCode>> named;
+  for (const auto& [name, arg] : args->named) {
+    named.emplace_back(name, compile(arg));
+  }
+
+  return with_rewind(form, [this, form, builtin, unnamed = std::move(unnamed),
+                            named = std::move(named)](
+                               const HeapPtr<EnvironmentObject>& env) {
+    Arguments evaluated;
+    evaluated.unnamed.reserve(unnamed.size());
+    for (const auto& arg : unnamed) {
+      evaluated.unnamed.push_back(arg(env));
+    }
+    for (const auto& [name, arg] : named) {
+      evaluated.named[name] = arg(env);
+    }
+    return ((*this).*builtin)(form, evaluated, env);
+  });
+}
+
+/*!
+ * Compile a form that calls a macro or a lambda. What the head refers to is only known when the
+ * code runs, so the arguments are compiled the first time it's called with a lambda.
+ */
+Interpreter::CompiledCode Interpreter::compile_call(const Object& form) {
+  struct CallSite {
+    std::vector<Object> positional;
+    std::map<std::string, Object> keywords;
+
+    bool args_compiled = false;
+    std::vector<CompiledCode> positional_code;
+    std::map<std::string, CompiledCode> keyword_code;
+
+    // the last macro expanded here, and its compiled expansion.
+    Object macro;
+    std::shared_ptr<CompiledCode> expansion;
+    int forms_version = 0;
+  };
+
+  const auto& head = form.as_pair()->car;
+  auto site = std::make_shared<CallSite>();
+  site->forms_version = m_custom_forms_version;
+
+  // split up the arguments like get_args. If they are malformed, let it report the error.
+  for (const Object* current = &form.as_pair()->cdr; !current->is_empty_list();
+       current = &current->as_pair()->cdr) {
+    if (!current->is_pair()) {
+      return compile_fallback(form);
+    }
+    const auto& arg = current->as_pair()->car;
+    if (arg.is_symbol() && arg.as_symbol()->name.at(0) == ':') {
+      current = &current->as_pair()->cdr;
+      if (!current->is_pair() ||
+          !site->keywords.emplace(arg.as_symbol()->name.substr(1), current->as_pair()->car)
+               .second) {
+        return compile_fallback(form);
+      }
+    } else {
+      site->positional.push_back(arg);
+    }
+  }
+
+  auto call = [this, form, site](const Object& value,
+                                 const HeapPtr<EnvironmentObject>& env) -> Object {
+    if (value.type != ObjectType::LAMBDA) {
+      throw_eval_error(form, "head of form didn't evaluate to lambda");
+    }
+    auto lambda = value.as_lambda();
+    const auto& spec = lambda->args;
+
+    if (!site->args_compiled) {
+      for (const auto& arg : site->positional) {
+        site->positional_code.push_back(compile(arg));
+      }
+      for (const auto& [name, arg] : site->keywords) {
+        site->keyword_code.emplace(name, compile(arg));
+      }
+      site->args_compiled = true;
+    }
+
+    Arguments args;
+    if (site->keywords.empty() && spec.named.empty()) {
+      // only positional arguments, check them like get_args.
+      if (site->positional.size() < spec.unnamed.size()) {
+        throw_eval_error(form, "didn't get enough arguments");
+      }
+      if (site->positional.size() > spec.unnamed.size() && spec.rest.empty()) {
+        throw_eval_error(form, "got too many arguments");
+      }
+      args.unnamed.reserve(spec.unnamed.size());
+      for (size_t i = 0; i < site->positional_code.size(); i++) {
+        if (i < spec.unnamed.size()) {
+          args.unnamed.push_back(site->positional_code[i](env));
+        } else {
+          args.rest.push_back(site->positional_code[i](env));
+        }
+      }
+    } else {
+      args = get_args(form, form.as_pair()->cdr, spec);
+      size_t i = 0;
+      for (auto& arg : args.unnamed) {
+        arg = site->positional_code.at(i++)(env);
+      }
+      for (auto& [name, arg] : args.named) {
+        auto kv = site->keyword_code.find(name);
+        // default values are evaluated here, like eval_args does.
+        arg = kv == site->keyword_code.end() ? eval_with_rewind(arg, env) : kv->second(env);
+      }
+      for (auto& arg : args.rest) {
+        arg = site->positional_code.at(i++)(env);
+      }
+    }
+    return call_lambda(form, lambda, args);
+  };
+
+  if (!head.is_symbol()) {
+    auto head_code = compile(head);
+    return with_rewind(form, [head_code = std::move(head_code), call = std::move(call)](
+                                 const HeapPtr<EnvironmentObject>& env) {
+      return call(head_code(env), env);
+    });
+  }
+
+  return with_rewind(form, [this, form, head, site, call = std::move(call)](
+                               const HeapPtr<EnvironmentObject>& env) -> Object {
+    if (site->forms_version != m_custom_forms_version) {
+      // a custom form was added since this was compiled, it might use this name.
+      auto kv = m_forms.find(head.as_symbol());
+      if (kv != m_forms.end() && kv->second.custom) {
+        return eval_pair(form, env);
+      }
+      site->forms_version = m_custom_forms_version;
+    }
+
+    Object value;
+    if (!try_symbol_lookup(head, env, &value)) {
+      // report the error like the interpreter does.
+      value = eval_with_rewind(head, env);
+    } else if (value.is_macro()) {
+      if (!site->expansion || site->macro.heap_obj != value.heap_obj) {
+        auto expanded = expand_macro(form, value, form.as_pair()->cdr, env);
+        site->expansion = std::make_shared<CompiledCode>(compile(expanded));
+        site->macro = value;
+      }
+      // the expansion may run this code again and replace it.
+      auto expansion = site->expansion;
+      return (*expansion)(env);
+    }
+    return call(value, env);
+  });
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_quote(const Object& form) {
+  auto args = try_get_args(*this, form, make_varargs());
+  if (!args_valid(args, {{}}, {})) {
+    return std::nullopt;
+  }
+  Object value = args->unnamed.front();
+  return [value](const auto&) { return value; };
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_quasiquote(const Object& form) {
+  const auto& rest = form.as_pair()->cdr;
+  if (!rest.is_pair() || !rest.as_pair()->cdr.is_empty_list()) {
+    return std::nullopt;
+  }
+  auto code = compile_quasiquote_list(rest.as_pair()->car);
+  if (!code) {
+    return std::nullopt;
+  }
+  return with_rewind(form, std::move(*code));
+}
+
+/*!
+ * Compile a quasiquoted list, like quasiquote_helper. Nothing is returned if it's malformed.
+ */
+std::optional<Interpreter::CompiledCode> Interpreter::compile_quasiquote_list(const Object& list) {
+  struct Part {
+    Object value;       // if there is no code
+    CompiledCode code;  // unquoted code, or a nested list
+    bool splice = false;
+  };
+  std::vector<Part> parts;
+
+  const Object* current = &list;
+  for (; current->is_pair(); current = &current->as_pair()->cdr) {
+    const auto& item = current->as_pair()->car;
+    Part part;
+    if (!item.is_pair()) {
+      part.value = item;
+    } else {
+      const auto& item_head = item.as_pair()->car;
+      bool unquote = item_head.is_symbol() && item_head.as_symbol()->name == "unquote";
+      bool splice = item_head.is_symbol() && item_head.as_symbol()->name == "unquote-splicing";
+      if (unquote || splice) {
+        const auto& unquote_arg = item.as_pair()->cdr;
+        if (!unquote_arg.is_pair() || !unquote_arg.as_pair()->cdr.is_empty_list()) {
+          return std::nullopt;
+        }
+        part.code = compile(unquote_arg.as_pair()->car);
+        part.splice = splice;
+      } else {
+        auto nested = compile_quasiquote_list(item);
+        if (!nested) {
+          return std::nullopt;
+        }
+        part.code = std::move(*nested);
+      }
+    }
+    parts.push_back(std::move(part));
+  }
+  if (!current->is_empty_list()) {
+    return std::nullopt;
+  }
+
+  return [this, list, parts = std::move(parts)](const HeapPtr<EnvironmentObject>& env) {
+    std::vector<Object> result;
+    result.reserve(parts.size());
+    for (const auto& part : parts) {
+      if (!part.code) {
+        result.push_back(part.value);
+      } else if (!part.splice) {
+        result.push_back(part.code(env));
+      } else {
+        Object spliced = part.code(env);
+        const Object* to_add = &spliced;
+        while (to_add->is_pair()) {
+          result.push_back(to_add->as_pair()->car);
+          to_add = &to_add->as_pair()->cdr;
+        }
+        if (!to_add->is_empty_list()) {
+          throw_eval_error(list, "malformed unquote-splicing result");
+        }
+      }
+    }
+    return build_list(std::move(result));
+  };
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_cond(const Object& form) {
+  struct Clause {
+    CompiledCode condition;
+    std::vector<CompiledCode> body;
+  };
+  std::vector<Clause> clauses;
+
+  const auto& rest = form.as_pair()->cdr;
+  if (!rest.is_pair()) {
+    return std::nullopt;
+  }
+  const Object* current = &rest;
+  for (; current->is_pair(); current = &current->as_pair()->cdr) {
+    const auto& clause = current->as_pair()->car;
+    if (!clause.is_pair()) {
+      return std::nullopt;
+    }
+    auto body = compile_list(clause.as_pair()->cdr);
+    if (!body) {
+      return std::nullopt;
+    }
+    clauses.push_back({compile(clause.as_pair()->car), std::move(*body)});
+  }
+  if (!current->is_empty_list()) {
+    return std::nullopt;
+  }
+
+  return with_rewind(form, [this, clauses = std::move(clauses)](
+                               const HeapPtr<EnvironmentObject>& env) -> Object {
+    for (const auto& clause : clauses) {
+      Object result = clause.condition(env);
+      if (truthy(result)) {
+        // with no body, the value of the condition is the result.
+        for (const auto& code : clause.body) {
+          result = code(env);
+        }
+        return result;
+      }
+    }
+    return bool_to_symbol(false);
+  });
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_or_and(const Object& form,
+                                                                     bool is_or) {
+  const auto& rest = form.as_pair()->cdr;
+  if (!rest.is_pair()) {
+    return std::nullopt;
+  }
+  auto codes = compile_list(rest);
+  if (!codes) {
+    return std::nullopt;
+  }
+
+  if (is_or) {
+    return with_rewind(form, [this, codes = std::move(*codes)](
+                                 const HeapPtr<EnvironmentObject>& env) -> Object {
+      for (const auto& code : codes) {
+        Object current = code(env);
+        if (truthy(current)) {
+          return current;
+        }
+      }
+      return bool_to_symbol(false);
+    });
+  }
+  return with_rewind(form, [this, codes = std::move(*codes)](
+                               const HeapPtr<EnvironmentObject>& env) -> Object {
+    Object current;
+    for (const auto& code : codes) {
+      current = code(env);
+      if (!truthy(current)) {
+        return bool_to_symbol(false);
+      }
+    }
+    return current;
+  });
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_while(const Object& form) {
+  const auto& rest = form.as_pair()->cdr;
+  if (!rest.is_pair() || !rest.as_pair()->cdr.is_pair()) {
+    return std::nullopt;
+  }
+  auto body = compile_list(rest.as_pair()->cdr);
+  if (!body) {
+    return std::nullopt;
+  }
+
+  return with_rewind(form, [this, condition = compile(rest.as_pair()->car),
+                            body = std::move(*body)](
+                               const HeapPtr<EnvironmentObject>& env) -> Object {
+    Object rv = bool_to_symbol(false);
+    while (truthy(condition(env))) {
+      for (const auto& code : body) {
+        rv = code(env);
+      }
+    }
+    return rv;
+  });
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_define(const Object& form) {
+  auto args = try_get_args(*this, form, make_varargs());
+  if (!args_valid(args, {ObjectType::SYMBOL, {}}, {{"env", {false, {}}}})) {
+    return std::nullopt;
+  }
+
+  HeapObject* sym = args->unnamed[0].as_symbol();
+  std::optional<CompiledCode> env_code;
+  if (args->has_named("env")) {
+    env_code = compile(args->get_named("env"));
+  }
+
+  return with_rewind(form, [this, form, sym, env_code = std::move(env_code),
+                            value_code = compile(args->unnamed[1])](
+                               const HeapPtr<EnvironmentObject>& env) {
+    auto define_env = env;
+    if (env_code) {
+      auto result = (*env_code)(env);
+      expect_env(form, result);
+      define_env = result.as_env_ptr();
+    }
+
+    Object value = value_code(env);
+    define_env->vars[sym] = value;
+    return value;
+  });
+}
+
+std::optional<Interpreter::CompiledCode> Interpreter::compile_set(const Object& form) {
+  auto args = try_get_args(*this, form, make_varargs());
+  if (!args_valid(args, {ObjectType::SYMBOL, {}}, {})) {
+    return std::nullopt;
+  }
+
+  return with_rewind(form, [this, to_define = args->unnamed[0],
+                            value_code = compile(args->unnamed[1])](
+                               const HeapPtr<EnvironmentObject>& env) -> Object {
+    Object to_set = value_code(env);
+    for (auto* search_env = env.get(); search_env; search_env = search_env->parent_env.get()) {
+      auto kv = search_env->vars.find(to_define.as_symbol());
+      if (kv != search_env->vars.end()) {
+        kv->second = to_set;
+        return kv->second;
+      }
+    }
+    throw_eval_error(to_define, "symbol is not defined");
+    return to_set;
+  });
+}
+
+/*!
+ * Compile a lambda or macro definition. The lambdas created here share their compiled body.
+ */
+std::optional<Interpreter::CompiledCode> Interpreter::compile_lambda(const Object& form,
+                                                                     bool is_macro) {
+  const auto& rest = form.as_pair()->cdr;
+  if (!rest.is_pair()) {
+    return std::nullopt;
+  }
+  Object arg_list = rest.as_pair()->car;
+  if (!arg_list.is_pair() && !arg_list.is_empty_list()) {
+    return std::nullopt;
+  }
+  ArgumentSpec spec;
+  try {
+    spec = parse_arg_spec(form, arg_list);
+  } catch (std::runtime_error&) {
+    return std::nullopt;
+  }
+  const auto& body = rest.as_pair()->cdr;
+  if (!body.is_pair()) {
+    return std::nullopt;
+  }
+
+  auto compiled = std::make_shared<std::shared_ptr<CompiledBody>>();
+  return with_rewind(form, [this, spec = std::move(spec), body, compiled, is_macro](
+                               const HeapPtr<EnvironmentObject>& env) {
+    if (!*compiled) {
+      *compiled = compile_body(spec, body);
+    }
+    if (is_macro) {
+      Object new_macro = MacroObject::make_new();
+      auto m = new_macro.as_macro();
+      m->args = spec;
+      m->body = body;
+      m->parent_env = env;
+      m->compiled = *compiled;
+      return new_macro;
+    }
+    Object new_lambda = LambdaObject::make_new();
+    auto l = new_lambda.as_lambda();
+    l->args = spec;
+    l->body = body;
+    l->parent_env = env;
+    l->compiled = *compiled;
+    return new_lambda;
+  });
+}
+
+}  // namespace goos
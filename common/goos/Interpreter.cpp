@@ -7,6 +7,7 @@
 
 #include <utility>
 
+#include "ObjectSerializer.h"
 #include "ParseHelpers.h"
 
 #include "common/goos/Printer.h"
@@ -37,8 +38,13 @@ Interpreter::Interpreter(const std::string& username) {
   define_var_in_env(global_environment, user, "*user*");
   define_var_in_env(goal_env, user, "*user*");
 
+  m_true = intern("#t");
+  m_false = intern("#f");
+  m_true_sym = m_true.as_symbol();
+  m_false_sym = m_false.as_symbol();
+
   // setup maps
-  special_forms = {
+  const std::pair<const char*, SpecialForm> special_forms[] = {
       {"define", &Interpreter::eval_define},
       {"quote", &Interpreter::eval_quote},
       {"set!", &Interpreter::eval_set},
@@ -51,50 +57,59 @@ Interpreter::Interpreter(const std::string& username) {
       {"while", &Interpreter::eval_while},
   };
 
-  builtin_forms = {{"top-level", &Interpreter::eval_begin},
-                   {"begin", &Interpreter::eval_begin},
-                   {"exit", &Interpreter::eval_exit},
-                   {"read", &Interpreter::eval_read},
-                   {"read-data-file", &Interpreter::eval_read_data_file},
-                   {"read-file", &Interpreter::eval_read_file},
-                   {"print", &Interpreter::eval_print},
-                   {"inspect", &Interpreter::eval_inspect},
-                   {"load-file", &Interpreter::eval_load_file},
-                   {"try-load-file", &Interpreter::eval_try_load_file},
-                   {"eq?", &Interpreter::eval_equals},
-                   {"gensym", &Interpreter::eval_gensym},
-                   {"eval", &Interpreter::eval_eval},
-                   {"cons", &Interpreter::eval_cons},
-                   {"car", &Interpreter::eval_car},
-                   {"cdr", &Interpreter::eval_cdr},
-                   {"set-car!", &Interpreter::eval_set_car},
-                   {"set-cdr!", &Interpreter::eval_set_cdr},
-                   {"+", &Interpreter::eval_plus},
-                   {"-", &Interpreter::eval_minus},
-                   {"*", &Interpreter::eval_times},
-                   {"/", &Interpreter::eval_divide},
-                   {"=", &Interpreter::eval_numequals},
-                   {"<", &Interpreter::eval_lt},
-                   {">", &Interpreter::eval_gt},
-                   {"<=", &Interpreter::eval_leq},
-                   {">=", &Interpreter::eval_geq},
-                   {"null?", &Interpreter::eval_null},
-                   {"type?", &Interpreter::eval_type},
-                   {"fmt", &Interpreter::eval_format},
-                   {"error", &Interpreter::eval_error},
-                   {"string-ref", &Interpreter::eval_string_ref},
-                   {"string-length", &Interpreter::eval_string_length},
-                   {"string-append", &Interpreter::eval_string_append},
-                   {"string-starts-with?", &Interpreter::eval_string_starts_with},
-                   {"string-ends-with?", &Interpreter::eval_string_ends_with},
-                   {"string-split", &Interpreter::eval_string_split},
-                   {"ash", &Interpreter::eval_ash},
-                   {"symbol->string", &Interpreter::eval_symbol_to_string},
-                   {"string->symbol", &Interpreter::eval_string_to_symbol},
-                   {"get-environment-variable", &Interpreter::eval_get_env},
-                   {"make-string-hash-table", &Interpreter::eval_make_string_hash_table},
-                   {"hash-table-set!", &Interpreter::eval_hash_table_set},
-                   {"hash-table-try-ref", &Interpreter::eval_hash_table_try_ref}};
+  const std::pair<const char*, BuiltinForm> builtin_forms[] = {
+      {"top-level", &Interpreter::eval_begin},
+      {"begin", &Interpreter::eval_begin},
+      {"exit", &Interpreter::eval_exit},
+      {"read", &Interpreter::eval_read},
+      {"read-data-file", &Interpreter::eval_read_data_file},
+      {"read-file", &Interpreter::eval_read_file},
+      {"print", &Interpreter::eval_print},
+      {"inspect", &Interpreter::eval_inspect},
+      {"load-file", &Interpreter::eval_load_file},
+      {"try-load-file", &Interpreter::eval_try_load_file},
+      {"eq?", &Interpreter::eval_equals},
+      {"gensym", &Interpreter::eval_gensym},
+      {"eval", &Interpreter::eval_eval},
+      {"cons", &Interpreter::eval_cons},
+      {"car", &Interpreter::eval_car},
+      {"cdr", &Interpreter::eval_cdr},
+      {"set-car!", &Interpreter::eval_set_car},
+      {"set-cdr!", &Interpreter::eval_set_cdr},
+      {"+", &Interpreter::eval_plus},
+      {"-", &Interpreter::eval_minus},
+      {"*", &Interpreter::eval_times},
+      {"/", &Interpreter::eval_divide},
+      {"=", &Interpreter::eval_numequals},
+      {"<", &Interpreter::eval_lt},
+      {">", &Interpreter::eval_gt},
+      {"<=", &Interpreter::eval_leq},
+      {">=", &Interpreter::eval_geq},
+      {"null?", &Interpreter::eval_null},
+      {"type?", &Interpreter::eval_type},
+      {"fmt", &Interpreter::eval_format},
+      {"error", &Interpreter::eval_error},
+      {"string-ref", &Interpreter::eval_string_ref},
+      {"string-length", &Interpreter::eval_string_length},
+      {"string-append", &Interpreter::eval_string_append},
+      {"string-starts-with?", &Interpreter::eval_string_starts_with},
+      {"string-ends-with?", &Interpreter::eval_string_ends_with},
+      {"string-split", &Interpreter::eval_string_split},
+      {"ash", &Interpreter::eval_ash},
+      {"symbol->string", &Interpreter::eval_symbol_to_string},
+      {"string->symbol", &Interpreter::eval_string_to_symbol},
+      {"get-environment-variable", &Interpreter::eval_get_env},
+      {"make-string-hash-table", &Interpreter::eval_make_string_hash_table},
+      {"hash-table-set!", &Interpreter::eval_hash_table_set},
+      {"hash-table-try-ref", &Interpreter::eval_hash_table_try_ref},
+  };
+
+  for (const auto& [name, form] : special_forms) {
+    m_forms[intern_ptr(name)].special = form;
+  }
+  for (const auto& [name, form] : builtin_forms) {
+    m_forms[intern_ptr(name)].builtin = form;
+  }
 
   string_to_type = {{"empty-list", ObjectType::EMPTY_LIST},
                     {"integer", ObjectType::INTEGER},
@@ -119,8 +134,9 @@ Interpreter::Interpreter(const std::string& username) {
 void Interpreter::register_form(
     const std::string& name,
     const std::function<
-        Object(const Object&, Arguments&, const std::shared_ptr<EnvironmentObject>&)>& form) {
-  m_custom_forms[name] = form;
+        Object(const Object&, Arguments&, const HeapPtr<EnvironmentObject>&)>& form) {
+  m_forms[intern_ptr(name)].custom = form;
+  m_custom_forms_version++;
 }
 
 Interpreter::~Interpreter() {
@@ -130,6 +146,21 @@ Interpreter::~Interpreter() {
   goal_env.as_env()->vars.clear();
 }
 
+/*!
+ * Save or load the global and GOAL environments, with everything defined in them. Loading replaces
+ * the current environments.
+ */
+void Interpreter::serialize_environments(ObjectSerializer& ser) {
+  if (ser.is_loading()) {
+    // same as the destructor: the old environments refer to themselves, so clear them to free them.
+    global_environment.as_env()->vars.clear();
+    goal_env.as_env()->vars.clear();
+  }
+  ser.from_object(&global_environment);
+  ser.from_object(&goal_env);
+  ser.ser().from_ptr(&gensym_id);
+}
+
 /*!
  * Disable printfs on errors, to make test output look less messy.
  */
@@ -200,20 +231,27 @@ void Interpreter::throw_eval_error(const Object& o, const std::string& err) {
  * and if possible what file/line "obj" comes from.
  */
 Object Interpreter::eval_with_rewind(const Object& obj,
-                                     const std::shared_ptr<EnvironmentObject>& env) {
+                                     const HeapPtr<EnvironmentObject>& env) {
   Object result = Object::make_empty_list();
   try {
     result = eval(obj, env);
   } catch (std::runtime_error& e) {
-    if (!disable_printing) {
-      printf("-----------------------------------------\n");
-      printf("From object %s\nat %s\n", obj.inspect().c_str(), reader.db.get_info_for(obj).c_str());
-    }
+    print_eval_error_location(obj);
     throw e;
   }
   return result;
 }
 
+/*!
+ * Print the object that was being evaluated when there was an error, and where it came from.
+ */
+void Interpreter::print_eval_error_location(const Object& obj) {
+  if (!disable_printing) {
+    printf("-----------------------------------------\n");
+    printf("From object %s\nat %s\n", obj.inspect().c_str(), reader.db.get_info_for(obj).c_str());
+  }
+}
+
 /*!
  * Sets dest to the global variable with the given name, if the variable exists.
  * Returns if the variable was found.
@@ -336,7 +374,7 @@ Arguments Interpreter::get_args(const Object& form, const Object& rest, const Ar
  *
  * Note that in varargs mode, all unnamed arguments are put in unnamed, not rest.
  */
-void Interpreter::eval_args(Arguments* args, const std::shared_ptr<EnvironmentObject>& env) {
+void Interpreter::eval_args(Arguments* args, const HeapPtr<EnvironmentObject>& env) {
   for (auto& arg : args->unnamed) {
     arg = eval_with_rewind(arg, env);
   }
@@ -451,7 +489,7 @@ void Interpreter::vararg_check(
  */
 Object Interpreter::eval_list_return_last(const Object& form,
                                           Object rest,
-                                          const std::shared_ptr<EnvironmentObject>& env) {
+                                          const HeapPtr<EnvironmentObject>& env) {
   Object o = std::move(rest);
   Object rv = Object::make_empty_list();
   for (;;) {
@@ -480,7 +518,7 @@ void Interpreter::expect_env(const Object& form, const Object& o) {
 /*!
  * Highest-level evaluation dispatch.
  */
-Object Interpreter::eval(Object obj, const std::shared_ptr<EnvironmentObject>& env) {
+Object Interpreter::eval(Object obj, const HeapPtr<EnvironmentObject>& env) {
   switch (obj.type) {
     case ObjectType::SYMBOL:
       return eval_symbol(obj, env);
@@ -497,17 +535,16 @@ Object Interpreter::eval(Object obj, const std::shared_ptr<EnvironmentObject>& e
   }
 }
 
-namespace {
-
 /*!
  * Try to find a symbol in an env or parent env. If successful, set dest and return true. Otherwise
  * return false.
  */
-bool try_symbol_lookup(const Object& sym,
-                       const std::shared_ptr<EnvironmentObject>& env,
-                       Object* dest) {
+bool Interpreter::try_symbol_lookup(const Object& sym,
+                                    const HeapPtr<EnvironmentObject>& env,
+                                    Object* dest) const {
   // booleans are hard-coded here
-  if (sym.as_symbol()->name == "#t" || sym.as_symbol()->name == "#f") {
+  auto* sym_obj = sym.as_symbol();
+  if (sym_obj == m_true_sym || sym_obj == m_false_sym) {
     *dest = sym;
     return true;
   }
@@ -515,7 +552,7 @@ bool try_symbol_lookup(const Object& sym,
   // loop up envs until we find it.
   EnvironmentObject* search_env = env.get();
   for (;;) {
-    auto kv = search_env->vars.find(sym.as_symbol());
+    auto kv = search_env->vars.find(sym_obj);
     if (kv != search_env->vars.end()) {
       *dest = kv->second;
       return true;
@@ -529,12 +566,11 @@ bool try_symbol_lookup(const Object& sym,
     }
   }
 }
-}  // namespace
 
 /*!
  * Evaluate a symbol by finding the closest scoped variable with matching name.
  */
-Object Interpreter::eval_symbol(const Object& sym, const std::shared_ptr<EnvironmentObject>& env) {
+Object Interpreter::eval_symbol(const Object& sym, const HeapPtr<EnvironmentObject>& env) {
   Object result;
   if (!try_symbol_lookup(sym, env, &result)) {
     throw_eval_error(sym, "symbol is not defined");
@@ -543,7 +579,7 @@ Object Interpreter::eval_symbol(const Object& sym, const std::shared_ptr<Environ
 }
 
 bool Interpreter::eval_symbol(const Object& sym,
-                              const std::shared_ptr<EnvironmentObject>& env,
+                              const HeapPtr<EnvironmentObject>& env,
                               Object* result) {
   return try_symbol_lookup(sym, env, result);
 }
@@ -551,49 +587,42 @@ bool Interpreter::eval_symbol(const Object& sym,
 /*!
  * Evaluate a pair, either as special form, builtin form, macro application, or lambda application.
  */
-Object Interpreter::eval_pair(const Object& obj, const std::shared_ptr<EnvironmentObject>& env) {
+Object Interpreter::eval_pair(const Object& obj, const HeapPtr<EnvironmentObject>& env) {
   auto pair = obj.as_pair();
   Object head = pair->car;
   Object rest = pair->cdr;
 
   // first see if we got a symbol:
   if (head.type == ObjectType::SYMBOL) {
-    auto head_sym = head.as_symbol();
-
-    // try a special form first
-    auto kv_sf = special_forms.find(head_sym->name);
-    if (kv_sf != special_forms.end()) {
-      return ((*this).*(kv_sf->second))(obj, rest, env);
-    }
+    auto kv = m_forms.find(head.as_symbol());
+    if (kv != m_forms.end()) {
+      const auto& forms = kv->second;
+      // try a special form first
+      if (forms.special) {
+        return ((*this).*(forms.special))(obj, rest, env);
+      }
 
-    // try builtins next
-    auto kv_b = builtin_forms.find(head_sym->name);
-    if (kv_b != builtin_forms.end()) {
-      Arguments args = get_args(obj, rest, make_varargs());
-      // all "built-in" forms expect arguments to be evaluated (that's why they aren't special)
-      eval_args(&args, env);
-      return ((*this).*(kv_b->second))(obj, args, env);
-    }
+      // try builtins next
+      if (forms.builtin) {
+        Arguments args = get_args(obj, rest, make_varargs());
+        // all "built-in" forms expect arguments to be evaluated (that's why they aren't special)
+        eval_args(&args, env);
+        return ((*this).*(forms.builtin))(obj, args, env);
+      }
 
-    // try custom forms next
-    auto kv_u = m_custom_forms.find(head_sym->name);
-    if (kv_u != m_custom_forms.end()) {
-      Arguments args = get_args(obj, rest, make_varargs());
-      return (kv_u->second)(obj, args, env);
+      // try custom forms next
+      if (forms.custom) {
+        Arguments args = get_args(obj, rest, make_varargs());
+        return (forms.custom)(obj, args, env);
+      }
     }
 
     // try macros next
     Object macro_obj;
     if (try_symbol_lookup(head, env, &macro_obj) && macro_obj.is_macro()) {
-      auto macro = macro_obj.as_macro();
-      Arguments args = get_args(obj, rest, macro->args);
-
-      auto mac_env_obj = EnvironmentObject::make_new();
-      auto mac_env = mac_env_obj.as_env_ptr();
-      mac_env->parent_env = env;  // not 100% clear that this is right
-      set_args_in_env(obj, args, macro->args, mac_env);
       // expand the macro!
-      return eval_with_rewind(eval_list_return_last(macro->body, macro->body, mac_env), env);
+      // not 100% clear that the macro should be able to see env
+      return eval_with_rewind(expand_macro(obj, macro_obj, rest, env), env);
     }
   }
 
@@ -606,21 +635,15 @@ Object Interpreter::eval_pair(const Object& obj, const std::shared_ptr<Environme
   auto lam = eval_head.as_lambda();
   Arguments args = get_args(obj, rest, lam->args);
   eval_args(&args, env);
-  auto lam_env_obj = EnvironmentObject::make_new();
-  auto lam_env = lam_env_obj.as_env_ptr();
-  lam_env->parent_env = lam->parent_env;
-  set_args_in_env(obj, args, lam->args, lam_env);
-  return eval_list_return_last(lam->body, lam->body, lam_env);
+  return call_lambda(obj, lam, args);
 }
 
 /*!
- * Given some arguments, an argument spec, and and environment, define the arguments are variables
- * in the environment.
+ * Check that the arguments match the argument spec, before they are set in an environment.
  */
-void Interpreter::set_args_in_env(const Object& form,
+void Interpreter::check_arg_count(const Object& form,
                                   const Arguments& args,
-                                  const ArgumentSpec& arg_spec,
-                                  const std::shared_ptr<EnvironmentObject>& env) {
+                                  const ArgumentSpec& arg_spec) {
   if (arg_spec.rest.empty() && args.unnamed.size() != arg_spec.unnamed.size()) {
     throw_eval_error(form, "did not get the expected number of unnamed arguments (got " +
                                std::to_string(args.unnamed.size()) + ", expected " +
@@ -631,24 +654,8 @@ void Interpreter::set_args_in_env(const Object& form,
                                std::to_string(arg_spec.unnamed.size()) + ")");
   }
 
-  // unnamed args
-  for (size_t i = 0; i < arg_spec.unnamed.size(); i++) {
-    env->vars[intern(arg_spec.unnamed.at(i)).as_symbol()] = args.unnamed.at(i);
-  }
-
-  // named args
-  for (const auto& kv : arg_spec.named) {
-    env->vars[intern(kv.first).as_symbol()] = args.named.at(kv.first);
-  }
-
-  // rest args
-  if (!arg_spec.rest.empty()) {
-    // will correctly handle the '() case
-    env->vars[intern(arg_spec.rest).as_symbol()] = build_list(args.rest);
-  } else {
-    if (!args.rest.empty()) {
-      throw_eval_error(form, "got too many arguments");
-    }
+  if (arg_spec.rest.empty() && !args.rest.empty()) {
+    throw_eval_error(form, "got too many arguments");
   }
 }
 
@@ -657,7 +664,7 @@ void Interpreter::set_args_in_env(const Object& form,
  */
 Object Interpreter::eval_define(const Object& form,
                                 const Object& rest,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   auto args = get_args(form, rest, make_varargs());
   vararg_check(form, args, {ObjectType::SYMBOL, {}}, {{"env", {false, {}}}});
 
@@ -679,13 +686,13 @@ Object Interpreter::eval_define(const Object& form,
  */
 Object Interpreter::eval_set(const Object& form,
                              const Object& rest,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   auto args = get_args(form, rest, make_varargs());
   vararg_check(form, args, {ObjectType::SYMBOL, {}}, {});
   auto to_define = args.unnamed.at(0);
   Object to_set = eval_with_rewind(args.unnamed.at(1), env);
 
-  std::shared_ptr<EnvironmentObject> search_env = env;
+  HeapPtr<EnvironmentObject> search_env = env;
   for (;;) {
     auto kv = search_env->vars.find(to_define.as_symbol());
     if (kv != search_env->vars.end()) {
@@ -707,7 +714,7 @@ Object Interpreter::eval_set(const Object& form,
  */
 Object Interpreter::eval_lambda(const Object& form,
                                 const Object& rest,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   if (!rest.is_pair()) {
     throw_eval_error(form, "lambda must receive two arguments");
   }
@@ -736,7 +743,7 @@ Object Interpreter::eval_lambda(const Object& form,
  */
 Object Interpreter::eval_macro(const Object& form,
                                const Object& rest,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   if (!rest.is_pair()) {
     throw_eval_error(form, "macro must receive two arguments");
   }
@@ -765,7 +772,7 @@ Object Interpreter::eval_macro(const Object& form,
  */
 Object Interpreter::eval_quote(const Object& form,
                                const Object& rest,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   auto args = get_args(form, rest, make_varargs());
   vararg_check(form, args, {{}}, {});
@@ -776,7 +783,7 @@ Object Interpreter::eval_quote(const Object& form,
  * Recursive quasi-quote evaluation
  */
 Object Interpreter::quasiquote_helper(const Object& form,
-                                      const std::shared_ptr<EnvironmentObject>& env) {
+                                      const HeapPtr<EnvironmentObject>& env) {
   Object lst = form;
   std::vector<Object> result;
   for (;;) {
@@ -835,22 +842,18 @@ Object Interpreter::quasiquote_helper(const Object& form,
  */
 Object Interpreter::eval_quasiquote(const Object& form,
                                     const Object& rest,
-                                    const std::shared_ptr<EnvironmentObject>& env) {
+                                    const HeapPtr<EnvironmentObject>& env) {
   if (rest.type != ObjectType::PAIR || rest.as_pair()->cdr.type != ObjectType::EMPTY_LIST)
     throw_eval_error(form, "quasiquote must have one argument!");
   return quasiquote_helper(rest.as_pair()->car, env);
 }
 
-bool Interpreter::truthy(const Object& o) {
-  return !(o.is_symbol() && o.as_symbol()->name == "#f");
-}
-
 /*!
  * Scheme "cond" statement - tested by integrated tests only.
  */
 Object Interpreter::eval_cond(const Object& form,
                               const Object& rest,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   if (rest.type != ObjectType::PAIR)
     throw_eval_error(form, "cond must have at least one clause, which must be a form");
   Object result;
@@ -875,7 +878,7 @@ Object Interpreter::eval_cond(const Object& form,
         lst = lst.as_pair()->cdr;
       }
     } else if (lst.type == ObjectType::EMPTY_LIST) {
-      return SymbolObject::make_new(reader.symbolTable, "#f");
+      return bool_to_symbol(false);
     } else {
       throw_eval_error(form, "malformed cond");
     }
@@ -887,7 +890,7 @@ Object Interpreter::eval_cond(const Object& form,
  */
 Object Interpreter::eval_or(const Object& form,
                             const Object& rest,
-                            const std::shared_ptr<EnvironmentObject>& env) {
+                            const HeapPtr<EnvironmentObject>& env) {
   if (rest.type != ObjectType::PAIR) {
     throw_eval_error(form, "or must have at least one argument!");
   }
@@ -901,7 +904,7 @@ Object Interpreter::eval_or(const Object& form,
       }
       lst = lst.as_pair()->cdr;
     } else if (lst.type == ObjectType::EMPTY_LIST) {
-      return SymbolObject::make_new(reader.symbolTable, "#f");
+      return bool_to_symbol(false);
     } else {
       throw_eval_error(form, "invalid or form");
     }
@@ -913,7 +916,7 @@ Object Interpreter::eval_or(const Object& form,
  */
 Object Interpreter::eval_and(const Object& form,
                              const Object& rest,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   if (rest.type != ObjectType::PAIR) {
     throw_eval_error(form, "and must have at least one argument!");
   }
@@ -924,7 +927,7 @@ Object Interpreter::eval_and(const Object& form,
     if (lst.type == ObjectType::PAIR) {
       current = eval_with_rewind(lst.as_pair()->car, env);
       if (!truthy(current)) {
-        return SymbolObject::make_new(reader.symbolTable, "#f");
+        return bool_to_symbol(false);
       }
       lst = lst.as_pair()->cdr;
     } else if (lst.type == ObjectType::EMPTY_LIST) {
@@ -940,7 +943,7 @@ Object Interpreter::eval_and(const Object& form,
  */
 Object Interpreter::eval_while(const Object& form,
                                const Object& rest,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   if (rest.type != ObjectType::PAIR) {
     throw_eval_error(form, "while must have condition and body");
   }
@@ -951,7 +954,7 @@ Object Interpreter::eval_while(const Object& form,
     throw_eval_error(form, "while must have condition and body");
   }
 
-  Object rv = SymbolObject::make_new(reader.symbolTable, "#f");
+  Object rv = bool_to_symbol(false);
   while (truthy(eval_with_rewind(condition, env))) {
     rv = eval_list_return_last(form, body, env);
   }
@@ -964,7 +967,7 @@ Object Interpreter::eval_while(const Object& form,
  */
 Object Interpreter::eval_exit(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)form;
   (void)args;
   (void)env;
@@ -977,7 +980,7 @@ Object Interpreter::eval_exit(const Object& form,
  */
 Object Interpreter::eval_begin(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   if (!args.named.empty()) {
     throw_eval_error(form, "begin form cannot have keyword arguments");
@@ -995,7 +998,7 @@ Object Interpreter::eval_begin(const Object& form,
  */
 Object Interpreter::eval_read(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
 
@@ -1013,7 +1016,7 @@ Object Interpreter::eval_read(const Object& form,
  */
 Object Interpreter::eval_read_data_file(const Object& form,
                                         Arguments& args,
-                                        const std::shared_ptr<EnvironmentObject>& env) {
+                                        const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
 
@@ -1030,7 +1033,7 @@ Object Interpreter::eval_read_data_file(const Object& form,
  */
 Object Interpreter::eval_read_file(const Object& form,
                                    Arguments& args,
-                                   const std::shared_ptr<EnvironmentObject>& env) {
+                                   const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
 
@@ -1047,7 +1050,7 @@ Object Interpreter::eval_read_file(const Object& form,
  */
 Object Interpreter::eval_load_file(const Object& form,
                                    Arguments& args,
-                                   const std::shared_ptr<EnvironmentObject>& env) {
+                                   const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
 
@@ -1071,13 +1074,13 @@ Object Interpreter::eval_load_file(const Object& form,
  */
 Object Interpreter::eval_try_load_file(const Object& form,
                                        Arguments& args,
-                                       const std::shared_ptr<EnvironmentObject>& env) {
+                                       const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
 
   auto path = {args.unnamed.at(0).as_string()->data};
   if (!fs::exists(file_util::get_file_path(path))) {
-    return SymbolObject::make_new(reader.symbolTable, "#f");
+    return bool_to_symbol(false);
   }
 
   Object o;
@@ -1092,7 +1095,7 @@ Object Interpreter::eval_try_load_file(const Object& form,
   } catch (std::runtime_error& e) {
     throw_eval_error(form, std::string("eval error inside of try-load-file:\n") + e.what());
   }
-  return SymbolObject::make_new(reader.symbolTable, "#t");
+  return bool_to_symbol(true);
 }
 
 /*!
@@ -1101,7 +1104,7 @@ Object Interpreter::eval_try_load_file(const Object& form,
  */
 Object Interpreter::eval_print(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}}, {});
 
@@ -1117,7 +1120,7 @@ Object Interpreter::eval_print(const Object& form,
  */
 Object Interpreter::eval_inspect(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>& env) {
+                                 const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}}, {});
 
@@ -1133,11 +1136,10 @@ Object Interpreter::eval_inspect(const Object& form,
  */
 Object Interpreter::eval_equals(const Object& form,
                                 Arguments& args,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}, {}}, {});
-  return SymbolObject::make_new(reader.symbolTable,
-                                args.unnamed[0] == args.unnamed[1] ? "#t" : "#f");
+  return bool_to_symbol(args.unnamed[0] == args.unnamed[1]);
 }
 
 /*!
@@ -1194,7 +1196,7 @@ IntType Interpreter::number(const Object& obj) {
 template <typename T>
 Object Interpreter::num_plus(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   (void)form;
   T result = 0;
@@ -1209,7 +1211,7 @@ Object Interpreter::num_plus(const Object& form,
  */
 Object Interpreter::eval_plus(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   if (!args.named.empty() || args.unnamed.empty()) {
     throw_eval_error(form, "+ must receive at least one unnamed argument!");
   }
@@ -1233,7 +1235,7 @@ Object Interpreter::eval_plus(const Object& form,
 template <typename T>
 Object Interpreter::num_times(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   (void)form;
   T result = 1;
@@ -1248,7 +1250,7 @@ Object Interpreter::num_times(const Object& form,
  */
 Object Interpreter::eval_times(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   if (!args.named.empty() || args.unnamed.empty()) {
     throw_eval_error(form, "* must receive at least one unnamed argument!");
   }
@@ -1272,7 +1274,7 @@ Object Interpreter::eval_times(const Object& form,
 template <typename T>
 Object Interpreter::num_minus(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   (void)form;
   T result;
@@ -1292,7 +1294,7 @@ Object Interpreter::num_minus(const Object& form,
  */
 Object Interpreter::eval_minus(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   if (!args.named.empty() || args.unnamed.empty()) {
     throw_eval_error(form, "- must receive at least one unnamed argument!");
   }
@@ -1316,7 +1318,7 @@ Object Interpreter::eval_minus(const Object& form,
 template <typename T>
 Object Interpreter::num_divide(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   (void)form;
   T result = number<T>(args.unnamed[0]) / number<T>(args.unnamed[1]);
@@ -1328,7 +1330,7 @@ Object Interpreter::num_divide(const Object& form,
  */
 Object Interpreter::eval_divide(const Object& form,
                                 Arguments& args,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}, {}}, {});
   switch (args.unnamed.front().type) {
     case ObjectType::INTEGER:
@@ -1348,7 +1350,7 @@ Object Interpreter::eval_divide(const Object& form,
  */
 Object Interpreter::eval_numequals(const Object& form,
                                    Arguments& args,
-                                   const std::shared_ptr<EnvironmentObject>& env) {
+                                   const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   if (!args.named.empty() || args.unnamed.size() < 2) {
     throw_eval_error(form, "= must receive at least two unnamed arguments!");
@@ -1381,23 +1383,23 @@ Object Interpreter::eval_numequals(const Object& form,
       return Object::make_empty_list();
   }
 
-  return SymbolObject::make_new(reader.symbolTable, result ? "#t" : "#f");
+  return bool_to_symbol(result);
 }
 
 template <typename T>
 Object Interpreter::num_lt(const Object& form,
                            Arguments& args,
-                           const std::shared_ptr<EnvironmentObject>& env) {
+                           const HeapPtr<EnvironmentObject>& env) {
   (void)form;
   (void)env;
   T a = number<T>(args.unnamed[0]);
   T b = number<T>(args.unnamed[1]);
-  return SymbolObject::make_new(reader.symbolTable, (a < b) ? "#t" : "#f");
+  return bool_to_symbol(a < b);
 }
 
 Object Interpreter::eval_lt(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env) {
+                            const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}, {}}, {});
   switch (args.unnamed.front().type) {
     case ObjectType::INTEGER:
@@ -1415,17 +1417,17 @@ Object Interpreter::eval_lt(const Object& form,
 template <typename T>
 Object Interpreter::num_gt(const Object& form,
                            Arguments& args,
-                           const std::shared_ptr<EnvironmentObject>& env) {
+                           const HeapPtr<EnvironmentObject>& env) {
   (void)form;
   (void)env;
   T a = number<T>(args.unnamed[0]);
   T b = number<T>(args.unnamed[1]);
-  return SymbolObject::make_new(reader.symbolTable, (a > b) ? "#t" : "#f");
+  return bool_to_symbol(a > b);
 }
 
 Object Interpreter::eval_gt(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env) {
+                            const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}, {}}, {});
   switch (args.unnamed.front().type) {
     case ObjectType::INTEGER:
@@ -1443,17 +1445,17 @@ Object Interpreter::eval_gt(const Object& form,
 template <typename T>
 Object Interpreter::num_leq(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env) {
+                            const HeapPtr<EnvironmentObject>& env) {
   (void)form;
   (void)env;
   T a = number<T>(args.unnamed[0]);
   T b = number<T>(args.unnamed[1]);
-  return SymbolObject::make_new(reader.symbolTable, (a <= b) ? "#t" : "#f");
+  return bool_to_symbol(a <= b);
 }
 
 Object Interpreter::eval_leq(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}, {}}, {});
   switch (args.unnamed.front().type) {
     case ObjectType::INTEGER:
@@ -1471,17 +1473,17 @@ Object Interpreter::eval_leq(const Object& form,
 template <typename T>
 Object Interpreter::num_geq(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env) {
+                            const HeapPtr<EnvironmentObject>& env) {
   (void)form;
   (void)env;
   T a = number<T>(args.unnamed[0]);
   T b = number<T>(args.unnamed[1]);
-  return SymbolObject::make_new(reader.symbolTable, (a >= b) ? "#t" : "#f");
+  return bool_to_symbol(a >= b);
 }
 
 Object Interpreter::eval_geq(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}, {}}, {});
   switch (args.unnamed.front().type) {
     case ObjectType::INTEGER:
@@ -1498,14 +1500,14 @@ Object Interpreter::eval_geq(const Object& form,
 
 Object Interpreter::eval_eval(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   vararg_check(form, args, {{}}, {});
   return eval(args.unnamed[0], env);
 }
 
 Object Interpreter::eval_car(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::PAIR}, {});
   return args.unnamed[0].as_pair()->car;
@@ -1513,7 +1515,7 @@ Object Interpreter::eval_car(const Object& form,
 
 Object Interpreter::eval_set_car(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>& env) {
+                                 const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::PAIR, {}}, {});
   args.unnamed[0].as_pair()->car = args.unnamed[1];
@@ -1522,7 +1524,7 @@ Object Interpreter::eval_set_car(const Object& form,
 
 Object Interpreter::eval_set_cdr(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>& env) {
+                                 const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::PAIR, {}}, {});
   args.unnamed[0].as_pair()->cdr = args.unnamed[1];
@@ -1531,7 +1533,7 @@ Object Interpreter::eval_set_cdr(const Object& form,
 
 Object Interpreter::eval_cdr(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::PAIR}, {});
   return args.unnamed[0].as_pair()->cdr;
@@ -1539,7 +1541,7 @@ Object Interpreter::eval_cdr(const Object& form,
 
 Object Interpreter::eval_gensym(const Object& form,
                                 Arguments& args,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {}, {});
   return SymbolObject::make_new(reader.symbolTable, "gensym" + std::to_string(gensym_id++));
@@ -1547,7 +1549,7 @@ Object Interpreter::eval_gensym(const Object& form,
 
 Object Interpreter::eval_cons(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}, {}}, {});
   return PairObject::make_new(args.unnamed[0], args.unnamed[1]);
@@ -1555,15 +1557,15 @@ Object Interpreter::eval_cons(const Object& form,
 
 Object Interpreter::eval_null(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}}, {});
-  return SymbolObject::make_new(reader.symbolTable, args.unnamed[0].is_empty_list() ? "#t" : "#f");
+  return bool_to_symbol(args.unnamed[0].is_empty_list());
 }
 
 Object Interpreter::eval_type(const Object& form,
                               Arguments& args,
-                              const std::shared_ptr<EnvironmentObject>& env) {
+                              const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{ObjectType::SYMBOL}, {}}, {});
 
@@ -1573,15 +1575,15 @@ Object Interpreter::eval_type(const Object& form,
   }
 
   if (args.unnamed[1].type == kv->second) {
-    return SymbolObject::make_new(reader.symbolTable, "#t");
+    return bool_to_symbol(true);
   } else {
-    return SymbolObject::make_new(reader.symbolTable, "#f");
+    return bool_to_symbol(false);
   }
 }
 
 Object Interpreter::eval_format(const Object& form,
                                 Arguments& args,
-                                const std::shared_ptr<EnvironmentObject>& env) {
+                                const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   if (args.unnamed.size() < 2) {
     throw_eval_error(form, "format must get at least two arguments");
@@ -1622,7 +1624,7 @@ Object Interpreter::eval_format(const Object& form,
 
 Object Interpreter::eval_error(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env) {
+                               const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
   throw_eval_error(form, "Error: " + args.unnamed.at(0).as_string()->data);
@@ -1631,7 +1633,7 @@ Object Interpreter::eval_error(const Object& form,
 
 Object Interpreter::eval_string_ref(const Object& form,
                                     Arguments& args,
-                                    const std::shared_ptr<EnvironmentObject>& env) {
+                                    const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING, ObjectType::INTEGER}, {});
   auto str = args.unnamed.at(0).as_string();
@@ -1645,7 +1647,7 @@ Object Interpreter::eval_string_ref(const Object& form,
 
 Object Interpreter::eval_string_length(const Object& form,
                                        Arguments& args,
-                                       const std::shared_ptr<EnvironmentObject>& env) {
+                                       const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING}, {});
   auto str = args.unnamed.at(0).as_string();
@@ -1654,7 +1656,7 @@ Object Interpreter::eval_string_length(const Object& form,
 
 Object Interpreter::eval_string_append(const Object& form,
                                        Arguments& args,
-                                       const std::shared_ptr<EnvironmentObject>& env) {
+                                       const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   if (!args.named.empty()) {
     throw_eval_error(form, "string-append does not accept named arguments");
@@ -1673,35 +1675,35 @@ Object Interpreter::eval_string_append(const Object& form,
 
 Object Interpreter::eval_string_starts_with(const Object& form,
                                             Arguments& args,
-                                            const std::shared_ptr<EnvironmentObject>& env) {
+                                            const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING, ObjectType::STRING}, {});
   auto& str = args.unnamed.at(0).as_string()->data;
   auto& suffix = args.unnamed.at(1).as_string()->data;
 
   if (str_util::starts_with(str, suffix)) {
-    return SymbolObject::make_new(reader.symbolTable, "#t");
+    return bool_to_symbol(true);
   }
-  return SymbolObject::make_new(reader.symbolTable, "#f");
+  return bool_to_symbol(false);
 }
 
 Object Interpreter::eval_string_ends_with(const Object& form,
                                           Arguments& args,
-                                          const std::shared_ptr<EnvironmentObject>& env) {
+                                          const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING, ObjectType::STRING}, {});
   auto& str = args.unnamed.at(0).as_string()->data;
   auto& suffix = args.unnamed.at(1).as_string()->data;
 
   if (str_util::ends_with(str, suffix)) {
-    return SymbolObject::make_new(reader.symbolTable, "#t");
+    return bool_to_symbol(true);
   }
-  return SymbolObject::make_new(reader.symbolTable, "#f");
+  return bool_to_symbol(false);
 }
 
 Object Interpreter::eval_string_split(const Object& form,
                                       Arguments& args,
-                                      const std::shared_ptr<EnvironmentObject>& env) {
+                                      const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {ObjectType::STRING, ObjectType::STRING}, {});
   auto& str = args.unnamed.at(0).as_string()->data;
@@ -1712,7 +1714,7 @@ Object Interpreter::eval_string_split(const Object& form,
 
 Object Interpreter::eval_ash(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env) {
+                             const HeapPtr<EnvironmentObject>& env) {
   (void)env;
   vararg_check(form, args, {{}, {}}, {});
   auto val = number_to_integer(args.unnamed.at(0));
@@ -1729,21 +1731,21 @@ Object Interpreter::eval_ash(const Object& form,
 
 Object Interpreter::eval_symbol_to_string(const Object& form,
                                           Arguments& args,
-                                          const std::shared_ptr<EnvironmentObject>&) {
+                                          const HeapPtr<EnvironmentObject>&) {
   vararg_check(form, args, {ObjectType::SYMBOL}, {});
   return StringObject::make_new(args.unnamed.at(0).as_symbol()->name);
 }
 
 Object Interpreter::eval_string_to_symbol(const Object& form,
                                           Arguments& args,
-                                          const std::shared_ptr<EnvironmentObject>&) {
+                                          const HeapPtr<EnvironmentObject>&) {
   vararg_check(form, args, {ObjectType::STRING}, {});
   return SymbolObject::make_new(reader.symbolTable, args.unnamed.at(0).as_string()->data);
 }
 
 Object Interpreter::eval_get_env(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>&) {
+                                 const HeapPtr<EnvironmentObject>&) {
   vararg_check(form, args, {ObjectType::STRING}, {{"default", {false, ObjectType::STRING}}});
   const std::string var_name = args.unnamed.at(0).as_string()->data;
   auto env_p = get_env(var_name);
@@ -1763,7 +1765,7 @@ Object Interpreter::eval_get_env(const Object& form,
  */
 Object Interpreter::eval_make_string_hash_table(const Object& form,
                                                 Arguments& args,
-                                                const std::shared_ptr<EnvironmentObject>& /*env*/) {
+                                                const HeapPtr<EnvironmentObject>& /*env*/) {
   vararg_check(form, args, {}, {});
   return StringHashTableObject::make_new();
 }
@@ -1774,7 +1776,7 @@ Object Interpreter::eval_make_string_hash_table(const Object& form,
  */
 Object Interpreter::eval_hash_table_set(const Object& form,
                                         Arguments& args,
-                                        const std::shared_ptr<EnvironmentObject>& /*env*/) {
+                                        const HeapPtr<EnvironmentObject>& /*env*/) {
   vararg_check(form, args, {ObjectType::STRING_HASH_TABLE, ObjectType::STRING, {}}, {});
   args.unnamed.at(0).as_string_hash_table()->data[args.unnamed.at(1).as_string()->data] =
       args.unnamed.at(2);
@@ -1786,16 +1788,15 @@ Object Interpreter::eval_hash_table_set(const Object& form,
  */
 Object Interpreter::eval_hash_table_try_ref(const Object& form,
                                             Arguments& args,
-                                            const std::shared_ptr<EnvironmentObject>& /*env*/) {
+                                            const HeapPtr<EnvironmentObject>& /*env*/) {
   vararg_check(form, args, {ObjectType::STRING_HASH_TABLE, ObjectType::STRING}, {});
   const auto* table = args.unnamed.at(0).as_string_hash_table();
   const auto& it = table->data.find(args.unnamed.at(1).as_string()->data);
   if (it == table->data.end()) {
     // not in table
-    return PairObject::make_new(SymbolObject::make_new(reader.symbolTable, "#f"),
-                                Object::make_empty_list());
+    return PairObject::make_new(bool_to_symbol(false), Object::make_empty_list());
   } else {
-    return PairObject::make_new(SymbolObject::make_new(reader.symbolTable, "#t"), it->second);
+    return PairObject::make_new(bool_to_symbol(true), it->second);
   }
 }
 }  // namespace goos
@@ -5,6 +5,7 @@
  * The GOOS Interpreter and implementation of special and "built-in forms"
  */
 
+#include <functional>
 #include <memory>
 #include <optional>
 
@@ -12,39 +13,44 @@
 #include "Reader.h"
 
 namespace goos {
+class ObjectSerializer;
+
 class Interpreter {
  public:
   Interpreter(const std::string& user_profile = "#f");
   ~Interpreter();
   void execute_repl(REPL::Wrapper& repl);
   void throw_eval_error(const Object& o, const std::string& err);
-  Object eval_with_rewind(const Object& obj, const std::shared_ptr<EnvironmentObject>& env);
+  Object eval_with_rewind(const Object& obj, const HeapPtr<EnvironmentObject>& env);
   bool get_global_variable_by_name(const std::string& name, Object* dest);
   void set_global_variable_by_name(const std::string& name, const Object& value);
   void set_global_variable_to_symbol(const std::string& name, const std::string& value);
-  Object eval(Object obj, const std::shared_ptr<EnvironmentObject>& env);
+  Object eval(Object obj, const HeapPtr<EnvironmentObject>& env);
   Object intern(const std::string& name);
   HeapObject* intern_ptr(const std::string& name);
   void disable_printfs();
-  Object eval_symbol(const Object& sym, const std::shared_ptr<EnvironmentObject>& env);
+  Object eval_symbol(const Object& sym, const HeapPtr<EnvironmentObject>& env);
   bool eval_symbol(const Object& sym,
-                   const std::shared_ptr<EnvironmentObject>& env,
+                   const HeapPtr<EnvironmentObject>& env,
                    Object* result);
   Arguments get_args(const Object& form, const Object& rest, const ArgumentSpec& spec);
-  void set_args_in_env(const Object& form,
-                       const Arguments& args,
-                       const ArgumentSpec& arg_spec,
-                       const std::shared_ptr<EnvironmentObject>& env);
   Object eval_list_return_last(const Object& form,
                                Object rest,
-                               const std::shared_ptr<EnvironmentObject>& env);
-  bool truthy(const Object& o);
+                               const HeapPtr<EnvironmentObject>& env);
+  Object expand_macro(const Object& form,
+                      const Object& macro_obj,
+                      const Object& rest,
+                      const HeapPtr<EnvironmentObject>& env);
+  bool truthy(const Object& o) const { return !(o.is_symbol() && o.as_symbol() == m_false_sym); }
+  // the symbol #t or #f
+  const Object& bool_to_symbol(bool value) const { return value ? m_true : m_false; }
 
   void register_form(
       const std::string& name,
       const std::function<
-          Object(const Object&, Arguments&, const std::shared_ptr<EnvironmentObject>&)>& form);
-  void eval_args(Arguments* args, const std::shared_ptr<EnvironmentObject>& env);
+          Object(const Object&, Arguments&, const HeapPtr<EnvironmentObject>&)>& form);
+  void eval_args(Arguments* args, const HeapPtr<EnvironmentObject>& env);
+  void serialize_environments(ObjectSerializer& ser);
 
   Reader reader;
   Object global_environment;
@@ -61,13 +67,18 @@ class Interpreter {
       const std::vector<std::optional<ObjectType>>& unnamed,
       const std::unordered_map<std::string, std::pair<bool, std::optional<ObjectType>>>& named);
 
-  Object eval_pair(const Object& o, const std::shared_ptr<EnvironmentObject>& env);
+  Object eval_pair(const Object& o, const HeapPtr<EnvironmentObject>& env);
+  bool try_symbol_lookup(const Object& sym,
+                         const HeapPtr<EnvironmentObject>& env,
+                         Object* dest) const;
+  void print_eval_error_location(const Object& obj);
+  void check_arg_count(const Object& form, const Arguments& args, const ArgumentSpec& arg_spec);
 
  public:
   ArgumentSpec parse_arg_spec(const Object& form, Object& rest);
 
  private:
-  Object quasiquote_helper(const Object& form, const std::shared_ptr<EnvironmentObject>& env);
+  Object quasiquote_helper(const Object& form, const HeapPtr<EnvironmentObject>& env);
 
   IntType number_to_integer(const Object& obj);
   FloatType number_to_float(const Object& obj);
@@ -76,215 +87,257 @@ class Interpreter {
   T number(const Object& obj);
 
   template <typename T>
-  Object num_lt(const Object& form, Arguments& args, const std::shared_ptr<EnvironmentObject>& env);
+  Object num_lt(const Object& form, Arguments& args, const HeapPtr<EnvironmentObject>& env);
   template <typename T>
-  Object num_gt(const Object& form, Arguments& args, const std::shared_ptr<EnvironmentObject>& env);
+  Object num_gt(const Object& form, Arguments& args, const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_leq(const Object& form,
                  Arguments& args,
-                 const std::shared_ptr<EnvironmentObject>& env);
+                 const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_geq(const Object& form,
                  Arguments& args,
-                 const std::shared_ptr<EnvironmentObject>& env);
+                 const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_plus(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_minus(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_divide(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   template <typename T>
   Object num_times(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
 
   Object eval_eval(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_equals(const Object& form,
                      Arguments& args,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_exit(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_begin(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_read(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_read_data_file(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env);
+                             const HeapPtr<EnvironmentObject>& env);
   Object eval_read_file(const Object& form,
                         Arguments& args,
-                        const std::shared_ptr<EnvironmentObject>& env);
+                        const HeapPtr<EnvironmentObject>& env);
   Object eval_load_file(const Object& form,
                         Arguments& args,
-                        const std::shared_ptr<EnvironmentObject>& env);
+                        const HeapPtr<EnvironmentObject>& env);
   Object eval_try_load_file(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env);
+                            const HeapPtr<EnvironmentObject>& env);
   Object eval_print(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_inspect(const Object& form,
                       Arguments& args,
-                      const std::shared_ptr<EnvironmentObject>& env);
+                      const HeapPtr<EnvironmentObject>& env);
   Object eval_plus(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_minus(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_times(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_divide(const Object& form,
                      Arguments& args,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_numequals(const Object& form,
                         Arguments& args,
-                        const std::shared_ptr<EnvironmentObject>& env);
+                        const HeapPtr<EnvironmentObject>& env);
   Object eval_lt(const Object& form,
                  Arguments& args,
-                 const std::shared_ptr<EnvironmentObject>& env);
+                 const HeapPtr<EnvironmentObject>& env);
   Object eval_gt(const Object& form,
                  Arguments& args,
-                 const std::shared_ptr<EnvironmentObject>& env);
+                 const HeapPtr<EnvironmentObject>& env);
   Object eval_leq(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_geq(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_car(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_cdr(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_set_car(const Object& form,
                       Arguments& args,
-                      const std::shared_ptr<EnvironmentObject>& env);
+                      const HeapPtr<EnvironmentObject>& env);
   Object eval_set_cdr(const Object& form,
                       Arguments& args,
-                      const std::shared_ptr<EnvironmentObject>& env);
+                      const HeapPtr<EnvironmentObject>& env);
   Object eval_gensym(const Object& form,
                      Arguments& args,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_cons(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_null(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_type(const Object& form,
                    Arguments& args,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_format(const Object& form,
                      Arguments& args,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_error(const Object& form,
                     Arguments& args,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_string_ref(const Object& form,
                          Arguments& args,
-                         const std::shared_ptr<EnvironmentObject>& env);
+                         const HeapPtr<EnvironmentObject>& env);
   Object eval_string_length(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env);
+                            const HeapPtr<EnvironmentObject>& env);
   Object eval_string_append(const Object& form,
                             Arguments& args,
-                            const std::shared_ptr<EnvironmentObject>& env);
+                            const HeapPtr<EnvironmentObject>& env);
   Object eval_string_starts_with(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>& env);
+                                 const HeapPtr<EnvironmentObject>& env);
   Object eval_string_ends_with(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env);
+                               const HeapPtr<EnvironmentObject>& env);
   Object eval_string_split(const Object& form,
                            Arguments& args,
-                           const std::shared_ptr<EnvironmentObject>& env);
+                           const HeapPtr<EnvironmentObject>& env);
   Object eval_ash(const Object& form,
                   Arguments& args,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_symbol_to_string(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env);
+                               const HeapPtr<EnvironmentObject>& env);
   Object eval_string_to_symbol(const Object& form,
                                Arguments& args,
-                               const std::shared_ptr<EnvironmentObject>& env);
+                               const HeapPtr<EnvironmentObject>& env);
   Object eval_get_env(const Object& form,
                       Arguments& args,
-                      const std::shared_ptr<EnvironmentObject>& env);
+                      const HeapPtr<EnvironmentObject>& env);
 
   // specials
   Object eval_define(const Object& form,
                      const Object& rest,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_quote(const Object& form,
                     const Object& rest,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_set(const Object& form,
                   const Object& rest,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_lambda(const Object& form,
                      const Object& rest,
-                     const std::shared_ptr<EnvironmentObject>& env);
+                     const HeapPtr<EnvironmentObject>& env);
   Object eval_cond(const Object& form,
                    const Object& rest,
-                   const std::shared_ptr<EnvironmentObject>& env);
+                   const HeapPtr<EnvironmentObject>& env);
   Object eval_or(const Object& form,
                  const Object& rest,
-                 const std::shared_ptr<EnvironmentObject>& env);
+                 const HeapPtr<EnvironmentObject>& env);
   Object eval_and(const Object& form,
                   const Object& rest,
-                  const std::shared_ptr<EnvironmentObject>& env);
+                  const HeapPtr<EnvironmentObject>& env);
   Object eval_quasiquote(const Object& form,
                          const Object& rest,
-                         const std::shared_ptr<EnvironmentObject>& env);
+                         const HeapPtr<EnvironmentObject>& env);
   Object eval_macro(const Object& form,
                     const Object& rest,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
   Object eval_while(const Object& form,
                     const Object& rest,
-                    const std::shared_ptr<EnvironmentObject>& env);
+                    const HeapPtr<EnvironmentObject>& env);
 
   Object eval_make_string_hash_table(const Object& form,
                                      Arguments& args,
-                                     const std::shared_ptr<EnvironmentObject>& env);
+                                     const HeapPtr<EnvironmentObject>& env);
   Object eval_hash_table_try_ref(const Object& form,
                                  Arguments& args,
-                                 const std::shared_ptr<EnvironmentObject>& env);
+                                 const HeapPtr<EnvironmentObject>& env);
   Object eval_hash_table_set(const Object& form,
                              Arguments& args,
-                             const std::shared_ptr<EnvironmentObject>& env);
+                             const HeapPtr<EnvironmentObject>& env);
 
   bool want_exit = false;
   bool disable_printing = false;
 
-  std::unordered_map<std::string,
-                     Object (Interpreter::*)(const Object& form,
-                                             Arguments& args,
-                                             const std::shared_ptr<EnvironmentObject>& env)>
-      builtin_forms;
+  using SpecialForm = Object (Interpreter::*)(const Object& form,
+                                              const Object& rest,
+                                              const HeapPtr<EnvironmentObject>& env);
+  using BuiltinForm = Object (Interpreter::*)(const Object& form,
+                                              Arguments& args,
+                                              const HeapPtr<EnvironmentObject>& env);
+  using CustomForm =
+      std::function<Object(const Object&, Arguments&, const HeapPtr<EnvironmentObject>&)>;
+
+  // The forms named by a symbol. If a name has more than one kind of form, special forms are used
+  // first, then builtins, then custom forms.
+  struct Forms {
+    SpecialForm special = nullptr;
+    BuiltinForm builtin = nullptr;
+    CustomForm custom;
+  };
+
+  // forms are found by the symbol object in the form, so evaluating doesn't hash or compare names.
+  std::unordered_map<const HeapObject*, Forms> m_forms;
+
+  // the symbols #t and #f
+  HeapObject* m_true_sym = nullptr;
+  HeapObject* m_false_sym = nullptr;
+  Object m_true;
+  Object m_false;
+  // increased when a custom form is registered, so compiled code can look for new forms.
+  int m_custom_forms_version = 0;
+
+  // Compiling the bodies of lambdas and macros, see CodeCompiler.cpp
+  using CompiledCode = std::function<Object(const HeapPtr<EnvironmentObject>& env)>;
+  Object call_lambda(const Object& form, LambdaObject* lambda, const Arguments& args);
+  Object call_body(const Object& form,
+                   const Arguments& args,
+                   const ArgumentSpec& arg_spec,
+                   const Object& body,
+                   std::shared_ptr<CompiledBody>* compiled,
+                   const HeapPtr<EnvironmentObject>& parent_env);
+  std::shared_ptr<CompiledBody> compile_body(const ArgumentSpec& arg_spec, const Object& body);
+  template <typename F>
+  CompiledCode with_rewind(const Object& form, F&& code);
+  CompiledCode compile(const Object& form);
+  CompiledCode compile_fallback(const Object& form);
+  CompiledCode compile_pair(const Object& form);
+  CompiledCode compile_call(const Object& form);
+  CompiledCode compile_builtin(const Object& form, BuiltinForm builtin);
+  CompiledCode compile_special(const Object& form, SpecialForm special);
+  std::optional<std::vector<CompiledCode>> compile_list(const Object& list);
+  std::optional<CompiledCode> compile_quote(const Object& form);
+  std::optional<CompiledCode> compile_quasiquote(const Object& form);
+  std::optional<CompiledCode> compile_quasiquote_list(const Object& list);
+  std::optional<CompiledCode> compile_cond(const Object& form);
+  std::optional<CompiledCode> compile_or_and(const Object& form, bool is_or);
+  std::optional<CompiledCode> compile_while(const Object& form);
+  std::optional<CompiledCode> compile_define(const Object& form);
+  std::optional<CompiledCode> compile_set(const Object& form);
+  std::optional<CompiledCode> compile_lambda(const Object& form, bool is_macro);
 
-  std::unordered_map<
-      std::string,
-      std::function<Object(const Object&, Arguments&, const std::shared_ptr<EnvironmentObject>&)>>
-      m_custom_forms;
-  std::unordered_map<std::string,
-                     Object (Interpreter::*)(const Object& form,
-                                             const Object& rest,
-                                             const std::shared_ptr<EnvironmentObject>& env)>
-      special_forms;
   int64_t gensym_id = 0;
 
   std::unordered_map<std::string, ObjectType> string_to_type;
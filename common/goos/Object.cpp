@@ -4,8 +4,7 @@
  * There are different types of objects, as represented by ObjectType.
  * An "Object" is an efficient wrapper around any of these types.
  * Some types are "heap allocated", and have reference semantics, and others are
- * "fixed" and have value semantics.  Heap allocated objects implement reference counting with
- * std::shared_ptr.
+ * "fixed" and have value semantics.  Heap allocated objects are reference counted with HeapPtr.
  *
  * To create a new Object for a heap allocated type, use the make_new static method of the type of
  * object you want to make. This will return a correctly setup Object. For fixed objects, use
@@ -41,6 +40,7 @@
 #include "Object.h"
 
 #include <cinttypes>
+#include <mutex>
 
 #include "common/util/FileUtil.h"
 #include "common/util/print_float.h"
@@ -136,6 +136,86 @@ std::string fixed_to_string(char x) {
   return {buff};
 }
 
+namespace {
+/*!
+ * Memory for PairObjects. Reading code and expanding macros allocate and free millions of pairs,
+ * so freed pairs are kept on a free list for each thread and reused. New pairs come from large
+ * chunks, so the pairs of a list that was read together are next to each other in memory.
+ *
+ * The memory is never returned to the system. When a thread exits, its free list is moved to a
+ * shared list, where other threads can take it.
+ */
+union PairBlock {
+  PairBlock* next;
+  alignas(PairObject) char data[sizeof(PairObject)];
+};
+
+constexpr int PAIRS_PER_CHUNK = 4096;
+
+std::mutex g_shared_pairs_mutex;
+PairBlock* g_shared_free_pairs = nullptr;
+
+// a plain pointer, so pairs can still be freed while the thread's objects are destroyed.
+thread_local PairBlock* t_free_pairs = nullptr;
+
+/*!
+ * Moves the free pairs of a thread to the shared list when the thread exits.
+ */
+struct PairFreeListOwner {
+  ~PairFreeListOwner() {
+    if (!t_free_pairs) {
+      return;
+    }
+    PairBlock* last = t_free_pairs;
+    while (last->next) {
+      last = last->next;
+    }
+    std::lock_guard<std::mutex> lock(g_shared_pairs_mutex);
+    last->next = g_shared_free_pairs;
+    g_shared_free_pairs = t_free_pairs;
+    t_free_pairs = nullptr;
+  }
+};
+
+thread_local PairFreeListOwner t_pair_free_list_owner;
+
+void refill_free_pairs() {
+  // make sure the pairs are given back when this thread exits.
+  (void)&t_pair_free_list_owner;
+  {
+    std::lock_guard<std::mutex> lock(g_shared_pairs_mutex);
+    if (g_shared_free_pairs) {
+      t_free_pairs = g_shared_free_pairs;
+      g_shared_free_pairs = nullptr;
+      return;
+    }
+  }
+
+  auto* chunk = static_cast<PairBlock*>(::operator new(sizeof(PairBlock) * PAIRS_PER_CHUNK));
+  for (int i = 0; i < PAIRS_PER_CHUNK - 1; i++) {
+    chunk[i].next = &chunk[i + 1];
+  }
+  chunk[PAIRS_PER_CHUNK - 1].next = nullptr;
+  t_free_pairs = chunk;
+}
+}  // namespace
+
+void* PairObject::operator new(size_t size) {
+  ASSERT(size == sizeof(PairObject));
+  if (!t_free_pairs) {
+    refill_free_pairs();
+  }
+  PairBlock* block = t_free_pairs;
+  t_free_pairs = block->next;
+  return block;
+}
+
+void PairObject::operator delete(void* ptr) {
+  auto* block = static_cast<PairBlock*>(ptr);
+  block->next = t_free_pairs;
+  t_free_pairs = block;
+}
+
 /*!
  * Create a new symbol object by interning
  */
@@ -155,9 +235,8 @@ Object build_list(const std::vector<Object>& objects) {
   }
 
   // this is by far the most expensive part of parsing, so this is done a bit carefully.
-  // we maintain a std::shared_ptr<PairObject> that represents the list, built from back to front.
-  std::shared_ptr<PairObject> head =
-      std::make_shared<PairObject>(objects.back(), Object::make_empty_list());
+  // we maintain a HeapPtr<PairObject> that represents the list, built from back to front.
+  HeapPtr<PairObject> head = make_heap<PairObject>(objects.back(), Object::make_empty_list());
 
   s64 idx = ((s64)objects.size()) - 2;
   while (idx >= 0) {
@@ -165,7 +244,7 @@ Object build_list(const std::vector<Object>& objects) {
     next.type = ObjectType::PAIR;
     next.heap_obj = std::move(head);
 
-    head = std::make_shared<PairObject>();
+    head = make_heap<PairObject>();
     head->car = objects[idx];
     head->cdr = std::move(next);
 
@@ -174,7 +253,7 @@ Object build_list(const std::vector<Object>& objects) {
 
   Object result;
   result.type = ObjectType::PAIR;
-  result.heap_obj = head;
+  result.heap_obj = std::move(head);
   return result;
 }
 
@@ -184,9 +263,8 @@ Object build_list(std::vector<Object>&& objects) {
   }
 
   // this is by far the most expensive part of parsing, so this is done a bit carefully.
-  // we maintain a std::shared_ptr<PairObject> that represents the list, built from back to front.
-  std::shared_ptr<PairObject> head =
-      std::make_shared<PairObject>(objects.back(), Object::make_empty_list());
+  // we maintain a HeapPtr<PairObject> that represents the list, built from back to front.
+  HeapPtr<PairObject> head = make_heap<PairObject>(objects.back(), Object::make_empty_list());
 
   s64 idx = ((s64)objects.size()) - 2;
   while (idx >= 0) {
@@ -194,7 +272,7 @@ Object build_list(std::vector<Object>&& objects) {
     next.type = ObjectType::PAIR;
     next.heap_obj = std::move(head);
 
-    head = std::make_shared<PairObject>();
+    head = make_heap<PairObject>();
     head->car = std::move(objects[idx]);
     head->cdr = std::move(next);
 
@@ -203,7 +281,7 @@ Object build_list(std::vector<Object>&& objects) {
 
   Object result;
   result.type = ObjectType::PAIR;
-  result.heap_obj = head;
+  result.heap_obj = std::move(head);
   return result;
 }
 
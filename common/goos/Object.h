@@ -6,8 +6,7 @@
  * There are different types of objects, as represented by ObjectType.
  * An "Object" is an efficient wrapper around any of these types.
  * Some types are "heap allocated", and have reference semantics, and others are
- * "fixed" and have value semantics.  Heap allocated objects implement reference counting with
- * std::shared_ptr.
+ * "fixed" and have value semantics.  Heap allocated objects are reference counted with HeapPtr.
  *
  * To create a new Object for a heap allocated type, use the make_new static method of the type of
  * object you want to make. This will return a correctly setup Object. For fixed objects, use
@@ -27,6 +26,7 @@
  *
  * SYMBOL - a special heap allocated object. SymbolObject::make_new requires a SymbolTable to
  * store the newly allocated symbol in, and will return an existing symbol if there already is one.
+ * Symbols are shared between threads, so their reference count is atomic.
  *
  * STRING - a heap allocated object. Create with StringObject::make_new. Uses std::string internally
  *
@@ -43,6 +43,7 @@
  *
  */
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -157,8 +158,135 @@ class HeapObject {
   virtual std::string print() const = 0;
   virtual std::string inspect() const = 0;
   virtual ~HeapObject() = default;
+
+ protected:
+  HeapObject() = default;
+  // for objects that may be referenced from several threads at once, like symbols.
+  explicit HeapObject(bool shared) : m_shared(shared) {}
+  // a copy of an object has its own references.
+  HeapObject(const HeapObject& other) : m_shared(other.m_shared) {}
+  HeapObject& operator=(const HeapObject&) { return *this; }
+
+ private:
+  template <typename T>
+  friend class HeapPtr;
+
+  void add_ref() const {
+    if (m_shared) {
+      m_refcount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      m_refcount.store(m_refcount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+
+  void release() const {
+    u32 remaining;
+    if (m_shared) {
+      remaining = m_refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    } else {
+      remaining = m_refcount.load(std::memory_order_relaxed) - 1;
+      m_refcount.store(remaining, std::memory_order_relaxed);
+    }
+    if (remaining == 0) {
+      delete this;
+    }
+  }
+
+  // Most GOOS objects are only used from one thread at a time, so their count is updated with
+  // plain loads and stores. Symbols are interned once and then shared between threads (the
+  // decompiler's pretty printer), so they use a real atomic count.
+  mutable std::atomic<u32> m_refcount = 0;
+  bool m_shared = false;
+};
+
+/*!
+ * A reference counted pointer to a HeapObject, like a std::shared_ptr, but with the count stored
+ * in the object.
+ */
+template <typename T>
+class HeapPtr {
+ public:
+  HeapPtr() = default;
+  HeapPtr(std::nullptr_t) {}
+  explicit HeapPtr(T* ptr) : m_ptr(ptr) { retain(); }
+  HeapPtr(const HeapPtr& other) : m_ptr(other.m_ptr) { retain(); }
+  HeapPtr(HeapPtr&& other) noexcept : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+  template <typename U>
+  HeapPtr(const HeapPtr<U>& other) : m_ptr(other.get()) {
+    retain();
+  }
+  template <typename U>
+  HeapPtr(HeapPtr<U>&& other) noexcept : m_ptr(other.release_ownership()) {}
+  ~HeapPtr() {
+    if (m_ptr) {
+      m_ptr->release();
+    }
+  }
+
+  // the new object is referenced before the old one is released, because releasing the old one
+  // may also free the other pointer.
+  HeapPtr& operator=(const HeapPtr& other) {
+    HeapPtr(other).swap(*this);
+    return *this;
+  }
+  HeapPtr& operator=(HeapPtr&& other) noexcept {
+    HeapPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  T* get() const { return m_ptr; }
+  T* operator->() const { return m_ptr; }
+  T& operator*() const { return *m_ptr; }
+  explicit operator bool() const { return m_ptr != nullptr; }
+  void reset() { HeapPtr().swap(*this); }
+  void swap(HeapPtr& other) noexcept { std::swap(m_ptr, other.m_ptr); }
+
+  // give up the reference without releasing it.
+  T* release_ownership() {
+    T* result = m_ptr;
+    m_ptr = nullptr;
+    return result;
+  }
+
+  template <typename U>
+  bool operator==(const HeapPtr<U>& other) const {
+    return m_ptr == other.get();
+  }
+  template <typename U>
+  bool operator!=(const HeapPtr<U>& other) const {
+    return m_ptr != other.get();
+  }
+  bool operator==(std::nullptr_t) const { return m_ptr == nullptr; }
+  bool operator!=(std::nullptr_t) const { return m_ptr != nullptr; }
+
+ private:
+  void retain() const {
+    if (m_ptr) {
+      m_ptr->add_ref();
+    }
+  }
+
+  T* m_ptr = nullptr;
 };
 
+/*!
+ * Allocate a new heap object, like std::make_shared.
+ */
+template <typename T, typename... Args>
+HeapPtr<T> make_heap(Args&&... args) {
+  return HeapPtr<T>(new T(std::forward<Args>(args)...));
+}
+}  // namespace goos
+
+namespace std {
+template <typename T>
+struct hash<goos::HeapPtr<T>> {
+  size_t operator()(const goos::HeapPtr<T>& ptr) const { return std::hash<T*>()(ptr.get()); }
+};
+}  // namespace std
+
+namespace goos {
+
 // forward declare all HeapObjects
 class PairObject;
 class EnvironmentObject;
@@ -168,11 +296,11 @@ class LambdaObject;
 class MacroObject;
 class ArrayObject;
 class StringHashTableObject;
+struct CompiledBody;
 
 // Wrapper Object class for all objects
 class Object {
  public:
-  std::shared_ptr<HeapObject> heap_obj = nullptr;
   friend Object build_list(const std::vector<Object>& objects);
   friend Object build_list(std::vector<Object>&& objects);
 
@@ -183,6 +311,9 @@ class Object {
   };
 
   ObjectType type = ObjectType::INVALID;
+  // last, so assigning an object that is part of this one (like lst = lst.as_pair()->cdr) reads
+  // everything before the old heap object is released.
+  HeapPtr<HeapObject> heap_obj = nullptr;
 
   std::string print() const {
     switch (type) {
@@ -246,7 +377,7 @@ class Object {
 
   PairObject* as_pair() const;
   EnvironmentObject* as_env() const;
-  std::shared_ptr<EnvironmentObject> as_env_ptr() const;
+  HeapPtr<EnvironmentObject> as_env_ptr() const;
   SymbolObject* as_symbol() const;
   StringObject* as_string() const;
   LambdaObject* as_lambda() const;
@@ -322,7 +453,7 @@ class SymbolTable;
 class SymbolObject : public HeapObject {
  public:
   std::string name;
-  explicit SymbolObject(std::string _name) : name(std::move(_name)) {}
+  explicit SymbolObject(std::string _name) : HeapObject(true), name(std::move(_name)) {}
   static Object make_new(SymbolTable& st, const std::string& name);
 
   std::string print() const override { return name; }
@@ -337,20 +468,14 @@ class SymbolObject : public HeapObject {
  */
 class SymbolTable {
  public:
-  std::shared_ptr<HeapObject> intern(const std::string& name) {
-    const auto& kv = table.find(name);
-    if (kv == table.end()) {
-      auto iter = table.insert({name, std::make_shared<SymbolObject>(name)});
-      return (*iter.first).second;
-    } else {
-      return kv->second;
-    }
+  HeapPtr<HeapObject> intern(const std::string& name) {
+    return HeapPtr<HeapObject>(intern_ptr(name));
   }
 
   HeapObject* intern_ptr(const std::string& name) {
     const auto& kv = table.find(name);
     if (kv == table.end()) {
-      auto iter = table.insert({name, std::make_shared<SymbolObject>(name)});
+      auto iter = table.insert({name, make_heap<SymbolObject>(name)});
       return (*iter.first).second.get();
     } else {
       return kv->second.get();
@@ -360,7 +485,8 @@ class SymbolTable {
   ~SymbolTable() = default;
 
  private:
-  std::unordered_map<std::string, std::shared_ptr<HeapObject>> table;
+  // the table holds a reference to each symbol, so symbols stay alive in objects that outlive it.
+  std::unordered_map<std::string, HeapPtr<SymbolObject>> table;
 };
 
 class StringObject : public HeapObject {
@@ -371,7 +497,7 @@ class StringObject : public HeapObject {
   static Object make_new(const std::string& text) {
     Object obj;
     obj.type = ObjectType::STRING;
-    obj.heap_obj = std::make_shared<StringObject>(text);
+    obj.heap_obj = make_heap<StringObject>(text);
     return obj;
   }
 
@@ -388,10 +514,14 @@ class PairObject : public HeapObject {
   PairObject(const Object& car_, const Object& cdr_) : car(car_), cdr(cdr_) {}
   PairObject() = default;
 
+  // pairs are allocated from a pool, see Object.cpp.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   static Object make_new(const Object& a, const Object& b) {
     Object obj;
     obj.type = ObjectType::PAIR;
-    obj.heap_obj = std::make_shared<PairObject>(a, b);
+    obj.heap_obj = make_heap<PairObject>(a, b);
     return obj;
   }
 
@@ -414,9 +544,9 @@ class PairObject : public HeapObject {
 
     for (;;) {
       if (to_print.type == ObjectType::PAIR) {
-        Object to_print_car = std::dynamic_pointer_cast<PairObject>(to_print.heap_obj)->car;
+        Object to_print_car = to_print.as_pair()->car;
         result += to_print_car.print();
-        to_print = std::dynamic_pointer_cast<PairObject>(to_print.heap_obj)->cdr;
+        to_print = to_print.as_pair()->cdr;
         if (to_print.type == ObjectType::EMPTY_LIST) {
           result += ")";
           return result;
@@ -437,29 +567,92 @@ class PairObject : public HeapObject {
   ~PairObject() = default;
 };
 
+/*!
+ * The variables of an environment, by symbol. Most environments hold the arguments of a single
+ * lambda or macro call, so the variables are stored in a flat array and searched in order. Large
+ * environments, like the global environment, also get an index.
+ */
+class EnvironmentVars {
+ public:
+  using value_type = std::pair<HeapObject*, Object>;
+  using iterator = std::vector<value_type>::iterator;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  iterator find(const HeapObject* sym) { return m_vars.begin() + find_index(sym); }
+  const_iterator find(const HeapObject* sym) const { return m_vars.begin() + find_index(sym); }
+
+  Object& operator[](HeapObject* sym) {
+    auto it = find(sym);
+    if (it != m_vars.end()) {
+      return it->second;
+    }
+    m_vars.emplace_back(sym, Object());
+    if (!m_index.empty()) {
+      m_index[sym] = m_vars.size() - 1;
+    } else if (m_vars.size() > MAX_UNINDEXED_SIZE) {
+      for (size_t i = 0; i < m_vars.size(); i++) {
+        m_index[m_vars[i].first] = i;
+      }
+    }
+    return m_vars.back().second;
+  }
+
+  void reserve(size_t size) { m_vars.reserve(size); }
+  size_t size() const { return m_vars.size(); }
+  bool empty() const { return m_vars.empty(); }
+  void clear() {
+    m_vars.clear();
+    m_index.clear();
+  }
+
+  iterator begin() { return m_vars.begin(); }
+  iterator end() { return m_vars.end(); }
+  const_iterator begin() const { return m_vars.begin(); }
+  const_iterator end() const { return m_vars.end(); }
+
+ private:
+  // the index of the variable, or the number of variables if there is none.
+  size_t find_index(const HeapObject* sym) const {
+    if (m_index.empty()) {
+      for (size_t i = 0; i < m_vars.size(); i++) {
+        if (m_vars[i].first == sym) {
+          return i;
+        }
+      }
+      return m_vars.size();
+    }
+    auto kv = m_index.find(sym);
+    return kv == m_index.end() ? m_vars.size() : kv->second;
+  }
+
+  static constexpr size_t MAX_UNINDEXED_SIZE = 16;
+  std::vector<value_type> m_vars;
+  std::unordered_map<const HeapObject*, size_t> m_index;
+};
+
 class EnvironmentObject : public HeapObject {
  public:
   std::string name;
-  std::shared_ptr<EnvironmentObject> parent_env;
+  HeapPtr<EnvironmentObject> parent_env;
 
   // the symbols will be stored in the symbol table and never removed, so we don't need shared
   // pointers here.
-  std::unordered_map<HeapObject*, Object> vars;
+  EnvironmentVars vars;
 
   EnvironmentObject() = default;
 
   static Object make_new() {
     Object obj;
     obj.type = ObjectType::ENVIRONMENT;
-    obj.heap_obj = std::make_shared<EnvironmentObject>();
+    obj.heap_obj = make_heap<EnvironmentObject>();
     return obj;
   }
 
   static Object make_new(std::string name,
-                         std::shared_ptr<EnvironmentObject> parent_env = nullptr) {
+                         HeapPtr<EnvironmentObject> parent_env = nullptr) {
     Object obj;
     obj.type = ObjectType::ENVIRONMENT;
-    auto env = std::make_shared<EnvironmentObject>();
+    auto env = make_heap<EnvironmentObject>();
     env->name = std::move(name);
     env->parent_env = std::move(parent_env);
     obj.heap_obj = std::move(env);
@@ -518,16 +711,18 @@ struct Arguments {
 class LambdaObject : public HeapObject {
  public:
   std::string name;
-  std::shared_ptr<EnvironmentObject> parent_env;
+  HeapPtr<EnvironmentObject> parent_env;
   Object body;
   ArgumentSpec args;
+  // the body, compiled by the interpreter when the lambda is first called.
+  std::shared_ptr<CompiledBody> compiled;
 
   LambdaObject() = default;
 
   static Object make_new() {
     Object obj;
     obj.type = ObjectType::LAMBDA;
-    obj.heap_obj = std::make_shared<LambdaObject>();
+    obj.heap_obj = make_heap<LambdaObject>();
     return obj;
   }
 
@@ -545,16 +740,18 @@ class LambdaObject : public HeapObject {
 class MacroObject : public HeapObject {
  public:
   std::string name;
-  std::shared_ptr<EnvironmentObject> parent_env;
+  HeapPtr<EnvironmentObject> parent_env;
   Object body;
   ArgumentSpec args;
+  // the body, compiled by the interpreter when the macro is first used.
+  std::shared_ptr<CompiledBody> compiled;
 
   MacroObject() = default;
 
   static Object make_new() {
     Object obj;
     obj.type = ObjectType::MACRO;
-    obj.heap_obj = std::make_shared<MacroObject>();
+    obj.heap_obj = make_heap<MacroObject>();
     return obj;
   }
 
@@ -576,7 +773,7 @@ class ArrayObject : public HeapObject {
   static Object make_new(std::vector<Object> objects) {
     Object obj;
     obj.type = ObjectType::ARRAY;
-    obj.heap_obj = std::make_shared<ArrayObject>(std::move(objects));
+    obj.heap_obj = make_heap<ArrayObject>(std::move(objects));
     return obj;
   }
 
@@ -610,7 +807,7 @@ class StringHashTableObject : public HeapObject {
   static Object make_new() {
     Object obj;
     obj.type = ObjectType::STRING_HASH_TABLE;
-    obj.heap_obj = std::make_shared<StringHashTableObject>();
+    obj.heap_obj = make_heap<StringHashTableObject>();
     return obj;
   }
 
@@ -653,11 +850,11 @@ inline EnvironmentObject* Object::as_env() const {
   return static_cast<EnvironmentObject*>(heap_obj.get());
 }
 
-inline std::shared_ptr<EnvironmentObject> Object::as_env_ptr() const {
+inline HeapPtr<EnvironmentObject> Object::as_env_ptr() const {
   if (type != ObjectType::ENVIRONMENT) {
     throw std::runtime_error("as_env called on a " + object_type_to_string(type) + " " + print());
   }
-  return std::dynamic_pointer_cast<EnvironmentObject>(heap_obj);
+  return HeapPtr<EnvironmentObject>(static_cast<EnvironmentObject*>(heap_obj.get()));
 }
 
 inline SymbolObject* Object::as_symbol() const {
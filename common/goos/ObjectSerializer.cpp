@@ -0,0 +1,401 @@
+/*!
+ * @file ObjectSerializer.cpp
+ * Save and load GOOS objects with a Serializer.
+ *
+ * Each object starts with its ObjectType. Fixed objects follow with their value. Heap objects
+ * follow with an id: an id that was seen before refers to that object, and the next unused id is a
+ * new object whose contents come next. A new object gets its id before its contents are saved, so
+ * the contents can refer back to it.
+ *
+ * A list's pairs are saved together instead of each cdr being nested in its pair, so long lists
+ * don't need deep recursion.
+ */
+
+#include "ObjectSerializer.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "third-party/fmt/core.h"
+
+namespace goos {
+
+namespace {
+// saved for pairs without a source location.
+constexpr s32 NO_TEXT = -1;
+
+enum class TextKind : u8 { FILE, OTHER };
+
+template <typename T, typename Map>
+std::vector<std::pair<const T*, const Object*>> sorted_entries(
+    const Map& map,
+    const std::function<bool(const T&, const T&)>& less) {
+  // unordered maps are saved in a consistent order, so the same objects always save the same way.
+  std::vector<std::pair<const T*, const Object*>> result;
+  for (const auto& [key, value] : map) {
+    result.push_back({&key, &value});
+  }
+  std::sort(result.begin(), result.end(),
+            [&](const auto& a, const auto& b) { return less(*a.first, *b.first); });
+  return result;
+}
+}  // namespace
+
+void ObjectSerializer::from_object(Object* obj) {
+  if (m_ser.is_saving()) {
+    save_object(*obj);
+  } else {
+    *obj = load_object();
+  }
+}
+
+void ObjectSerializer::from_env(HeapPtr<EnvironmentObject>* env) {
+  if (m_ser.is_saving()) {
+    if (*env) {
+      Object obj;
+      obj.type = ObjectType::ENVIRONMENT;
+      obj.heap_obj = *env;
+      save_object(obj);
+    } else {
+      save_object(Object::make_empty_list());
+    }
+  } else {
+    auto obj = load_object();
+    *env = obj.is_empty_list() ? nullptr : obj.as_env_ptr();
+  }
+}
+
+void ObjectSerializer::from_arg_spec(ArgumentSpec* spec) {
+  m_ser.from_ptr(&spec->varargs);
+  m_ser.from_string_vector(&spec->unnamed);
+  m_ser.from_str(&spec->rest);
+  if (m_ser.is_saving()) {
+    m_ser.save<size_t>(spec->named.size());
+    std::vector<std::string> names;
+    for (const auto& [name, arg] : spec->named) {
+      names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) {
+      auto& arg = spec->named.at(name);
+      m_ser.save_str(&name);
+      m_ser.from_ptr(&arg.has_default);
+      save_object(arg.default_value);
+    }
+  } else {
+    spec->named.clear();
+    auto count = m_ser.load<size_t>();
+    for (size_t i = 0; i < count; i++) {
+      auto& arg = spec->named[m_ser.load_string()];
+      m_ser.from_ptr(&arg.has_default);
+      arg.default_value = load_object();
+    }
+  }
+}
+
+void ObjectSerializer::save_object(const Object& obj) {
+  m_ser.save<ObjectType>(obj.type);
+  switch (obj.type) {
+    case ObjectType::EMPTY_LIST:
+      return;
+    case ObjectType::INTEGER:
+      m_ser.save<IntType>(obj.integer_obj.value);
+      return;
+    case ObjectType::FLOAT:
+      m_ser.save<FloatType>(obj.float_obj.value);
+      return;
+    case ObjectType::CHAR:
+      m_ser.save<char>(obj.char_obj.value);
+      return;
+    case ObjectType::INVALID:
+      throw std::runtime_error("Cannot save an invalid GOOS object");
+    default:
+      break;
+  }
+
+  auto it = m_ids.find(obj.heap_obj.get());
+  if (it != m_ids.end()) {
+    m_ser.save<u32>(it->second);
+    return;
+  }
+
+  m_ser.save<u32>(m_ids.size());
+  if (obj.is_pair()) {
+    save_pairs(obj);
+  } else {
+    m_ids.insert({obj.heap_obj.get(), m_ids.size()});
+    save_contents(obj);
+  }
+}
+
+void ObjectSerializer::save_contents(const Object& obj) {
+  switch (obj.type) {
+    case ObjectType::SYMBOL:
+      m_ser.save_str(&obj.as_symbol()->name);
+      break;
+    case ObjectType::STRING:
+      m_ser.save_str(&obj.as_string()->data);
+      break;
+    case ObjectType::ARRAY: {
+      auto* array = obj.as_array();
+      m_ser.save<size_t>(array->size());
+      for (auto& elt : array->data) {
+        save_object(elt);
+      }
+    } break;
+    case ObjectType::LAMBDA: {
+      auto* lambda = obj.as_lambda();
+      m_ser.save_str(&lambda->name);
+      from_env(&lambda->parent_env);
+      save_object(lambda->body);
+      from_arg_spec(&lambda->args);
+    } break;
+    case ObjectType::MACRO: {
+      auto* macro = obj.as_macro();
+      m_ser.save_str(&macro->name);
+      from_env(&macro->parent_env);
+      save_object(macro->body);
+      from_arg_spec(&macro->args);
+    } break;
+    case ObjectType::ENVIRONMENT: {
+      auto* env = obj.as_env();
+      m_ser.save_str(&env->name);
+      from_env(&env->parent_env);
+      m_ser.save<size_t>(env->vars.size());
+      for (auto& [sym, value] : sorted_entries<HeapObject*>(
+               env->vars, [](HeapObject* const& a, HeapObject* const& b) {
+                 return static_cast<SymbolObject*>(a)->name < static_cast<SymbolObject*>(b)->name;
+               })) {
+        // symbols are never freed, so vars doesn't hold a reference to them.
+        save_object(
+            SymbolObject::make_new(m_reader.symbolTable, static_cast<SymbolObject*>(*sym)->name));
+        save_object(*value);
+      }
+    } break;
+    case ObjectType::STRING_HASH_TABLE: {
+      auto* table = obj.as_string_hash_table();
+      m_ser.save<size_t>(table->data.size());
+      for (auto& [key, value] : sorted_entries<std::string>(
+               table->data, [](const std::string& a, const std::string& b) { return a < b; })) {
+        m_ser.save_str(key);
+        save_object(*value);
+      }
+    } break;
+    default:
+      ASSERT_NOT_REACHED();
+  }
+}
+
+/*!
+ * Save a pair, and the pairs in its cdr that haven't been saved yet.
+ */
+void ObjectSerializer::save_pairs(const Object& first) {
+  std::vector<const Object*> pairs;
+  const Object* tail = &first;
+  while (tail->is_pair() && m_ids.find(tail->heap_obj.get()) == m_ids.end()) {
+    m_ids.insert({tail->heap_obj.get(), m_ids.size()});
+    pairs.push_back(tail);
+    tail = &tail->as_pair()->cdr;
+  }
+
+  m_ser.save<u32>(pairs.size());
+  for (auto* pair : pairs) {
+    save_location(*pair);
+  }
+  for (auto* pair : pairs) {
+    save_object(pair->as_pair()->car);
+  }
+  save_object(*tail);
+}
+
+/*!
+ * Save where a pair came from in the source. Texts read from files are loaded from the file again,
+ * other texts are saved.
+ */
+void ObjectSerializer::save_location(const Object& pair) {
+  auto* ref = m_reader.db.try_get_ref(pair);
+  if (!ref) {
+    m_ser.save<s32>(NO_TEXT);
+    return;
+  }
+
+  auto [it, added] = m_text_ids.insert({ref->frag.get(), (s32)m_text_ids.size()});
+  m_ser.save<s32>(it->second);
+  if (added) {
+    auto description = ref->frag->get_description();
+    m_ser.save_str(&description);
+    if (auto* file = dynamic_cast<const FileText*>(ref->frag.get())) {
+      m_ser.save<TextKind>(TextKind::FILE);
+      m_ser.save_str(&file->filename());
+    } else {
+      m_ser.save<TextKind>(TextKind::OTHER);
+      std::string text(ref->frag->get_text(), ref->frag->get_size());
+      m_ser.save_str(&text);
+    }
+  }
+  m_ser.save<s32>(ref->offset);
+}
+
+Object ObjectSerializer::load_object() {
+  Object obj;
+  obj.type = m_ser.load<ObjectType>();
+  switch (obj.type) {
+    case ObjectType::EMPTY_LIST:
+      return obj;
+    case ObjectType::INTEGER:
+      obj.integer_obj.value = m_ser.load<IntType>();
+      return obj;
+    case ObjectType::FLOAT:
+      obj.float_obj.value = m_ser.load<FloatType>();
+      return obj;
+    case ObjectType::CHAR:
+      obj.char_obj.value = m_ser.load<char>();
+      return obj;
+    default:
+      break;
+  }
+
+  auto id = m_ser.load<u32>();
+  if (id < m_objects.size()) {
+    if (m_objects[id].type != obj.type) {
+      throw std::runtime_error(fmt::format("GOOS object {} was saved as a {}, but is a {}", id,
+                                           object_type_to_string(obj.type),
+                                           object_type_to_string(m_objects[id].type)));
+    }
+    return m_objects[id];
+  }
+  if (id != m_objects.size()) {
+    throw std::runtime_error(fmt::format("Invalid GOOS object id {}", id));
+  }
+
+  switch (obj.type) {
+    case ObjectType::PAIR:
+      return load_pairs();
+    case ObjectType::SYMBOL:
+      obj = SymbolObject::make_new(m_reader.symbolTable, m_ser.load_string());
+      break;
+    case ObjectType::STRING:
+      obj = StringObject::make_new(m_ser.load_string());
+      break;
+    case ObjectType::ARRAY:
+      obj = ArrayObject::make_new({});
+      break;
+    case ObjectType::LAMBDA:
+      obj = LambdaObject::make_new();
+      break;
+    case ObjectType::MACRO:
+      obj = MacroObject::make_new();
+      break;
+    case ObjectType::ENVIRONMENT:
+      obj = EnvironmentObject::make_new();
+      break;
+    case ObjectType::STRING_HASH_TABLE:
+      obj = StringHashTableObject::make_new();
+      break;
+    default:
+      throw std::runtime_error(fmt::format("Invalid GOOS object type {}", (int)obj.type));
+  }
+
+  // add it first, so the contents can refer to it.
+  m_objects.push_back(obj);
+  load_contents(obj);
+  return obj;
+}
+
+void ObjectSerializer::load_contents(const Object& obj) {
+  switch (obj.type) {
+    case ObjectType::SYMBOL:
+    case ObjectType::STRING:
+      break;
+    case ObjectType::ARRAY: {
+      auto* array = obj.as_array();
+      array->data.resize(m_ser.load<size_t>());
+      for (auto& elt : array->data) {
+        elt = load_object();
+      }
+    } break;
+    case ObjectType::LAMBDA: {
+      auto* lambda = obj.as_lambda();
+      m_ser.from_str(&lambda->name);
+      from_env(&lambda->parent_env);
+      lambda->body = load_object();
+      from_arg_spec(&lambda->args);
+    } break;
+    case ObjectType::MACRO: {
+      auto* macro = obj.as_macro();
+      m_ser.from_str(&macro->name);
+      from_env(&macro->parent_env);
+      macro->body = load_object();
+      from_arg_spec(&macro->args);
+    } break;
+    case ObjectType::ENVIRONMENT: {
+      auto* env = obj.as_env();
+      m_ser.from_str(&env->name);
+      from_env(&env->parent_env);
+      auto count = m_ser.load<size_t>();
+      for (size_t i = 0; i < count; i++) {
+        auto sym = load_object();
+        env->vars[sym.as_symbol()] = load_object();
+      }
+    } break;
+    case ObjectType::STRING_HASH_TABLE: {
+      auto* table = obj.as_string_hash_table();
+      auto count = m_ser.load<size_t>();
+      for (size_t i = 0; i < count; i++) {
+        auto key = m_ser.load_string();
+        table->data[key] = load_object();
+      }
+    } break;
+    default:
+      ASSERT_NOT_REACHED();
+  }
+}
+
+Object ObjectSerializer::load_pairs() {
+  auto count = m_ser.load<u32>();
+  if (count == 0) {
+    throw std::runtime_error("Invalid GOOS list");
+  }
+
+  size_t first_id = m_objects.size();
+  for (u32 i = 0; i < count; i++) {
+    m_objects.push_back(PairObject::make_new(Object::make_empty_list(), Object::make_empty_list()));
+  }
+  for (u32 i = 0; i < count; i++) {
+    load_location(m_objects[first_id + i]);
+  }
+  for (u32 i = 0; i < count; i++) {
+    // loading may add objects, so look the pair up after.
+    auto car = load_object();
+    m_objects[first_id + i].as_pair()->car = car;
+  }
+  auto tail = load_object();
+  for (u32 i = 0; i < count; i++) {
+    m_objects[first_id + i].as_pair()->cdr = i + 1 < count ? m_objects[first_id + i + 1] : tail;
+  }
+  return m_objects[first_id];
+}
+
+void ObjectSerializer::load_location(const Object& pair) {
+  auto id = m_ser.load<s32>();
+  if (id == NO_TEXT) {
+    return;
+  }
+
+  if (id == (s32)m_texts.size()) {
+    auto description = m_ser.load_string();
+    std::shared_ptr<SourceText> text;
+    if (m_ser.load<TextKind>() == TextKind::FILE) {
+      text = std::make_shared<FileText>(m_ser.load_string(), description);
+    } else {
+      text = std::make_shared<ProgramString>(m_ser.load_string(), description);
+    }
+    m_reader.db.insert(text);
+    m_texts.push_back(text);
+  } else if (id < 0 || id > (s32)m_texts.size()) {
+    throw std::runtime_error(fmt::format("Invalid source text id {}", id));
+  }
+  m_reader.db.link(pair, m_texts.at(id), m_ser.load<s32>());
+}
+}  // namespace goos
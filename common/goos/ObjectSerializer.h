@@ -0,0 +1,62 @@
+#pragma once
+
+/*!
+ * @file ObjectSerializer.h
+ * Save and load GOOS objects with a Serializer.
+ */
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/goos/Object.h"
+#include "common/goos/Reader.h"
+#include "common/util/Serializer.h"
+
+namespace goos {
+
+/*!
+ * Saves or loads GOOS objects. Like the Serializer, the same functions are used for both, and
+ * objects must be loaded in the same order they were saved.
+ *
+ * Each heap object is saved once, so objects that are shared or refer to themselves (like an
+ * environment holding a lambda that was defined in it) are still shared after loading, as long as
+ * they are saved with the same ObjectSerializer. Loaded symbols are interned in the reader's symbol
+ * table, and the reader's source locations of pairs are kept, so errors in loaded code still point
+ * to the code.
+ */
+class ObjectSerializer {
+ public:
+  ObjectSerializer(Serializer& ser, Reader& reader) : m_ser(ser), m_reader(reader) {}
+
+  Serializer& ser() { return m_ser; }
+  bool is_saving() const { return m_ser.is_saving(); }
+  bool is_loading() const { return m_ser.is_loading(); }
+
+  void from_object(Object* obj);
+  // the environment may be null.
+  void from_env(HeapPtr<EnvironmentObject>* env);
+  void from_arg_spec(ArgumentSpec* spec);
+
+ private:
+  void save_object(const Object& obj);
+  void save_contents(const Object& obj);
+  void save_pairs(const Object& first);
+  void save_location(const Object& pair);
+  Object load_object();
+  void load_contents(const Object& obj);
+  Object load_pairs();
+  void load_location(const Object& pair);
+
+  Serializer& m_ser;
+  Reader& m_reader;
+
+  // when saving, the ids of objects and source texts that are already saved.
+  std::unordered_map<const HeapObject*, u32> m_ids;
+  std::unordered_map<const SourceText*, s32> m_text_ids;
+
+  // when loading, the objects and source texts that have been loaded, by id.
+  std::vector<Object> m_objects;
+  std::vector<std::shared_ptr<SourceText>> m_texts;
+};
+}  // namespace goos
@@ -11,13 +11,20 @@
 
 #include "Reader.h"
 
+#include <cstring>
+
 #include "common/log/log.h"
 #include "common/repl/util.h"
+#include "common/util/BitUtils.h"
 #include "common/util/FileUtil.h"
 #include "common/util/FontUtils.h"
 
 #include "third-party/fmt/core.h"
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace goos {
 
 namespace {
@@ -53,6 +60,104 @@ bool str_contains(const std::string& str, char c) {
   }
   return false;
 }
+
+/*
+ * Scanning helpers. These look at 16 characters at a time with SSE2, which every x86-64 CPU has,
+ * and finish the last few characters (or everything, on other CPUs) one at a time.
+ */
+
+/*!
+ * Get the offset of the first character at or after start that isn't a space, tab or newline.
+ */
+int skip_whitespace(const char* data, int start, int size) {
+  int i = start;
+#if defined(__x86_64__) || defined(_M_X64)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  for (; i + 16 <= size; i += 16) {
+    __m128i chars = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i white = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(chars, newline), _mm_cmpeq_epi8(chars, carriage_return)));
+    u32 not_white = ~(u32)_mm_movemask_epi8(white) & 0xffff;
+    if (not_white) {
+      return i + count_trailing_zeros_u32(not_white);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    char c = data[i];
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+      break;
+    }
+  }
+  return i;
+}
+
+/*!
+ * Get the offset of the first quote or backslash at or after start, or size if there isn't one.
+ */
+int find_string_special_char(const char* data, int start, int size) {
+  int i = start;
+#if defined(__x86_64__) || defined(_M_X64)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; i + 16 <= size; i += 16) {
+    __m128i chars = _mm_loadu_si128((const __m128i*)(data + i));
+    u32 special = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)));
+    if (special) {
+      return i + count_trailing_zeros_u32(special);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    if (data[i] == '"' || data[i] == '\\') {
+      break;
+    }
+  }
+  return i;
+}
+
+/*!
+ * Get the offset of the first character that isn't valid source text, or size if they all are.
+ * Printable ASCII and whitespace are checked 16 at a time, anything else is checked in the table.
+ */
+int find_invalid_source_char(const char* data, int start, int size, const bool* valid_chars) {
+  int i = start;
+#if defined(__x86_64__) || defined(_M_X64)
+  // signed compares, so characters above 0x7f are negative and end up in the slow path.
+  const __m128i below_space = _mm_set1_epi8(' ' - 1);
+  const __m128i above_tilde = _mm_set1_epi8('~' + 1);
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  for (; i + 16 <= size; i += 16) {
+    __m128i chars = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i printable =
+        _mm_and_si128(_mm_cmpgt_epi8(chars, below_space), _mm_cmplt_epi8(chars, above_tilde));
+    __m128i white =
+        _mm_or_si128(_mm_cmpeq_epi8(chars, tab),
+                     _mm_or_si128(_mm_cmpeq_epi8(chars, newline),
+                                  _mm_cmpeq_epi8(chars, carriage_return)));
+    if (_mm_movemask_epi8(_mm_or_si128(printable, white)) != 0xffff) {
+      for (int j = i; j < i + 16; j++) {
+        if (!valid_chars[(u8)data[j]]) {
+          return j;
+        }
+      }
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    if (!valid_chars[(u8)data[i]]) {
+      break;
+    }
+  }
+  return i;
+}
 }  // namespace
 
 /*!
@@ -60,40 +165,35 @@ bool str_contains(const std::string& str, char c) {
  * This will leave the stream at the next non-whitespace character (or at the end)
  */
 void TextStream::seek_past_whitespace_and_comments() {
-  while (text_remains()) {
-    char c = peek();
-    switch (c) {
-      case ' ':
-      case '\t':
-      case '\n':
-      case '\r':
-        // just a whitespace, eat it!
-        read();
-        break;
+  while (true) {
+    seek = skip_whitespace(data, seek, size);
+    if (!text_remains()) {
+      return;
+    }
 
-      case ';':
+    switch (peek()) {
+      case ';': {
         // line comment.
-        while (text_remains() && read() != '\n') {
-        }
-        break;
+        auto* end = (const char*)memchr(data + seek, '\n', size - seek);
+        seek = end ? int(end - data) + 1 : size;
+      } break;
 
       case '#':
         if (text_remains(1) && peek(1) == '|') {
-          ASSERT(read() == '#');  // #
-          ASSERT(read() == '|');  // |
-
-          bool found_end = false;
-          // find |#
-          while (text_remains() && !found_end) {
-            // find |
-            while (text_remains() && read() != '|') {
+          seek += 2;  // #|
+
+          // find |#. The character after each | is consumed, even if it isn't #.
+          while (text_remains()) {
+            auto* bar = (const char*)memchr(data + seek, '|', size - seek);
+            if (!bar) {
+              seek = size;
+              break;
             }
+            seek = int(bar - data) + 1;
             if (text_remains() && read() == '#') {
-              found_end = true;
+              break;
             }
           }
-          continue;
-
         } else {
           // not a line comment
           return;
@@ -157,6 +257,14 @@ Reader::Reader() {
     m_valid_symbols_chars[(int)*c] = true;
   }
 
+  // table of characters that end a symbol or number
+  for (auto& x : m_token_end_chars) {
+    x = false;
+  }
+  for (char c : {' ', '\n', '\t', '\r', ')', ';', '('}) {
+    m_token_end_chars[(u8)c] = true;
+  }
+
   // table of characters that are valid in source code:
   for (auto& x : m_valid_source_text_chars) {
     x = false;
@@ -262,14 +370,14 @@ Object Reader::internal_read(std::shared_ptr<SourceText> text,
   }
 
   // validate the input
-  for (int offset = check_encoding ? 3 : 0; offset < text->get_size(); offset++) {
-    if (!is_valid_source_char(text->get_text()[offset])) {
-      // failed.
-      int line_number = text->get_line_idx(offset) + 1;
-      throw std::runtime_error(fmt::format("Invalid character found on line {} of {}: 0x{:x}",
-                                           line_number, text->get_description(),
-                                           (u8)text->get_text()[offset]));
-    }
+  int bad_offset = find_invalid_source_char(text->get_text(), check_encoding ? 3 : 0,
+                                            text->get_size(), m_valid_source_text_chars);
+  if (bad_offset < text->get_size()) {
+    // failed.
+    int line_number = text->get_line_idx(bad_offset) + 1;
+    throw std::runtime_error(fmt::format("Invalid character found on line {} of {}: 0x{:x}",
+                                         line_number, text->get_description(),
+                                         (u8)text->get_text()[bad_offset]));
   }
 
   // first create stream
@@ -312,43 +420,40 @@ bool Reader::check_string_is_valid(const std::string& str) const {
 Token Reader::get_next_token(TextStream& stream) {
   ASSERT(stream.text_remains());
   Token t;
-  t.source_line = stream.line_count;
   t.source_offset = stream.seek;
-  t.source_text = stream.text;
 
   char first = stream.read();
-  t.text.push_back(first);
 
   // First - look for special tokens which end early:
 
   // parens, double quotes, quotes, and backticks are tokens.
-  if (first == '(' || first == ')' || first == '"' || first == '\'' || first == '`')
+  if (first == '(' || first == ')' || first == '"' || first == '\'' || first == '`') {
+    t.text.push_back(first);
     return t;
+  }
 
   // ",@" is its own token
   if (first == ',' && stream.text_remains() && stream.peek() == '@') {
-    t.text.push_back(stream.read());
+    stream.read();
+    t.text = ",@";
     return t;
   } else if (first == ',') {
     // "," is its own token.
+    t.text.push_back(first);
     return t;
   } else if (first == '#' && stream.text_remains() && stream.peek() == '(') {
-    t.text.push_back(stream.read());
+    stream.read();
+    t.text = "#(";
     return t;
   }
 
   // Second - not a special token, so we read until we get a character that ends the token.
-  while (stream.text_remains()) {
-    char next = stream.peek();
-    if (next == ' ' || next == '\n' || next == '\t' || next == '\r' || next == ')' || next == ';' ||
-        next == '(') {
-      return t;
-    } else {
-      // not the end, so add to token.
-      t.text.push_back(stream.read());
-    }
+  int end = stream.seek;
+  while (end < stream.size && !m_token_end_chars[(u8)stream.data[end]]) {
+    end++;
   }
-
+  t.text.assign(stream.data + t.source_offset, end - t.source_offset);
+  stream.seek = end;
   return t;
 }
 
@@ -624,6 +729,14 @@ bool Reader::read_string(TextStream& stream, Object& obj) {
   std::string str;
 
   while (stream.text_remains()) {
+    // copy everything up to the next quote or escape at once.
+    int special = find_string_special_char(stream.data, stream.seek, stream.size);
+    str.append(stream.data + stream.seek, special - stream.seek);
+    stream.seek = special;
+    if (!stream.text_remains()) {
+      break;
+    }
+
     char c = stream.read();
     if (c == '"') {
       obj = StringObject::make_new(str);
@@ -631,45 +744,42 @@ bool Reader::read_string(TextStream& stream, Object& obj) {
       break;
     }
 
-    if (c == '\\') {
-      if (!stream.text_remains()) {
+    // otherwise, it is an escape.
+    if (!stream.text_remains()) {
+      throw_reader_error(stream, "incomplete string escape code", -1);
+    }
+    if (stream.peek() == 'n') {
+      stream.read();
+      str.push_back('\n');
+    } else if (stream.peek() == 't') {
+      stream.read();
+      str.push_back('\t');
+    } else if (stream.peek() == '\\') {
+      stream.read();
+      str.push_back('\\');
+    } else if (stream.peek() == '"') {
+      stream.read();
+      str.push_back('"');
+    } else if (stream.peek() == 'c') {
+      stream.read();
+      if (!stream.text_remains(2)) {
         throw_reader_error(stream, "incomplete string escape code", -1);
       }
-      if (stream.peek() == 'n') {
-        stream.read();
-        str.push_back('\n');
-      } else if (stream.peek() == 't') {
-        stream.read();
-        str.push_back('\t');
-      } else if (stream.peek() == '\\') {
-        stream.read();
-        str.push_back('\\');
-      } else if (stream.peek() == '"') {
-        stream.read();
-        str.push_back('"');
-      } else if (stream.peek() == 'c') {
-        stream.read();
-        if (!stream.text_remains(2)) {
-          throw_reader_error(stream, "incomplete string escape code", -1);
-        }
-        auto first = stream.read();
-        auto second = stream.read();
-        if (!hex_char(first) || !hex_char(second)) {
-          throw_reader_error(stream, "invalid character escape hex number", -3);
-        }
-        char hex_num[3] = {first, second, '\0'};
-        std::size_t end = 0;
-        auto value = std::stoul(hex_num, &end, 16);
-        if (end != 2) {
-          throw_reader_error(stream, "invalid character escape", -2);
-        }
-        ASSERT(value < 256);
-        str.push_back(char(value));
-      } else {
-        throw_reader_error(stream, "unknown string escape code", -1);
+      auto first = stream.read();
+      auto second = stream.read();
+      if (!hex_char(first) || !hex_char(second)) {
+        throw_reader_error(stream, "invalid character escape hex number", -3);
+      }
+      char hex_num[3] = {first, second, '\0'};
+      std::size_t end = 0;
+      auto value = std::stoul(hex_num, &end, 16);
+      if (end != 2) {
+        throw_reader_error(stream, "invalid character escape", -2);
       }
+      ASSERT(value < 256);
+      str.push_back(char(value));
     } else {
-      str.push_back(c);
+      throw_reader_error(stream, "unknown string escape code", -1);
     }
   }
 
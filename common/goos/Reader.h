@@ -25,34 +25,34 @@ namespace goos {
 
 /*!
  * Wrapper around a source of text that allows reading/peeking.
+ * Line numbers aren't tracked here, the SourceText can find them from an offset when needed.
  */
 struct TextStream {
-  explicit TextStream(std::shared_ptr<SourceText> ptr) { text = std::move(ptr); }
+  explicit TextStream(std::shared_ptr<SourceText> ptr)
+      : text(std::move(ptr)), data(text->get_text()), size(text->get_size()) {}
 
   std::shared_ptr<SourceText> text;
+  const char* data;
+  int size;
   int seek = 0;
-  int line_count = 0;
 
   char peek() {
-    ASSERT(seek < text->get_size());
-    return text->get_text()[seek];
+    ASSERT(seek < size);
+    return data[seek];
   }
 
   char peek(int i) {
-    ASSERT(seek + i < text->get_size());
-    return text->get_text()[seek + i];
+    ASSERT(seek + i < size);
+    return data[seek + i];
   }
 
   char read() {
-    ASSERT(seek < text->get_size());
-    char c = text->get_text()[seek++];
-    if (c == '\n')
-      line_count++;
-    return c;
+    ASSERT(seek < size);
+    return data[seek++];
   }
 
-  bool text_remains() { return seek < text->get_size(); }
-  bool text_remains(int i) { return seek + i < text->get_size(); }
+  bool text_remains() { return seek < size; }
+  bool text_remains(int i) { return seek + i < size; }
   void seek_past_whitespace_and_comments();
   void read_utf8_encoding(bool throw_on_error);
 };
@@ -61,9 +61,7 @@ struct TextStream {
  * A Token used for parsing.
  */
 struct Token {
-  std::shared_ptr<SourceText> source_text;
   int source_offset;
-  int source_line;
   std::string text;
 };
 
@@ -101,6 +99,7 @@ class Reader {
   void add_reader_macro(const std::string& shortcut, std::string replacement);
 
   bool m_valid_symbols_chars[256];
+  bool m_token_end_chars[256];
   bool m_valid_source_text_chars[256];
 
   bool is_valid_source_char(char c) const;
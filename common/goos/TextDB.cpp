@@ -13,6 +13,9 @@
 
 #include "TextDB.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "common/util/FileUtil.h"
 
 #include "third-party/fmt/core.h"
@@ -33,10 +36,11 @@ SourceText::SourceText(std::string r) : m_text(std::move(r)) {
 void SourceText::build_offsets() {
   m_offset_by_line.clear();
   m_offset_by_line.push_back(0);
-  for (uint32_t i = 0; i < m_text.size(); i++) {
-    if (m_text[i] == '\n') {
-      m_offset_by_line.push_back(i);
-    }
+  const char* start = m_text.data();
+  const char* end = start + m_text.size();
+  for (auto* nl = (const char*)memchr(start, '\n', end - start); nl;
+       nl = (const char*)memchr(nl + 1, '\n', end - nl - 1)) {
+    m_offset_by_line.push_back(nl - start);
   }
   m_offset_by_line.push_back(m_text.size());
 }
@@ -51,19 +55,28 @@ std::string SourceText::get_line_containing_offset(int offset) {
                        std::max(0, range.second - range.first - start_offset));
 }
 
+/*!
+ * Find the first line that ends at or after offset, or -1 if the offset is outside the text.
+ */
+int SourceText::find_line(int offset) const {
+  auto line_end = std::lower_bound(m_offset_by_line.begin() + 1, m_offset_by_line.end(), offset);
+  if (line_end == m_offset_by_line.end() || offset < m_offset_by_line.front()) {
+    return -1;
+  }
+  return line_end - (m_offset_by_line.begin() + 1);
+}
+
 /*!
  * Get the index of the line containing the character at position "offset".
- * O(n_lines) crappy implementation.
  * Error if not found.
  */
 int SourceText::get_line_idx(int offset) {
-  for (uint32_t line = 0; line < m_offset_by_line.size() - 1; line++) {
-    if (offset >= m_offset_by_line[line] && offset <= m_offset_by_line[line + 1]) {
-      return line;
-    }
+  int line = find_line(offset);
+  if (line < 0) {
+    throw std::runtime_error("Unable to get line index for character at position " +
+                             std::to_string(offset));
   }
-  throw std::runtime_error("Unable to get line index for character at position " +
-                           std::to_string(offset));
+  return line;
 }
 
 int SourceText::get_offset_of_line(int line_idx) {
@@ -74,20 +87,30 @@ int SourceText::get_offset_of_line(int line_idx) {
  * Gets the [start, end) character offset of the line containing the given offset.
  */
 std::pair<int, int> SourceText::get_containing_line(int offset) {
-  for (uint32_t line = 0; line < m_offset_by_line.size() - 1; line++) {
-    if (offset >= m_offset_by_line[line] && offset <= m_offset_by_line[line + 1]) {
-      return std::make_pair(m_offset_by_line[line], m_offset_by_line[line + 1]);
-    }
+  int line = find_line(offset);
+  if (line < 0) {
+    return std::make_pair(0, (int)m_text.size());
   }
-  return std::make_pair(0, (int)m_text.size());
+  return std::make_pair(m_offset_by_line[line], m_offset_by_line[line + 1]);
 }
 
 /*!
- * Read text from a file.
+ * Read text from a file. The file is mapped and copied once, instead of going through a stream.
  */
 FileText::FileText(const std::string& filename, const std::string& description_name)
     : m_filename(filename), m_desc_name(description_name) {
-  m_text = file_util::read_text_file(m_filename);
+  file_util::MappedFile file(m_filename);
+  m_text.assign((const char*)file.data(), file.size());
+#ifdef _WIN32
+  // match reading in text mode, which converts \r\n line endings to \n.
+  auto out = m_text.begin();
+  for (auto in = m_text.begin(); in != m_text.end(); ++in) {
+    if (*in != '\r' || in + 1 == m_text.end() || in[1] != '\n') {
+      *out++ = *in;
+    }
+  }
+  m_text.erase(out, m_text.end());
+#endif
   build_offsets();
 }
 
@@ -176,7 +199,7 @@ std::optional<TextDb::ShortInfo> TextDb::get_short_info_for(const std::shared_pt
 }
 
 std::optional<TextDb::ShortInfo> TextDb::try_get_short_info(
-    const std::shared_ptr<goos::HeapObject>& heap_obj) const {
+    const goos::HeapPtr<goos::HeapObject>& heap_obj) const {
   auto it = m_map.find(heap_obj);
   if (it != m_map.end()) {
     auto& frag = it->second.frag;
@@ -223,6 +246,19 @@ bool TextDb::has_info(const Object& o) const {
   return o.is_pair() && (m_map.find(o.heap_obj) != m_map.end());
 }
 
+/*!
+ * Get the location of a pair, or null if it doesn't have one.
+ */
+const TextRef* TextDb::try_get_ref(const Object& o) const {
+  if (o.is_pair()) {
+    auto it = m_map.find(o.heap_obj);
+    if (it != m_map.end()) {
+      return &it->second;
+    }
+  }
+  return nullptr;
+}
+
 /*!
  * Make child have the same location in the source as parent.  For example, if parent generates
  * code that we want to be associated with the parent's location in source.
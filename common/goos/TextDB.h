@@ -48,6 +48,7 @@ class SourceText {
   std::string m_text;
   std::vector<int> m_offset_by_line;
   std::pair<int, int> get_containing_line(int offset);
+  int find_line(int offset) const;
 };
 
 /*!
@@ -83,6 +84,7 @@ class FileText : public SourceText {
   FileText(const std::string& filename, const std::string& description_name);
 
   std::string get_description() { return m_desc_name; }
+  const std::string& filename() const { return m_filename; }
   ~FileText() = default;
 
  private:
@@ -112,14 +114,16 @@ class TextDb {
   std::optional<ShortInfo> get_short_info_for(const std::shared_ptr<SourceText>& frag,
                                               int offset) const;
   std::optional<ShortInfo> try_get_short_info(const Object& o) const;
-  std::optional<ShortInfo> try_get_short_info(const std::shared_ptr<goos::HeapObject>& o) const;
+  std::optional<ShortInfo> try_get_short_info(const goos::HeapPtr<goos::HeapObject>& o) const;
 
   bool has_info(const Object& o) const;
+  const TextRef* try_get_ref(const Object& o) const;
+  const std::vector<std::shared_ptr<SourceText>>& fragments() const { return m_fragments; }
   void inherit_info(const Object& parent, const Object& child);
   void clear_info();
 
  private:
   std::vector<std::shared_ptr<SourceText>> m_fragments;
-  std::unordered_map<std::shared_ptr<goos::HeapObject>, TextRef> m_map;
+  std::unordered_map<goos::HeapPtr<goos::HeapObject>, TextRef> m_map;
 };
 }  // namespace goos
@@ -9,6 +9,7 @@
 
 #include "common/log/log.h"
 #include "common/util/Assert.h"
+#include "common/util/Serializer.h"
 
 #include "third-party/fmt/core.h"
 
@@ -28,6 +29,51 @@ std::string reg_kind_to_string(RegClass kind) {
   }
 }
 
+void serialize_metadata(Serializer& ser, DefinitionMetadata* meta) {
+  bool has_info = meta->definition_info.has_value();
+  ser.from_ptr(&has_info);
+  if (has_info) {
+    if (ser.is_loading()) {
+      meta->definition_info.emplace();
+    }
+    auto& info = *meta->definition_info;
+    ser.from_str(&info.filename);
+    ser.from_ptr(&info.line_idx_to_display);
+    ser.from_ptr(&info.pos_in_line);
+    ser.from_str(&info.line_text);
+  } else if (ser.is_loading()) {
+    meta->definition_info.reset();
+  }
+  ser.from_optional_str(&meta->docstring);
+}
+
+void serialize_state_metadata(
+    Serializer& ser,
+    std::unordered_map<std::string, std::unordered_map<std::string, DefinitionMetadata>>* meta) {
+  if (ser.is_saving()) {
+    ser.save<size_t>(meta->size());
+    for (auto& [outer_name, inner] : *meta) {
+      ser.save_str(&outer_name);
+      ser.save<size_t>(inner.size());
+      for (auto& [inner_name, info] : inner) {
+        ser.save_str(&inner_name);
+        serialize_metadata(ser, &info);
+      }
+    }
+  } else {
+    meta->clear();
+    auto outer_count = ser.load<size_t>();
+    for (size_t i = 0; i < outer_count; i++) {
+      auto& inner = (*meta)[ser.load_string()];
+      auto inner_count = ser.load<size_t>();
+      for (size_t j = 0; j < inner_count; j++) {
+        auto name = ser.load_string();
+        serialize_metadata(ser, &inner[name]);
+      }
+    }
+  }
+}
+
 }  // namespace
 
 /*!
@@ -76,6 +122,17 @@ std::string MethodInfo::diff(const MethodInfo& other) const {
   return result;
 }
 
+void MethodInfo::serialize(Serializer& ser) {
+  ser.from_ptr(&id);
+  ser.from_str(&name);
+  type.serialize(ser);
+  ser.from_str(&defined_in_type);
+  ser.from_ptr(&no_virtual);
+  ser.from_ptr(&overrides_parent);
+  ser.from_ptr(&only_overrides_docstring);
+  ser.from_optional_str(&docstring);
+}
+
 /*!
  * Print a one-line description of a method (name and type)
  */
@@ -180,6 +237,20 @@ std::string Field::diff(const Field& other) const {
   return result;
 }
 
+void Field::serialize(Serializer& ser) {
+  ser.from_str(&m_name);
+  m_type.serialize(ser);
+  ser.from_ptr(&m_offset);
+  ser.from_ptr(&m_inline);
+  ser.from_ptr(&m_dynamic);
+  ser.from_ptr(&m_array);
+  ser.from_ptr(&m_array_size);
+  ser.from_ptr(&m_alignment);
+  ser.from_ptr(&m_skip_in_static_decomp);
+  ser.from_ptr(&m_placed_by_user);
+  ser.from_ptr(&m_field_score);
+}
+
 /////////////
 // Type
 /////////////
@@ -192,6 +263,8 @@ Type::Type(std::string parent, std::string name, bool is_boxed, int heap_base)
       m_is_boxed(is_boxed),
       m_heap_base(heap_base) {
   m_runtime_name = m_name;
+  m_interned_parent = TypeName::intern(m_parent);
+  m_interned_name = TypeName::intern(m_name);
 }
 
 /*!
@@ -344,7 +417,8 @@ std::string Type::common_type_info_diff(const Type& other) const {
  * parents.
  */
 bool Type::has_parent() const {
-  return m_name != "object" && !m_parent.empty();
+  static const TypeName* object_name = TypeName::intern("object");
+  return m_interned_name != object_name && m_interned_parent != TypeName::empty();
 }
 
 /*!
@@ -466,6 +540,42 @@ void Type::add_state(const std::string& name, const TypeSpec& type) {
   }
 }
 
+void Type::serialize(Serializer& ser) {
+  serialize_metadata(ser, &m_metadata);
+  serialize_state_metadata(ser, &m_virtual_state_definition_meta);
+  serialize_state_metadata(ser, &m_state_definition_meta);
+  ser.from_serializable_vector(&m_methods);
+
+  size_t state_count = m_states.size();
+  ser.from_ptr(&state_count);
+  if (ser.is_saving()) {
+    for (auto& [name, type] : m_states) {
+      ser.save_str(&name);
+      type.serialize(ser);
+    }
+  } else {
+    m_states.clear();
+    for (size_t i = 0; i < state_count; i++) {
+      auto name = ser.load_string();
+      m_states[name].serialize(ser);
+    }
+  }
+
+  m_new_method_info.serialize(ser);
+  ser.from_ptr(&m_new_method_info_defined);
+  ser.from_ptr(&m_generate_inspect);
+  ser.from_str(&m_parent);
+  ser.from_str(&m_name);
+  if (ser.is_loading()) {
+    m_interned_parent = TypeName::intern(m_parent);
+    m_interned_name = TypeName::intern(m_name);
+  }
+  ser.from_ptr(&m_allow_in_runtime);
+  ser.from_str(&m_runtime_name);
+  ser.from_ptr(&m_is_boxed);
+  ser.from_ptr(&m_heap_base);
+}
+
 std::string Type::incompatible_diff(const Type& other) const {
   return fmt::format("diff is not implemented between {} and {}\n", typeid((*this)).name(),
                      typeid(other).name());
@@ -638,6 +748,14 @@ void ValueType::inherit(const ValueType* parent) {
   m_reg_kind = parent->m_reg_kind;
 }
 
+void ValueType::serialize(Serializer& ser) {
+  Type::serialize(ser);
+  ser.from_ptr(&m_size);
+  ser.from_ptr(&m_offset);
+  ser.from_ptr(&m_sign_extend);
+  ser.from_ptr(&m_reg_kind);
+}
+
 std::string ValueType::print() const {
   return fmt::format(
       "[ValueType] {}\n parent: {}\n boxed: {}\n size: {}\n sext: {}\n register: {}\n{}", m_name,
@@ -767,6 +885,18 @@ void StructureType::inherit(StructureType* parent) {
   m_idx_of_first_unique_field = m_fields.size();
 }
 
+void StructureType::serialize(Serializer& ser) {
+  Type::serialize(ser);
+  ser.from_serializable_vector(&m_fields);
+  ser.from_ptr(&m_dynamic);
+  ser.from_ptr(&m_size_in_mem);
+  ser.from_ptr(&m_pack);
+  ser.from_ptr(&m_allow_misalign);
+  ser.from_ptr(&m_offset);
+  ser.from_ptr(&m_always_stack_singleton);
+  ser.from_ptr(&m_idx_of_first_unique_field);
+}
+
 bool StructureType::operator==(const Type& other) const {
   if (typeid(*this) != typeid(other)) {
     return false;
@@ -967,6 +1097,7 @@ bool BasicType::operator==(const Type& other) const {
          m_offset == p_other->m_offset &&
          m_idx_of_first_unique_field == p_other->m_idx_of_first_unique_field &&
          m_final == p_other->m_final &&
+         m_no_devirtualize == p_other->m_no_devirtualize &&
          m_always_stack_singleton == p_other->m_always_stack_singleton;
   // clang-format on
 }
@@ -983,9 +1114,20 @@ std::string BasicType::diff_impl(const Type& other_) const {
     result += fmt::format("final: {} vs. {}\n", m_final, other.m_final);
   }
 
+  if (m_no_devirtualize != other.m_no_devirtualize) {
+    result += fmt::format("no-devirtualize: {} vs. {}\n", m_no_devirtualize,
+                          other.m_no_devirtualize);
+  }
+
   return result;
 }
 
+void BasicType::serialize(Serializer& ser) {
+  StructureType::serialize(ser);
+  ser.from_ptr(&m_final);
+  ser.from_ptr(&m_no_devirtualize);
+}
+
 /////////////////
 // Bitfield
 /////////////////
@@ -1046,6 +1188,14 @@ std::string BitField::print() const {
   return fmt::format("[{} {}] sz {} off {}", name(), type().print(), size(), offset());
 }
 
+void BitField::serialize(Serializer& ser) {
+  m_type.serialize(ser);
+  ser.from_str(&m_name);
+  ser.from_ptr(&m_offset);
+  ser.from_ptr(&m_size);
+  ser.from_ptr(&m_skip_in_static_decomp);
+}
+
 std::string BitFieldType::print() const {
   std::string result;
   result += fmt::format("Parent type: {}\nFields:\n", get_parent());
@@ -1104,6 +1254,11 @@ std::string BitFieldType::diff_impl(const Type& other_) const {
   return result;
 }
 
+void BitFieldType::serialize(Serializer& ser) {
+  ValueType::serialize(ser);
+  ser.from_serializable_vector(&m_fields);
+}
+
 /////////////////
 // Enum
 /////////////////
@@ -1169,3 +1324,22 @@ std::string EnumType::diff_impl(const Type& other_) const {
 
   return result;
 }
+
+void EnumType::serialize(Serializer& ser) {
+  ValueType::serialize(ser);
+  ser.from_ptr(&m_is_bitfield);
+  size_t count = m_entries.size();
+  ser.from_ptr(&count);
+  if (ser.is_saving()) {
+    for (auto& [name, value] : m_entries) {
+      ser.save_str(&name);
+      ser.save<s64>(value);
+    }
+  } else {
+    m_entries.clear();
+    for (size_t i = 0; i < count; i++) {
+      auto name = ser.load_string();
+      m_entries[name] = ser.load<s64>();
+    }
+  }
+}
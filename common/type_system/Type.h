@@ -37,6 +37,7 @@ struct MethodInfo {
   bool operator!=(const MethodInfo& other) const { return !((*this) == other); }
   std::string print_one_line() const;
   std::string diff(const MethodInfo& other) const;
+  void serialize(Serializer& ser);
 };
 
 /*!
@@ -84,6 +85,8 @@ class Type {
   std::string get_name() const;
   std::string get_runtime_name() const;
   std::string get_parent() const;
+  const TypeName* get_interned_name() const { return m_interned_name; }
+  const TypeName* get_interned_parent() const { return m_interned_parent; }
   void set_runtime_type(std::string name);
   bool get_my_method(const std::string& name, MethodInfo* out) const;
   bool get_my_method(int id, MethodInfo* out) const;
@@ -116,6 +119,9 @@ class Type {
 
   bool gen_inspect() const { return m_generate_inspect; }
 
+  // save or load everything about this type. Children save their own data after their parent's.
+  virtual void serialize(Serializer& ser);
+
   DefinitionMetadata m_metadata;
   std::unordered_map<std::string, std::unordered_map<std::string, DefinitionMetadata>>
       m_virtual_state_definition_meta = {};
@@ -135,6 +141,8 @@ class Type {
 
   std::string m_parent;  // the parent type (is empty for none and object)
   std::string m_name;
+  const TypeName* m_interned_parent = nullptr;
+  const TypeName* m_interned_name = nullptr;
   bool m_allow_in_runtime = true;
   std::string m_runtime_name;
   bool m_is_boxed = false;  // does this have runtime type information?
@@ -189,6 +197,7 @@ class ValueType : public Type {
   std::string diff_impl(const Type& other) const override;
   ~ValueType() = default;
   void inherit(const ValueType* parent);
+  void serialize(Serializer& ser) override;
 
  protected:
   friend class TypeSystem;
@@ -236,6 +245,7 @@ class Field {
   bool operator==(const Field& other) const;
   bool operator!=(const Field& other) const { return !((*this) == other); }
   std::string diff(const Field& other) const;
+  void serialize(Serializer& ser);
 
   int alignment() const {
     ASSERT(m_alignment != -1);
@@ -302,6 +312,7 @@ class StructureType : public ReferenceType {
   void set_allow_misalign(bool misalign) { m_allow_misalign = misalign; }
   void set_gen_inspect(bool gen_inspect) { m_generate_inspect = gen_inspect; }
   int size() const { return m_size_in_mem; }
+  void serialize(Serializer& ser) override;
 
  protected:
   friend class TypeSystem;
@@ -334,12 +345,16 @@ class BasicType : public StructureType {
   std::string print() const override;
   bool final() const { return m_final; }
   void set_final() { m_final = true; }
+  bool no_devirtualize() const { return m_no_devirtualize; }
+  void set_no_devirtualize() { m_no_devirtualize = true; }
   ~BasicType() = default;
   bool operator==(const Type& other) const override;
   std::string diff_impl(const Type& other) const override;
+  void serialize(Serializer& ser) override;
 
  protected:
   bool m_final = false;
+  bool m_no_devirtualize = false;
 };
 
 class BitField {
@@ -355,6 +370,7 @@ class BitField {
   bool operator!=(const BitField& other) const { return !((*this) == other); }
   std::string diff(const BitField& other) const;
   std::string print() const;
+  void serialize(Serializer& ser);
 
  private:
   TypeSpec m_type;
@@ -373,6 +389,7 @@ class BitFieldType : public ValueType {
   const std::vector<BitField>& fields() const { return m_fields; }
   std::string diff_impl(const Type& other) const override;
   void set_gen_inspect(bool gen_inspect) { m_generate_inspect = gen_inspect; }
+  void serialize(Serializer& ser) override;
 
  private:
   friend class TypeSystem;
@@ -390,6 +407,7 @@ class EnumType : public ValueType {
   const std::unordered_map<std::string, s64>& entries() const { return m_entries; }
   bool is_bitfield() const { return m_is_bitfield; }
   std::string diff_impl(const Type& other) const override;
+  void serialize(Serializer& ser) override;
 
  private:
   friend class TypeSystem;
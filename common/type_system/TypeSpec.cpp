@@ -5,19 +5,66 @@
 
 #include "TypeSpec.h"
 
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include "common/util/Serializer.h"
 
 #include "third-party/fmt/core.h"
 
+namespace {
+struct TypeNameTable {
+  std::shared_mutex mutex;
+  // keys point into the TypeNames, which are never freed.
+  std::unordered_map<std::string_view, const TypeName*> by_name;
+  u32 next_id = 0;
+};
+
+TypeNameTable& type_name_table() {
+  // intentionally leaked, so TypeSpecs in static objects can still be destroyed during exit.
+  static auto* table = new TypeNameTable;
+  return *table;
+}
+}  // namespace
+
+const TypeName* TypeName::intern(const std::string& name) {
+  auto& table = type_name_table();
+  {
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.by_name.find(name);
+    if (it != table.by_name.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(table.mutex);
+  auto it = table.by_name.find(name);
+  if (it != table.by_name.end()) {
+    return it->second;  // another thread added it
+  }
+  auto* result = new TypeName{name, table.next_id++};
+  table.by_name[result->name] = result;
+  return result;
+}
+
+const TypeName* TypeName::empty() {
+  static const TypeName* empty_name = intern("");
+  return empty_name;
+}
+
 bool TypeTag::operator==(const TypeTag& other) const {
   return name == other.name && value == other.value;
 }
 
 std::string TypeSpec::print() const {
   if ((!m_arguments || m_arguments->empty()) && m_tags.empty()) {
-    return m_type;
+    return m_type->name;
   } else {
-    std::string result = "(" + m_type;
+    std::string result = "(" + m_type->name;
 
     if (m_arguments) {
       for (auto& x : *m_arguments) {
@@ -33,6 +80,40 @@ std::string TypeSpec::print() const {
   }
 }
 
+void TypeSpec::serialize(Serializer& ser) {
+  if (ser.is_saving()) {
+    ser.save_str(&m_type->name);
+  } else {
+    m_type = TypeName::intern(ser.load_string());
+  }
+
+  // keep the difference between no arguments and an empty argument list.
+  bool has_arguments = m_arguments;
+  ser.from_ptr(&has_arguments);
+  if (has_arguments) {
+    size_t count = m_arguments ? m_arguments->size() : 0;
+    ser.from_ptr(&count);
+    if (ser.is_loading()) {
+      delete m_arguments;
+      m_arguments = new std::vector<TypeSpec>(count);
+    }
+    for (auto& arg : *m_arguments) {
+      arg.serialize(ser);
+    }
+  } else if (ser.is_loading()) {
+    delete m_arguments;
+    m_arguments = nullptr;
+  }
+
+  size_t tag_count = m_tags.size();
+  ser.from_ptr(&tag_count);
+  m_tags.resize(tag_count);
+  for (auto& tag : m_tags) {
+    ser.from_str(&tag.name);
+    ser.from_str(&tag.value);
+  }
+}
+
 bool TypeSpec::operator!=(const TypeSpec& other) const {
   return !(other == *this);
 }
@@ -55,7 +136,7 @@ bool TypeSpec::operator==(const TypeSpec& other) const {
 
 TypeSpec TypeSpec::substitute_for_method_call(const std::string& method_type) const {
   TypeSpec result;
-  result.m_type = (m_type == "_type_") ? method_type : m_type;
+  result.m_type = (m_type->name == "_type_") ? TypeName::intern(method_type) : m_type;
   if (m_arguments) {
     result.m_arguments = new std::vector<TypeSpec>();
     for (const auto& x : *m_arguments) {
@@ -70,7 +151,7 @@ bool TypeSpec::is_compatible_child_method(const TypeSpec& implementation,
                                           const std::string& child_type,
                                           int* bad_arg_idx_out) const {
   bool ok = implementation.m_type == m_type ||
-            (m_type == "_type_" && implementation.m_type == child_type);
+            (m_type->name == "_type_" && implementation.m_type->name == child_type);
   if (!ok || implementation.arg_count() != arg_count()) {
     if (bad_arg_idx_out)
       *bad_arg_idx_out = -1;
@@ -9,9 +9,28 @@
 #include <string>
 #include <vector>
 
+#include "common/common_types.h"
 #include "common/util/Assert.h"
 #include "common/util/SmallVector.h"
 
+class Serializer;
+
+/*!
+ * The name of a type. Each name is stored exactly once for the whole program and never freed, so
+ * two TypeNames are the same type if they are the same pointer, and each has a small integer id
+ * that can be used to index tables. TypeSpecs refer to their base type with one of these, so they
+ * can be copied and compared without touching strings.
+ */
+struct TypeName {
+  std::string name;
+  u32 id;
+
+  // Get the TypeName for a name, creating it if needed. Safe to call from multiple threads.
+  static const TypeName* intern(const std::string& name);
+  // The TypeName for "", used by default constructed TypeSpecs.
+  static const TypeName* empty();
+};
+
 /*!
  * A :name value modifier to apply to a type.
  */
@@ -34,10 +53,27 @@ struct TypeTag {
 class TypeSpec {
  public:
   TypeSpec() = default;
-  TypeSpec(const std::string& type) : m_type(type) {}
+  TypeSpec(const std::string& type) : m_type(TypeName::intern(type)) {}
+  TypeSpec(const TypeName* type) : m_type(type) {}
 
   TypeSpec(const std::string& type, const std::vector<TypeSpec>& arguments)
-      : m_type(type), m_arguments(new std::vector<TypeSpec>(arguments)) {}
+      : m_type(TypeName::intern(type)), m_arguments(new std::vector<TypeSpec>(arguments)) {}
+
+  TypeSpec(TypeSpec&& other) noexcept
+      : m_type(other.m_type), m_arguments(other.m_arguments), m_tags(std::move(other.m_tags)) {
+    other.m_arguments = nullptr;
+  }
+
+  TypeSpec& operator=(TypeSpec&& other) noexcept {
+    if (this != &other) {
+      delete m_arguments;
+      m_type = other.m_type;
+      m_arguments = other.m_arguments;
+      m_tags = std::move(other.m_tags);
+      other.m_arguments = nullptr;
+    }
+    return *this;
+  }
 
   TypeSpec(const TypeSpec& other) {
     m_type = other.m_type;
@@ -95,7 +131,9 @@ class TypeSpec {
   void modify_tag(const std::string& tag_name, const std::string& tag_value);
   void add_or_modify_tag(const std::string& tag_name, const std::string& tag_value);
 
-  const std::string& base_type() const { return m_type; }
+  const std::string& base_type() const { return m_type->name; }
+  const TypeName* base_type_name() const { return m_type; }
+  u32 base_type_id() const { return m_type->id; }
 
   bool has_single_arg() const {
     if (m_arguments) {
@@ -149,9 +187,11 @@ class TypeSpec {
 
   const std::vector<TypeTag>& tags() const { return m_tags; }
 
+  void serialize(Serializer& ser);
+
  private:
   friend class TypeSystem;
-  std::string m_type;
+  const TypeName* m_type = TypeName::empty();
   // hiding this behind a pointer makes things faster in the case where we have no
   // arguments (most of the time) and makes the type analysis pass in the decompiler 2x faster.
   std::vector<TypeSpec>* m_arguments = nullptr;
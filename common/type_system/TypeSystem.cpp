@@ -12,6 +12,7 @@
 
 #include "common/log/log.h"
 #include "common/util/Assert.h"
+#include "common/util/Serializer.h"
 #include "common/util/math_util.h"
 
 #include "third-party/fmt/color.h"
@@ -30,8 +31,75 @@ template <typename... Args>
   throw std::runtime_error(
       fmt::format("Type Error: {}", fmt::format(str, std::forward<Args>(args)...)));
 }
+
+thread_local TypeLookupRecorder* g_current_lookup_recorder = nullptr;
+
+// the class of a serialized type
+enum class TypeKind : u8 { NULL_TYPE, VALUE, STRUCTURE, BASIC, BITFIELD, ENUM };
+
+TypeKind get_type_kind(const Type* type) {
+  // check children before their parents
+  if (dynamic_cast<const EnumType*>(type)) {
+    return TypeKind::ENUM;
+  }
+  if (dynamic_cast<const BitFieldType*>(type)) {
+    return TypeKind::BITFIELD;
+  }
+  if (dynamic_cast<const ValueType*>(type)) {
+    return TypeKind::VALUE;
+  }
+  if (dynamic_cast<const BasicType*>(type)) {
+    return TypeKind::BASIC;
+  }
+  if (dynamic_cast<const StructureType*>(type)) {
+    return TypeKind::STRUCTURE;
+  }
+  if (dynamic_cast<const NullType*>(type)) {
+    return TypeKind::NULL_TYPE;
+  }
+  throw std::runtime_error(fmt::format("Cannot serialize type {}", type->get_name()));
+}
+
+/*!
+ * Make a type of the given kind, which will be filled in by loading it.
+ */
+std::unique_ptr<Type> make_type_for_load(TypeKind kind) {
+  switch (kind) {
+    case TypeKind::NULL_TYPE:
+      return std::make_unique<NullType>("");
+    case TypeKind::VALUE:
+      return std::make_unique<ValueType>("", "", false, 0, false, RegClass::INVALID);
+    case TypeKind::STRUCTURE:
+      return std::make_unique<StructureType>("", "", false, false, false, 0);
+    case TypeKind::BASIC:
+      return std::make_unique<BasicType>("", "", false, 0);
+    case TypeKind::BITFIELD:
+      return std::make_unique<BitFieldType>("", "", 0, false);
+    case TypeKind::ENUM: {
+      ValueType parent("", "", false, 0, false, RegClass::INVALID);
+      return std::make_unique<EnumType>(&parent, "", false, std::unordered_map<std::string, s64>());
+    }
+    default:
+      throw std::runtime_error(fmt::format("Invalid type kind {}", (int)kind));
+  }
+}
 }  // namespace
 
+TypeLookupRecorder::TypeLookupRecorder() : m_prev(g_current_lookup_recorder) {
+  g_current_lookup_recorder = this;
+}
+
+TypeLookupRecorder::~TypeLookupRecorder() {
+  ASSERT(g_current_lookup_recorder == this);
+  g_current_lookup_recorder = m_prev;
+}
+
+void TypeLookupRecorder::record(const std::string& type_name) {
+  if (g_current_lookup_recorder) {
+    g_current_lookup_recorder->m_types.insert(type_name);
+  }
+}
+
 TypeSystem::TypeSystem() {
   // the "none" and "_type_" types are included by default.
   add_type("none", std::make_unique<NullType>("none"));
@@ -69,11 +137,14 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
                   kv->second->get_name(), kv->second->print(), type->print());
         // extra dangerous, we have allowed type redefinition!
 
+        add_child_type(type->get_parent(), name);
+
         // keep the unique_ptr around, just in case somebody references this old type pointer.
         m_old_types.push_back(std::move(m_types[name]));
 
         // update the type
         m_types[name] = std::move(type);
+        update_type_id_table(name);
       } else {
         throw_typesystem_error(
             "Inconsistent type definition. Type {} was originally\n{}\nand is redefined "
@@ -96,9 +167,12 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
         throw_typesystem_error("Cannot create new type {}. The parent type {} is not defined.\n",
                                type->get_name(), type->get_parent());
       }
+
+      add_child_type(type->get_parent(), name);
     }
 
     m_types[name] = std::move(type);
+    update_type_id_table(name);
     auto fwd_it = m_forward_declared_types.find(name);
     if (fwd_it != m_forward_declared_types.end()) {
       // need to check parent is correct.
@@ -113,6 +187,17 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
   return m_types[name].get();
 }
 
+/*!
+ * Point the entry for this type in m_types_by_id to the current definition in m_types.
+ */
+void TypeSystem::update_type_id_table(const std::string& name) {
+  auto id = TypeName::intern(name)->id;
+  if (id >= m_types_by_id.size()) {
+    m_types_by_id.resize(id + 1, nullptr);
+  }
+  m_types_by_id[id] = m_types.at(name).get();
+}
+
 /*!
  * Inform the type system that there will eventually be a type named "name".
  * This will allow the type system to generate TypeSpecs for this type, but not access detailed
@@ -161,6 +246,7 @@ void TypeSystem::forward_declare_type_as(const std::string& new_type,
     return;
   }
 
+  add_child_type(parent_type, new_type);
   auto fwd_it = m_forward_declared_types.find(new_type);
   if (fwd_it == m_forward_declared_types.end()) {
     m_forward_declared_types[new_type] = parent_type;
@@ -258,6 +344,7 @@ int TypeSystem::get_type_method_count(const std::string& name) const {
 }
 
 std::optional<int> TypeSystem::try_get_type_method_count(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   auto type_it = m_types.find(name);
   if (type_it != m_types.end()) {
     return get_next_method_id(type_it->second.get());
@@ -350,6 +437,7 @@ DerefInfo TypeSystem::get_deref_info(const TypeSpec& ts) const {
  * If you really need a TypeSpec which refers to a non-existent type, just construct your own.
  */
 TypeSpec TypeSystem::make_typespec(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   if (m_types.find(name) != m_types.end() ||
       m_forward_declared_types.find(name) != m_forward_declared_types.end()) {
     return TypeSpec(name);
@@ -359,6 +447,7 @@ TypeSpec TypeSystem::make_typespec(const std::string& name) const {
 }
 
 bool TypeSystem::fully_defined_type_exists(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   return m_types.find(name) != m_types.end();
 }
 
@@ -367,6 +456,7 @@ bool TypeSystem::fully_defined_type_exists(const TypeSpec& type) const {
 }
 
 bool TypeSystem::partially_defined_type_exists(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   return m_forward_declared_types.find(name) != m_forward_declared_types.end();
 }
 
@@ -424,6 +514,7 @@ TypeSpec TypeSystem::make_inline_array_typespec(const TypeSpec& type) const {
  * lookup_type to find the most up-to-date type information.
  */
 Type* TypeSystem::lookup_type(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   auto kv = m_types.find(name);
   if (kv != m_types.end()) {
     return kv->second.get();
@@ -464,6 +555,7 @@ Type* TypeSystem::lookup_type_allow_partial_def(const TypeSpec& ts) const {
  * forward defined as a basic or structure, just get basic/structure.
  */
 Type* TypeSystem::lookup_type_allow_partial_def(const std::string& name) const {
+  TypeLookupRecorder::record(name);
   // look up fully defined types first:
   auto kv = m_types.find(name);
   if (kv != m_types.end()) {
@@ -494,6 +586,21 @@ Type* TypeSystem::lookup_type_allow_partial_def(const std::string& name) const {
   return result;
 }
 
+/*!
+ * Same as lookup_type_allow_partial_def, but fully defined types are found with an array lookup
+ * instead of hashing the name.
+ */
+Type* TypeSystem::lookup_interned_allow_partial_def(const TypeName* name) const {
+  if (name->id < m_types_by_id.size()) {
+    auto* result = m_types_by_id[name->id];
+    if (result) {
+      TypeLookupRecorder::record(name->name);
+      return result;
+    }
+  }
+  return lookup_type_allow_partial_def(name->name);
+}
+
 /*!
  * Get load size for a type.  Will succeed if one of the two conditions is true:
  * - Is a fully defined type.
@@ -501,6 +608,7 @@ Type* TypeSystem::lookup_type_allow_partial_def(const std::string& name) const {
  * This should be safe to use to load a value from a field.
  */
 int TypeSystem::get_load_size_allow_partial_def(const TypeSpec& ts) const {
+  TypeLookupRecorder::record(ts.base_type());
   auto fully_defined_it = m_types.find(ts.base_type());
   if (fully_defined_it != m_types.end()) {
     return fully_defined_it->second->get_load_size();
@@ -731,6 +839,7 @@ MethodInfo TypeSystem::lookup_method(const std::string& type_name,
 bool TypeSystem::try_lookup_method(const std::string& type_name,
                                    const std::string& method_name,
                                    MethodInfo* info) const {
+  TypeLookupRecorder::record(type_name);
   auto kv = m_types.find(type_name);
   if (kv == m_types.end()) {
     // try to look up a forward declared type.
@@ -751,6 +860,7 @@ bool TypeSystem::try_lookup_method(const std::string& type_name,
 bool TypeSystem::try_lookup_method(const std::string& type_name,
                                    int method_id,
                                    MethodInfo* info) const {
+  TypeLookupRecorder::record(type_name);
   auto kv = m_types.find(type_name);
   if (kv == m_types.end()) {
     return false;
@@ -1555,7 +1665,8 @@ bool TypeSystem::typecheck_and_throw(const TypeSpec& expected,
                                      bool allow_type_alias) const {
   bool success = true;
   // first, typecheck the base types:
-  if (!typecheck_base_types(expected.base_type(), actual.base_type(), allow_type_alias)) {
+  if (!typecheck_base_types(expected.base_type_name(), actual.base_type_name(),
+                            allow_type_alias)) {
     success = false;
   }
 
@@ -1617,53 +1728,57 @@ bool TypeSystem::typecheck_and_throw(const TypeSpec& expected,
 /*!
  * Is actual of type expected? For base types.
  */
-bool TypeSystem::typecheck_base_types(const std::string& input_expected,
-                                      const std::string& input_actual,
+bool TypeSystem::typecheck_base_types(const std::string& expected,
+                                      const std::string& actual,
                                       bool allow_alias) const {
-  std::string expected = input_expected;
-  std::string actual = input_actual;
+  return typecheck_base_types(TypeName::intern(expected), TypeName::intern(actual), allow_alias);
+}
 
-  // the unit types aren't picky.
-  if (expected == "meters") {
-    expected = "float";
-  }
+bool TypeSystem::typecheck_base_types(const TypeName* expected,
+                                      const TypeName* actual,
+                                      bool allow_alias) const {
+  static const TypeName* meters_name = TypeName::intern("meters");
+  static const TypeName* seconds_name = TypeName::intern("seconds");
+  static const TypeName* degrees_name = TypeName::intern("degrees");
+  static const TypeName* float_name = TypeName::intern("float");
+  static const TypeName* time_frame_name = TypeName::intern("time-frame");
+  static const TypeName* int_name = TypeName::intern("int");
 
-  if (expected == "seconds") {
-    expected = "time-frame";
+  // the unit types aren't picky.
+  if (expected == meters_name || expected == degrees_name) {
+    expected = float_name;
   }
 
-  if (actual == "seconds") {
-    actual = "time-frame";
+  if (expected == seconds_name) {
+    expected = time_frame_name;
   }
 
-  if (expected == "degrees") {
-    expected = "float";
+  if (actual == seconds_name) {
+    actual = time_frame_name;
   }
 
   // the decompiler prefers no aliasing so it can detect casts properly
   if (allow_alias) {
-    if (expected == "time-frame") {
-      expected = "int";
+    if (expected == time_frame_name) {
+      expected = int_name;
     }
 
-    if (actual == "time-frame") {
-      actual = "int";
+    if (actual == time_frame_name) {
+      actual = int_name;
     }
   }
 
   // just to make sure it exists.
-  lookup_type_allow_partial_def(expected);
+  lookup_interned_allow_partial_def(expected);
 
-  if (expected == actual || expected == lookup_type_allow_partial_def(actual)->get_name()) {
-    lookup_type_allow_partial_def(actual);  // make sure it exists
+  auto actual_type = lookup_interned_allow_partial_def(actual);
+  if (expected == actual || expected == actual_type->get_interned_name()) {
     return true;
   }
 
-  std::string actual_name = actual;
-  auto actual_type = lookup_type_allow_partial_def(actual_name);
   while (actual_type->has_parent()) {
-    actual_name = actual_type->get_parent();
-    actual_type = lookup_type_allow_partial_def(actual_name);
+    auto actual_name = actual_type->get_interned_parent();
+    actual_type = lookup_interned_allow_partial_def(actual_name);
 
     if (expected == actual_name) {
       return true;
@@ -1674,6 +1789,7 @@ bool TypeSystem::typecheck_base_types(const std::string& input_expected,
 }
 
 EnumType* TypeSystem::try_enum_lookup(const std::string& type_name) const {
+  TypeLookupRecorder::record(type_name);
   auto it = m_types.find(type_name);
   if (it != m_types.end()) {
     return dynamic_cast<EnumType*>(it->second.get());
@@ -1686,10 +1802,14 @@ EnumType* TypeSystem::try_enum_lookup(const TypeSpec& type) const {
 }
 
 /*!
- * Get a path from type to object.
+ * Get a path from type to object. Types without a parent, like object and none, are their own path.
  */
 std::vector<std::string> TypeSystem::get_path_up_tree(const std::string& type) const {
-  auto parent = lookup_type_allow_partial_def(type)->get_parent();
+  auto type_info = lookup_type_allow_partial_def(type);
+  if (!type_info->has_parent()) {
+    return {type};
+  }
+  auto parent = type_info->get_parent();
   std::vector<std::string> path = {type};
   path.push_back(parent);
   auto parent_type = lookup_type_allow_partial_def(parent);
@@ -1706,25 +1826,40 @@ std::vector<std::string> TypeSystem::get_path_up_tree(const std::string& type) c
 /*!
  * Lowest common ancestor of two base types.
  */
-std::string TypeSystem::lca_base(const std::string& a, const std::string& b) const {
+const TypeName* TypeSystem::lca_base(const TypeName* a, const TypeName* b) const {
+  static const TypeName* none_name = TypeName::intern("none");
   if (a == b) {
     return a;
   }
 
-  if (a == "none" || b == "none") {
-    return "none";
+  if (a == none_name || b == none_name) {
+    return none_name;
   }
 
-  auto a_up = get_path_up_tree(a);
-  auto b_up = get_path_up_tree(b);
+  // same as get_path_up_tree, but without strings.
+  auto path_up_tree = [&](const TypeName* type) {
+    cu::SmallVector<const TypeName*, 16> path;
+    path.push_back(type);
+    auto parent_type = lookup_interned_allow_partial_def(type);
+    path.push_back(parent_type->get_interned_parent());
+    parent_type = lookup_interned_allow_partial_def(parent_type->get_interned_parent());
+    while (parent_type->has_parent()) {
+      path.push_back(parent_type->get_interned_parent());
+      parent_type = lookup_interned_allow_partial_def(parent_type->get_interned_parent());
+    }
+    return path;
+  };
+
+  auto a_up = path_up_tree(a);
+  auto b_up = path_up_tree(b);
 
   int ai = a_up.size() - 1;
   int bi = b_up.size() - 1;
 
-  std::string* result = nullptr;
+  const TypeName* result = nullptr;
   while (ai >= 0 && bi >= 0) {
-    if (a_up.at(ai) == b_up.at(bi)) {
-      result = &a_up.at(ai);
+    if (a_up[ai] == b_up[bi]) {
+      result = a_up[ai];
     } else {
       break;
     }
@@ -1733,7 +1868,7 @@ std::string TypeSystem::lca_base(const std::string& a, const std::string& b) con
   }
 
   ASSERT(result);
-  return *result;
+  return result;
 }
 
 /*!
@@ -1743,10 +1878,12 @@ std::string TypeSystem::lca_base(const std::string& a, const std::string& b) con
  * (lca(a, b) lca(b, d)).
  */
 TypeSpec TypeSystem::lowest_common_ancestor(const TypeSpec& a, const TypeSpec& b) const {
-  auto result = make_typespec(lca_base(a.base_type(), b.base_type()));
-  if (result == TypeSpec("function") && a.arg_count() == 2 && b.arg_count() == 2 &&
-      (a.get_arg(0) == TypeSpec("_varargs_") || b.get_arg(0) == TypeSpec("_varargs_"))) {
-    return TypeSpec("function");
+  static const TypeSpec function_ts("function");
+  static const TypeSpec varargs_ts("_varargs_");
+  TypeSpec result(lca_base(a.base_type_name(), b.base_type_name()));
+  if (result == function_ts && a.arg_count() == 2 && b.arg_count() == 2 &&
+      (a.get_arg(0) == varargs_ts || b.get_arg(0) == varargs_ts)) {
+    return function_ts;
   }
   if (!a.empty() && !b.empty() && a.arg_count() == b.arg_count()) {
     // recursively add arguments
@@ -2148,6 +2285,7 @@ bool TypeSystem::should_use_virtual_methods(const Type* type, int method_id) con
 }
 
 bool TypeSystem::should_use_virtual_methods(const TypeSpec& type, int method_id) const {
+  TypeLookupRecorder::record(type.base_type());
   auto it = m_types.find(type.base_type());
   if (it != m_types.end()) {
     // it's a fully defined type
@@ -2167,3 +2305,128 @@ bool TypeSystem::should_use_virtual_methods(const TypeSpec& type, int method_id)
     }
   }
 }
+
+/*!
+ * Does this type have a child type, or a forward declaration of one?
+ */
+bool TypeSystem::has_child_types(const std::string& type_name) const {
+  return m_types_with_children.find(type_name) != m_types_with_children.end();
+}
+
+/*!
+ * Can method calls on this type skip the lookup of the runtime type? This is true if the type is a
+ * basic that has no child types so far and doesn't have the :no-devirtualize option. The type is
+ * remembered, and it becomes an error to add a child type to it later, because the calls compiled
+ * with this assumption would ignore the child's methods.
+ */
+bool TypeSystem::try_assume_leaf_type(const std::string& type_name) {
+  auto it = m_types.find(type_name);
+  if (it == m_types.end()) {
+    return false;
+  }
+  auto as_basic = dynamic_cast<const BasicType*>(it->second.get());
+  if (!as_basic || as_basic->no_devirtualize() || has_child_types(type_name)) {
+    return false;
+  }
+  m_assumed_leaf_types.insert(type_name);
+  return true;
+}
+
+/*!
+ * Record that parent has a child type.
+ */
+void TypeSystem::add_child_type(const std::string& parent, const std::string& child) {
+  if (m_assumed_leaf_types.find(parent) != m_assumed_leaf_types.end()) {
+    throw_typesystem_error(
+        "Cannot create type {}. Method calls on its parent {} were already compiled assuming {} "
+        "has no child types. Add :no-devirtualize to the deftype of {}, or turn off the "
+        "devirtualize-leaf-types setting.\n",
+        child, parent, parent, parent);
+  }
+  m_types_with_children.insert(parent);
+}
+
+void TypeSystem::serialize(Serializer& ser) {
+  size_t type_count = m_types.size();
+  ser.from_ptr(&type_count);
+  if (ser.is_saving()) {
+    // sorted, so the same types always save the same way.
+    std::vector<std::string> names;
+    for (auto& [name, type] : m_types) {
+      names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) {
+      auto& type = m_types.at(name);
+      ser.save<TypeKind>(get_type_kind(type.get()));
+      type->serialize(ser);
+    }
+  } else {
+    // like a redefinition, keep the old types alive in case anything still points to them.
+    for (auto& [name, type] : m_types) {
+      m_old_types.push_back(std::move(type));
+    }
+    m_types.clear();
+    m_types_by_id.clear();
+    for (size_t i = 0; i < type_count; i++) {
+      auto type = make_type_for_load(ser.load<TypeKind>());
+      type->serialize(ser);
+      auto name = type->get_name();
+      m_types[name] = std::move(type);
+      update_type_id_table(name);
+    }
+  }
+
+  size_t forward_declared_count = m_forward_declared_types.size();
+  ser.from_ptr(&forward_declared_count);
+  if (ser.is_saving()) {
+    std::vector<std::string> names;
+    for (auto& [name, parent] : m_forward_declared_types) {
+      names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) {
+      ser.save_str(&name);
+      ser.save_str(&m_forward_declared_types.at(name));
+    }
+  } else {
+    m_forward_declared_types.clear();
+    for (size_t i = 0; i < forward_declared_count; i++) {
+      auto name = ser.load_string();
+      m_forward_declared_types[name] = ser.load_string();
+    }
+  }
+
+  size_t method_count_count = m_forward_declared_method_counts.size();
+  ser.from_ptr(&method_count_count);
+  if (ser.is_saving()) {
+    std::vector<std::string> names;
+    for (auto& [name, count] : m_forward_declared_method_counts) {
+      names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) {
+      ser.save_str(&name);
+      ser.save<int>(m_forward_declared_method_counts.at(name));
+    }
+  } else {
+    m_forward_declared_method_counts.clear();
+    for (size_t i = 0; i < method_count_count; i++) {
+      auto name = ser.load_string();
+      m_forward_declared_method_counts[name] = ser.load<int>();
+    }
+  }
+
+  for (auto* set : {&m_types_with_children, &m_assumed_leaf_types}) {
+    std::vector<std::string> names(set->begin(), set->end());
+    std::sort(names.begin(), names.end());
+    ser.from_string_vector(&names);
+    if (!ser.is_saving()) {
+      set->clear();
+      set->insert(names.begin(), names.end());
+    }
+  }
+
+  ser.from_string_vector(&m_types_allowed_to_be_redefined);
+  ser.from_ptr(&m_allow_redefinition);
+}
@@ -120,6 +120,26 @@ struct ReverseLookupNode {
   std::vector<FieldReverseLookupOutput::Token> to_vector() const;
 };
 
+/*!
+ * While one of these exists, the name of every type looked up by a TypeSystem on the current
+ * thread is recorded. The decompiler uses this to find the types that an object file depends on.
+ * These can be nested: only the innermost recorder is used.
+ */
+class TypeLookupRecorder {
+ public:
+  TypeLookupRecorder();
+  ~TypeLookupRecorder();
+  TypeLookupRecorder(const TypeLookupRecorder&) = delete;
+  TypeLookupRecorder& operator=(const TypeLookupRecorder&) = delete;
+
+  static void record(const std::string& type_name);
+  const std::unordered_set<std::string>& types() const { return m_types; }
+
+ private:
+  TypeLookupRecorder* m_prev = nullptr;
+  std::unordered_set<std::string> m_types;
+};
+
 class TypeSystem {
  public:
   TypeSystem();
@@ -220,6 +240,11 @@ class TypeSystem {
 
   void add_builtin_types(GameVersion version);
 
+  /*!
+   * Save or load all types. Loading replaces the types that are already defined.
+   */
+  void serialize(Serializer& ser);
+
   std::string print_all_type_information() const;
   bool typecheck_and_throw(const TypeSpec& expected,
                            const TypeSpec& actual,
@@ -241,6 +266,8 @@ class TypeSystem {
 
   bool should_use_virtual_methods(const Type* type, int method_id) const;
   bool should_use_virtual_methods(const TypeSpec& type, int method_id) const;
+  bool has_child_types(const std::string& type_name) const;
+  bool try_assume_leaf_type(const std::string& type_name);
 
   /*!
    * Get a type by name and cast to a child class of Type*. Must succeed.
@@ -291,10 +318,15 @@ class TypeSystem {
       const std::optional<std::vector<std::string>>& existing_matches = {});
 
  private:
-  std::string lca_base(const std::string& a, const std::string& b) const;
+  const TypeName* lca_base(const TypeName* a, const TypeName* b) const;
   bool typecheck_base_types(const std::string& expected,
                             const std::string& actual,
                             bool allow_alias) const;
+  bool typecheck_base_types(const TypeName* expected,
+                            const TypeName* actual,
+                            bool allow_alias) const;
+  Type* lookup_interned_allow_partial_def(const TypeName* name) const;
+  void update_type_id_table(const std::string& name);
   int get_alignment_in_type(const Field& field);
   Field lookup_field(const std::string& type_name, const std::string& field_name) const;
   StructureType* add_builtin_structure(const std::string& parent,
@@ -308,14 +340,21 @@ class TypeSystem {
                                     bool sign_extend = false,
                                     RegClass reg = RegClass::GPR_64);
   void builtin_structure_inherit(StructureType* st);
+  void add_child_type(const std::string& parent, const std::string& child);
 
   std::unordered_map<std::string, std::unique_ptr<Type>> m_types;
+  // the same types as m_types, indexed by TypeName id. nullptr if the type isn't fully defined.
+  std::vector<Type*> m_types_by_id;
   std::unordered_map<std::string, std::string> m_forward_declared_types;
   std::unordered_map<std::string, int> m_forward_declared_method_counts;
 
   std::vector<std::unique_ptr<Type>> m_old_types;
 
   std::vector<std::string> m_types_allowed_to_be_redefined;
+  // types that have a child type, or a forward declaration of one.
+  std::unordered_set<std::string> m_types_with_children;
+  // types that method calls were compiled for assuming they would never have a child type.
+  std::unordered_set<std::string> m_assumed_leaf_types;
   bool m_allow_redefinition = false;
 };
 
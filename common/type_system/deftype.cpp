@@ -206,6 +206,7 @@ struct StructureDefResult {
   bool pack_me = false;
   bool allow_misaligned = false;
   bool final = false;
+  bool no_devirtualize = false;
   bool always_stack_singleton = false;
 
   std::unordered_map<std::string, std::unordered_map<std::string, DefinitionMetadata>>
@@ -503,6 +504,8 @@ StructureDefResult parse_structure_def(
         result.allow_misaligned = true;
       } else if (opt_name == ":final") {
         result.final = true;
+      } else if (opt_name == ":no-devirtualize") {
+        result.no_devirtualize = true;
       } else if (opt_name == ":always-stack-singleton") {
         result.always_stack_singleton = true;
       } else {
@@ -762,6 +765,9 @@ DeftypeResult parse_deftype(const goos::Object& deftype,
     if (sr.final) {
       new_type->set_final();
     }
+    if (sr.no_devirtualize) {
+      new_type->set_no_devirtualize();
+    }
     ts->add_type(name, std::move(new_type));
   } else if (is_type("structure", parent_type, ts)) {
     auto new_type = std::make_unique<StructureType>(parent_type_name, name, false, false, false, 0);
@@ -788,6 +794,10 @@ DeftypeResult parse_deftype(const goos::Object& deftype,
       throw std::runtime_error(
           fmt::format("[TypeSystem] :final option cannot be used on structure type {}", name));
     }
+    if (sr.no_devirtualize) {
+      throw std::runtime_error(fmt::format(
+          "[TypeSystem] :no-devirtualize option cannot be used on structure type {}", name));
+    }
     new_type->set_heap_base(result.flags.heap_base);
     ts->add_type(name, std::move(new_type));
   } else if (is_type("integer", parent_type, ts)) {
@@ -12,30 +12,38 @@
 #include "common/common_types.h"
 #include "common/util/Assert.h"
 
+/*!
+ * Reads from a buffer owned by someone else. The buffer must outlive the reader.
+ */
 class BinaryReader {
  public:
-  explicit BinaryReader(const std::vector<uint8_t>& _buffer) : m_buffer(_buffer) {}
+  explicit BinaryReader(const std::vector<uint8_t>& _buffer)
+      : m_buffer(_buffer.data()), m_size(_buffer.size()) {}
+  BinaryReader(const u8* buffer, size_t size) : m_buffer(buffer), m_size(size) {}
+  // the reader doesn't own the buffer, so it can't be given a temporary.
+  explicit BinaryReader(std::vector<uint8_t>&& _buffer) = delete;
 
   template <typename T>
   T read() {
-    ASSERT(m_seek + sizeof(T) <= m_buffer.size());
+    ASSERT(m_seek + sizeof(T) <= m_size);
     T obj;
-    memcpy(&obj, m_buffer.data() + m_seek, sizeof(T));
+    memcpy(&obj, m_buffer + m_seek, sizeof(T));
     m_seek += sizeof(T);
     return obj;
   }
 
   void ffwd(int amount) {
     m_seek += amount;
-    ASSERT(m_seek <= m_buffer.size());
+    ASSERT(m_seek <= m_size);
   }
 
-  uint32_t bytes_left() const { return m_buffer.size() - m_seek; }
-  uint8_t* here() { return m_buffer.data() + m_seek; }
+  uint32_t bytes_left() const { return m_size - m_seek; }
+  const uint8_t* here() const { return m_buffer + m_seek; }
   uint32_t get_seek() const { return m_seek; }
   void set_seek(u32 seek) { m_seek = seek; }
 
  private:
-  std::vector<u8> m_buffer;
+  const u8* m_buffer = nullptr;
+  size_t m_size = 0;
   uint32_t m_seek = 0;
 };
@@ -105,3 +105,23 @@ inline u32 count_leading_zeros_u32(u32 in) {
   return result;
 #endif
 }
+
+inline u32 count_trailing_zeros_u32(u32 in) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(in);
+#else
+  unsigned long result;
+  _BitScanForward(&result, in);
+  return result;
+#endif
+}
+
+inline u32 count_trailing_zeros_u64(u64 in) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(in);
+#else
+  unsigned long result;
+  _BitScanForward64(&result, in);
+  return result;
+#endif
+}
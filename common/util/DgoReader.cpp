@@ -12,9 +12,9 @@
 
 #include "third-party/json.hpp"
 
-DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
+DgoReader::DgoReader(std::string file_name, const u8* data, size_t size)
     : m_file_name(std::move(file_name)) {
-  BinaryReader reader(data);
+  BinaryReader reader(data, size);
   auto header = reader.read<DgoHeader>();
   m_internal_name = header.name;
   std::unordered_set<std::string> all_unique_names;
@@ -46,11 +46,11 @@ DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
     }
 
     all_unique_names.insert(entry.unique_name);
-    entry.data.resize(obj_header.size);
 
     ASSERT((reader.get_seek() % 16) == 0);
-    memcpy(entry.data.data(), reader.here(), obj_header.size);
-    m_entries.push_back(entry);
+    entry.data = reader.here();
+    entry.size = obj_header.size;
+    m_entries.push_back(std::move(entry));
 
     reader.ffwd(align16(obj_header.size));
   }
@@ -6,15 +6,23 @@
 #include "common/common_types.h"
 
 struct DgoDataEntry {
-  std::vector<u8> data;
+  const u8* data = nullptr;  // points into the data given to the DgoReader.
+  size_t size = 0;
   std::string internal_name;
   std::string unique_name;
 };
 
+/*!
+ * Splits a DGO into object files. The objects are not copied, so the DGO data must outlive the
+ * DgoReader and its entries.
+ */
 class DgoReader {
  public:
-  DgoReader(std::string file_name, const std::vector<u8>& data);
-  const std::vector<DgoDataEntry> entries() const { return m_entries; }
+  DgoReader(std::string file_name, const u8* data, size_t size);
+  DgoReader(std::string file_name, const std::vector<u8>& data)
+      : DgoReader(std::move(file_name), data.data(), data.size()) {}
+  DgoReader(std::string file_name, std::vector<u8>&& data) = delete;
+  const std::vector<DgoDataEntry>& entries() const { return m_entries; }
   std::string description_as_json() const;
 
  private:
@@ -32,7 +32,11 @@
 #include <Windows.h>
 #else
 #include <cstring>
+#include <fcntl.h>
 #include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 #include "common/log/log.h"
 #include "common/util/Assert.h"
@@ -515,10 +519,15 @@ void assert_file_exists(const char* path, const char* error_message) {
  * Check if the given DGO header (or entire file) is compressed.
  */
 bool dgo_header_is_compressed(const std::vector<u8>& data) {
+  return dgo_header_is_compressed(data.data(), data.size());
+}
+
+bool dgo_header_is_compressed(const u8* data, size_t size) {
   const char compressed_header[] = "oZlB";
+  ASSERT(size >= 4);
   bool is_compressed = true;
   for (int i = 0; i < 4; i++) {
-    if (compressed_header[i] != data.at(i)) {
+    if (compressed_header[i] != data[i]) {
       is_compressed = false;
     }
   }
@@ -529,8 +538,12 @@ bool dgo_header_is_compressed(const std::vector<u8>& data) {
  * Decompress a DGO. Resulting data will start at the DGO header.
  */
 std::vector<u8> decompress_dgo(const std::vector<u8>& data_in) {
+  return decompress_dgo(data_in.data(), data_in.size());
+}
+
+std::vector<u8> decompress_dgo(const u8* data, size_t size) {
   constexpr int MAX_CHUNK_SIZE = 0x8000;
-  BinaryReader compressed_reader(data_in);
+  BinaryReader compressed_reader(data, size);
   // seek past oZlB
   compressed_reader.ffwd(4);
   std::size_t decompressed_size = compressed_reader.read<uint32_t>();
@@ -613,4 +626,59 @@ void copy_file(const fs::path& src, const fs::path& dst) {
   fs::copy_file(src, dst, fs::copy_options::overwrite_existing);
 }
 
+MappedFile::MappedFile(const fs::path& path) {
+  if (!fs::exists(path)) {
+    throw std::runtime_error(fmt::format("File {} cannot be opened", path.string()));
+  }
+  size_t size = fs::file_size(path);
+  // can't map an empty file.
+  if (size > 0) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+      HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping) {
+        // the view keeps the file open, so the handles can be closed now.
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view) {
+          m_data = (const u8*)view;
+          m_size = size;
+          m_mapped = true;
+        }
+        CloseHandle(mapping);
+      }
+      CloseHandle(file);
+    }
+#else
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd >= 0) {
+      void* mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem != MAP_FAILED) {
+        m_data = (const u8*)mem;
+        m_size = size;
+        m_mapped = true;
+      }
+      close(fd);
+    }
+#endif
+  }
+
+  if (!m_mapped) {
+    m_fallback = read_binary_file(path);
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (m_mapped) {
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<u8*>(m_data), m_size);
+#endif
+  }
+}
+
 }  // namespace file_util
@@ -59,10 +59,33 @@ void MakeISOName(char* dst, const char* src);
 void ISONameFromAnimationName(char* dst, const char* src);
 void assert_file_exists(const char* path, const char* error_message);
 bool dgo_header_is_compressed(const std::vector<u8>& data);
+bool dgo_header_is_compressed(const u8* data, size_t size);
 std::vector<u8> decompress_dgo(const std::vector<u8>& data_in);
+std::vector<u8> decompress_dgo(const u8* data, size_t size);
 FILE* open_file(const fs::path& path, const std::string& mode);
 std::vector<fs::path> find_files_recursively(const fs::path& base_dir, const std::regex& pattern);
 std::vector<fs::path> find_directories_in_dir(const fs::path& base_dir);
 /// Will overwrite the destination if it exists
 void copy_file(const fs::path& src, const fs::path& dst);
+
+/*!
+ * Read-only access to the contents of a file. If possible, the file is memory mapped, so it is
+ * read from disk as it is used and is never copied. Otherwise, it is read into memory.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const fs::path& path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const u8* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  const u8* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_mapped = false;
+  std::vector<u8> m_fallback;  // file contents, if the file couldn't be mapped
+};
 }  // namespace file_util
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "common/common_types.h"
+
+#include "third-party/zstd/lib/common/xxhash.h"
+
+/*!
+ * Builds a hash from a sequence of values. Strings are terminated, so "ab" "c" and "a" "bc" are
+ * different. Used for the keys of on-disk caches, so the result must not change between runs.
+ */
+class Hasher {
+ public:
+  void add(const std::string& str) {
+    m_data.append(str);
+    m_data.push_back('\0');
+  }
+
+  void add(const char* str) { add(std::string(str)); }
+
+  void add(s64 value) { m_data.append((const char*)&value, sizeof(value)); }
+
+  void add(const std::optional<std::string>& str) {
+    add((s64)str.has_value());
+    if (str) {
+      add(*str);
+    }
+  }
+
+  u64 result() const { return XXH64(m_data.data(), m_data.size(), 0); }
+
+ private:
+  std::string m_data;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <cstring>
+#include <functional>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "common/common_types.h"
@@ -42,14 +46,35 @@ class Serializer {
     m_size = initial_size;
   }
 
+  /*!
+   * Construct a serializer in streaming writing mode. Instead of saving everything to one buffer,
+   * the data is passed to sink in chunks of around buffer_size bytes. Call flush() when done.
+   */
+  explicit Serializer(std::function<void(const u8*, size_t)> sink, size_t buffer_size = 1 << 20)
+      : m_size(buffer_size), m_writing(true), m_sink(std::move(sink)) {
+    m_data = (u8*)malloc(m_size);
+  }
+
+  enum class Ownership {
+    COPY,   // copy the data to a buffer owned by the serializer
+    BORROW  // read directly from the caller's data
+  };
+
   /*!
    * Construct a serializer that reads from the given data.
-   * The data is copied to an internal buffer managed by the serializer, there is no need to keep
-   * the input data around.
+   * By default, the data is copied to an internal buffer managed by the serializer, there is no
+   * need to keep the input data around. With Ownership::BORROW, nothing is copied and the data
+   * must stay valid until the serializer is destroyed.
    */
-  Serializer(const u8* data, size_t size) : m_size(size), m_writing(false) {
-    m_data = (u8*)malloc(size);
-    memcpy(m_data, data, size);
+  Serializer(const u8* data, size_t size, Ownership ownership = Ownership::COPY)
+      : m_size(size), m_writing(false), m_owns_data(ownership == Ownership::COPY) {
+    if (m_owns_data) {
+      m_data = (u8*)malloc(size);
+      memcpy(m_data, data, size);
+    } else {
+      // safe, loading never writes to m_data.
+      m_data = const_cast<u8*>(data);
+    }
   }
 
   // don't allow copying, assigning, or move constructing.
@@ -63,10 +88,16 @@ class Serializer {
       return *this;
     }
 
+    if (m_owns_data) {
+      free(m_data);
+    }
     m_data = other.m_data;
+    m_owns_data = other.m_owns_data;
     m_size = other.m_size;
     m_offset = other.m_offset;
     m_writing = other.m_writing;
+    m_sink = std::move(other.m_sink);
+    m_flushed_size = other.m_flushed_size;
 
     other.m_data = nullptr;
     other.m_size = 0;
@@ -74,7 +105,11 @@ class Serializer {
     return *this;
   }
 
-  ~Serializer() { free(m_data); }
+  ~Serializer() {
+    if (m_owns_data) {
+      free(m_data);
+    }
+  }
 
   /*!
    * Save or load the thing pointed to by ptr.
@@ -116,11 +151,12 @@ class Serializer {
   void from_str(std::string* str) {
     // size, then data.
     if (is_loading()) {
-      str->resize(load<size_t>());
+      size_t size = load<size_t>();
+      str->assign((const char*)consume(size), size);
     } else {
       save<size_t>(str->size());
+      from_raw_data(str->data(), str->size());
     }
-    from_raw_data(str->data(), str->size());
   }
 
   /*!
@@ -148,12 +184,21 @@ class Serializer {
    */
   template <typename T>
   void from_pod_vector(std::vector<T>* vec) {
+    static_assert(std::is_trivially_copyable_v<T>);
     if (is_saving()) {
       save<size_t>(vec->size());
+      from_raw_data(vec->data(), sizeof(T) * vec->size());
     } else {
-      vec->resize(load<size_t>());
+      size_t count = load<size_t>();
+      const u8* src = consume(sizeof(T) * count);
+      if ((uintptr_t)src % alignof(T) == 0) {
+        // copy straight from the buffer, without zero-initializing the vector first.
+        vec->assign((const T*)src, (const T*)src + count);
+      } else {
+        vec->resize(count);
+        memcpy(vec->data(), src, sizeof(T) * count);
+      }
     }
-    from_raw_data(vec->data(), sizeof(T) * vec->size());
   }
 
   void from_string_vector(std::vector<std::string>* vec) {
@@ -167,6 +212,38 @@ class Serializer {
     }
   }
 
+  /*!
+   * Save or load an optional string.
+   */
+  void from_optional_str(std::optional<std::string>* str) {
+    bool has_value = str->has_value();
+    from_ptr(&has_value);
+    if (has_value) {
+      if (is_loading()) {
+        str->emplace();
+      }
+      from_str(&str->value());
+    } else if (is_loading()) {
+      str->reset();
+    }
+  }
+
+  /*!
+   * Save or load a vector of objects that have a serialize(Serializer&) method.
+   */
+  template <typename T>
+  void from_serializable_vector(std::vector<T>* vec) {
+    size_t size = vec->size();
+    from_ptr(&size);
+    if (is_loading()) {
+      vec->clear();
+      vec->resize(size);
+    }
+    for (auto& x : *vec) {
+      x.serialize(*this);
+    }
+  }
+
   /*!
    * Are we saving?
    */
@@ -190,9 +267,30 @@ class Serializer {
    */
   std::pair<const u8*, size_t> get_save_result() {
     ASSERT(m_writing);
+    ASSERT(!m_sink);
     return {m_data, m_offset};
   }
 
+  /*!
+   * In streaming mode, pass any buffered data to the sink.
+   */
+  void flush() {
+    ASSERT(m_writing && m_sink);
+    if (m_offset) {
+      m_sink(m_data, m_offset);
+      m_flushed_size += m_offset;
+      m_offset = 0;
+    }
+  }
+
+  /*!
+   * Total number of bytes saved so far, including data already passed to the sink.
+   */
+  size_t saved_size() const {
+    ASSERT(m_writing);
+    return m_flushed_size + m_offset;
+  }
+
   /*!
    * Have we reached the end of the load?
    */
@@ -207,11 +305,31 @@ class Serializer {
   size_t data_size() const { return m_size; }
 
  private:
+  /*!
+   * Skip over size bytes when loading, and return a pointer to them.
+   */
+  const u8* consume(size_t size) {
+    ASSERT(!m_writing);
+    ASSERT(m_offset + size <= m_size);
+    const u8* result = m_data + m_offset;
+    m_offset += size;
+    return result;
+  }
+
   /*!
    * Main function to read and write the buffer.
    */
   void read_or_write(void* data, size_t size) {
     if (m_writing) {
+      if (m_sink && m_offset + size > m_size) {
+        // streaming: send out the buffer and start over. Big things go straight to the sink.
+        flush();
+        if (size > m_size) {
+          m_sink((const u8*)data, size);
+          m_flushed_size += size;
+          return;
+        }
+      }
       // if we would overflow, just resize the buffer.
       if (m_offset + size > m_size) {
         m_size = (m_offset + size) * 2;
@@ -230,4 +348,7 @@ class Serializer {
   size_t m_size = 0;
   size_t m_offset = 0;
   bool m_writing = false;
+  bool m_owns_data = true;
+  std::function<void(const u8*, size_t)> m_sink;
+  size_t m_flushed_size = 0;
 };
@@ -0,0 +1,216 @@
+#include "ThreadPool.h"
+
+#include <chrono>
+
+#include "common/util/Assert.h"
+#include "common/util/Timer.h"
+
+#include "third-party/fmt/core.h"
+
+namespace {
+thread_local ThreadPool* g_current_pool = nullptr;
+thread_local int g_current_worker = -1;
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; i++) {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+  // start threads after all workers exist, they may steal from each other right away.
+  for (int i = 0; i < num_threads; i++) {
+    m_workers[i]->thread = std::thread([this, i]() { worker_loop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lk(m_sleep_mutex);
+    m_stop = true;
+  }
+  m_sleep_cv.notify_all();
+  for (auto& worker : m_workers) {
+    worker->thread.join();
+  }
+  ASSERT(m_queued == 0);
+}
+
+ThreadPool* ThreadPool::current() {
+  return g_current_pool;
+}
+
+ThreadPool::ScopedCurrent::ScopedCurrent(ThreadPool* pool) : m_prev(g_current_pool) {
+  // workers already have a pool, and their worker index would be wrong for another pool.
+  ASSERT(g_current_worker < 0);
+  g_current_pool = pool;
+}
+
+ThreadPool::ScopedCurrent::~ScopedCurrent() {
+  g_current_pool = m_prev;
+}
+
+void ThreadPool::push(Task&& task) {
+  int queue_idx;
+  if (g_current_pool == this && g_current_worker >= 0) {
+    // nested task: keep it local, it will likely use the same data as the task that made it.
+    queue_idx = g_current_worker;
+  } else {
+    queue_idx = m_next_queue++ % m_workers.size();
+  }
+
+  {
+    auto& worker = *m_workers[queue_idx];
+    std::lock_guard<std::mutex> lk(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+
+  {
+    // lock so a worker can't check m_queued and then go to sleep after we notify.
+    std::lock_guard<std::mutex> lk(m_sleep_mutex);
+    m_queued++;
+  }
+  m_sleep_cv.notify_one();
+}
+
+/*!
+ * Get a task, first from our own queue (newest first), then by stealing from others (oldest
+ * first). Threads outside the pool pass -1 and can only steal.
+ */
+bool ThreadPool::try_pop(int worker_idx, Task* out) {
+  if (worker_idx >= 0) {
+    auto& worker = *m_workers[worker_idx];
+    std::lock_guard<std::mutex> lk(worker.mutex);
+    if (!worker.tasks.empty()) {
+      *out = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+      return true;
+    }
+  }
+
+  int n = m_workers.size();
+  int start = worker_idx >= 0 ? worker_idx + 1 : 0;
+  for (int i = 0; i < n; i++) {
+    int victim = (start + i) % n;
+    if (victim == worker_idx) {
+      continue;
+    }
+    auto& worker = *m_workers[victim];
+    std::lock_guard<std::mutex> lk(worker.mutex);
+    if (!worker.tasks.empty()) {
+      *out = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run_task(Task& task, int worker_idx) {
+  m_queued--;
+  // a thread outside the pool may be helping in TaskGroup::wait. The task should still see this
+  // pool as current, so its own groups run in the pool.
+  auto prev_pool = g_current_pool;
+  g_current_pool = this;
+  Timer timer;
+  timer.start(false);
+  try {
+    task.func();
+  } catch (...) {
+    std::lock_guard<std::mutex> lk(task.group->m_timing_mutex);
+    if (!task.group->m_exception) {
+      task.group->m_exception = std::current_exception();
+    }
+  }
+  g_current_pool = prev_pool;
+  task.group->finish_task({std::move(task.name), timer.getMs(), worker_idx});
+}
+
+bool ThreadPool::try_run_one(int worker_idx) {
+  Task task;
+  if (!try_pop(worker_idx, &task)) {
+    return false;
+  }
+  run_task(task, worker_idx);
+  return true;
+}
+
+void ThreadPool::worker_loop(int worker_idx) {
+  g_current_pool = this;
+  g_current_worker = worker_idx;
+  while (true) {
+    if (try_run_one(worker_idx)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(m_sleep_mutex);
+    m_sleep_cv.wait(lk, [&]() { return m_stop || m_queued > 0; });
+    if (m_stop && m_queued == 0) {
+      return;
+    }
+  }
+}
+
+ThreadPool::TaskGroup::~TaskGroup() {
+  // tasks reference the group, so it must outlive them.
+  ASSERT_MSG(m_pending == 0, "TaskGroup destroyed without wait()");
+}
+
+void ThreadPool::TaskGroup::run(const std::string& name, std::function<void()> func) {
+  if (!m_pool) {
+    Timer timer;
+    timer.start(false);
+    func();
+    finish_task({name, timer.getMs(), -1});
+    return;
+  }
+  m_pending++;
+  m_pool->push({name, std::move(func), this});
+}
+
+void ThreadPool::TaskGroup::wait() {
+  if (!m_pool) {
+    return;
+  }
+  int worker_idx = g_current_pool == m_pool ? g_current_worker : -1;
+  while (m_pending > 0) {
+    // help out instead of blocking. This is what makes nested groups safe: the tasks we are
+    // waiting on may be sitting in our own queue.
+    if (!m_pool->try_run_one(worker_idx)) {
+      // our tasks are all running on other threads.
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lk(m_timing_mutex);
+    std::swap(exception, m_exception);
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::TaskGroup::finish_task(TaskTiming&& timing) {
+  {
+    std::lock_guard<std::mutex> lk(m_timing_mutex);
+    m_timings.push_back(std::move(timing));
+  }
+  if (m_pool) {
+    m_pending--;
+  }
+}
+
+std::vector<ThreadPool::TaskTiming> ThreadPool::TaskGroup::timings() const {
+  std::lock_guard<std::mutex> lk(m_timing_mutex);
+  return m_timings;
+}
+
+void parallel_for(const std::string& name, int count, const std::function<void(int)>& func) {
+  ThreadPool::TaskGroup group;
+  for (int i = 0; i < count; i++) {
+    group.run(fmt::format("{}-{}", name, i), [&func, i]() { func(i); });
+  }
+  group.wait();
+}
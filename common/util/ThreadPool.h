@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * Work-stealing pool of threads.
+ *
+ * Each worker has its own queue of tasks. Workers run their own tasks newest first, and when they
+ * run out, they steal the oldest task from another worker. Tasks are added through a TaskGroup,
+ * which can be waited on. A thread waiting on a group runs other tasks while it waits, so tasks can
+ * create and wait on their own groups without running out of threads.
+ *
+ * Usage:
+ *   ThreadPool pool;
+ *   ThreadPool::TaskGroup group(&pool);
+ *   for (auto& thing : things) {
+ *     group.run(thing.name, [&]() { process(thing); });
+ *   }
+ *   group.wait();
+ *
+ * Code that may or may not be running inside of a pool can use ThreadPool::current(). A TaskGroup
+ * without a pool just runs tasks immediately on the calling thread.
+ */
+class ThreadPool {
+ public:
+  struct TaskTiming {
+    std::string name;
+    double ms = 0;
+    int thread = 0;  // worker index, or -1 if run by a thread outside of the pool
+  };
+
+  class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool* pool) : m_pool(pool) {}
+    TaskGroup() : TaskGroup(ThreadPool::current()) {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup();
+
+    void run(const std::string& name, std::function<void()> func);
+    // wait for all tasks. If a task threw, the first exception is rethrown here.
+    void wait();
+
+    // timings of all tasks finished so far, in the order they finished.
+    std::vector<TaskTiming> timings() const;
+
+   private:
+    friend class ThreadPool;
+    void finish_task(TaskTiming&& timing);
+
+    ThreadPool* m_pool = nullptr;
+    std::atomic<int> m_pending = 0;
+    mutable std::mutex m_timing_mutex;
+    std::vector<TaskTiming> m_timings;
+    std::exception_ptr m_exception;  // guarded by m_timing_mutex
+  };
+
+  /*!
+   * Create a pool with the given number of threads. If 0, uses one per core.
+   */
+  explicit ThreadPool(int num_threads = 0);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  int num_threads() const { return (int)m_workers.size(); }
+
+  /*!
+   * The pool that the calling thread is a worker in, or nullptr.
+   */
+  static ThreadPool* current();
+
+  /*!
+   * Make a pool current on a thread that isn't one of its workers, like the compiler's thread, so
+   * code called from there can use parallel_for.
+   */
+  class ScopedCurrent {
+   public:
+    explicit ScopedCurrent(ThreadPool* pool);
+    ScopedCurrent(const ScopedCurrent&) = delete;
+    ScopedCurrent& operator=(const ScopedCurrent&) = delete;
+    ~ScopedCurrent();
+
+   private:
+    ThreadPool* m_prev = nullptr;
+  };
+
+ private:
+  struct Task {
+    std::string name;
+    std::function<void()> func;
+    TaskGroup* group = nullptr;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  void push(Task&& task);
+  bool try_run_one(int worker_idx);
+  bool try_pop(int worker_idx, Task* out);
+  void run_task(Task& task, int worker_idx);
+  void worker_loop(int worker_idx);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::atomic<int> m_next_queue = 0;  // round-robin for tasks added from outside of the pool
+
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_sleep_cv;
+  std::atomic<int> m_queued = 0;
+  bool m_stop = false;
+};
+
+/*!
+ * Run func(i) for i in [0, count) on the current pool (if any) and wait for all of them.
+ */
+void parallel_for(const std::string& name, int count, const std::function<void(int)>& func);
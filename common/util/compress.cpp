@@ -10,22 +10,87 @@
 
 namespace compression {
 
+namespace {
+void check_zstd_error(size_t result) {
+  if (ZSTD_isError(result)) {
+    ASSERT_MSG(false, fmt::format("ZSTD error: {}", ZSTD_getErrorName(result)));
+  }
+}
+
+ZSTD_CCtx* make_context(const ZstdOptions& options) {
+  auto ctx = ZSTD_createCCtx();
+  ASSERT(ctx);
+  check_zstd_error(ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, options.level));
+  if (options.workers > 0) {
+    check_zstd_error(ZSTD_CCtx_setParameter(ctx, ZSTD_c_nbWorkers, options.workers));
+  }
+  return ctx;
+}
+}  // namespace
+
 /*!
  * Compress data with zstd.  There is an 8-byte header containing the decompressed data's size.
  */
 std::vector<u8> compress_zstd(const void* data, size_t size) {
+  return compress_zstd(data, size, ZstdOptions());
+}
+
+std::vector<u8> compress_zstd(const void* data, size_t size, const ZstdOptions& options) {
   auto max_compressed = ZSTD_compressBound(size);
   std::vector<u8> result(sizeof(size_t) + max_compressed);
   memcpy(result.data(), &size, sizeof(size_t));
+  auto ctx = make_context(options);
   auto compressed_size =
-      ZSTD_compress(result.data() + sizeof(size_t), max_compressed, data, size, 1);
-  if (ZSTD_isError(compressed_size)) {
-    ASSERT_MSG(false, fmt::format("ZSTD error: {}", ZSTD_getErrorName(compressed_size)));
-  }
+      ZSTD_compress2(ctx, result.data() + sizeof(size_t), max_compressed, data, size);
+  ZSTD_freeCCtx(ctx);
+  check_zstd_error(compressed_size);
   result.resize(sizeof(size_t) + compressed_size);
   return result;
 }
 
+ZstdStreamCompressor::ZstdStreamCompressor(const ZstdOptions& options) {
+  m_ctx = make_context(options);
+  // header is filled in once we know the size.
+  m_result.resize(sizeof(size_t));
+}
+
+ZstdStreamCompressor::~ZstdStreamCompressor() {
+  ZSTD_freeCCtx((ZSTD_CCtx*)m_ctx);
+}
+
+void ZstdStreamCompressor::run(const void* data, size_t size, bool end) {
+  ZSTD_inBuffer in = {data, size, 0};
+  auto mode = end ? ZSTD_e_end : ZSTD_e_continue;
+  while (true) {
+    // make sure there's always space for a full block of output.
+    size_t out_start = m_result.size();
+    m_result.resize(out_start + ZSTD_CStreamOutSize());
+    ZSTD_outBuffer out = {m_result.data() + out_start, m_result.size() - out_start, 0};
+    size_t remaining = ZSTD_compressStream2((ZSTD_CCtx*)m_ctx, &out, &in, mode);
+    check_zstd_error(remaining);
+    m_result.resize(out_start + out.pos);
+    // when continuing, we're done once zstd has taken all the input. It may hold on to some.
+    // when ending, we need to wait for zstd to flush everything.
+    if (end ? remaining == 0 : in.pos == in.size) {
+      break;
+    }
+  }
+}
+
+void ZstdStreamCompressor::add(const void* data, size_t size) {
+  ASSERT(!m_finished);
+  m_uncompressed_size += size;
+  run(data, size, false);
+}
+
+std::vector<u8> ZstdStreamCompressor::finish() {
+  ASSERT(!m_finished);
+  m_finished = true;
+  run(nullptr, 0, true);
+  memcpy(m_result.data(), &m_uncompressed_size, sizeof(size_t));
+  return std::move(m_result);
+}
+
 /*!
  * Decompress data with zstd.  The first 8-bytes of the data should be a header containing the
  * decompressed data's size.
@@ -39,9 +104,7 @@ std::vector<u8> decompress_zstd(const void* data, size_t size) {
   std::vector<u8> result(decompressed_size);
   auto decomp_size = ZSTD_decompress(result.data(), decompressed_size,
                                      (const u8*)data + sizeof(size_t), compressed_size);
-  if (ZSTD_isError(decomp_size)) {
-    ASSERT_MSG(false, fmt::format("ZSTD error: {}", ZSTD_getErrorName(compressed_size)));
-  }
+  check_zstd_error(decomp_size);
 
   ASSERT(decomp_size == decompressed_size);
   return result;
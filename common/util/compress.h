@@ -5,7 +5,39 @@
 
 #include "common/common_types.h"
 namespace compression {
+
+struct ZstdOptions {
+  int level = 1;    // zstd compression level. 1 is fastest, 19 is smallest.
+  int workers = 0;  // number of zstd worker threads. 0 compresses on the calling thread.
+};
+
 // compress and decompress data with zstd
 std::vector<u8> compress_zstd(const void* data, size_t size);
+std::vector<u8> compress_zstd(const void* data, size_t size, const ZstdOptions& options);
 std::vector<u8> decompress_zstd(const void* data, size_t size);
-}  // namespace compression
\ No newline at end of file
+
+/*!
+ * Compress data with zstd as it is produced, without needing all of the uncompressed data in memory
+ * at once. The result is in the same format as compress_zstd, and can be read by decompress_zstd.
+ */
+class ZstdStreamCompressor {
+ public:
+  explicit ZstdStreamCompressor(const ZstdOptions& options = {});
+  ZstdStreamCompressor(const ZstdStreamCompressor&) = delete;
+  ZstdStreamCompressor& operator=(const ZstdStreamCompressor&) = delete;
+  ~ZstdStreamCompressor();
+
+  void add(const void* data, size_t size);
+  std::vector<u8> finish();
+
+  size_t uncompressed_size() const { return m_uncompressed_size; }
+
+ private:
+  void run(const void* data, size_t size, bool end);
+
+  void* m_ctx = nullptr;  // ZSTD_CCtx
+  std::vector<u8> m_result;
+  size_t m_uncompressed_size = 0;
+  bool m_finished = false;
+};
+}  // namespace compression
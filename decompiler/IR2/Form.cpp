@@ -18,14 +18,29 @@ namespace decompiler {
 // FormPool
 ///////////////////
 
-FormPool::~FormPool() {
-  for (auto& x : m_forms) {
-    delete x;
-  }
+namespace {
+// small functions are common, so start with a small chunk, and grow for large functions.
+constexpr size_t FORM_POOL_MIN_CHUNK_SIZE = 4 * 1024;
+constexpr size_t FORM_POOL_MAX_CHUNK_SIZE = 256 * 1024;
+}  // namespace
 
-  for (auto& x : m_elements) {
-    delete x;
-  }
+FormPool::~FormPool() {
+  for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it) {
+    it->destroy(it->obj);
+  }
+}
+
+void* FormPool::alloc_bytes_in_new_chunk(size_t size, size_t align) {
+  // new[] only guarantees this alignment, which is enough for any form.
+  ASSERT(align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  size_t chunk_size = std::clamp(m_chunk_size * 2, FORM_POOL_MIN_CHUNK_SIZE,
+                                 FORM_POOL_MAX_CHUNK_SIZE);
+  chunk_size = std::max(chunk_size, size);
+  m_chunk = m_chunks.emplace_back(new u8[chunk_size]).get();
+  m_chunk_size = chunk_size;
+  m_chunk_used = size;
+  m_stats.chunks++;
+  return m_chunk;
 }
 
 ///////////////////
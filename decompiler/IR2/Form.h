@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <memory>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
@@ -2002,60 +2003,76 @@ class Form {
 
 class CfgVtx;
 
+/*!
+ * Memory usage of a FormPool.
+ */
+struct FormPoolStats {
+  u64 allocations = 0;  // number of Forms and FormElements allocated
+  u64 bytes = 0;        // total size of the Forms and FormElements
+  u64 chunks = 0;       // number of chunks allocated from the heap
+
+  FormPoolStats& operator+=(const FormPoolStats& other) {
+    allocations += other.allocations;
+    bytes += other.bytes;
+    chunks += other.chunks;
+    return *this;
+  }
+
+  std::string print() const {
+    return fmt::format("FORM POOL STATS: {} allocations, {:.2f} MB in {} chunks\n", allocations,
+                       bytes / (1024.f * 1024.f), chunks);
+  }
+};
+
 /*!
  * A FormPool is used to allocate forms and form elements.
  * It will clean up everything when it is destroyed.
  * As a result, you don't need to worry about deleting / referencing counting when manipulating
  * a Form graph.
+ * Forms and FormElements are never freed individually, so they are bump allocated from large
+ * chunks, and all freed at once when the pool is destroyed. Destructors are only run for types that
+ * need them.
  */
 class FormPool {
  public:
+  FormPool() = default;
+  FormPool(const FormPool&) = delete;
+  FormPool& operator=(const FormPool&) = delete;
+
   template <typename T, class... Args>
   T* alloc_element(Args&&... args) {
-    auto elt = new T(std::forward<Args>(args)...);
-    m_elements.emplace_back(elt);
-    return elt;
+    return alloc<T>(std::forward<Args>(args)...);
   }
 
   template <typename T, class... Args>
   Form* alloc_single_element_form(FormElement* parent, Args&&... args) {
-    auto elt = new T(std::forward<Args>(args)...);
-    m_elements.emplace_back(elt);
+    auto elt = alloc<T>(std::forward<Args>(args)...);
     auto form = alloc_single_form(parent, elt);
     return form;
   }
 
   template <typename T, class... Args>
   Form* form(Args&&... args) {
-    auto elt = new T(std::forward<Args>(args)...);
-    m_elements.emplace_back(elt);
+    auto elt = alloc<T>(std::forward<Args>(args)...);
     auto form = alloc_single_form(nullptr, elt);
     return form;
   }
 
   Form* alloc_single_form(FormElement* parent, FormElement* elt) {
-    auto form = new Form(parent, elt);
-    m_forms.push_back(form);
-    return form;
+    return alloc<Form>(parent, elt);
   }
 
   Form* alloc_sequence_form(FormElement* parent, const std::vector<FormElement*> sequence) {
-    auto form = new Form(parent, sequence);
-    m_forms.push_back(form);
-    return form;
+    return alloc<Form>(parent, sequence);
   }
 
   Form* acquire(std::unique_ptr<Form> form_ptr) {
-    Form* form = form_ptr.release();
-    m_forms.push_back(form);
+    Form* form = form_ptr.get();
+    m_acquired_forms.push_back(std::move(form_ptr));
     return form;
   }
 
-  Form* alloc_empty_form() {
-    Form* form = new Form;
-    m_forms.push_back(form);
-    return form;
-  }
+  Form* alloc_empty_form() { return alloc<Form>(); }
 
   Form* lookup_cached_conversion(const CfgVtx* vtx) const {
     auto it = m_vtx_to_form_cache.find(vtx);
@@ -2070,11 +2087,45 @@ class FormPool {
     m_vtx_to_form_cache[vtx] = form;
   }
 
+  const FormPoolStats& stats() const { return m_stats; }
+
   ~FormPool();
 
  private:
-  std::vector<Form*> m_forms;
-  std::vector<FormElement*> m_elements;
+  template <typename T, class... Args>
+  T* alloc(Args&&... args) {
+    T* result = new (alloc_bytes(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      m_destructors.push_back({result, [](void* obj) { static_cast<T*>(obj)->~T(); }});
+    }
+    return result;
+  }
+
+  void* alloc_bytes(size_t size, size_t align) {
+    m_stats.allocations++;
+    m_stats.bytes += size;
+    size_t start = (m_chunk_used + align - 1) & ~(align - 1);
+    if (start + size > m_chunk_size) {
+      return alloc_bytes_in_new_chunk(size, align);
+    }
+    m_chunk_used = start + size;
+    return m_chunk + start;
+  }
+
+  void* alloc_bytes_in_new_chunk(size_t size, size_t align);
+
+  struct Destructor {
+    void* obj;
+    void (*destroy)(void*);
+  };
+
+  u8* m_chunk = nullptr;
+  size_t m_chunk_used = 0;
+  size_t m_chunk_size = 0;
+  std::vector<std::unique_ptr<u8[]>> m_chunks;
+  std::vector<Destructor> m_destructors;
+  std::vector<std::unique_ptr<Form>> m_acquired_forms;
+  FormPoolStats m_stats;
   std::unordered_map<const CfgVtx*, Form*> m_vtx_to_form_cache;
 };
 
@@ -0,0 +1,458 @@
+#include "IR2Cache.h"
+
+#include <algorithm>
+
+#include "common/log/log.h"
+#include "common/util/Hasher.h"
+
+#include "decompiler/ObjectFile/ObjectFileDB.h"
+#include "decompiler/config.h"
+
+#include "third-party/fmt/core.h"
+#include "third-party/json.hpp"
+
+namespace decompiler {
+
+// Increase this when a change to the decompiler changes its output.
+constexpr int IR2_CACHE_VERSION = 1;
+
+namespace {
+
+/*!
+ * Get the keys of a map in sorted order, so the hash doesn't depend on hash table ordering.
+ */
+template <typename Map>
+std::vector<typename Map::key_type> sorted_keys(const Map& map) {
+  std::vector<typename Map::key_type> result;
+  result.reserve(map.size());
+  for (const auto& kv : map) {
+    result.push_back(kv.first);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+template <typename Set>
+std::vector<typename Set::value_type> sorted_values(const Set& set) {
+  std::vector<typename Set::value_type> result(set.begin(), set.end());
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+template <typename Set>
+void add_membership(Hasher& h, const Set& set, const std::string& name) {
+  h.add((s64)(set.find(name) != set.end()));
+}
+
+/*!
+ * Add all the config entries for a single function.
+ */
+void add_function_config(Hasher& h, const Config& config, const std::string& name) {
+  h.add(name);
+
+  const auto& hacks = config.hacks;
+  add_membership(h, hacks.no_type_analysis_functions_by_name, name);
+  add_membership(h, hacks.hint_inline_assembly_functions, name);
+  add_membership(h, hacks.asm_functions_by_name, name);
+  add_membership(h, hacks.pair_functions_by_name, name);
+  add_membership(h, hacks.reject_cond_to_value, name);
+  add_membership(h, hacks.mips2c_functions_by_name, name);
+
+  auto cond_it = hacks.cond_with_else_len_by_func_name.find(name);
+  if (cond_it != hacks.cond_with_else_len_by_func_name.end()) {
+    const auto& lengths = cond_it->second.max_length_by_start_block;
+    for (const auto& block : sorted_keys(lengths)) {
+      h.add(block);
+      h.add((s64)lengths.at(block));
+    }
+  }
+
+  auto asm_br_it = hacks.blocks_ending_in_asm_branch_by_func_name.find(name);
+  if (asm_br_it != hacks.blocks_ending_in_asm_branch_by_func_name.end()) {
+    for (auto block : sorted_values(asm_br_it->second)) {
+      h.add((s64)block);
+    }
+  }
+
+  auto format_it = hacks.format_ops_with_dynamic_string_by_func_name.find(name);
+  if (format_it != hacks.format_ops_with_dynamic_string_by_func_name.end()) {
+    for (const auto& op : format_it->second) {
+      for (auto x : op) {
+        h.add((s64)x);
+      }
+      h.add("");
+    }
+  }
+
+  auto jump_table_it = hacks.mips2c_jump_table_functions.find(name);
+  if (jump_table_it != hacks.mips2c_jump_table_functions.end()) {
+    for (auto x : jump_table_it->second) {
+      h.add((s64)x);
+    }
+  }
+
+  auto reg_cast_it = config.register_type_casts_by_function_by_atomic_op_idx.find(name);
+  if (reg_cast_it != config.register_type_casts_by_function_by_atomic_op_idx.end()) {
+    for (auto idx : sorted_keys(reg_cast_it->second)) {
+      for (const auto& cast : reg_cast_it->second.at(idx)) {
+        h.add((s64)cast.atomic_op_idx);
+        h.add(cast.reg.to_string());
+        h.add(cast.type_name);
+      }
+    }
+  }
+
+  auto stack_cast_it = config.stack_type_casts_by_function_by_stack_offset.find(name);
+  if (stack_cast_it != config.stack_type_casts_by_function_by_stack_offset.end()) {
+    for (auto offset : sorted_keys(stack_cast_it->second)) {
+      const auto& cast = stack_cast_it->second.at(offset);
+      h.add((s64)cast.stack_offset);
+      h.add(cast.type_name);
+    }
+  }
+
+  auto stack_struct_it = config.stack_structure_hints_by_function.find(name);
+  if (stack_struct_it != config.stack_structure_hints_by_function.end()) {
+    for (const auto& hint : stack_struct_it->second) {
+      h.add(hint.element_type);
+      h.add((s64)hint.container_type);
+      h.add((s64)hint.container_size);
+      h.add((s64)hint.stack_offset);
+    }
+  }
+
+  auto arg_it = config.function_arg_names.find(name);
+  if (arg_it != config.function_arg_names.end()) {
+    for (const auto& arg : arg_it->second) {
+      h.add(arg);
+    }
+  }
+
+  auto var_it = config.function_var_overrides.find(name);
+  if (var_it != config.function_var_overrides.end()) {
+    for (const auto& var : sorted_keys(var_it->second)) {
+      const auto& override = var_it->second.at(var);
+      h.add(var);
+      h.add(override.name);
+      h.add(override.type);
+    }
+  }
+
+  auto art_it = config.art_groups_by_function.find(name);
+  if (art_it != config.art_groups_by_function.end()) {
+    h.add(art_it->second);
+  }
+}
+
+/*!
+ * Get all symbols that the object file links to.
+ */
+std::vector<std::string> referenced_symbols(const ObjectFileData& data) {
+  std::unordered_set<std::string> symbols;
+  for (const auto& seg_words : data.linked_data.words_by_seg) {
+    for (const auto& word : seg_words) {
+      switch (word.kind()) {
+        case LinkedWord::SYM_PTR:
+        case LinkedWord::SYM_OFFSET:
+        case LinkedWord::SYM_VAL_OFFSET:
+        case LinkedWord::TYPE_PTR:
+          symbols.insert(word.symbol_name());
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return sorted_values(symbols);
+}
+
+std::string fingerprint_to_string(u64 fingerprint) {
+  return fmt::format("{:016x}", fingerprint);
+}
+}  // namespace
+
+IR2Cache::IR2Cache(
+    const fs::path& cache_dir,
+    const Config& config,
+    const DecompilerTypeSystem& dts,
+    const std::unordered_set<std::string>& skip_functions,
+    const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states)
+    : m_dir(cache_dir), m_config(config), m_dts(dts) {
+  file_util::create_dir_if_needed(m_dir);
+
+  // things that apply to every object
+  Hasher h;
+  h.add((s64)IR2_CACHE_VERSION);
+  h.add((s64)config.game_version);
+  h.add((s64)config.print_cfgs);
+  h.add(config.all_types_file);
+  for (const auto& fmt_string : sorted_keys(config.bad_format_strings)) {
+    h.add(fmt_string);
+    h.add((s64)config.bad_format_strings.at(fmt_string));
+  }
+  for (const auto& ag : sorted_keys(dts.art_group_info)) {
+    h.add(ag);
+    const auto& elts = dts.art_group_info.at(ag);
+    for (auto idx : sorted_keys(elts)) {
+      h.add((s64)idx);
+      h.add(elts.at(idx));
+    }
+  }
+  for (const auto& func : sorted_values(skip_functions)) {
+    h.add(func);
+  }
+  for (const auto& state : sorted_keys(skip_states)) {
+    h.add(state);
+    for (const auto& handler : sorted_values(skip_states.at(state))) {
+      h.add(handler);
+    }
+  }
+  m_global_key = h.result();
+}
+
+/*!
+ * Get the name of the cache entry for an object: a hash of the object data and the config used to
+ * decompile it. Must be called after the top-level pass, so functions have their names.
+ */
+u64 IR2Cache::object_key(const ObjectFileData& data) const {
+  Hasher h;
+  h.add((s64)m_global_key);
+  h.add(data.to_unique_name());
+  h.add(data.name_from_map);
+  h.add((s64)data.record.hash);
+  h.add((s64)data.data.size());
+
+  auto obj_name = data.to_unique_name();
+  auto label_it = m_config.label_types.find(obj_name);
+  if (label_it != m_config.label_types.end()) {
+    for (const auto& label : sorted_keys(label_it->second)) {
+      const auto& info = label_it->second.at(label);
+      h.add(label);
+      h.add((s64)info.is_value);
+      h.add(info.type_name);
+      h.add((s64)info.array_size.value_or(-1));
+    }
+  }
+
+  auto anon_it = m_config.anon_function_types_by_obj_by_id.find(obj_name);
+  if (anon_it != m_config.anon_function_types_by_obj_by_id.end()) {
+    for (auto id : sorted_keys(anon_it->second)) {
+      h.add((s64)id);
+      h.add(anon_it->second.at(id));
+    }
+  }
+
+  auto art_it = m_config.art_groups_by_file.find(obj_name);
+  if (art_it != m_config.art_groups_by_file.end()) {
+    h.add(art_it->second);
+  }
+
+  auto import_it = m_config.import_deps_by_file.find(obj_name);
+  if (import_it != m_config.import_deps_by_file.end()) {
+    for (const auto& dep : import_it->second) {
+      h.add(dep);
+    }
+  }
+
+  for (const auto& seg_functions : data.linked_data.functions_by_seg) {
+    for (const auto& func : seg_functions) {
+      add_function_config(h, m_config, func.name());
+    }
+  }
+
+  return h.result();
+}
+
+fs::path IR2Cache::entry_path(u64 key) const {
+  return m_dir / (fingerprint_to_string(key) + ".json");
+}
+
+/*!
+ * Hash everything about a type that could change decompiler output: the type and all of its
+ * parents, their methods and states, and their documentation.
+ */
+u64 IR2Cache::type_fingerprint(const std::string& type_name) {
+  {
+    std::lock_guard<std::mutex> lock(m_type_fingerprint_mutex);
+    auto it = m_type_fingerprints.find(type_name);
+    if (it != m_type_fingerprints.end()) {
+      return it->second;
+    }
+  }
+
+  Hasher h;
+  const auto& ts = m_dts.ts;
+  if (!ts.fully_defined_type_exists(type_name) && !ts.partially_defined_type_exists(type_name)) {
+    h.add("unknown type");
+  } else {
+    for (const auto& name : ts.get_path_up_tree(type_name)) {
+      h.add(name);
+      if (!ts.fully_defined_type_exists(name)) {
+        h.add("forward declared");
+        continue;
+      }
+      auto* type = ts.lookup_type(name);
+      h.add(type->print());
+      h.add(type->print_method_info());
+      for (const auto& method : type->get_methods_defined_for_type()) {
+        h.add(method.docstring);
+      }
+      for (const auto& [state, state_type] : type->get_states_declared_for_type()) {
+        h.add(state);
+        h.add(state_type.print());
+      }
+      if (auto* as_enum = dynamic_cast<const EnumType*>(type)) {
+        h.add((s64)as_enum->is_bitfield());
+        for (const auto& entry : sorted_keys(as_enum->entries())) {
+          h.add(entry);
+          h.add(as_enum->entries().at(entry));
+        }
+      }
+      auto state_doc_it = m_dts.virtual_state_metadata.find(name);
+      if (state_doc_it != m_dts.virtual_state_metadata.end()) {
+        for (const auto& state : sorted_keys(state_doc_it->second)) {
+          for (const auto& handler : sorted_keys(state_doc_it->second.at(state))) {
+            h.add(state);
+            h.add(handler);
+            h.add(state_doc_it->second.at(state).at(handler).docstring);
+          }
+        }
+      }
+    }
+  }
+
+  auto result = h.result();
+  std::lock_guard<std::mutex> lock(m_type_fingerprint_mutex);
+  m_type_fingerprints[type_name] = result;
+  return result;
+}
+
+/*!
+ * Hash the type and documentation of a global symbol.
+ */
+u64 IR2Cache::symbol_fingerprint(const std::string& symbol_name) const {
+  Hasher h;
+  h.add((s64)(m_dts.symbols.find(symbol_name) != m_dts.symbols.end()));
+  auto type_it = m_dts.symbol_types.find(symbol_name);
+  if (type_it != m_dts.symbol_types.end()) {
+    h.add(type_it->second.print());
+  }
+  auto meta_it = m_dts.symbol_metadata_map.find(symbol_name);
+  if (meta_it != m_dts.symbol_metadata_map.end()) {
+    h.add(meta_it->second.docstring);
+  }
+  auto state_doc_it = m_dts.state_metadata.find(symbol_name);
+  if (state_doc_it != m_dts.state_metadata.end()) {
+    for (const auto& handler : sorted_keys(state_doc_it->second)) {
+      h.add(handler);
+      h.add(state_doc_it->second.at(handler).docstring);
+    }
+  }
+  return h.result();
+}
+
+/*!
+ * Find a cache entry for this object. Returns nothing if there's no entry, or if any type or symbol
+ * the object used has changed since the entry was stored.
+ */
+std::optional<IR2CacheEntry> IR2Cache::lookup(const ObjectFileData& data, u64 key) {
+  auto path = entry_path(key);
+  if (!fs::exists(path)) {
+    m_misses++;
+    return std::nullopt;
+  }
+
+  try {
+    auto json = nlohmann::json::parse(file_util::read_text_file(path));
+    if (json.at("version").get<int>() != IR2_CACHE_VERSION ||
+        json.at("object").get<std::string>() != data.to_unique_name()) {
+      m_misses++;
+      return std::nullopt;
+    }
+
+    for (auto& [name, fingerprint] : json.at("types").items()) {
+      if (fingerprint.get<std::string>() != fingerprint_to_string(type_fingerprint(name))) {
+        lg::info("IR2 cache: {} needs to be decompiled because type {} changed",
+                 data.to_unique_name(), name);
+        m_misses++;
+        return std::nullopt;
+      }
+    }
+
+    for (auto& [name, fingerprint] : json.at("symbols").items()) {
+      if (fingerprint.get<std::string>() != fingerprint_to_string(symbol_fingerprint(name))) {
+        lg::info("IR2 cache: {} needs to be decompiled because symbol {} changed",
+                 data.to_unique_name(), name);
+        m_misses++;
+        return std::nullopt;
+      }
+    }
+
+    IR2CacheEntry entry;
+    entry.ir2_asm = json.at("ir2_asm").get<std::string>();
+    entry.disasm = json.at("disasm").get<std::string>();
+    if (json.contains("symbol_map")) {
+      const auto& symbol_map = json.at("symbol_map");
+      auto& symbols = entry.symbols.emplace();
+      symbols.object_file_name = symbol_map.at("object").get<std::string>();
+      for (const auto& sym : symbol_map.at("symbols")) {
+        auto& info = symbols.symbols.emplace_back();
+        info.name = sym.at(0).get<std::string>();
+        info.is_type = sym.at(1).get<bool>();
+      }
+    }
+    m_hits++;
+    return entry;
+  } catch (const std::exception& e) {
+    lg::warn("IR2 cache: ignoring bad entry {}: {}", path.string(), e.what());
+    m_misses++;
+    return std::nullopt;
+  }
+}
+
+/*!
+ * Store the output of decompiling an object. used_types should contain the names of all types
+ * looked up while the object was decompiled.
+ */
+void IR2Cache::store(const ObjectFileData& data,
+                     u64 key,
+                     const std::unordered_set<std::string>& used_types,
+                     const IR2CacheEntry& entry) {
+  nlohmann::json json;
+  json["version"] = IR2_CACHE_VERSION;
+  json["object"] = data.to_unique_name();
+
+  auto symbols = referenced_symbols(data);
+  // type pointers in the object are also types that the object depends on.
+  std::unordered_set<std::string> all_types = used_types;
+  all_types.insert(symbols.begin(), symbols.end());
+
+  auto types_json = nlohmann::json::object();
+  for (const auto& name : sorted_values(all_types)) {
+    types_json[name] = fingerprint_to_string(type_fingerprint(name));
+  }
+  json["types"] = types_json;
+
+  auto symbols_json = nlohmann::json::object();
+  for (const auto& name : symbols) {
+    symbols_json[name] = fingerprint_to_string(symbol_fingerprint(name));
+  }
+  json["symbols"] = symbols_json;
+
+  json["ir2_asm"] = entry.ir2_asm;
+  json["disasm"] = entry.disasm;
+  if (entry.symbols) {
+    nlohmann::json symbol_map;
+    symbol_map["object"] = entry.symbols->object_file_name;
+    auto syms = nlohmann::json::array();
+    for (const auto& info : entry.symbols->symbols) {
+      syms.push_back({info.name, info.is_type});
+    }
+    symbol_map["symbols"] = syms;
+    json["symbol_map"] = symbol_map;
+  }
+
+  file_util::write_text_file(entry_path(key), json.dump());
+}
+
+}  // namespace decompiler
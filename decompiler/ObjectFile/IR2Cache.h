@@ -0,0 +1,76 @@
+#pragma once
+
+/*!
+ * @file IR2Cache.h
+ * An on-disk cache of the IR2 output of each object file.
+ *
+ * Entries are named by a hash of the object file data and the parts of the config that apply to it.
+ * Each entry also remembers the types and symbols that were used during decompilation, and is only
+ * used if none of them have changed. This way, editing all-types.gc only re-decompiles the object
+ * files that actually depend on the edited types.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/util/FileUtil.h"
+
+#include "decompiler/analysis/symbol_def_map.h"
+
+namespace decompiler {
+struct Config;
+struct ObjectFileData;
+class DecompilerTypeSystem;
+
+/*!
+ * The output of the IR2 passes on a single object file.
+ */
+struct IR2CacheEntry {
+  std::string ir2_asm;  // the _ir2.asm file
+  std::string disasm;   // the _disasm.gc file
+  std::optional<SymbolMapBuilder::ObjectSymbolList> symbols;
+};
+
+class IR2Cache {
+ public:
+  IR2Cache(const fs::path& cache_dir,
+           const Config& config,
+           const DecompilerTypeSystem& dts,
+           const std::unordered_set<std::string>& skip_functions,
+           const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states);
+
+  // All functions below are safe to call from multiple threads, on different objects.
+  u64 object_key(const ObjectFileData& data) const;
+  std::optional<IR2CacheEntry> lookup(const ObjectFileData& data, u64 key);
+  void store(const ObjectFileData& data,
+             u64 key,
+             const std::unordered_set<std::string>& used_types,
+             const IR2CacheEntry& entry);
+
+  int hits() const { return m_hits; }
+  int misses() const { return m_misses; }
+
+ private:
+  u64 type_fingerprint(const std::string& type_name);
+  u64 symbol_fingerprint(const std::string& symbol_name) const;
+  fs::path entry_path(u64 key) const;
+
+  fs::path m_dir;
+  const Config& m_config;
+  const DecompilerTypeSystem& m_dts;
+  u64 m_global_key = 0;
+
+  std::mutex m_type_fingerprint_mutex;
+  std::unordered_map<std::string, u64> m_type_fingerprints;
+
+  std::atomic<int> m_hits = 0;
+  std::atomic<int> m_misses = 0;
+};
+
+}  // namespace decompiler
@@ -263,14 +263,20 @@ void ObjectFileDB::load_map_file(const std::string& map_data) {
  * Load the objects stored in the given DGO into the ObjectFileDB
  */
 void ObjectFileDB::get_objs_from_dgo(const fs::path& filename, const Config& config) {
-  auto dgo_data = file_util::read_binary_file(filename);
-  stats.total_dgo_bytes += dgo_data.size();
+  // objects are only copied out of the DGO if they aren't duplicates of one we already have.
+  file_util::MappedFile dgo_file(filename);
+  stats.total_dgo_bytes += dgo_file.size();
 
-  if (file_util::dgo_header_is_compressed(dgo_data)) {
-    dgo_data = file_util::decompress_dgo(dgo_data);
+  std::vector<u8> decompressed_data;
+  const u8* dgo_data = dgo_file.data();
+  size_t dgo_size = dgo_file.size();
+  if (file_util::dgo_header_is_compressed(dgo_data, dgo_size)) {
+    decompressed_data = file_util::decompress_dgo(dgo_data, dgo_size);
+    dgo_data = decompressed_data.data();
+    dgo_size = decompressed_data.size();
   }
 
-  BinaryReader reader(dgo_data);
+  BinaryReader reader(dgo_data, dgo_size);
   auto header = reader.read<DgoHeader>();
 
   auto dgo_base_name = filename.filename().string();
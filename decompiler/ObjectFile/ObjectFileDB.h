@@ -7,6 +7,7 @@
  * (there may be different object files with the same name sometimes)
  */
 
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -17,6 +18,7 @@
 #include "common/util/Assert.h"
 #include "common/util/FileUtil.h"
 
+#include "decompiler/IR2/Form.h"
 #include "decompiler/analysis/symbol_def_map.h"
 #include "decompiler/data/TextureDB.h"
 #include "decompiler/util/DecompilerTypeSystem.h"
@@ -155,6 +157,22 @@ struct LetRewriteStats {
   }
 };
 
+/*!
+ * Results of the IR2 passes on a single object file that must be merged into the ObjectFileDB in
+ * object order. This lets object files be analyzed in parallel.
+ */
+class IR2Cache;
+
+struct ObjectFileIR2Results {
+  LetRewriteStats let;
+  FormPoolStats form_pool;
+  std::optional<SymbolMapBuilder::ObjectSymbolList> symbols;
+  // if set, also keep a copy of the text written to the output folder (for the IR2 cache).
+  bool keep_output_text = false;
+  std::string ir2_asm;
+  std::string disasm;
+};
+
 class ObjectFileDB {
  public:
   ObjectFileDB(const std::vector<fs::path>& _dgos,
@@ -183,6 +201,22 @@ class ObjectFileDB {
       const Config& config,
       const std::unordered_set<std::string>& skip_functions,
       const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states);
+  void ir2_process_object_file(
+      ObjectFileData& data,
+      const fs::path& output_dir,
+      const Config& config,
+      const std::unordered_set<std::string>& skip_functions,
+      const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states,
+      ObjectFileIR2Results& results);
+  void ir2_process_object_file_cached(
+      ObjectFileData& data,
+      const fs::path& output_dir,
+      const Config& config,
+      const std::unordered_set<std::string>& skip_functions,
+      const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states,
+      IR2Cache* cache,
+      ObjectFileIR2Results& results);
+  void ir2_merge_results(const ObjectFileIR2Results& results);
   void analyze_functions_ir2(
       const fs::path& output_dir,
       const Config& config,
@@ -200,16 +234,20 @@ class ObjectFileDB {
   void ir2_cfg_build_pass(int seg, ObjectFileData& data);
   // void ir2_store_current_forms(int seg);
   void ir2_build_expressions(int seg, const Config& config, ObjectFileData& data);
-  void ir2_insert_lets(int seg, ObjectFileData& data);
+  void ir2_insert_lets(int seg, ObjectFileData& data, LetRewriteStats& let_stats);
   void ir2_rewrite_inline_asm_instructions(int seg, ObjectFileData& data);
   void ir2_insert_anonymous_functions(int seg, ObjectFileData& data);
-  void ir2_symbol_definition_map(ObjectFileData& data);
+  void ir2_symbol_definition_map(ObjectFileData& data, ObjectFileIR2Results& results);
   void ir2_write_results(const fs::path& output_dir,
                          const Config& config,
                          const std::vector<std::string>& imports,
-                         ObjectFileData& data);
+                         ObjectFileData& data,
+                         ObjectFileIR2Results& results);
   void ir2_do_segment_analysis_phase1(int seg, const Config& config, ObjectFileData& data);
-  void ir2_do_segment_analysis_phase2(int seg, const Config& config, ObjectFileData& data);
+  void ir2_do_segment_analysis_phase2(int seg,
+                                      const Config& config,
+                                      ObjectFileData& data,
+                                      LetRewriteStats& let_stats);
   void ir2_setup_labels(const Config& config, ObjectFileData& data);
   void ir2_run_mips2c(const Config& config, ObjectFileData& data);
   struct PerObjectAllTypeInfo {
@@ -373,6 +411,7 @@ class ObjectFileDB {
 
   struct {
     LetRewriteStats let;
+    FormPoolStats form_pool;
     uint32_t total_dgo_bytes = 0;
     uint32_t total_obj_files = 0;
     uint32_t unique_obj_files = 0;
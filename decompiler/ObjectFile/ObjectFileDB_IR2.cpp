@@ -5,13 +5,20 @@
 
 #include "ObjectFileDB.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "common/goos/PrettyPrinter.h"
 #include "common/link_types.h"
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
+#include "common/util/SimpleThreadGroup.h"
 #include "common/util/Timer.h"
 
 #include "decompiler/IR2/Form.h"
+#include "decompiler/ObjectFile/IR2Cache.h"
 #include "decompiler/analysis/analyze_inspect_method.h"
 #include "decompiler/analysis/cfg_builder.h"
 #include "decompiler/analysis/expression_build.h"
@@ -39,12 +46,31 @@ void ObjectFileDB::process_object_file_data(
     const Config& config,
     const std::unordered_set<std::string>& skip_functions,
     const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states) {
+  ObjectFileIR2Results results;
+  ir2_process_object_file(data, output_dir, config, skip_functions, skip_states, results);
+  ir2_merge_results(results);
+}
+
+/*!
+ * Run all IR2 passes on a single object file.
+ * This only reads shared ObjectFileDB state, so it is safe to call on multiple objects at the same
+ * time. Anything that must be combined across objects is put in results.
+ */
+void ObjectFileDB::ir2_process_object_file(
+    ObjectFileData& data,
+    const fs::path& output_dir,
+    const Config& config,
+    const std::unordered_set<std::string>& skip_functions,
+    const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states,
+    ObjectFileIR2Results& results) {
   Timer file_timer;
+  // don't let settings from the previous object leak in, this would depend on processing order.
+  dts.type_prop_settings.reset();
   ir2_do_segment_analysis_phase1(TOP_LEVEL_SEGMENT, config, data);
   ir2_do_segment_analysis_phase1(DEBUG_SEGMENT, config, data);
   ir2_do_segment_analysis_phase1(MAIN_SEGMENT, config, data);
   ir2_setup_labels(config, data);
-  ir2_do_segment_analysis_phase2(TOP_LEVEL_SEGMENT, config, data);
+  ir2_do_segment_analysis_phase2(TOP_LEVEL_SEGMENT, config, data, results.let);
   if (data.linked_data.functions_by_seg.size() == 3) {
     enum { DEFPART, DEFSTATE, DEFSKELGROUP } step = DEFPART;
     try {
@@ -68,8 +94,8 @@ void ObjectFileDB::process_object_file_data(
       }
     }
   }
-  ir2_do_segment_analysis_phase2(DEBUG_SEGMENT, config, data);
-  ir2_do_segment_analysis_phase2(MAIN_SEGMENT, config, data);
+  ir2_do_segment_analysis_phase2(DEBUG_SEGMENT, config, data, results.let);
+  ir2_do_segment_analysis_phase2(MAIN_SEGMENT, config, data, results.let);
 
   ir2_insert_anonymous_functions(DEBUG_SEGMENT, data);
   ir2_insert_anonymous_functions(MAIN_SEGMENT, data);
@@ -77,7 +103,7 @@ void ObjectFileDB::process_object_file_data(
 
   ir2_run_mips2c(config, data);
 
-  ir2_symbol_definition_map(data);
+  ir2_symbol_definition_map(data, results);
 
   // TODO - insert the game_name into the import line automatically
   // instead of `goal_src/jak1/import/something.gc`
@@ -91,12 +117,18 @@ void ObjectFileDB::process_object_file_data(
   }
 
   if (!output_dir.string().empty()) {
-    ir2_write_results(output_dir, config, imports, data);
+    ir2_write_results(output_dir, config, imports, data, results);
   } else {
     data.output_with_skips = ir2_final_out(data, imports, skip_functions);
     data.full_output = ir2_final_out(data, imports, {});
   }
 
+  for_each_function_def_order_in_obj(data, [&](Function& f, int) {
+    if (f.ir2.form_pool) {
+      results.form_pool += f.ir2.form_pool->stats();
+    }
+  });
+
   if (!config.generate_all_types) {
     // this frees ir2 memory, but means future passes can't look back on this function.
     for_each_function_def_order_in_obj(data, [&](Function& f, int) { f.ir2 = {}; });
@@ -117,10 +149,75 @@ void ObjectFileDB::process_object_file_data(
   lg::info("Done in {:.2f}ms", file_timer.getMs());
 }
 
+/*!
+ * Like ir2_process_object_file, but reuse the output from a previous run if the object, its config,
+ * and the types and symbols it uses have not changed. If cache is null, this always decompiles.
+ * Let stats are not stored in the cache, so they only include objects that were decompiled.
+ */
+void ObjectFileDB::ir2_process_object_file_cached(
+    ObjectFileData& data,
+    const fs::path& output_dir,
+    const Config& config,
+    const std::unordered_set<std::string>& skip_functions,
+    const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states,
+    IR2Cache* cache,
+    ObjectFileIR2Results& results) {
+  if (!cache) {
+    ir2_process_object_file(data, output_dir, config, skip_functions, skip_states, results);
+    return;
+  }
+
+  u64 key = cache->object_key(data);
+  auto entry = cache->lookup(data, key);
+  if (entry) {
+    if (!entry->ir2_asm.empty()) {
+      file_util::write_text_file(output_dir / (data.to_unique_name() + "_ir2.asm"),
+                                 entry->ir2_asm);
+    }
+    if (!entry->disasm.empty()) {
+      file_util::write_text_file(output_dir / (data.to_unique_name() + "_disasm.gc"),
+                                 entry->disasm);
+    }
+    results.symbols = entry->symbols;
+    // ir2 isn't kept when the cache is enabled, so free the functions like a normal run would.
+    for_each_function_def_order_in_obj(data, [&](Function& f, int) { f.ir2 = {}; });
+    lg::info("Used cached output");
+    return;
+  }
+
+  std::unordered_set<std::string> used_types;
+  {
+    TypeLookupRecorder recorder;
+    results.keep_output_text = true;
+    ir2_process_object_file(data, output_dir, config, skip_functions, skip_states, results);
+    used_types = recorder.types();
+  }
+
+  IR2CacheEntry new_entry;
+  new_entry.ir2_asm = std::move(results.ir2_asm);
+  new_entry.disasm = std::move(results.disasm);
+  new_entry.symbols = results.symbols;
+  cache->store(data, key, used_types, new_entry);
+}
+
+/*!
+ * Combine the results of ir2_process_object_file into the ObjectFileDB.
+ * Must be called once per object, in for_each_obj order.
+ */
+void ObjectFileDB::ir2_merge_results(const ObjectFileIR2Results& results) {
+  stats.let += results.let;
+  stats.form_pool += results.form_pool;
+  if (results.symbols) {
+    map_builder.add_object_symbols(*results.symbols);
+  }
+}
+
 /*!
  * Main IR2 analysis pass.
  * At this point, we assume that the files are loaded and we've run find_code to locate all
  * functions, but nothing else.
+ * If config.decompile_threads is not 1, object files are processed in parallel. In this case, the
+ * callbacks may be called from any thread, but never at the same time.
  */
 void ObjectFileDB::analyze_functions_ir2(
     const fs::path& output_dir,
@@ -129,23 +226,77 @@ void ObjectFileDB::analyze_functions_ir2(
     const std::optional<std::function<void()>> postfile_callback,
     const std::unordered_set<std::string>& skip_functions,
     const std::unordered_map<std::string, std::unordered_set<std::string>>& skip_states) {
-  int total_file_count = 0;
-  for (auto& f : obj_files_by_name) {
-    total_file_count += f.second.size();
+  std::vector<ObjectFileData*> objs;
+  for_each_obj([&](ObjectFileData& data) { objs.push_back(&data); });
+  int total_file_count = objs.size();
+
+  int num_threads = config.decompile_threads;
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
   }
-  int file_idx = 1;
-  for_each_obj([&](ObjectFileData& data) {
-    if (prefile_callback) {
-      prefile_callback.value()(data.to_unique_name());
+  num_threads = std::max(1, std::min(num_threads, total_file_count));
+
+  // the cache only stores the output files, so it can't be used if we need to keep ir2 around.
+  std::unique_ptr<IR2Cache> cache;
+  if (config.ir2_cache && !output_dir.string().empty() && !config.generate_all_types) {
+    cache = std::make_unique<IR2Cache>(output_dir / "ir2_cache", config, dts, skip_functions,
+                                       skip_states);
+  }
+
+  if (num_threads == 1) {
+    int file_idx = 1;
+    for (auto* data : objs) {
+      if (prefile_callback) {
+        prefile_callback.value()(data->to_unique_name());
+      }
+      lg::info("[{:3d}/{}]------ {}", file_idx++, total_file_count, data->to_unique_name());
+      ObjectFileIR2Results results;
+      ir2_process_object_file_cached(*data, output_dir, config, skip_functions, skip_states,
+                                     cache.get(), results);
+      ir2_merge_results(results);
+      if (postfile_callback) {
+        postfile_callback.value()();
+      }
     }
-    lg::info("[{:3d}/{}]------ {}", file_idx++, total_file_count, data.to_unique_name());
-    process_object_file_data(data, output_dir, config, skip_functions, skip_states);
-    if (postfile_callback) {
-      postfile_callback.value()();
+  } else {
+    lg::info("Decompiling {} object files with {} threads", total_file_count, num_threads);
+    // objects are handed out one at a time because their size varies a lot.
+    std::vector<ObjectFileIR2Results> results(objs.size());
+    std::atomic<int> next_obj = 0;
+    std::atomic<int> file_idx = 1;
+    std::mutex callback_mutex;
+    SimpleThreadGroup threads;
+    threads.run(
+        [&](int) {
+          for (int i = next_obj++; i < total_file_count; i = next_obj++) {
+            auto& data = *objs[i];
+            if (prefile_callback) {
+              std::lock_guard<std::mutex> lock(callback_mutex);
+              prefile_callback.value()(data.to_unique_name());
+            }
+            lg::info("[{:3d}/{}]------ {}", file_idx++, total_file_count, data.to_unique_name());
+            ir2_process_object_file_cached(data, output_dir, config, skip_functions,
+                                           skip_states, cache.get(), results[i]);
+            if (postfile_callback) {
+              std::lock_guard<std::mutex> lock(callback_mutex);
+              postfile_callback.value()();
+            }
+          }
+        },
+        num_threads, num_threads);
+    threads.join();
+
+    // merge in the original order, so the output is the same as a single threaded run.
+    for (auto& result : results) {
+      ir2_merge_results(result);
     }
-  });
+  }
 
+  if (cache) {
+    lg::info("IR2 cache: {} objects reused, {} decompiled", cache->hits(), cache->misses());
+  }
   lg::info("{}", stats.let.print());
+  lg::info("{}", stats.form_pool.print());
 
   if (config.generate_symbol_definition_map) {
     lg::info("Generating symbol definition map...");
@@ -165,7 +316,8 @@ void ObjectFileDB::ir2_do_segment_analysis_phase1(int seg,
 
 void ObjectFileDB::ir2_do_segment_analysis_phase2(int seg,
                                                   const Config& config,
-                                                  ObjectFileData& data) {
+                                                  ObjectFileData& data,
+                                                  LetRewriteStats& let_stats) {
   ir2_type_analysis_pass(seg, config, data);
   ir2_register_usage_pass(seg, data);
   ir2_variable_pass(seg, data);
@@ -174,7 +326,7 @@ void ObjectFileDB::ir2_do_segment_analysis_phase2(int seg,
   ir2_build_expressions(seg, config, data);
   ir2_rewrite_inline_asm_instructions(seg, data);
 
-  ir2_insert_lets(seg, data);
+  ir2_insert_lets(seg, data, let_stats);
 }
 
 void ObjectFileDB::ir2_setup_labels(const Config& config, ObjectFileData& data) {
@@ -495,8 +647,9 @@ void ObjectFileDB::ir2_atomic_op_pass(int seg, const Config& config, ObjectFileD
   });
 }
 
-void ObjectFileDB::ir2_symbol_definition_map(ObjectFileData& data) {
-  map_builder.add_object(data);
+void ObjectFileDB::ir2_symbol_definition_map(ObjectFileData& data,
+                                             ObjectFileIR2Results& results) {
+  results.symbols = SymbolMapBuilder::find_symbols_in_object(data);
 }
 
 template <typename Key, typename Value>
@@ -700,11 +853,11 @@ void ObjectFileDB::ir2_build_expressions(int seg, const Config& config, ObjectFi
   });
 }
 
-void ObjectFileDB::ir2_insert_lets(int seg, ObjectFileData& data) {
+void ObjectFileDB::ir2_insert_lets(int seg, ObjectFileData& data, LetRewriteStats& let_stats) {
   for_each_function_in_seg_in_obj(seg, data, [&](Function& func) {
     if (func.ir2.expressions_succeeded) {
       try {
-        insert_lets(func, func.ir2.env, *func.ir2.form_pool, func.ir2.top_form, stats.let);
+        insert_lets(func, func.ir2.env, *func.ir2.form_pool, func.ir2.top_form, let_stats);
       } catch (const std::exception& e) {
         const auto err = fmt::format(
             "Error while inserting lets: {}. Make sure that the return type is not "
@@ -745,7 +898,8 @@ void ObjectFileDB::ir2_insert_anonymous_functions(int seg, ObjectFileData& data)
 void ObjectFileDB::ir2_write_results(const fs::path& output_dir,
                                      const Config& config,
                                      const std::vector<std::string>& imports,
-                                     ObjectFileData& obj) {
+                                     ObjectFileData& obj,
+                                     ObjectFileIR2Results& results) {
   if (obj.linked_data.has_any_functions()) {
     auto file_text = ir2_to_file(obj, config);
     auto file_name = output_dir / (obj.to_unique_name() + "_ir2.asm");
@@ -754,6 +908,11 @@ void ObjectFileDB::ir2_write_results(const fs::path& output_dir,
     auto final = ir2_final_out(obj, imports, {});
     auto final_name = output_dir / (obj.to_unique_name() + "_disasm.gc");
     file_util::write_text_file(final_name, final);
+
+    if (results.keep_output_text) {
+      results.ir2_asm = std::move(file_text);
+      results.disasm = std::move(final);
+    }
   }
 }
 
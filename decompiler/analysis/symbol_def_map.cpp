@@ -7,23 +7,51 @@
 namespace decompiler {
 
 void SymbolMapBuilder::add_object(const ObjectFileData& data) {
+  auto symbols = find_symbols_in_object(data);
+  if (symbols) {
+    add_object_symbols(*symbols);
+  }
+}
+
+/*!
+ * Find the symbols used by a single object file, in order, without considering other objects.
+ * Returns nothing for non-code files.
+ */
+std::optional<SymbolMapBuilder::ObjectSymbolList> SymbolMapBuilder::find_symbols_in_object(
+    const ObjectFileData& data) {
   // skip non-code files
   if (data.obj_version != 3) {
-    return;
+    return std::nullopt;
   }
-  m_first_detections.emplace_back();
-  m_first_detections.back().object_file_name = data.name_from_map;
+  ObjectSymbolList result;
+  result.object_file_name = data.name_from_map;
+  std::unordered_set<std::string> seen_symbols, seen_types;
   // add load/stores from all functions
   for (const auto& seg_functions : data.linked_data.functions_by_seg) {
     for (const auto& function : seg_functions) {
-      add_load_store_from_function(function, &m_first_detections.back());
+      add_load_store_from_function(function, &result, &seen_symbols);
     }
   }
 
   // add deftypes in the top level function
   const auto& top_level_functions = data.linked_data.functions_by_seg.at(TOP_LEVEL_SEGMENT);
   ASSERT(top_level_functions.size() == 1);
-  add_deftypes_from_top_level_function(top_level_functions.at(0), &m_first_detections.back());
+  add_deftypes_from_top_level_function(top_level_functions.at(0), &result, &seen_types);
+  return result;
+}
+
+/*!
+ * Add the symbols from find_symbols_in_object, skipping the ones seen in previous objects.
+ */
+void SymbolMapBuilder::add_object_symbols(const ObjectSymbolList& symbols) {
+  auto& output = m_first_detections.emplace_back();
+  output.object_file_name = symbols.object_file_name;
+  for (const auto& info : symbols.symbols) {
+    auto& seen = info.is_type ? m_seen_types : m_seen_symbols;
+    if (seen.insert(info.name).second) {
+      output.symbols.push_back(info);
+    }
+  }
 }
 
 void SymbolMapBuilder::build_map() {
@@ -91,7 +119,9 @@ std::optional<std::string> get_loaded_or_stored_symbol_name(const AtomicOp* op)
 }
 }  // namespace
 
-void SymbolMapBuilder::add_load_store_from_function(const Function& f, ObjectSymbolList* output) {
+void SymbolMapBuilder::add_load_store_from_function(const Function& f,
+                                                    ObjectSymbolList* output,
+                                                    std::unordered_set<std::string>* seen_symbols) {
   if (!f.ir2.atomic_ops_succeeded) {
     if (!f.suspected_asm) {
       // some asm functions will use mips2c which doesn't require atomic ops.
@@ -105,26 +135,28 @@ void SymbolMapBuilder::add_load_store_from_function(const Function& f, ObjectSym
   for (const auto& op : f.ir2.atomic_ops->ops) {
     const auto sym = get_loaded_or_stored_symbol_name(op.get());
     if (sym) {
-      if (m_seen_symbols.find(*sym) == m_seen_symbols.end()) {
+      if (seen_symbols->find(*sym) == seen_symbols->end()) {
         SymbolInfo info;
         info.name = *sym;
         info.is_type = false;
         output->symbols.push_back(info);
-        m_seen_symbols.insert(*sym);
+        seen_symbols->insert(*sym);
       }
     }
   }
 }
 
-void SymbolMapBuilder::add_deftypes_from_top_level_function(const Function& f,
-                                                            ObjectSymbolList* output) {
+void SymbolMapBuilder::add_deftypes_from_top_level_function(
+    const Function& f,
+    ObjectSymbolList* output,
+    std::unordered_set<std::string>* seen_types) {
   for (const auto& name : f.types_defined) {
-    if (m_seen_types.find(name) == m_seen_types.end()) {
+    if (seen_types->find(name) == seen_types->end()) {
       SymbolInfo info;
       info.name = name;
       info.is_type = true;
       output->symbols.push_back(info);
-      m_seen_types.insert(name);
+      seen_types->insert(name);
     }
   }
 }
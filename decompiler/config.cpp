@@ -72,12 +72,24 @@ Config make_config_via_json(nlohmann::json& json) {
   config.hexdump_code = json.at("hexdump_code").get<bool>();
   config.hexdump_data = json.at("hexdump_data").get<bool>();
   config.find_functions = json.at("find_functions").get<bool>();
+  if (json.contains("decompile_threads")) {
+    config.decompile_threads = json.at("decompile_threads").get<int>();
+  }
+  if (json.contains("ir2_cache")) {
+    config.ir2_cache = json.at("ir2_cache").get<bool>();
+  }
   config.dump_objs = json.at("dump_objs").get<bool>();
   config.print_cfgs = json.at("print_cfgs").get<bool>();
   config.generate_symbol_definition_map = json.at("generate_symbol_definition_map").get<bool>();
   config.is_pal = json.at("is_pal").get<bool>();
   config.rip_levels = json.at("rip_levels").get<bool>();
   config.extract_collision = json.at("extract_collision").get<bool>();
+  if (json.contains("level_compression_level")) {
+    config.level_compression.level = json.at("level_compression_level").get<int>();
+  }
+  if (json.contains("level_compression_threads")) {
+    config.level_compression.workers = json.at("level_compression_threads").get<int>();
+  }
   config.generate_all_types = json.at("generate_all_types").get<bool>();
   if (json.contains("read_spools")) {
     config.read_spools = json.at("read_spools").get<bool>();
@@ -8,6 +8,7 @@
 
 #include "common/common_types.h"
 #include "common/util/FileUtil.h"
+#include "common/util/compress.h"
 #include "common/versions.h"
 
 #include "decompiler/Disasm/Register.h"
@@ -117,7 +118,10 @@ struct Config {
   bool dump_art_group_info = false;
   bool rip_levels = false;
   bool extract_collision = false;
+  compression::ZstdOptions level_compression;
   bool find_functions = false;
+  int decompile_threads = 1;
+  bool ir2_cache = false;
   bool read_spools = false;
 
   bool write_hex_near_instructions = false;
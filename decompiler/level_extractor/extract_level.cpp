@@ -1,11 +1,13 @@
 #include "extract_level.h"
 
+#include <algorithm>
 #include <set>
 #include <thread>
 
+#include "common/custom_data/fr3_file.h"
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
-#include "common/util/SimpleThreadGroup.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/compress.h"
 #include "common/util/string_util.h"
 
@@ -116,12 +118,13 @@ void extract_art_groups_from_level(const ObjectFileDB& db,
                                    const std::string& dgo_name,
                                    tfrag3::Level& level_data) {
   const auto& files = db.obj_files_by_dgo.at(dgo_name);
+  std::vector<const ObjectFileData*> ag_files;
   for (const auto& file : files) {
     if (file.name.length() > 3 && !file.name.compare(file.name.length() - 3, 3, "-ag")) {
-      const auto& ag_file = db.lookup_record(file);
-      extract_merc(ag_file, tex_db, db.dts, tex_remap, level_data, false, db.version());
+      ag_files.push_back(&db.lookup_record(file));
     }
   }
+  extract_merc(ag_files, tex_db, db.dts, tex_remap, level_data, false, db.version());
 }
 
 std::vector<level_tools::TextureRemap> extract_bsp_from_level(const ObjectFileDB& db,
@@ -215,6 +218,25 @@ std::vector<level_tools::TextureRemap> extract_bsp_from_level(const ObjectFileDB
   return bsp_header.texture_remap_table;
 }
 
+/*!
+ * Serialize, compress, and save a level as a sectioned .fr3 file.
+ */
+void save_fr3(tfrag3::Level& level,
+              const std::string& dgo_name,
+              const fs::path& output_folder,
+              const compression::ZstdOptions& compression_options) {
+  size_t uncompressed_size = 0;
+  auto compressed = tfrag3::write_fr3(level, compression_options, &uncompressed_size);
+
+  lg::info("stats for {}", dgo_name);
+  print_memory_usage(level, uncompressed_size);
+  lg::info("compressed: {} -> {} ({:.2f}%)", uncompressed_size, compressed.size(),
+           100.f * compressed.size() / uncompressed_size);
+  file_util::write_binary_file(
+      output_folder / fmt::format("{}.fr3", dgo_name.substr(0, dgo_name.length() - 4)),
+      compressed.data(), compressed.size());
+}
+
 /*!
  * Extract stuff found in GAME.CGO.
  * Even though GAME.CGO isn't technically a level, the decompiler/loader treat it like one,
@@ -224,7 +246,8 @@ void extract_common(const ObjectFileDB& db,
                     const TextureDB& tex_db,
                     const std::string& dgo_name,
                     bool dump_levels,
-                    const fs::path& output_folder) {
+                    const fs::path& output_folder,
+                    const compression::ZstdOptions& compression_options) {
   if (db.obj_files_by_dgo.count(dgo_name) == 0) {
     lg::warn("Skipping common extract for {} because the DGO was not part of the input", dgo_name);
     return;
@@ -241,18 +264,7 @@ void extract_common(const ObjectFileDB& db,
   add_all_textures_from_level(tfrag_level, dgo_name, tex_db);
   extract_art_groups_from_level(db, tex_db, {}, dgo_name, tfrag_level);
 
-  Serializer ser;
-  tfrag_level.serialize(ser);
-  auto compressed =
-      compression::compress_zstd(ser.get_save_result().first, ser.get_save_result().second);
-
-  lg::info("stats for {}", dgo_name);
-  print_memory_usage(tfrag_level, ser.get_save_result().second);
-  lg::info("compressed: {} -> {} ({:.2f}%)", ser.get_save_result().second, compressed.size(),
-           100.f * compressed.size() / ser.get_save_result().second);
-  file_util::write_binary_file(
-      output_folder / fmt::format("{}.fr3", dgo_name.substr(0, dgo_name.length() - 4)),
-      compressed.data(), compressed.size());
+  save_fr3(tfrag_level, dgo_name, output_folder, compression_options);
 
   if (dump_levels) {
     auto file_path = file_util::get_jak_project_dir() / "glb_out" / "common.glb";
@@ -267,7 +279,8 @@ void extract_from_level(const ObjectFileDB& db,
                         const DecompileHacks& hacks,
                         bool dump_level,
                         bool extract_collision,
-                        const fs::path& output_folder) {
+                        const fs::path& output_folder,
+                        const compression::ZstdOptions& compression_options) {
   if (db.obj_files_by_dgo.count(dgo_name) == 0) {
     lg::warn("Skipping extract for {} because the DGO was not part of the input", dgo_name);
     return;
@@ -280,17 +293,7 @@ void extract_from_level(const ObjectFileDB& db,
       extract_bsp_from_level(db, tex_db, dgo_name, hacks, extract_collision, level_data);
   extract_art_groups_from_level(db, tex_db, tex_remap, dgo_name, level_data);
 
-  Serializer ser;
-  level_data.serialize(ser);
-  auto compressed =
-      compression::compress_zstd(ser.get_save_result().first, ser.get_save_result().second);
-  lg::info("stats for {}", dgo_name);
-  print_memory_usage(level_data, ser.get_save_result().second);
-  lg::info("compressed: {} -> {} ({:.2f}%)", ser.get_save_result().second, compressed.size(),
-           100.f * compressed.size() / ser.get_save_result().second);
-  file_util::write_binary_file(
-      output_folder / fmt::format("{}.fr3", dgo_name.substr(0, dgo_name.length() - 4)),
-      compressed.data(), compressed.size());
+  save_fr3(level_data, dgo_name, output_folder, compression_options);
 
   if (dump_level) {
     auto back_file_path = file_util::get_jak_project_dir() / "glb_out" /
@@ -311,16 +314,29 @@ void extract_all_levels(const ObjectFileDB& db,
                         const DecompileHacks& hacks,
                         bool debug_dump_level,
                         bool extract_collision,
-                        const fs::path& output_path) {
-  extract_common(db, tex_db, common_name, debug_dump_level, output_path);
-  SimpleThreadGroup threads;
-  threads.run(
-      [&](int idx) {
-        extract_from_level(db, tex_db, dgo_names[idx], hacks, debug_dump_level, extract_collision,
-                           output_path);
-      },
-      dgo_names.size());
-  threads.join();
+                        const fs::path& output_path,
+                        const compression::ZstdOptions& compression_options) {
+  // levels are split into smaller tasks (art groups, lods of trees), so one big level doesn't
+  // leave the other threads idle at the end.
+  ThreadPool pool;
+  ThreadPool::TaskGroup levels(&pool);
+  levels.run(common_name, [&]() {
+    extract_common(db, tex_db, common_name, debug_dump_level, output_path, compression_options);
+  });
+  for (const auto& dgo_name : dgo_names) {
+    levels.run(dgo_name, [&, dgo_name]() {
+      extract_from_level(db, tex_db, dgo_name, hacks, debug_dump_level, extract_collision,
+                         output_path, compression_options);
+    });
+  }
+  levels.wait();
+
+  auto timings = levels.timings();
+  std::sort(timings.begin(), timings.end(),
+            [](const auto& a, const auto& b) { return a.ms > b.ms; });
+  for (const auto& timing : timings) {
+    lg::info("extract {}: {:.2f} ms", timing.name, timing.ms);
+  }
 }
 
 }  // namespace decompiler
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "common/math/Vector.h"
+#include "common/util/compress.h"
 
 #include "decompiler/ObjectFile/ObjectFileDB.h"
 
@@ -16,5 +17,6 @@ void extract_all_levels(const ObjectFileDB& db,
                         const DecompileHacks& hacks,
                         bool debug_dump_level,
                         bool extract_collision,
-                        const fs::path& path);
+                        const fs::path& path,
+                        const compression::ZstdOptions& compression_options);
 }  // namespace decompiler
@@ -2,6 +2,7 @@
 
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/colors.h"
 #include "common/util/string_util.h"
 
@@ -117,7 +118,9 @@ struct ConvertedMercEffect {
   std::vector<u32> verts_per_frag;
   bool has_envmap = false;
   DrawMode envmap_mode;
-  u32 envmap_texture;
+  // the envmap texture is added to the level later, so this can run in parallel.
+  u32 envmap_combo_tex_id = 0;
+  const char* envmap_debug_name = nullptr;
   std::optional<s8> eye_slot;
 };
 
@@ -761,8 +764,6 @@ ConvertedMercEffect convert_merc_effect(const MercEffect& input_effect,
                                         size_t ctrl_idx,
                                         size_t effect_idx,
                                         bool dump,
-                                        const TextureDB& tex_db,
-                                        tfrag3::Level& out,
                                         GameVersion version) {
   ConvertedMercEffect result;
   result.ctrl_idx = ctrl_idx;
@@ -783,8 +784,8 @@ ConvertedMercEffect convert_merc_effect(const MercEffect& input_effect,
     u32 tpage = new_tex >> 20;
     u32 tidx = (new_tex >> 8) & 0b1111'1111'1111;
     u32 tex_combo = (((u32)tpage) << 16) | tidx;
-    result.envmap_texture = find_or_add_texture_to_level(out, tex_db, "envmap", tex_combo,
-                                                         ctrl_header, nullptr, version);
+    result.envmap_combo_tex_id = tex_combo;
+    result.envmap_debug_name = "envmap";
   } else if (input_effect.envmap_or_effect_usage) {
     u32 tex_combo = 0;
     switch (version) {
@@ -803,8 +804,8 @@ ConvertedMercEffect convert_merc_effect(const MercEffect& input_effect,
         ASSERT_NOT_REACHED();
     }
 
-    result.envmap_texture = find_or_add_texture_to_level(out, tex_db, "envmap-default", tex_combo,
-                                                         ctrl_header, nullptr, version);
+    result.envmap_combo_tex_id = tex_combo;
+    result.envmap_debug_name = "envmap-default";
 
     DrawMode mode;
     mode.set_at(false);
@@ -1241,36 +1242,68 @@ void create_modifiable_vertex_data(
 }
 
 /*!
- * Top-level merc extraction
+ * The merc data from a single art group, before it has been added to a level.
  */
-void extract_merc(const ObjectFileData& ag_data,
-                  const TextureDB& tex_db,
-                  const DecompilerTypeSystem& dts,
-                  const std::vector<level_tools::TextureRemap>& map,
-                  tfrag3::Level& out,
-                  bool dump_level,
-                  GameVersion version) {
-  if (dump_level) {
-    file_util::create_dir_if_needed(file_util::get_file_path({"debug_out/merc"}));
-  }
+struct ExtractedMercArtGroup {
+  std::vector<MercCtrl> ctrls;
+  std::vector<std::vector<ConvertedMercEffect>> effects;  // ctrl, effect
+};
+
+/*!
+ * Unpack and convert all the merc-ctrls in an art group. This only reads the art group and doesn't
+ * touch the level, so it can run on multiple art groups at the same time.
+ */
+ExtractedMercArtGroup extract_merc_ctrls_and_effects(
+    const ObjectFileData& ag_data,
+    const DecompilerTypeSystem& dts,
+    const std::vector<level_tools::TextureRemap>& map,
+    bool dump_level,
+    GameVersion version) {
+  ExtractedMercArtGroup result;
   // find all merc-ctrls in the object file
   auto ctrl_locations = find_merc_ctrls(ag_data.linked_data);
 
   // extract them. this does very basic unpacking of data, as done by the VIF/DMA on PS2.
-  std::vector<MercCtrl> ctrls;
+  auto& ctrls = result.ctrls;
   for (auto location : ctrl_locations) {
     auto ctrl = extract_merc_ctrl(ag_data.linked_data, dts, location);
     ctrls.push_back(ctrl);
   }
 
   // extract draws. this does no regrouping yet.
-  std::vector<std::vector<ConvertedMercEffect>> all_effects;
   for (size_t ci = 0; ci < ctrls.size(); ci++) {
-    auto& effects_in_ctrl = all_effects.emplace_back();
+    auto& effects_in_ctrl = result.effects.emplace_back();
     for (size_t ei = 0; ei < ctrls[ci].effects.size(); ei++) {
       effects_in_ctrl.push_back(convert_merc_effect(ctrls[ci].effects[ei], ctrls[ci].header, map,
-                                                    ctrls[ci].name, ci, ei, dump_level, tex_db, out,
-                                                    version));
+                                                    ctrls[ci].name, ci, ei, dump_level, version));
+    }
+  }
+  return result;
+}
+
+/*!
+ * Add converted merc data to the level. Textures are added to the level as they are first used, so
+ * art groups must be added in a consistent order.
+ */
+void add_merc_to_level(ExtractedMercArtGroup& ag,
+                       const TextureDB& tex_db,
+                       tfrag3::Level& out,
+                       GameVersion version) {
+  const auto& ctrls = ag.ctrls;
+  auto& all_effects = ag.effects;
+
+  // envmaps first, this matches the order textures were added before extraction was split up.
+  std::vector<std::vector<u32>> envmap_textures;  // ctrl, effect
+  for (size_t ci = 0; ci < ctrls.size(); ci++) {
+    auto& textures_in_ctrl = envmap_textures.emplace_back();
+    for (auto& effect : all_effects[ci]) {
+      u32 tex = 0;
+      if (effect.envmap_debug_name) {
+        tex = find_or_add_texture_to_level(out, tex_db, effect.envmap_debug_name,
+                                           effect.envmap_combo_tex_id, ctrls[ci].header, nullptr,
+                                           version);
+      }
+      textures_in_ctrl.push_back(tex);
     }
   }
 
@@ -1298,7 +1331,7 @@ void extract_merc(const ObjectFileData& ag_data,
       auto& pc_effect = pc_ctrl.effects.emplace_back();
       auto& effect = all_effects[ci][ei];
       pc_effect.has_envmap = effect.has_envmap;
-      pc_effect.envmap_texture = effect.envmap_texture;
+      pc_effect.envmap_texture = envmap_textures[ci][ei];
       pc_effect.envmap_mode = effect.envmap_mode;
       u32 first_vertex = out.merc_data.vertices.size();
       for (auto& vtx : effect.vertices) {
@@ -1375,4 +1408,39 @@ void extract_merc(const ObjectFileData& ag_data,
     }
   }
 }
+
+/*!
+ * Top-level merc extraction
+ */
+void extract_merc(const ObjectFileData& ag_data,
+                  const TextureDB& tex_db,
+                  const DecompilerTypeSystem& dts,
+                  const std::vector<level_tools::TextureRemap>& map,
+                  tfrag3::Level& out,
+                  bool dump_level,
+                  GameVersion version) {
+  extract_merc(std::vector<const ObjectFileData*>{&ag_data}, tex_db, dts, map, out, dump_level,
+               version);
+}
+
+void extract_merc(const std::vector<const ObjectFileData*>& ag_data,
+                  const TextureDB& tex_db,
+                  const DecompilerTypeSystem& dts,
+                  const std::vector<level_tools::TextureRemap>& map,
+                  tfrag3::Level& out,
+                  bool dump_level,
+                  GameVersion version) {
+  if (dump_level) {
+    file_util::create_dir_if_needed(file_util::get_file_path({"debug_out/merc"}));
+  }
+
+  std::vector<ExtractedMercArtGroup> extracted(ag_data.size());
+  parallel_for("merc", ag_data.size(), [&](int i) {
+    extracted[i] = extract_merc_ctrls_and_effects(*ag_data[i], dts, map, dump_level, version);
+  });
+
+  for (auto& ag : extracted) {
+    add_merc_to_level(ag, tex_db, out, version);
+  }
+}
 }  // namespace decompiler
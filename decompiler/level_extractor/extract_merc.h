@@ -15,4 +15,14 @@ void extract_merc(const ObjectFileData& ag_data,
                   tfrag3::Level& out,
                   bool dump_level,
                   GameVersion version);
+
+// extract several art groups. The art groups are unpacked in parallel if running in a ThreadPool,
+// but are added to the level in order.
+void extract_merc(const std::vector<const ObjectFileData*>& ag_data,
+                  const TextureDB& tex_db,
+                  const DecompilerTypeSystem& dts,
+                  const std::vector<level_tools::TextureRemap>& map,
+                  tfrag3::Level& out,
+                  bool dump_level,
+                  GameVersion version);
 }  // namespace decompiler
\ No newline at end of file
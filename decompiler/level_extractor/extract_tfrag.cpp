@@ -6,6 +6,7 @@
 #include "common/log/log.h"
 #include "common/util/Assert.h"
 #include "common/util/FileUtil.h"
+#include "common/util/ThreadPool.h"
 
 #include "decompiler/ObjectFile/LinkedObjectFile.h"
 #include "decompiler/util/Error.h"
@@ -2099,24 +2100,29 @@ void make_tfrag3_data(std::map<u32, std::vector<GroupedDraw>>& draws,
   }
 }
 
-void emulate_tfrags(int geom,
-                    const std::vector<level_tools::TFragment>& frags,
-                    const std::string& debug_name,
-                    const std::vector<level_tools::TextureRemap>& map,
-                    tfrag3::Level& level_out,
-                    tfrag3::TfragTree& tree_out,
-                    std::vector<tfrag3::PreloadedVertex>& vertices,
-                    const TextureDB& tdb,
-                    const std::vector<std::pair<int, int>>& expected_missing_textures,
-                    bool dump_level,
-                    const std::string& level_name,
-                    bool disable_alpha_test_in_normal) {
+/*!
+ * The draws from running the tfrag VU program on all tfrags in a tree.
+ */
+struct EmulatedTfrags {
+  std::vector<TFragDraw> all_draws;
+  std::map<u32, std::vector<GroupedDraw>> groups;
+};
+
+/*!
+ * Emulate the tfrag renderer. This doesn't modify the level, so it's safe to run in parallel.
+ */
+EmulatedTfrags emulate_tfrags(int geom,
+                              const std::vector<level_tools::TFragment>& frags,
+                              const std::vector<level_tools::TextureRemap>& map,
+                              tfrag3::TFragmentTreeKind kind,
+                              bool disable_alpha_test_in_normal) {
   TFragExtractStats stats;
+  EmulatedTfrags result;
 
   std::vector<u8> vu_mem;
   vu_mem.resize(16 * 1024);
 
-  std::vector<TFragDraw> all_draws;
+  auto& all_draws = result.all_draws;
 
   for (auto& frag : frags) {
     TFragColorUnpack color_indices;
@@ -2126,14 +2132,28 @@ void emulate_tfrags(int geom,
     all_draws.insert(all_draws.end(), draws.begin(), draws.end());
   }
 
-  process_draw_mode(all_draws, map, tree_out.kind, disable_alpha_test_in_normal);
-  auto groups = make_draw_groups(all_draws);
+  process_draw_mode(all_draws, map, kind, disable_alpha_test_in_normal);
+  result.groups = make_draw_groups(all_draws);
+  return result;
+}
 
-  make_tfrag3_data(groups, tree_out, vertices, level_out.textures, tdb, expected_missing_textures,
-                   level_name);
+/*!
+ * Convert emulated draws to tfrag3 format. Adds textures to the level.
+ */
+void add_emulated_tfrags(EmulatedTfrags& emulated,
+                         const std::string& debug_name,
+                         tfrag3::Level& level_out,
+                         tfrag3::TfragTree& tree_out,
+                         std::vector<tfrag3::PreloadedVertex>& vertices,
+                         const TextureDB& tdb,
+                         const std::vector<std::pair<int, int>>& expected_missing_textures,
+                         bool dump_level,
+                         const std::string& level_name) {
+  make_tfrag3_data(emulated.groups, tree_out, vertices, level_out.textures, tdb,
+                   expected_missing_textures, level_name);
 
   if (dump_level) {
-    auto debug_out = debug_dump_to_obj(all_draws);
+    auto debug_out = debug_dump_to_obj(emulated.all_draws);
     auto file_path =
         file_util::get_file_path({"debug_out", fmt::format("tfrag-{}.obj", debug_name)});
     file_util::create_dir_if_needed_for_file(file_path);
@@ -2176,8 +2196,17 @@ void extract_tfrag(const level_tools::DrawableTreeTfrag* tree,
                    const std::string& level_name,
                    bool disable_atest_in_normal) {
   // go through 3 lods(?)
-  for (int geom = 0; geom < GEOM_MAX; ++geom) {
-    tfrag3::TfragTree this_tree;
+  // The VU emulation for each lod is independent, and runs in parallel. Converting to tfrag3 adds
+  // textures to the level, so that's done afterward, in order.
+  struct PerGeom {
+    tfrag3::TfragTree tree;
+    std::unordered_map<int, int> tfrag_parents;
+    EmulatedTfrags emulated;
+  };
+  std::vector<PerGeom> per_geom(GEOM_MAX);
+
+  parallel_for(debug_name, GEOM_MAX, [&](int geom) {
+    auto& this_tree = per_geom[geom].tree;
     if (tree->my_type() == "drawable-tree-tfrag") {
       this_tree.kind = tfrag3::TFragmentTreeKind::NORMAL;
     } else if (tree->my_type() == "drawable-tree-dirt-tfrag") {
@@ -2223,7 +2252,7 @@ void extract_tfrag(const level_tools::DrawableTreeTfrag* tree,
     this_tree.bvh.first_root = vis_nodes.first_root;
     this_tree.bvh.vis_nodes = std::move(vis_nodes.vis_nodes);
 
-    std::unordered_map<int, int> tfrag_parents;
+    auto& tfrag_parents = per_geom[geom].tfrag_parents;
     // for (auto& node : this_tree.vis_nodes) {
     for (size_t node_idx = 0; node_idx < this_tree.bvh.vis_nodes.size(); node_idx++) {
       const auto& node = this_tree.bvh.vis_nodes[node_idx];
@@ -2235,10 +2264,16 @@ void extract_tfrag(const level_tools::DrawableTreeTfrag* tree,
     }
     //  ASSERT(result.vis_nodes.last_child_node + 1 == idx);
 
+    per_geom[geom].emulated = emulate_tfrags(geom, as_tfrag_array->tfragments, map, this_tree.kind,
+                                             disable_atest_in_normal);
+  });
+
+  for (int geom = 0; geom < GEOM_MAX; ++geom) {
+    auto& this_tree = per_geom[geom].tree;
+    const auto& tfrag_parents = per_geom[geom].tfrag_parents;
     std::vector<tfrag3::PreloadedVertex> vertices;
-    emulate_tfrags(geom, as_tfrag_array->tfragments, debug_name, map, out, this_tree, vertices,
-                   tex_db, expected_missing_textures, dump_level, level_name,
-                   disable_atest_in_normal);
+    add_emulated_tfrags(per_geom[geom].emulated, debug_name, out, this_tree, vertices, tex_db,
+                        expected_missing_textures, dump_level, level_name);
     pack_tfrag_vertices(&this_tree.packed_vertices, vertices);
     extract_time_of_day(tree, this_tree);
 
@@ -2253,7 +2288,7 @@ void extract_tfrag(const level_tools::DrawableTreeTfrag* tree,
       }
       merge_groups(draw.vis_groups);
     }
-    out.tfrag_trees[geom].push_back(this_tree);
+    out.tfrag_trees[geom].push_back(std::move(this_tree));
   }
 }
 }  // namespace decompiler
@@ -4,6 +4,7 @@
 
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/string_util.h"
 
 #include "decompiler/ObjectFile/LinkedObjectFile.h"
@@ -2704,8 +2705,18 @@ void extract_tie(const level_tools::DrawableTreeInstanceTie* tree,
                  tfrag3::Level& out,
                  bool dump_level,
                  GameVersion version) {
-  for (int geo = 0; geo < GEOM_MAX; ++geo) {
-    tfrag3::TieTree this_tree;
+  // The VU emulation for each geometry is independent, and runs in parallel. Creating draws adds
+  // textures to the level, so that's done afterward, in order.
+  struct PerGeom {
+    tfrag3::TieTree tree;
+    std::unordered_map<int, int> instance_parents;
+    std::vector<TieProtoInfo> info;
+    BigPalette full_palette;
+  };
+  std::vector<PerGeom> per_geom(GEOM_MAX);
+
+  parallel_for(debug_name, GEOM_MAX, [&](int geo) {
+    auto& this_tree = per_geom[geo].tree;
 
     // sanity check the vis tree (not a perfect check, but this is used in game and should be right)
     ASSERT(tree->length == (int)tree->arrays.size());
@@ -2730,7 +2741,7 @@ void extract_tie(const level_tools::DrawableTreeInstanceTie* tree,
     // we use the index of the instance in the instance list as its index. But this is different
     // from its visibility index. This map goes from instance index to the parent node in the vis
     // tree. later, we can use this to remap from instance idx to the visiblity node index.
-    std::unordered_map<int, int> instance_parents;
+    auto& instance_parents = per_geom[geo].instance_parents;
     for (size_t node_idx = 0; node_idx < this_tree.bvh.vis_nodes.size(); node_idx++) {
       const auto& node = this_tree.bvh.vis_nodes[node_idx];
       if (node.flags == 0) {
@@ -2741,7 +2752,8 @@ void extract_tie(const level_tools::DrawableTreeInstanceTie* tree,
     }
 
     // convert level format data to a nicer format
-    auto info =
+    auto& info = per_geom[geo].info;
+    info =
         collect_instance_info(as_instance_array, &tree->prototypes.prototype_array_tie.data, geo);
     update_proto_info(&info, tex_map, tree->prototypes.prototype_array_tie.data, geo, version);
     if (version != GameVersion::Jak2) {
@@ -2767,7 +2779,14 @@ void extract_tie(const level_tools::DrawableTreeInstanceTie* tree,
     }
 
     // create time of day data.
-    auto full_palette = make_big_palette(info);
+    per_geom[geo].full_palette = make_big_palette(info);
+  });
+
+  for (int geo = 0; geo < GEOM_MAX; ++geo) {
+    auto& this_tree = per_geom[geo].tree;
+    const auto& instance_parents = per_geom[geo].instance_parents;
+    auto& info = per_geom[geo].info;
+    const auto& full_palette = per_geom[geo].full_palette;
 
     // create draws
     add_vertices_and_static_draw(this_tree, out, tex_db, info, version);
@@ -295,7 +295,8 @@ int main(int argc, char** argv) {
         file_util::get_jak_project_dir() / "out" / game_version_names[config.game_version] / "fr3";
     file_util::create_dir_if_needed(level_out_path);
     extract_all_levels(db, tex_db, config.levels_to_extract, "GAME.CGO", config.hacks,
-                       config.rip_levels, config.extract_collision, level_out_path);
+                       config.rip_levels, config.extract_collision, level_out_path,
+                       config.level_compression);
   }
 
   mem_log("After extraction: {} MB", get_peak_rss() / (1024 * 1024));
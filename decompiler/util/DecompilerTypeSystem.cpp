@@ -11,6 +11,8 @@
 #include "decompiler/Disasm/Register.h"
 
 namespace decompiler {
+thread_local DecompilerTypeSystem::TypePropSettings DecompilerTypeSystem::type_prop_settings;
+
 DecompilerTypeSystem::DecompilerTypeSystem(GameVersion version) {
   ts.add_builtin_types(version);
 }
@@ -116,6 +118,7 @@ void DecompilerTypeSystem::parse_type_defs(const std::vector<std::string>& file_
 }
 
 TypeSpec DecompilerTypeSystem::parse_type_spec(const std::string& str) const {
+  std::lock_guard<std::mutex> guard(m_reader_mutex);
   auto read = m_reader.read_from_string(str);
   auto data = cdr(read);
   return parse_typespec(&ts, car(data));
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "common/goos/Reader.h"
 #include "common/goos/TextDB.h"
 #include "common/type_system/TypeSystem.h"
@@ -70,12 +72,15 @@ class DecompilerTypeSystem {
   bool should_attempt_cast_simplify(const TypeSpec& expected, const TypeSpec& actual) const;
 
   // todo - totally eliminate this.
-  struct {
+  // this is per-thread so multiple functions can run type analysis at the same time.
+  struct TypePropSettings {
     std::string current_method_type;
     void reset() { current_method_type.clear(); }
-  } type_prop_settings;
+  };
+  static thread_local TypePropSettings type_prop_settings;
 
  private:
   mutable goos::Reader m_reader;
+  mutable std::mutex m_reader_mutex;
 };
 }  // namespace decompiler
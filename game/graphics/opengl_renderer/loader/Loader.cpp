@@ -1,9 +1,9 @@
 #include "Loader.h"
 
+#include "common/custom_data/fr3_file.h"
 #include "common/global_profiler/GlobalProfiler.h"
 #include "common/util/FileUtil.h"
 #include "common/util/Timer.h"
-#include "common/util/compress.h"
 
 #include "game/graphics/opengl_renderer/loader/LoaderStages.h"
 
@@ -17,10 +17,28 @@ std::string uppercase_string(const std::string& s) {
   }
   return result;
 }
+
+void unpack_section(const tfrag3::Fr3Section& section, tfrag3::Level* level) {
+  switch (section.kind) {
+    case tfrag3::Fr3SectionKind::TFRAG_TREE:
+      level->tfrag_trees.at(section.geom).at(section.first).unpack();
+      break;
+    case tfrag3::Fr3SectionKind::TIE_TREE:
+      level->tie_trees.at(section.geom).at(section.first).unpack();
+      break;
+    case tfrag3::Fr3SectionKind::SHRUB_TREE:
+      level->shrub_trees.at(section.first).unpack();
+      break;
+    default:
+      break;
+  }
+}
 }  // namespace
 
 Loader::Loader(const fs::path& base_path, int max_levels)
-    : m_base_path(base_path), m_max_levels(max_levels) {
+    : m_section_pool(std::min(4, (int)std::thread::hardware_concurrency())),
+      m_base_path(base_path),
+      m_max_levels(max_levels) {
   m_loader_thread = std::thread(&Loader::loader_thread, this);
   m_loader_stages = make_loader_stages();
 }
@@ -175,47 +193,49 @@ void Loader::loader_thread() {
       // simulate slower hard drive (so that the loader thread can lose to the game loads)
       // std::this_thread::sleep_for(std::chrono::milliseconds(1500));
 
-      // load the fr3 file
+      // map the fr3 file. Nothing is read from disk until sections are decompressed.
       Timer disk_timer;
       disk_timer.start(false);
-      auto data =
-          file_util::read_binary_file(m_base_path / fmt::format("{}.fr3", uppercase_string(lev)));
+      file_util::MappedFile file(m_base_path / fmt::format("{}.fr3", uppercase_string(lev)));
+      tfrag3::Fr3Reader reader(file.data(), file.size());
       double disk_load_time = disk_timer.getSeconds();
 
-      // the FR3 files are compressed
-      Timer decomp_timer;
-      decomp_timer.start(false);
-      auto decomp_data = compression::decompress_zstd(data.data(), data.size());
-      double decomp_time = decomp_timer.getSeconds();
-
-      // Read back into the tfrag3::Level structure
+      // decompress and read back into the tfrag3::Level structure, then "unpack", which creates
+      // the vertex data we'll upload to the GPU.
+      // sections are independent, so they are loaded in parallel, and each is unpacked as soon
+      // as it is loaded.
       Timer import_timer;
       import_timer.start(false);
       auto result = std::make_unique<tfrag3::Level>();
-      Serializer ser(decomp_data.data(), decomp_data.size());
-      result->serialize(ser);
-      double import_time = import_timer.getSeconds();
-
-      // and finally "unpack", which creates the vertex data we'll upload to the GPU
-      Timer unpack_timer;
-      unpack_timer.start(false);
-      for (auto& tie_tree : result->tie_trees) {
-        for (auto& tree : tie_tree) {
-          tree.unpack();
+      if (reader.is_sectioned()) {
+        reader.load_info(result.get());
+        ThreadPool::TaskGroup group(&m_section_pool);
+        for (const auto& section : reader.sections()) {
+          group.run("fr3-section", [&, section]() {
+            reader.load_section(section, result.get());
+            unpack_section(section, result.get());
+          });
         }
-      }
-      for (auto& t_tree : result->tfrag_trees) {
-        for (auto& tree : t_tree) {
-          tree.unpack();
+        group.wait();
+      } else {
+        reader.load_all(result.get());
+        for (auto& tie_tree : result->tie_trees) {
+          for (auto& tree : tie_tree) {
+            tree.unpack();
+          }
+        }
+        for (auto& t_tree : result->tfrag_trees) {
+          for (auto& tree : t_tree) {
+            tree.unpack();
+          }
+        }
+        for (auto& shrub_tree : result->shrub_trees) {
+          shrub_tree.unpack();
         }
       }
-
-      for (auto& shrub_tree : result->shrub_trees) {
-        shrub_tree.unpack();
-      }
-      fmt::print(
-          "------------> Load from file: {:.3f}s, import {:.3f}s, decomp {:.3f}s unpack {:.3f}s\n",
-          disk_load_time, import_time, decomp_time, unpack_timer.getSeconds());
+      fmt::print("------------> Load from file: {:.3f}s, import and unpack {:.3f}s ({})\n",
+                 disk_load_time, import_timer.getSeconds(),
+                 reader.is_sectioned() ? "sectioned" : "v1");
 
       // grab the lock again
       lk.lock();
@@ -235,12 +255,10 @@ void Loader::loader_thread() {
  * This should be called during initialization, before any threaded loading goes on.
  */
 void Loader::load_common(TexturePool& tex_pool, const std::string& name) {
-  auto data = file_util::read_binary_file(m_base_path / fmt::format("{}.fr3", name));
-
-  auto decomp_data = compression::decompress_zstd(data.data(), data.size());
-  Serializer ser(decomp_data.data(), decomp_data.size());
+  file_util::MappedFile file(m_base_path / fmt::format("{}.fr3", name));
+  tfrag3::Fr3Reader reader(file.data(), file.size());
   m_common_level.level = std::make_unique<tfrag3::Level>();
-  m_common_level.level->serialize(ser);
+  reader.load_all(m_common_level.level.get());
   for (auto& tex : m_common_level.level->textures) {
     m_common_level.textures.push_back(add_texture(tex_pool, tex, true));
   }
@@ -6,6 +6,7 @@
 
 #include "common/custom_data/Tfrag3Data.h"
 #include "common/util/FileUtil.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/Timer.h"
 
 #include "game/graphics/opengl_renderer/loader/common.h"
@@ -55,6 +56,9 @@ class Loader {
   std::vector<std::string> m_desired_levels;
   std::vector<std::unique_ptr<LoaderStage>> m_loader_stages;
 
+  // used by the loader thread to decompress and unpack fr3 sections in parallel
+  ThreadPool m_section_pool;
+
   fs::path m_base_path;
   int m_max_levels = 0;
 };
@@ -0,0 +1 @@
+#define GIT_VERSION "rev. 9421da"
@@ -45,7 +45,7 @@ void CardData::save_to_file(const std::string& name) {
 
 void CardData::load_from_file(const std::string& name) {
   auto raw_data = file_util::read_binary_file(name);
-  Serializer ser(raw_data.data(), raw_data.size());
+  Serializer ser(raw_data.data(), raw_data.size(), Serializer::Ownership::BORROW);
 
   ser.from_ptr(&is_formatted);
   files.clear();
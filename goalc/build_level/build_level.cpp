@@ -1,4 +1,5 @@
 #include "common/custom_data/Tfrag3Data.h"
+#include "common/custom_data/fr3_file.h"
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
 #include "common/util/compress.h"
@@ -17,14 +18,12 @@
 void save_pc_data(const std::string& nickname,
                   tfrag3::Level& data,
                   const fs::path& fr3_output_dir) {
-  Serializer ser;
-  data.serialize(ser);
-  auto compressed =
-      compression::compress_zstd(ser.get_save_result().first, ser.get_save_result().second);
+  size_t uncompressed_size = 0;
+  auto compressed = tfrag3::write_fr3(data, compression::ZstdOptions(), &uncompressed_size);
   lg::print("stats for {}\n", data.level_name);
-  print_memory_usage(data, ser.get_save_result().second);
-  lg::print("compressed: {} -> {} ({:.2f}%)\n", ser.get_save_result().second, compressed.size(),
-            100.f * compressed.size() / ser.get_save_result().second);
+  print_memory_usage(data, uncompressed_size);
+  lg::print("compressed: {} -> {} ({:.2f}%)\n", uncompressed_size, compressed.size(),
+            100.f * compressed.size() / uncompressed_size);
   file_util::write_binary_file(fr3_output_dir / fmt::format("{}.fr3", nickname), compressed.data(),
                                compressed.size());
 }
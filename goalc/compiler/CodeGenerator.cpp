@@ -11,6 +11,8 @@
 
 #include "IR.h"
 
+#include "common/util/ThreadPool.h"
+
 #include "goalc/debugger/DebugInfo.h"
 #include "goalc/emitter/IGen.h"
 
@@ -18,8 +20,11 @@
 
 using namespace emitter;
 
-CodeGenerator::CodeGenerator(FileEnv* env, DebugInfo* debug_info, GameVersion version)
-    : m_gen(version), m_fe(env), m_debug_info(debug_info) {}
+CodeGenerator::CodeGenerator(FileEnv* env,
+                             DebugInfo* debug_info,
+                             GameVersion version,
+                             bool peephole)
+    : m_gen(version), m_fe(env), m_debug_info(debug_info), m_peephole(peephole) {}
 
 /*!
  * Generate an object file.
@@ -41,11 +46,16 @@ std::vector<u8> CodeGenerator::run(const TypeSystem* ts) {
     for (auto& x : f->code_source()) {
       rec.debug->code_sources.push_back(x.heap_obj);
     }
-    for (auto& x : f->code()) {
-      rec.debug->ir_strings.push_back(x->print());
-    }
   }
 
+  // printing the IR for debug info is slow, and each function's debug info is separate.
+  parallel_for("ir-strings", m_fe->functions().size(), [&](int i) {
+    auto* debug = m_gen.get_existing_function_record(i).debug;
+    for (auto& x : m_fe->functions().at(i)->code()) {
+      debug->ir_strings.push_back(x->print());
+    }
+  });
+
   // next, add all static objects.
   for (auto& static_obj : m_fe->statics()) {
     static_obj->generate(&m_gen);
@@ -78,6 +88,9 @@ void CodeGenerator::do_goal_function(FunctionEnv* env, int f_idx) {
 
   auto f_rec = m_gen.get_existing_function_record(f_idx);
   // todo, extra alignment settings
+  if (m_peephole) {
+    m_gen.allow_peephole(f_rec);
+  }
 
   auto& ri = emitter::gRegInfo;
   const auto& allocs = env->alloc_result();
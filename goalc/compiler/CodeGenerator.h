@@ -18,7 +18,7 @@ class TypeSystem;
 
 class CodeGenerator {
  public:
-  CodeGenerator(FileEnv* env, DebugInfo* debug_info, GameVersion version);
+  CodeGenerator(FileEnv* env, DebugInfo* debug_info, GameVersion version, bool peephole);
   std::vector<u8> run(const TypeSystem* ts);
   emitter::ObjectGeneratorStats get_obj_stats() const { return m_gen.get_stats(); }
 
@@ -29,4 +29,5 @@ class CodeGenerator {
   emitter::ObjectGenerator m_gen;
   FileEnv* m_fe = nullptr;
   DebugInfo* m_debug_info = nullptr;
+  bool m_peephole = false;
 };
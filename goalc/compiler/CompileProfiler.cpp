@@ -0,0 +1,166 @@
+#include "CompileProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "common/global_profiler/GlobalProfiler.h"
+#include "common/util/Assert.h"
+
+#include "third-party/fmt/core.h"
+
+namespace {
+// enough for a full build's files, passes, and top-level forms.
+constexpr size_t TRACE_EVENT_COUNT = 1 << 17;
+
+u64 now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* kind_name(CompileProfiler::Kind kind) {
+  switch (kind) {
+    case CompileProfiler::Kind::SOURCE_FILE:
+      return "File";
+    case CompileProfiler::Kind::PASS:
+      return "Pass";
+    case CompileProfiler::Kind::FORM:
+      return "Top-level form";
+    case CompileProfiler::Kind::MACRO:
+      return "Macro";
+    default:
+      ASSERT(false);
+      return "";
+  }
+}
+}  // namespace
+
+CompileProfiler::Scope::Scope(CompileProfiler& prof, Kind kind, const std::string& name) {
+  if (prof.enabled()) {
+    m_prof = &prof;
+    m_session = prof.m_session;
+    m_depth = prof.begin(kind, name);
+  }
+}
+
+/*!
+ * Clear the previous results and start recording.
+ */
+void CompileProfiler::start() {
+  for (auto& entries : m_entries) {
+    entries.clear();
+  }
+  m_stack.clear();
+  m_session++;
+  m_enabled = true;
+  m_total_ns = 0;
+  m_start_ns = now_ns();
+
+  auto& trace = prof();
+  trace.set_enable(false);
+  trace.clear();
+  trace.set_max_events(TRACE_EVENT_COUNT);
+  trace.set_enable(true);
+  // the trace only includes events between the first and last ROOT.
+  trace.instant_event("ROOT");
+}
+
+/*!
+ * Stop recording and write the Chrome trace to the given file. Scopes that are still open, like
+ * the one for the form that stopped the profiler, are not counted.
+ */
+void CompileProfiler::stop(const std::string& trace_file) {
+  if (!m_enabled) {
+    return;
+  }
+
+  auto& trace = prof();
+  for (auto& frame : m_stack) {
+    frame.entry->active--;
+    if (frame.traced) {
+      trace.end_event();
+    }
+  }
+  m_stack.clear();
+  m_enabled = false;
+  m_total_ns = now_ns() - m_start_ns;
+
+  trace.instant_event("ROOT");
+  trace.set_enable(false);
+  trace.dump_to_json(trace_file);
+}
+
+size_t CompileProfiler::begin(Kind kind, const std::string& name) {
+  auto& entry = m_entries[(int)kind][name];
+  entry.active++;
+  auto& frame = m_stack.emplace_back();
+  frame.entry = &entry;
+  frame.traced = kind != Kind::MACRO;
+  if (frame.traced) {
+    prof().begin_event(name.c_str());
+  }
+  frame.start_ns = now_ns();
+  return m_stack.size() - 1;
+}
+
+void CompileProfiler::end(u32 session, size_t depth) {
+  if (!m_enabled || session != m_session || depth + 1 != m_stack.size()) {
+    // opened before the profiler was restarted or stopped.
+    return;
+  }
+
+  u64 elapsed = now_ns() - m_stack.back().start_ns;
+  auto frame = m_stack.back();
+  m_stack.pop_back();
+
+  frame.entry->count++;
+  frame.entry->exclusive_ns += elapsed - frame.child_ns;
+  if (--frame.entry->active == 0) {
+    frame.entry->inclusive_ns += elapsed;
+  }
+  if (!m_stack.empty()) {
+    m_stack.back().child_ns += elapsed;
+  }
+  if (frame.traced) {
+    prof().end_event();
+  }
+}
+
+/*!
+ * Get a table of the entries with the most exclusive time of each kind.
+ */
+std::string CompileProfiler::summary(int max_rows_per_kind) const {
+  std::string result = fmt::format("Profiled {:.1f} ms\n", m_total_ns / 1.e6);
+  for (int kind = 0; kind < (int)Kind::KIND_COUNT; kind++) {
+    std::vector<std::pair<const std::string*, const Entry*>> sorted;
+    for (const auto& [name, entry] : m_entries[kind]) {
+      if (entry.count) {
+        sorted.emplace_back(&name, &entry);
+      }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+      if (a.second->exclusive_ns != b.second->exclusive_ns) {
+        return a.second->exclusive_ns > b.second->exclusive_ns;
+      }
+      return *a.first < *b.first;
+    });
+
+    int rows = std::min((int)sorted.size(), max_rows_per_kind);
+    size_t name_width = 40;
+    for (int i = 0; i < rows; i++) {
+      name_width = std::max(name_width, sorted[i].first->size());
+    }
+
+    result += fmt::format("\n{:<{}} {:>9} {:>14} {:>14}\n", kind_name((Kind)kind), name_width + 2,
+                          "count", "exclusive (ms)", "inclusive (ms)");
+    for (int i = 0; i < rows; i++) {
+      const auto& [name, entry] = sorted[i];
+      result += fmt::format("  {:<{}} {:>9} {:>14.2f} {:>14.2f}\n", *name, name_width, entry->count,
+                            entry->exclusive_ns / 1.e6, entry->inclusive_ns / 1.e6);
+    }
+    if ((int)sorted.size() > max_rows_per_kind) {
+      result += fmt::format("  ... and {} more\n", sorted.size() - max_rows_per_kind);
+    }
+  }
+  return result;
+}
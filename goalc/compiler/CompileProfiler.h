@@ -0,0 +1,76 @@
+#pragma once
+
+/*!
+ * @file CompileProfiler.h
+ * An opt-in profiler for finding out where compile time goes.
+ *
+ * Time is attributed to source files, compiler passes, top-level forms and macros. Each gets an
+ * inclusive time (including everything nested inside of it) and an exclusive time (not including
+ * other profiled scopes nested inside of it). Files, passes, and top-level forms are also recorded
+ * as GlobalProfiler events, so a run can be viewed as a Chrome trace. There are too many macro
+ * expansions for the trace, so macros only appear in the summary.
+ *
+ * The profiler is only used from the thread running the compiler.
+ */
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/common_types.h"
+
+class CompileProfiler {
+ public:
+  enum class Kind : u8 { SOURCE_FILE, PASS, FORM, MACRO, KIND_COUNT };
+
+  /*!
+   * Attributes the time until it is destroyed to the given name. Does nothing if the profiler
+   * isn't running.
+   */
+  class Scope {
+   public:
+    Scope(CompileProfiler& prof, Kind kind, const std::string& name);
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope() {
+      if (m_prof) {
+        m_prof->end(m_session, m_depth);
+      }
+    }
+
+   private:
+    CompileProfiler* m_prof = nullptr;
+    u32 m_session = 0;
+    size_t m_depth = 0;
+  };
+
+  bool enabled() const { return m_enabled; }
+  void start();
+  void stop(const std::string& trace_file);
+  std::string summary(int max_rows_per_kind) const;
+
+ private:
+  struct Entry {
+    u64 inclusive_ns = 0;
+    u64 exclusive_ns = 0;
+    u64 count = 0;
+    int active = 0;  // how many times this is on the stack, to count recursion once.
+  };
+
+  struct Frame {
+    Entry* entry = nullptr;
+    u64 start_ns = 0;
+    u64 child_ns = 0;
+    bool traced = false;
+  };
+
+  size_t begin(Kind kind, const std::string& name);
+  void end(u32 session, size_t depth);
+
+  bool m_enabled = false;
+  u32 m_session = 0;
+  u64 m_total_ns = 0;
+  u64 m_start_ns = 0;
+  std::vector<Frame> m_stack;
+  std::unordered_map<std::string, Entry> m_entries[(int)Kind::KIND_COUNT];
+};
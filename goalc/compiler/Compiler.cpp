@@ -9,6 +9,8 @@
 #include "common/goos/PrettyPrinter.h"
 #include "common/link_types.h"
 #include "common/util/FileUtil.h"
+#include "common/util/Hasher.h"
+#include "common/util/Timer.h"
 
 #include "goalc/make/Tools.h"
 #include "goalc/regalloc/Allocator.h"
@@ -20,8 +22,10 @@ using namespace goos;
 
 Compiler::Compiler(GameVersion version,
                    const std::string& user_profile,
-                   std::unique_ptr<REPL::Wrapper> repl)
+                   std::unique_ptr<REPL::Wrapper> repl,
+                   const fs::path& snapshot_file)
     : m_version(version),
+      m_user_profile(user_profile),
       m_goos(user_profile),
       m_debugger(&m_listener, &m_goos.reader, version),
       m_repl(std::move(repl)),
@@ -37,19 +41,18 @@ Compiler::Compiler(GameVersion version,
   // define game version before loading goal-lib.gc
   m_goos.set_global_variable_by_name("GAME_VERSION", m_goos.intern(game_version_names[m_version]));
 
-  // load GOAL library
-  Object library_code = m_goos.reader.read_from_file({"goal_src", "goal-lib.gc"});
-  compile_object_file("goal-lib", library_code, false);
+  for (const auto& [name, info] : g_goal_forms) {
+    m_goal_forms[m_goos.intern_ptr(name)].compile = info.second;
+  }
+  for (const auto& [name, form] : g_const_prop_forms) {
+    m_goal_forms[m_goos.intern_ptr(name)].const_prop = form;
+  }
 
-  // user profile stuff
-  if (user_profile != "#f" && fs::exists(file_util::get_jak_project_dir() / "goal_src" / "user" /
-                                         user_profile / "user.gc")) {
-    try {
-      Object user_code =
-          m_goos.reader.read_from_file({"goal_src", "user", user_profile, "user.gc"});
-      compile_object_file(user_profile, user_code, false);
-    } catch (std::exception& e) {
-      print_compiler_warning("REPL Warning: {}\n", e.what());
+  // load GOAL library, from the snapshot if it is up to date.
+  if (snapshot_file.empty() || !load_snapshot(snapshot_file)) {
+    load_library();
+    if (!snapshot_file.empty()) {
+      save_snapshot(snapshot_file);
     }
   }
 
@@ -81,6 +84,27 @@ Compiler::Compiler(GameVersion version,
   setup_goos_forms();
 }
 
+/*!
+ * Compile the GOAL library and the user profile.
+ */
+void Compiler::load_library() {
+  // load GOAL library
+  Object library_code = m_goos.reader.read_from_file({"goal_src", "goal-lib.gc"});
+  compile_object_file("goal-lib", library_code, false);
+
+  // user profile stuff
+  if (m_user_profile != "#f" && fs::exists(file_util::get_jak_project_dir() / "goal_src" /
+                                           "user" / m_user_profile / "user.gc")) {
+    try {
+      Object user_code =
+          m_goos.reader.read_from_file({"goal_src", "user", m_user_profile, "user.gc"});
+      compile_object_file(m_user_profile, user_code, false);
+    } catch (std::exception& e) {
+      print_compiler_warning("REPL Warning: {}\n", e.what());
+    }
+  }
+}
+
 Compiler::~Compiler() {
   if (m_listener.is_connected()) {
     m_listener.send_reset(false);  // reset the target
@@ -235,14 +259,39 @@ Val* Compiler::compile_error_guard(const goos::Object& code, Env* env) {
   }
 }
 
-void Compiler::color_object_file(FileEnv* env) {
-  int num_spills_in_file = 0;
-  for (auto& f : env->functions()) {
+void Compiler::color_object_file(FileEnv* env, bool linear_scan_regalloc) {
+  // functions are allocated independently, so they can be done in parallel. The results are added
+  // to the functions in order afterward, so warnings and stats don't depend on timing.
+  struct FunctionAllocation {
+    AllocationResult result;
+    bool used_v1 = false;
+    bool linear_scan_failed = false;
+    s64 time_ns = 0;
+    IROptimizerStats ir_opt;
+  };
+  const auto& functions = env->functions();
+  std::vector<FunctionAllocation> allocations(functions.size());
+
+  auto allocate_function = [&](int func_idx) {
+    auto& f = functions.at(func_idx);
+    auto& allocation = allocations.at(func_idx);
+    if (m_settings.ir_opt_level > 0) {
+      allocation.ir_opt = optimize_function_ir(f.get(), m_settings.ir_opt_level);
+    }
+    Timer timer;
+    timer.start(false);
     AllocationInput input;
     input.is_asm_function = f->is_asm_func;
+    input.linear_scan = linear_scan_regalloc || m_settings.linear_scan_regalloc;
+    input.instructions.reserve(f->code().size());
     for (auto& i : f->code()) {
       input.instructions.push_back(i->to_rai());
-      input.debug_instruction_names.push_back(i->print());
+    }
+    if (m_settings.debug_print_regalloc) {
+      // these are only used in debug prints, and are expensive to build for large functions.
+      for (auto& i : f->code()) {
+        input.debug_instruction_names.push_back(i->print());
+      }
     }
 
     for (auto& reg_val : f->reg_vals()) {
@@ -263,28 +312,57 @@ void Compiler::color_object_file(FileEnv* env) {
       input.debug_settings.allocate_log_level = 2;
     }
 
-    m_debug_stats.total_funcs++;
+    allocation.result = allocate_registers_v2(input);
+    if (!allocation.result.ok && input.linear_scan) {
+      allocation.linear_scan_failed = true;
+      input.linear_scan = false;
+      allocation.result = allocate_registers_v2(input);
+    }
+    if (!allocation.result.ok) {
+      allocation.used_v1 = true;
+      allocation.result = allocate_registers(input);
+    }
+    allocation.time_ns = timer.getNs();
+  };
+
+  if (m_settings.debug_print_regalloc) {
+    // keep the debug prints of each function together.
+    for (size_t i = 0; i < functions.size(); i++) {
+      allocate_function(i);
+    }
+  } else {
+    ThreadPool::ScopedCurrent use_pool(&m_thread_pool);
+    parallel_for("regalloc", functions.size(), allocate_function);
+  }
 
-    auto regalloc_result_2 = allocate_registers_v2(input);
+  int num_spills_in_file = 0;
+  for (size_t i = 0; i < functions.size(); i++) {
+    auto& f = functions[i];
+    auto& allocation = allocations[i];
+    m_debug_stats.total_funcs++;
+    m_debug_stats.regalloc_ns += allocation.time_ns;
+    m_debug_stats.ir_opt += allocation.ir_opt;
+    m_debug_stats.num_saved_regs += allocation.result.used_saved_regs.size();
+    if (allocation.linear_scan_failed) {
+      m_debug_stats.funcs_linear_scan_failed++;
+    }
 
-    if (regalloc_result_2.ok) {
-      if (regalloc_result_2.num_spilled_vars > 0) {
+    if (!allocation.used_v1) {
+      if (allocation.result.num_spilled_vars > 0) {
         // lg::print("Function {} has {} spilled vars.\n", f->name(),
-        //  regalloc_result_2.num_spilled_vars);
+        //  allocation.result.num_spilled_vars);
       }
-      num_spills_in_file += regalloc_result_2.num_spills;
-      f->set_allocations(std::move(regalloc_result_2));
+      num_spills_in_file += allocation.result.num_spills;
     } else {
       lg::print(
           "Warning: function {} failed register allocation with the v2 allocator. Falling back to "
           "the v1 allocator.\n",
           f->name());
       m_debug_stats.funcs_requiring_v1_allocator++;
-      auto regalloc_result = allocate_registers(input);
-      m_debug_stats.num_spills_v1 += regalloc_result.num_spills;
-      num_spills_in_file += regalloc_result.num_spills;
-      f->set_allocations(std::move(regalloc_result));
+      m_debug_stats.num_spills_v1 += allocation.result.num_spills;
+      num_spills_in_file += allocation.result.num_spills;
     }
+    f->set_allocations(std::move(allocation.result));
   }
 
   m_debug_stats.num_spills += num_spills_in_file;
@@ -294,16 +372,19 @@ std::vector<u8> Compiler::codegen_object_file(FileEnv* env) {
   try {
     auto debug_info = &m_debugger.get_debug_info_for_object(env->name());
     debug_info->clear();
-    CodeGenerator gen(env, debug_info, m_version);
+    CodeGenerator gen(env, debug_info, m_version, m_settings.peephole);
     bool ok = true;
-    auto result = gen.run(&m_ts);
+    std::vector<u8> result;
+    {
+      ThreadPool::ScopedCurrent use_pool(&m_thread_pool);
+      result = gen.run(&m_ts);
+    }
     for (auto& f : env->functions()) {
       if (f->settings.print_asm) {
         lg::print("{}\n", debug_info->disassemble_function_by_name(f->name(), &ok, &m_goos.reader));
       }
     }
-    auto stats = gen.get_obj_stats();
-    m_debug_stats.num_moves_eliminated += stats.moves_eliminated;
+    record_codegen_stats(env, gen.get_obj_stats());
     env->cleanup_after_codegen();
     return result;
   } catch (std::exception& e) {
@@ -312,13 +393,51 @@ std::vector<u8> Compiler::codegen_object_file(FileEnv* env) {
   return {};
 }
 
+void Compiler::record_codegen_stats(FileEnv* env, const emitter::ObjectGeneratorStats& stats) {
+  m_debug_stats.num_moves_eliminated += stats.moves_eliminated;
+  m_debug_stats.num_moves_kept += stats.moves_kept;
+  m_debug_stats.peephole_by_file[env->name()] = stats;
+}
+
+/*!
+ * Finish a file with an object from the cache instead of running the back end. The cached debug
+ * info doesn't have the forms each IR came from, but they are the same as in this compile because
+ * the source and everything it used is the same. Returns false if the functions don't match.
+ */
+bool Compiler::use_cached_object(FileEnv* env, const CachedObject& cached) {
+  auto& debug_info = m_debugger.get_debug_info_for_object(env->name());
+  if (debug_info.function_count() != env->functions().size()) {
+    return false;
+  }
+  for (auto& f : env->functions()) {
+    if (!debug_info.has_function(f->name())) {
+      return false;
+    }
+    auto& func_info = debug_info.function_by_name(f->name());
+    if (func_info.ir_strings.size() != f->code_source().size()) {
+      return false;
+    }
+    func_info.code_sources.clear();
+    for (auto& x : f->code_source()) {
+      func_info.code_sources.push_back(x.heap_obj);
+    }
+  }
+  record_codegen_stats(env, cached.stats);
+  env->cleanup_after_codegen();
+  return true;
+}
+
 bool Compiler::codegen_and_disassemble_object_file(FileEnv* env,
                                                    std::vector<u8>* data_out,
                                                    std::string* asm_out) {
   auto debug_info = &m_debugger.get_debug_info_for_object(env->name());
   debug_info->clear();
-  CodeGenerator gen(env, debug_info, m_version);
-  *data_out = gen.run(&m_ts);
+  CodeGenerator gen(env, debug_info, m_version, m_settings.peephole);
+  {
+    ThreadPool::ScopedCurrent use_pool(&m_thread_pool);
+    *data_out = gen.run(&m_ts);
+  }
+  record_codegen_stats(env, gen.get_obj_stats());
   bool ok = true;
   *asm_out = debug_info->disassemble_all_functions(&ok, &m_goos.reader);
   return ok;
@@ -370,7 +489,7 @@ void Compiler::typecheck_reg_type_allow_false(const goos::Object& form,
 
 void Compiler::setup_goos_forms() {
   m_goos.register_form("get-enum-vals", [&](const goos::Object& form, goos::Arguments& args,
-                                            const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                            const goos::HeapPtr<goos::EnvironmentObject>& env) {
     m_goos.eval_args(&args, env);
     va_check(form, args, {goos::ObjectType::SYMBOL}, {});
     std::vector<Object> enum_vals;
@@ -400,6 +519,22 @@ void Compiler::setup_goos_forms() {
   });
 }
 
+/*!
+ * Hash the settings that change the generated code for a file, other than the dependencies recorded
+ * while compiling it.
+ */
+u64 Compiler::object_cache_key(bool linear_scan_regalloc) const {
+  Hasher h;
+  h.add((s64)m_version);
+  h.add((s64)m_settings.disable_math_const_prop);
+  h.add((s64)m_settings.emit_move_after_return);
+  h.add((s64)(linear_scan_regalloc || m_settings.linear_scan_regalloc));
+  h.add((s64)m_settings.ir_opt_level);
+  h.add((s64)m_settings.peephole);
+  h.add((s64)m_settings.devirtualize_leaf_types);
+  return h.result();
+}
+
 void Compiler::asm_file(const CompilationOptions& options) {
   // If the filename provided is not a valid path but it's a name (with or without an extension)
   // attempt to find it in the defined `asmFileSearchDirs`
@@ -447,7 +582,12 @@ void Compiler::asm_file(const CompilationOptions& options) {
     file_path = candidate_paths.at(0).string();
   }
 
-  auto code = m_goos.reader.read_from_file({file_path});
+  CompileProfiler::Scope file_scope(m_profiler, CompileProfiler::Kind::SOURCE_FILE, file_path);
+  goos::Object code;
+  {
+    CompileProfiler::Scope read_scope(m_profiler, CompileProfiler::Kind::PASS, "read");
+    code = m_goos.reader.read_from_file({file_path});
+  }
 
   std::string obj_file_name = file_path;
 
@@ -460,25 +600,85 @@ void Compiler::asm_file(const CompilationOptions& options) {
   }
   obj_file_name = obj_file_name.substr(0, obj_file_name.find_last_of('.'));
 
+  // the cache can only skip the back end, so it's only useful if we are going to run it.
+  bool use_cache = options.color && !options.disassemble && m_settings.use_object_cache &&
+                   !m_settings.debug_print_regalloc;
+  std::optional<ObjectDependencyRecorder> dependency_recorder;
+  if (use_cache) {
+    dependency_recorder.emplace();
+  }
+
   // COMPILE
-  auto obj_file = compile_object_file(obj_file_name, code, !options.no_code);
+  FileEnv* obj_file = nullptr;
+  {
+    CompileProfiler::Scope compile_scope(m_profiler, CompileProfiler::Kind::PASS,
+                                         "compile_object_file");
+    obj_file = compile_object_file(obj_file_name, code, !options.no_code);
+  }
 
   if (options.color) {
-    // register allocation
-    color_object_file(obj_file);
+    // print-asm output comes from code generation.
+    for (auto& f : obj_file->functions()) {
+      if (f->settings.print_asm) {
+        use_cache = false;
+      }
+    }
 
-    // code/object file generation
     std::vector<u8> data;
-    std::string disasm;
-    if (options.disassemble) {
-      codegen_and_disassemble_object_file(obj_file, &data, &disasm);
-      if (options.disassembly_output_file.empty()) {
-        printf("%s\n", disasm.c_str());
+    bool from_cache = false;
+    std::optional<ObjectDependencies> deps;
+    u64 cache_key = 0;
+    if (use_cache) {
+      deps = dependency_recorder->finish(m_ts);
+      dependency_recorder.reset();
+      auto source = file_util::read_binary_file(file_path);
+      deps->source = XXH64(source.data(), source.size(), 0);
+      cache_key = object_cache_key(options.linear_scan_regalloc);
+      m_object_cache.set_dir(file_util::get_jak_project_dir() / "out" /
+                             m_make.compiler_output_prefix() / "obj" / "cache");
+      auto cached = m_object_cache.lookup(obj_file_name, cache_key, *deps,
+                                          &m_debugger.get_debug_info_for_object(obj_file_name));
+      if (cached) {
+        if (use_cached_object(obj_file, *cached)) {
+          data = std::move(cached->data);
+          from_cache = true;
+        } else {
+          lg::warn("Object cache: regenerating {} because its functions don't match",
+                   obj_file_name);
+        }
+      }
+    }
+
+    if (!from_cache) {
+      // register allocation
+      {
+        CompileProfiler::Scope color_scope(m_profiler, CompileProfiler::Kind::PASS,
+                                           "color_object_file");
+        color_object_file(obj_file, options.linear_scan_regalloc);
+      }
+
+      // code/object file generation
+      std::string disasm;
+      if (options.disassemble) {
+        CompileProfiler::Scope codegen_scope(m_profiler, CompileProfiler::Kind::PASS,
+                                             "codegen_object_file");
+        codegen_and_disassemble_object_file(obj_file, &data, &disasm);
+        if (options.disassembly_output_file.empty()) {
+          printf("%s\n", disasm.c_str());
+        } else {
+          file_util::write_text_file(options.disassembly_output_file, disasm);
+        }
       } else {
-        file_util::write_text_file(options.disassembly_output_file, disasm);
+        CompileProfiler::Scope codegen_scope(m_profiler, CompileProfiler::Kind::PASS,
+                                             "codegen_object_file");
+        data = codegen_object_file(obj_file);
+      }
+
+      if (deps) {
+        m_object_cache.store(obj_file_name, cache_key, *deps, data,
+                             m_debug_stats.peephole_by_file.at(obj_file_name),
+                             &m_debugger.get_debug_info_for_object(obj_file_name));
       }
-    } else {
-      data = codegen_object_file(obj_file);
     }
 
     // send to target
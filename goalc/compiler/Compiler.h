@@ -7,11 +7,15 @@
 #include "common/goos/Interpreter.h"
 #include "common/repl/util.h"
 #include "common/type_system/TypeSystem.h"
+#include "common/util/ThreadPool.h"
 
+#include "goalc/compiler/CompileProfiler.h"
 #include "goalc/compiler/CompilerException.h"
 #include "goalc/compiler/CompilerSettings.h"
 #include "goalc/compiler/Env.h"
 #include "goalc/compiler/IR.h"
+#include "goalc/compiler/IROptimizer.h"
+#include "goalc/compiler/ObjectCache.h"
 #include "goalc/compiler/SymbolInfo.h"
 #include "goalc/data_compiler/game_text_common.h"
 #include "goalc/debugger/Debugger.h"
@@ -35,13 +39,19 @@ struct CompilationOptions {
   bool no_code = false;                 // file shouldn't generate code, throw error if it does
   bool disassemble = false;             // either print disassembly to stdout or output_file
   bool print_time = false;              // print timing statistics
+  bool linear_scan_regalloc = false;    // use the faster register allocator that spills more
 };
 
 class Compiler {
  public:
+  /*!
+   * If a snapshot file is given, the GOAL library is loaded from it instead of compiled, if the
+   * snapshot is up to date. Otherwise the library is compiled and the snapshot is saved.
+   */
   Compiler(GameVersion version,
            const std::string& user_profile = "#f",
-           std::unique_ptr<REPL::Wrapper> repl = nullptr);
+           std::unique_ptr<REPL::Wrapper> repl = nullptr,
+           const fs::path& snapshot_file = {});
   ~Compiler();
   void asm_file(const CompilationOptions& options);
 
@@ -78,6 +88,7 @@ class Compiler {
     m_ts.add_type_to_allowed_redefinition_list(type_name);
   }
   Debugger& get_debugger() { return m_debugger; }
+  const ObjectCache& get_object_cache() const { return m_object_cache; }
   listener::Listener& listener() { return m_listener; }
   void poke_target() { m_listener.send_poke(); }
   bool connect_to_target();
@@ -94,9 +105,11 @@ class Compiler {
                      std::vector<std::pair<std::string, replxx::Replxx::Color>> const& user_data);
   bool knows_object_file(const std::string& name);
   MakeSystem& make_system() { return m_make; }
+  void save_snapshot(const fs::path& path);
 
  private:
   GameVersion m_version;
+  std::string m_user_profile;
   TypeSystem m_ts;
   std::unique_ptr<GlobalEnv> m_global_env = nullptr;
   std::unique_ptr<None> m_none = nullptr;
@@ -115,16 +128,30 @@ class Compiler {
   SymbolInfoMap m_symbol_info;
   std::unique_ptr<REPL::Wrapper> m_repl;
   MakeSystem m_make;
+  ThreadPool m_thread_pool;  // for register allocation and code generation
+  ObjectCache m_object_cache;
+  CompileProfiler m_profiler;
 
   struct DebugStats {
     int num_spills = 0;
     int num_spills_v1 = 0;
     int num_moves_eliminated = 0;
+    int num_moves_kept = 0;
+    int num_saved_regs = 0;  // callee-saved registers pushed in prologues
     int total_funcs = 0;
     int funcs_requiring_v1_allocator = 0;
+    int funcs_linear_scan_failed = 0;
+    int num_devirtualized_calls = 0;
+    s64 regalloc_ns = 0;  // added up over all threads
+    IROptimizerStats ir_opt;
+    // from the most recent codegen of each file
+    std::unordered_map<std::string, emitter::ObjectGeneratorStats> peephole_by_file;
   } m_debug_stats;
 
   void setup_goos_forms();
+  void load_library();
+  bool load_snapshot(const fs::path& path);
+  void serialize_state(Serializer& ser);
   std::set<std::string> lookup_symbol_infos_starting_with(const std::string& prefix) const;
   std::vector<SymbolInfo>* lookup_exact_name_info(const std::string& name) const;
   bool get_true_or_false(const goos::Object& form, const goos::Object& boolean);
@@ -201,8 +228,11 @@ class Compiler {
                              Env* env);
 
   SymbolVal* compile_get_sym_obj(const std::string& name, Env* env);
-  void color_object_file(FileEnv* env);
+  void color_object_file(FileEnv* env, bool linear_scan_regalloc = false);
+  u64 object_cache_key(bool linear_scan_regalloc) const;
   std::vector<u8> codegen_object_file(FileEnv* env);
+  void record_codegen_stats(FileEnv* env, const emitter::ObjectGeneratorStats& stats);
+  bool use_cached_object(FileEnv* env, const CachedObject& cached);
   bool codegen_and_disassemble_object_file(FileEnv* env,
                                            std::vector<u8>* data_out,
                                            std::string* asm_out);
@@ -584,6 +614,7 @@ class Compiler {
   Val* compile_begin(const goos::Object& form, const goos::Object& rest, Env* env);
   ConstPropResult const_prop_begin(const goos::Object& form, const goos::Object& rest, Env* env);
   Val* compile_top_level(const goos::Object& form, const goos::Object& rest, Env* env);
+  Val* compile_forms_in_order(const goos::Object& forms, Env* env, bool profile_each_form);
   Val* compile_block(const goos::Object& form, const goos::Object& rest, Env* env);
   Val* compile_return_from(const goos::Object& form, const goos::Object& rest, Env* env);
   Val* compile_label(const goos::Object& form, const goos::Object& rest, Env* env);
@@ -615,6 +646,10 @@ class Compiler {
   Val* compile_print_debug_compiler_stats(const goos::Object& form,
                                           const goos::Object& rest,
                                           Env* env);
+  Val* compile_start_compile_profile(const goos::Object& form,
+                                     const goos::Object& rest,
+                                     Env* env);
+  Val* compile_stop_compile_profile(const goos::Object& form, const goos::Object& rest, Env* env);
   Val* compile_gen_docs(const goos::Object& form, const goos::Object& rest, Env* env);
 
   // ControlFlow
@@ -706,6 +741,22 @@ class Compiler {
                                          Env* env);
   Val* compile_go_hook(const goos::Object& form, const goos::Object& rest, Env* env);
   Val* compile_gc_text(const goos::Object& form, const goos::Object& rest, Env* env);
+
+ private:
+  using CompileForm = Val* (Compiler::*)(const goos::Object& form,
+                                         const goos::Object& rest,
+                                         Env* env);
+  using ConstPropForm = ConstPropResult (Compiler::*)(const goos::Object& form,
+                                                      const goos::Object& rest,
+                                                      Env* env);
+  struct GoalForms {
+    CompileForm compile = nullptr;
+    ConstPropForm const_prop = nullptr;
+  };
+
+  // g_goal_forms and g_const_prop_forms, by the symbol object of their name, so compiling a form
+  // doesn't hash its name.
+  std::unordered_map<const goos::HeapObject*, GoalForms> m_goal_forms;
 };
 
 extern const std::unordered_map<
@@ -713,3 +764,8 @@ extern const std::unordered_map<
     std::pair<std::string,
               Val* (Compiler::*)(const goos::Object& form, const goos::Object& rest, Env* env)>>
     g_goal_forms;
+extern const std::unordered_map<std::string,
+                                Compiler::ConstPropResult (Compiler::*)(const goos::Object& form,
+                                                                        const goos::Object& rest,
+                                                                        Env* env)>
+    g_const_prop_forms;
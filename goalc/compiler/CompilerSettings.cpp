@@ -1,5 +1,7 @@
 #include "CompilerSettings.h"
 
+#include <algorithm>
+
 CompilerSettings::CompilerSettings() {
   m_settings["print-ir"].kind = SettingKind::BOOL;
   m_settings["print-ir"].boolp = &debug_print_ir;
@@ -9,6 +11,21 @@ CompilerSettings::CompilerSettings() {
 
   m_settings["disable-math-const-prop"].kind = SettingKind::BOOL;
   m_settings["disable-math-const-prop"].boolp = &disable_math_const_prop;
+
+  m_settings["object-cache"].kind = SettingKind::BOOL;
+  m_settings["object-cache"].boolp = &use_object_cache;
+
+  m_settings["linear-scan-regalloc"].kind = SettingKind::BOOL;
+  m_settings["linear-scan-regalloc"].boolp = &linear_scan_regalloc;
+
+  m_settings["ir-opt-level"].kind = SettingKind::INT;
+  m_settings["ir-opt-level"].intp = &ir_opt_level;
+
+  m_settings["peephole"].kind = SettingKind::BOOL;
+  m_settings["peephole"].boolp = &peephole;
+
+  m_settings["devirtualize-leaf-types"].kind = SettingKind::BOOL;
+  m_settings["devirtualize-leaf-types"].boolp = &devirtualize_leaf_types;
 }
 
 void CompilerSettings::set(const std::string& name, const goos::Object& value) {
@@ -21,6 +38,47 @@ void CompilerSettings::set(const std::string& name, const goos::Object& value) {
   if (kv->second.boolp) {
     *kv->second.boolp = !(value.is_symbol() && value.as_symbol()->name == "#f");
   }
+  if (kv->second.intp) {
+    if (!value.is_int()) {
+      throw std::runtime_error("Compiler setting \"" + name + "\" must be an integer");
+    }
+    *kv->second.intp = value.as_int();
+  }
+}
+
+namespace {
+template <typename T, typename Map, typename Get>
+void serialize_settings(Serializer& ser, Map& settings, Get&& get) {
+  if (ser.is_saving()) {
+    std::vector<std::string> names;
+    for (auto& [name, entry] : settings) {
+      if (get(entry)) {
+        names.push_back(name);
+      }
+    }
+    std::sort(names.begin(), names.end());
+    ser.save<size_t>(names.size());
+    for (const auto& name : names) {
+      ser.save_str(&name);
+      ser.save<T>(*get(settings.at(name)));
+    }
+  } else {
+    auto count = ser.load<size_t>();
+    for (size_t i = 0; i < count; i++) {
+      auto name = ser.load_string();
+      T value = ser.load<T>();
+      auto it = settings.find(name);
+      if (it != settings.end() && get(it->second)) {
+        *get(it->second) = value;
+      }
+    }
+  }
+}
+}  // namespace
+
+void CompilerSettings::serialize(Serializer& ser) {
+  serialize_settings<bool>(ser, m_settings, [](SettingsEntry& entry) { return entry.boolp; });
+  serialize_settings<int>(ser, m_settings, [](SettingsEntry& entry) { return entry.intp; });
 }
 
 void CompilerSettings::link(bool& val, const std::string& name) {
@@ -4,6 +4,7 @@
 #include <unordered_map>
 
 #include "common/goos/Object.h"
+#include "common/util/Serializer.h"
 
 class CompilerSettings {
  public:
@@ -12,18 +13,26 @@ class CompilerSettings {
   bool debug_print_regalloc = false;
   bool disable_math_const_prop = false;
   bool emit_move_after_return = true;
+  bool use_object_cache = true;
+  bool linear_scan_regalloc = false;
+  int ir_opt_level = 0;
+  bool peephole = true;
+  bool devirtualize_leaf_types = false;
 
   void set(const std::string& name, const goos::Object& value);
+  // save or load the values of the boolean and integer settings.
+  void serialize(Serializer& ser);
 
  private:
   void link(bool& val, const std::string& name);
 
-  enum class SettingKind { BOOL, STRING, INVALID };
+  enum class SettingKind { BOOL, INT, STRING, INVALID };
 
   struct SettingsEntry {
     SettingKind kind = SettingKind::INVALID;
     goos::Object value;
     bool* boolp = nullptr;
+    int* intp = nullptr;
   };
 
   std::unordered_map<std::string, SettingsEntry> m_settings;
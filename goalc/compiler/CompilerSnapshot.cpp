@@ -0,0 +1,238 @@
+/*!
+ * @file CompilerSnapshot.cpp
+ * Save and load the state of the compiler after it has loaded the GOAL library.
+ *
+ * Compiling goal-lib.gc (and the kernel type definitions it includes) happens every time the
+ * compiler starts. Instead, the result can be saved to a snapshot: the GOOS environments with all
+ * the macros, the type system, global symbol types, constants and inline functions, and the symbol
+ * info used by the REPL. Loading a snapshot only takes a few milliseconds.
+ *
+ * The snapshot records every source file the compiler's reader had read, with a hash of the text
+ * that was used. If any of them changed, the snapshot is out of date and the library is compiled
+ * again. The project file is not part of the snapshot, it is loaded again after the snapshot.
+ */
+
+#include "common/goos/ObjectSerializer.h"
+#include "common/log/log.h"
+#include "common/util/Timer.h"
+
+#include "goalc/compiler/Compiler.h"
+
+#include "third-party/zstd/lib/common/xxhash.h"
+
+namespace {
+// Increase this when the format of the snapshot changes, or when a change to the compiler changes
+// the state it builds from the library.
+constexpr u32 COMPILER_SNAPSHOT_VERSION = 3;
+
+/*!
+ * Save or load an unordered_map. The key and value functions save or load a single key or value.
+ */
+template <typename Key, typename Value>
+void serialize_map(Serializer& ser,
+                   std::unordered_map<Key, Value>* map,
+                   const std::function<void(Key*)>& key_func,
+                   const std::function<void(Value*)>& value_func) {
+  size_t count = map->size();
+  ser.from_ptr(&count);
+  if (ser.is_saving()) {
+    for (auto& [key, value] : *map) {
+      Key key_copy = key;
+      key_func(&key_copy);
+      value_func(&value);
+    }
+  } else {
+    map->clear();
+    for (size_t i = 0; i < count; i++) {
+      Key key;
+      key_func(&key);
+      value_func(&(*map)[key]);
+    }
+  }
+}
+
+/*!
+ * The source files that were read by the reader, and the hash of the text that was read.
+ */
+std::vector<std::pair<std::string, u64>> get_source_hashes(const goos::Reader& reader) {
+  std::vector<std::pair<std::string, u64>> result;
+  for (const auto& text : reader.db.fragments()) {
+    if (auto* file = dynamic_cast<const goos::FileText*>(text.get())) {
+      result.emplace_back(file->filename(), XXH64(text->get_text(), text->get_size(), 0));
+    }
+  }
+  return result;
+}
+
+// the path of the user profile, like the reader names it.
+std::string user_profile_path(const std::string& user_profile) {
+  return file_util::get_file_path({"goal_src", "user", user_profile, "user.gc"});
+}
+}  // namespace
+
+/*!
+ * Save or load everything the compiler learned from compiling the library.
+ */
+void Compiler::serialize_state(Serializer& ser) {
+  goos::ObjectSerializer goos_ser(ser, m_goos.reader);
+  m_goos.serialize_environments(goos_ser);
+  m_ts.serialize(ser);
+  m_settings.serialize(ser);
+
+  // global symbols are stored by their symbol object.
+  auto symbol_key = [&](goos::HeapObject** key) {
+    goos::Object sym;
+    if (ser.is_saving()) {
+      sym = m_goos.intern(static_cast<goos::SymbolObject*>(*key)->name);
+    }
+    goos_ser.from_object(&sym);
+    *key = sym.as_symbol();
+  };
+
+  serialize_map<std::string, goos::ArgumentSpec>(
+      ser, &m_macro_specs, [&](std::string* name) { ser.from_str(name); },
+      [&](goos::ArgumentSpec* spec) { goos_ser.from_arg_spec(spec); });
+  serialize_map<std::string, TypeSpec>(
+      ser, &m_symbol_types, [&](std::string* name) { ser.from_str(name); },
+      [&](TypeSpec* type) { type->serialize(ser); });
+  serialize_map<goos::HeapObject*, goos::Object>(
+      ser, &m_global_constants, symbol_key,
+      [&](goos::Object* value) { goos_ser.from_object(value); });
+  serialize_map<goos::HeapObject*, InlineableFunction>(
+      ser, &m_inlineable_functions, symbol_key, [&](InlineableFunction* func) {
+        ser.from_str(&func->lambda.debug_name);
+        size_t param_count = func->lambda.params.size();
+        ser.from_ptr(&param_count);
+        func->lambda.params.resize(param_count);
+        for (auto& param : func->lambda.params) {
+          ser.from_str(&param.name);
+          param.type.serialize(ser);
+        }
+        goos_ser.from_object(&func->lambda.body);
+        func->type.serialize(ser);
+        ser.from_ptr(&func->inline_by_default);
+      });
+
+  m_symbol_info.serialize(goos_ser);
+
+  // the names of compiled files, for completion in the REPL.
+  std::vector<std::string> file_names;
+  if (ser.is_saving()) {
+    file_names = m_global_env->list_files_with_prefix("");
+  }
+  ser.from_string_vector(&file_names);
+  if (ser.is_loading()) {
+    for (auto& name : file_names) {
+      m_global_env->add_file(name);
+    }
+  }
+}
+
+/*!
+ * Save the current state of the compiler to a snapshot file.
+ */
+void Compiler::save_snapshot(const fs::path& path) {
+  Timer timer;
+  timer.start(false);
+  Serializer ser;
+  ser.save<u32>(COMPILER_SNAPSHOT_VERSION);
+  ser.save<GameVersion>(m_version);
+  ser.save_str(&m_user_profile);
+
+  auto sources = get_source_hashes(m_goos.reader);
+  ser.save<size_t>(sources.size());
+  for (auto& [file, hash] : sources) {
+    ser.save_str(&file);
+    ser.save<u64>(hash);
+  }
+  ser.save_str(&m_make.project_file());
+
+  serialize_state(ser);
+
+  auto [data, size] = ser.get_save_result();
+  std::vector<u8> file_data(sizeof(u64) + size);
+  u64 hash = XXH64(data, size, 0);
+  memcpy(file_data.data(), &hash, sizeof(u64));
+  memcpy(file_data.data() + sizeof(u64), data, size);
+  try {
+    file_util::create_dir_if_needed_for_file(path);
+    file_util::write_binary_file(path, file_data.data(), file_data.size());
+    lg::info("Saved compiler snapshot {} ({} KB) in {:.1f} ms", path.string(), size / 1024,
+             timer.getMs());
+  } catch (std::exception& e) {
+    lg::warn("Failed to save compiler snapshot {}: {}", path.string(), e.what());
+  }
+}
+
+/*!
+ * Load the state of the compiler from a snapshot file. Returns false without changing anything if
+ * there is no snapshot, or if it is out of date.
+ */
+bool Compiler::load_snapshot(const fs::path& path) {
+  Timer timer;
+  timer.start(false);
+  if (!fs::exists(path)) {
+    return false;
+  }
+
+  auto file_data = file_util::read_binary_file(path);
+  u64 hash = 0;
+  if (file_data.size() < sizeof(u64)) {
+    lg::warn("Ignoring invalid compiler snapshot {}", path.string());
+    return false;
+  }
+  memcpy(&hash, file_data.data(), sizeof(u64));
+  const u8* data = file_data.data() + sizeof(u64);
+  size_t size = file_data.size() - sizeof(u64);
+  if (XXH64(data, size, 0) != hash) {
+    lg::warn("Ignoring invalid compiler snapshot {}", path.string());
+    return false;
+  }
+
+  Serializer ser(data, size, Serializer::Ownership::BORROW);
+  auto out_of_date = [&](const std::string& reason) {
+    lg::info("Compiler snapshot {} is out of date: {}", path.string(), reason);
+    return false;
+  };
+
+  if (ser.load<u32>() != COMPILER_SNAPSHOT_VERSION) {
+    return out_of_date("it was saved by a different compiler");
+  }
+  if (ser.load<GameVersion>() != m_version) {
+    return out_of_date("it is for a different game");
+  }
+  if (ser.load_string() != m_user_profile) {
+    return out_of_date("it is for a different user");
+  }
+
+  auto source_count = ser.load<size_t>();
+  bool has_user_profile = false;
+  auto user_profile = user_profile_path(m_user_profile);
+  for (size_t i = 0; i < source_count; i++) {
+    auto file = ser.load_string();
+    auto file_hash = ser.load<u64>();
+    if (!fs::exists(file)) {
+      return out_of_date(fmt::format("{} is missing", file));
+    }
+    auto text = file_util::read_text_file(file);
+    if (XXH64(text.data(), text.size(), 0) != file_hash) {
+      return out_of_date(fmt::format("{} changed", file));
+    }
+    if (file == user_profile) {
+      has_user_profile = true;
+    }
+  }
+  if (m_user_profile != "#f" && !has_user_profile && fs::exists(user_profile)) {
+    return out_of_date(fmt::format("{} was added", user_profile));
+  }
+
+  auto project_file = ser.load_string();
+  serialize_state(ser);
+  ASSERT(ser.get_load_finished());
+  lg::info("Loaded compiler snapshot {} in {:.1f} ms", path.string(), timer.getMs());
+
+  if (!project_file.empty()) {
+    m_make.load_project_file(project_file);
+  }
+  return true;
+}
@@ -227,6 +227,10 @@ void FunctionEnv::emit(const goos::Object& form, std::unique_ptr<IR> ir, Env* lo
   }
 }
 
+void FunctionEnv::replace_ir(int idx, std::unique_ptr<IR> ir) {
+  m_code.at(idx) = std::move(ir);
+}
+
 void FunctionEnv::finish() {
   resolve_gotos();
 }
@@ -6,6 +6,7 @@
  * manages the memory for stuff generated during compiling.
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -188,6 +189,14 @@ class FunctionEnv : public DeclareEnv {
   int max_vars() const { return m_iregs.size(); }
   const std::vector<IRegConstraint>& constraints() { return m_constraints; }
   void constrain(const IRegConstraint& c) { m_constraints.push_back(c); }
+  template <typename Pred>
+  void remove_constraints_if(Pred&& pred) {
+    m_constraints.erase(std::remove_if(m_constraints.begin(), m_constraints.end(), pred),
+                        m_constraints.end());
+  }
+  // used by the optimizer. Instructions are replaced instead of removed because labels refer to
+  // them by index.
+  void replace_ir(int idx, std::unique_ptr<IR> ir);
   void set_allocations(AllocationResult&& result) { m_regalloc_result = std::move(result); }
   RegVal* lexical_lookup(goos::Object sym) override;
   const AllocationResult& alloc_result() { return m_regalloc_result; }
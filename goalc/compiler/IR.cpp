@@ -110,6 +110,7 @@ void regset_common(emitter::ObjectGenerator* gen,
       gen->count_eliminated_move();
       gen->add_instr(IGen::null(), irec);
     } else {
+      gen->count_kept_move();
       gen->add_instr(IGen::mov_gpr64_gpr64(dst_reg, src_reg), irec);
     }
   } else if (src_class == RegClass::FLOAT && dst_class == RegClass::FLOAT) {
@@ -118,6 +119,7 @@ void regset_common(emitter::ObjectGenerator* gen,
       gen->count_eliminated_move();
       gen->add_instr(IGen::null(), irec);
     } else {
+      gen->count_kept_move();
       gen->add_instr(IGen::mov_xmm32_xmm32(dst_reg, src_reg), irec);
     }
   } else if (src_is_xmm128 && dst_is_xmm128) {
@@ -126,6 +128,7 @@ void regset_common(emitter::ObjectGenerator* gen,
       gen->count_eliminated_move();
       gen->add_instr(IGen::null(), irec);
     } else {
+      gen->count_kept_move();
       gen->add_instr(IGen::mov_vf_vf(dst_reg, src_reg), irec);
     }
   } else if (src_class == RegClass::FLOAT && dst_class == RegClass::GPR_64) {
@@ -148,6 +151,18 @@ void regset_common(emitter::ObjectGenerator* gen,
     ASSERT(false);  // unhandled move.
   }
 }
+
+/*!
+ * Replace an operand that is only read, for IR::replace_read.
+ */
+template <typename T>
+bool replace_operand(T*& operand, const RegVal* old_val, RegVal* new_val) {
+  if (operand == old_val) {
+    operand = new_val;
+    return true;
+  }
+  return false;
+}
 }  // namespace
 
 ///////////
@@ -188,6 +203,7 @@ void IR_Return::do_codegen(emitter::ObjectGenerator* gen,
   auto dest_reg = get_reg(m_return_reg, allocs, irec);
 
   if (val_reg == dest_reg) {
+    gen->count_eliminated_move();
     gen->add_instr(IGen::null(), irec);
   } else {
     regset_common(gen, allocs, irec, m_return_reg, m_value, true);
@@ -195,6 +211,10 @@ void IR_Return::do_codegen(emitter::ObjectGenerator* gen,
   }
 }
 
+bool IR_Return::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_value != m_return_reg && replace_operand(m_value, old_val, new_val);
+}
+
 /////////////////////
 // LoadConstant64
 /////////////////////
@@ -288,6 +308,10 @@ void IR_SetSymbolValue::do_codegen(emitter::ObjectGenerator* gen,
   gen->link_instruction_symbol_mem(instr, m_dest->name());
 }
 
+bool IR_SetSymbolValue::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return replace_operand(m_src, old_val, new_val);
+}
+
 /////////////////////
 // GetSymbolValue
 /////////////////////
@@ -346,6 +370,10 @@ void IR_RegSet::do_codegen(emitter::ObjectGenerator* gen,
   regset_common(gen, allocs, irec, m_dest, m_src, true);
 }
 
+bool IR_RegSet::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_src != m_dest && replace_operand(m_src, old_val, new_val);
+}
+
 std::string IR_RegSet::print() {
   return fmt::format("mov {}, {}", m_dest->print(), m_src->print());
 }
@@ -388,6 +416,11 @@ void IR_GotoLabel::resolve(const Label* dest) {
   m_resolved = true;
 }
 
+void IR_GotoLabel::retarget(const Label* dest) {
+  ASSERT(m_resolved);
+  m_dest = dest;
+}
+
 /////////////////////
 // FunctionCall
 /////////////////////
@@ -548,6 +581,11 @@ IR_IntegerMath::IR_IntegerMath(IntegerMathKind kind, RegVal* dest, RegVal* arg)
 IR_IntegerMath::IR_IntegerMath(IntegerMathKind kind, RegVal* dest, u8 shift_amount)
     : m_kind(kind), m_dest(dest), m_shift_amount(shift_amount) {}
 
+IR_IntegerMath::IR_IntegerMath(IntegerMathKind kind, RegVal* dest, RegVal* arg, s32 imm)
+    : m_kind(kind), m_dest(dest), m_arg(arg), m_imm(imm) {
+  ASSERT(kind == IntegerMathKind::ADD_IMM_64);
+}
+
 std::string IR_IntegerMath::print() {
   switch (m_kind) {
     case IntegerMathKind::ADD_64:
@@ -586,6 +624,8 @@ std::string IR_IntegerMath::print() {
       return fmt::format("xor {}, {}", m_dest->print(), m_arg->print());
     case IntegerMathKind::NOT_64:
       return fmt::format("not {}", m_dest->print());
+    case IntegerMathKind::ADD_IMM_64:
+      return fmt::format("addi {}, {}, {}", m_dest->print(), m_arg->print(), m_imm);
     default:
       throw std::runtime_error("Unsupported IntegerMathKind");
   }
@@ -594,6 +634,11 @@ std::string IR_IntegerMath::print() {
 RegAllocInstr IR_IntegerMath::to_rai() {
   RegAllocInstr rai;
   rai.write.push_back(m_dest->ireg());
+  if (m_kind == IntegerMathKind::ADD_IMM_64) {
+    // doesn't read the destination, unless it's also the argument.
+    rai.read.push_back(m_arg->ireg());
+    return rai;
+  }
   rai.read.push_back(m_dest->ireg());
 
   if (m_kind != IntegerMathKind::NOT_64 && m_kind != IntegerMathKind::SHL_64 &&
@@ -694,11 +739,30 @@ void IR_IntegerMath::do_codegen(emitter::ObjectGenerator* gen,
       // see note on udiv, same applies here.
       gen->add_instr(IGen::movsx_r64_r32(get_reg(m_dest, allocs, irec), emitter::RDX), irec);
     } break;
+    case IntegerMathKind::ADD_IMM_64: {
+      auto dr = get_reg(m_dest, allocs, irec);
+      auto ar = get_reg(m_arg, allocs, irec);
+      if (dr == ar) {
+        gen->add_instr(IGen::add_gpr64_imm(dr, m_imm), irec);
+      } else {
+        gen->add_instr(IGen::lea_reg_plus_off(dr, ar, m_imm), irec);
+      }
+    } break;
     default:
       ASSERT(false);
   }
 }
 
+bool IR_IntegerMath::removable_if_unused() const {
+  // division by zero is an exception, so don't remove those.
+  return m_kind != IntegerMathKind::IDIV_32 && m_kind != IntegerMathKind::UDIV_32 &&
+         m_kind != IntegerMathKind::IMOD_32 && m_kind != IntegerMathKind::UMOD_32;
+}
+
+bool IR_IntegerMath::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_arg && m_arg != m_dest && replace_operand(m_arg, old_val, new_val);
+}
+
 /////////////////////
 // FloatMath
 /////////////////////
@@ -774,6 +838,10 @@ void IR_FloatMath::do_codegen(emitter::ObjectGenerator* gen,
   }
 }
 
+bool IR_FloatMath::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_arg != m_dest && replace_operand(m_arg, old_val, new_val);
+}
+
 /////////////////////
 // StaticVarLoad
 /////////////////////
@@ -918,6 +986,12 @@ void IR_ConditionalBranch::do_codegen(emitter::ObjectGenerator* gen,
   gen->link_instruction_jump(jump_rec, gen->get_future_ir_record_in_same_func(irec, label.idx));
 }
 
+bool IR_ConditionalBranch::replace_read(const RegVal* old_val, RegVal* new_val) {
+  bool replaced_a = replace_operand(condition.a, old_val, new_val);
+  bool replaced_b = replace_operand(condition.b, old_val, new_val);
+  return replaced_a || replaced_b;
+}
+
 /////////////////////
 // LoadConstantOffset
 /////////////////////
@@ -967,6 +1041,10 @@ void IR_LoadConstOffset::do_codegen(emitter::ObjectGenerator* gen,
   }
 }
 
+bool IR_LoadConstOffset::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_use_coloring && m_base != m_dest && replace_operand(m_base, old_val, new_val);
+}
+
 ///////////////////////
 // StoreConstantOffset
 ///////////////////////
@@ -1015,6 +1093,15 @@ void IR_StoreConstOffset::do_codegen(emitter::ObjectGenerator* gen,
   }
 }
 
+bool IR_StoreConstOffset::replace_read(const RegVal* old_val, RegVal* new_val) {
+  if (!m_use_coloring) {
+    return false;
+  }
+  bool replaced_value = replace_operand(m_value, old_val, new_val);
+  bool replaced_base = replace_operand(m_base, old_val, new_val);
+  return replaced_value || replaced_base;
+}
+
 ///////////////////////
 // Null
 ///////////////////////
@@ -1085,6 +1172,10 @@ void IR_FloatToInt::do_codegen(emitter::ObjectGenerator* gen,
                  irec);
 }
 
+bool IR_FloatToInt::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_src != m_dest && replace_operand(m_src, old_val, new_val);
+}
+
 ///////////////////////
 // IntToFloat
 ///////////////////////
@@ -1109,6 +1200,10 @@ void IR_IntToFloat::do_codegen(emitter::ObjectGenerator* gen,
                  irec);
 }
 
+bool IR_IntToFloat::replace_read(const RegVal* old_val, RegVal* new_val) {
+  return m_src != m_dest && replace_operand(m_src, old_val, new_val);
+}
+
 ///////////////////////
 // GetStackAddr
 ///////////////////////
@@ -20,6 +20,15 @@ class IR {
     (void)constraints;
     (void)my_id;
   }
+  // for the optimizer: is it safe to remove this if nothing reads the registers it writes?
+  virtual bool removable_if_unused() const { return false; }
+  // for the optimizer: read new_val instead of old_val. Returns false if this doesn't read old_val
+  // as a separate operand, like when the same operand is also written.
+  virtual bool replace_read(const RegVal* old_val, RegVal* new_val) {
+    (void)old_val;
+    (void)new_val;
+    return false;
+  }
   virtual ~IR() = default;
 };
 
@@ -32,6 +41,7 @@ class IR_Return : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
   const RegVal* value() { return m_value; }
 
  protected:
@@ -48,6 +58,9 @@ class IR_LoadConstant64 : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
+  const RegVal* dest() const { return m_dest; }
+  u64 value() const { return m_value; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -62,6 +75,7 @@ class IR_LoadSymbolPointer : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -76,6 +90,7 @@ class IR_SetSymbolValue : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  protected:
   const SymbolVal* m_dest = nullptr;
@@ -90,6 +105,7 @@ class IR_GetSymbolValue : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -105,6 +121,10 @@ class IR_RegSet : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
+  const RegVal* dest() const { return m_dest; }
+  const RegVal* src() const { return m_src; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -155,6 +175,7 @@ class IR_StaticVarAddr : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -169,6 +190,7 @@ class IR_StaticVarLoad : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -183,6 +205,7 @@ class IR_FunctionAddr : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -207,25 +230,32 @@ enum class IntegerMathKind {
   OR_64,
   AND_64,
   XOR_64,
-  NOT_64
+  NOT_64,
+  ADD_IMM_64  // dest = arg + imm. Only made by the optimizer.
 };
 
 class IR_IntegerMath : public IR {
  public:
   IR_IntegerMath(IntegerMathKind kind, RegVal* dest, RegVal* arg);
   IR_IntegerMath(IntegerMathKind kind, RegVal* dest, u8 shift_amount);
+  IR_IntegerMath(IntegerMathKind kind, RegVal* dest, RegVal* arg, s32 imm);
   std::string print() override;
   RegAllocInstr to_rai() override;
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override;
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
   IntegerMathKind get_kind() const { return m_kind; }
+  RegVal* dest() const { return m_dest; }
+  RegVal* arg() const { return m_arg; }
 
  protected:
   IntegerMathKind m_kind;
   RegVal* m_dest;
   RegVal* m_arg = nullptr;
   u8 m_shift_amount = 0;
+  s32 m_imm = 0;
 };
 
 enum class FloatMathKind { DIV_SS, MUL_SS, ADD_SS, SUB_SS, MIN_SS, MAX_SS, SQRT_SS };
@@ -239,6 +269,8 @@ class IR_FloatMath : public IR {
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
   FloatMathKind get_kind() const { return m_kind; }
+  bool removable_if_unused() const override { return true; }
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  protected:
   FloatMathKind m_kind;
@@ -268,6 +300,8 @@ class IR_GotoLabel : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const Label* dest() const { return m_dest; }
+  void retarget(const Label* dest);
 
  protected:
   const Label* m_dest = nullptr;
@@ -282,6 +316,7 @@ class IR_ConditionalBranch : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
   void mark_as_resolved() { m_resolved = true; }
 
   Condition condition;
@@ -322,6 +357,8 @@ class IR_FloatToInt : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  private:
   const RegVal* m_dest = nullptr;
@@ -336,6 +373,8 @@ class IR_IntToFloat : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  private:
   const RegVal* m_dest = nullptr;
@@ -350,6 +389,7 @@ class IR_GetStackAddr : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return true; }
 
  private:
   const RegVal* m_dest = nullptr;
@@ -387,6 +427,8 @@ class IR_LoadConstOffset : public IR_Asm {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool removable_if_unused() const override { return m_use_coloring; }
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  private:
   const RegVal* m_dest = nullptr;
@@ -407,6 +449,7 @@ class IR_StoreConstOffset : public IR_Asm {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  bool replace_read(const RegVal* old_val, RegVal* new_val) override;
 
  private:
   const RegVal* m_value = nullptr;
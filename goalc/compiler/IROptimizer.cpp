@@ -0,0 +1,492 @@
+#include "IROptimizer.h"
+
+#include <unordered_map>
+
+#include "goalc/compiler/Env.h"
+#include "goalc/compiler/IR.h"
+
+namespace {
+
+/*!
+ * The function being optimized, and what each of its instructions reads and writes.
+ */
+struct OptimizerState {
+  FunctionEnv* env = nullptr;
+  std::vector<RegAllocInstr> instrs;  // kept up to date as the IR changes.
+  std::vector<RegVal*> vals;          // by ireg id
+
+  // variables that can change without an instruction writing them: rlet variables used by inline
+  // assembly and variables on the stack, which can be written through a pointer.
+  std::vector<bool> untracked;
+  // variables that can't be removed or replaced by a copy: untracked or constrained to a register.
+  std::vector<bool> fixed;
+
+  IROptimizerStats stats;
+
+  int size() const { return int(instrs.size()); }
+  IR* ir(int idx) const { return env->code().at(idx).get(); }
+};
+
+OptimizerState make_state(FunctionEnv* env) {
+  OptimizerState state;
+  state.env = env;
+  for (auto& ir : env->code()) {
+    state.instrs.push_back(ir->to_rai());
+  }
+  state.vals.resize(env->max_vars(), nullptr);
+  for (auto& val : env->reg_vals()) {
+    int id = val->ireg().id;
+    if (id >= int(state.vals.size())) {
+      state.vals.resize(id + 1, nullptr);
+    }
+    state.vals.at(id) = val.get();
+  }
+  return state;
+}
+
+void find_fixed_vars(OptimizerState& state) {
+  state.untracked.assign(state.vals.size(), false);
+  state.fixed.assign(state.vals.size(), false);
+  for (size_t id = 0; id < state.vals.size(); id++) {
+    auto val = state.vals[id];
+    if (val && (val->rlet_constraint().has_value() || val->forced_on_stack())) {
+      state.untracked[id] = true;
+      state.fixed[id] = true;
+    }
+  }
+  for (auto& constraint : state.env->constraints()) {
+    if (constraint.contrain_everywhere) {
+      state.untracked.at(constraint.ireg.id) = true;
+    }
+    state.fixed.at(constraint.ireg.id) = true;
+  }
+}
+
+/*!
+ * Does the function jump somewhere that the IR doesn't describe? Only inline assembly can do this.
+ */
+bool has_unknown_control_flow(const OptimizerState& state) {
+  for (int idx = 0; idx < state.size(); idx++) {
+    auto ir = state.ir(idx);
+    if (dynamic_cast<IR_JumpReg*>(ir) || dynamic_cast<IR_AsmRet*>(ir)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void replace(OptimizerState& state, int idx, std::unique_ptr<IR> ir) {
+  state.instrs.at(idx) = ir->to_rai();
+  state.env->replace_ir(idx, std::move(ir));
+}
+
+void remove(OptimizerState& state, int idx) {
+  replace(state, idx, std::make_unique<IR_Null>());
+  state.env->remove_constraints_if([&](const IRegConstraint& constraint) {
+    return !constraint.contrain_everywhere && constraint.instr_idx == idx;
+  });
+  state.stats.instructions_removed++;
+}
+
+bool is_null(const OptimizerState& state, int idx) {
+  return dynamic_cast<IR_Null*>(state.ir(idx)) != nullptr;
+}
+
+/*!
+ * The index of the first instruction at or after idx that actually does something. This is where a
+ * jump to idx ends up.
+ */
+int next_real(const OptimizerState& state, int idx) {
+  while (idx < state.size() && is_null(state, idx)) {
+    idx++;
+  }
+  return idx;
+}
+
+std::vector<bool> find_block_starts(const OptimizerState& state) {
+  std::vector<bool> starts(state.size() + 1, false);
+  starts.at(0) = true;
+  for (int idx = 0; idx < state.size(); idx++) {
+    const auto& instr = state.instrs[idx];
+    for (auto dest : instr.jumps) {
+      starts.at(dest) = true;
+    }
+    if (!instr.jumps.empty() || !instr.fallthrough) {
+      starts.at(idx + 1) = true;
+    }
+  }
+  return starts;
+}
+
+bool fits_s32(s64 value) {
+  return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+/*!
+ * Use the immediate form of integer math if an argument is a known constant.
+ */
+void fold_integer_math(OptimizerState& state,
+                       int idx,
+                       IR_IntegerMath* math,
+                       const std::unordered_map<int, s64>& constants) {
+  auto dest = math->dest();
+  auto arg = math->arg();
+  if (!arg || arg == dest) {
+    return;
+  }
+
+  auto lookup = [&](const RegVal* val) -> std::optional<s64> {
+    auto it = constants.find(val->ireg().id);
+    if (it == constants.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  };
+  auto arg_value = lookup(arg);
+  auto dest_value = lookup(dest);
+
+  std::unique_ptr<IR> folded;
+  switch (math->get_kind()) {
+    case IntegerMathKind::ADD_64:
+      if (arg_value && fits_s32(*arg_value)) {
+        folded = std::make_unique<IR_IntegerMath>(IntegerMathKind::ADD_IMM_64, dest, dest,
+                                                  s32(*arg_value));
+      } else if (dest_value && fits_s32(*dest_value)) {
+        // the constant was loaded into dest, then the other value added.
+        folded = std::make_unique<IR_IntegerMath>(IntegerMathKind::ADD_IMM_64, dest, arg,
+                                                  s32(*dest_value));
+      }
+      break;
+    case IntegerMathKind::SUB_64:
+      if (arg_value && *arg_value != INT64_MIN && fits_s32(-*arg_value)) {
+        folded = std::make_unique<IR_IntegerMath>(IntegerMathKind::ADD_IMM_64, dest, dest,
+                                                  s32(-*arg_value));
+      }
+      break;
+    case IntegerMathKind::SHLV_64:
+    case IntegerMathKind::SHRV_64:
+    case IntegerMathKind::SARV_64:
+      if (arg_value && *arg_value >= 0 && *arg_value < 64) {
+        auto kind = math->get_kind() == IntegerMathKind::SHLV_64   ? IntegerMathKind::SHL_64
+                    : math->get_kind() == IntegerMathKind::SHRV_64 ? IntegerMathKind::SHR_64
+                                                                   : IntegerMathKind::SAR_64;
+        folded = std::make_unique<IR_IntegerMath>(kind, dest, u8(*arg_value));
+        // the shift amount no longer needs to be in rcx.
+        int arg_id = arg->ireg().id;
+        state.env->remove_constraints_if([&](const IRegConstraint& constraint) {
+          return !constraint.contrain_everywhere && constraint.instr_idx == idx &&
+                 constraint.ireg.id == arg_id;
+        });
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (folded) {
+    replace(state, idx, std::move(folded));
+    state.stats.constants_folded++;
+  }
+}
+
+/*!
+ * Within each basic block, read the original variable instead of a copy of it, and fold constants
+ * into integer math.
+ */
+void propagate_copies_and_fold_constants(OptimizerState& state) {
+  find_fixed_vars(state);
+  auto starts = find_block_starts(state);
+
+  std::unordered_map<int, s64> constants;
+  std::unordered_map<int, int> copies;  // variable -> the variable it is a copy of
+
+  for (int idx = 0; idx < state.size(); idx++) {
+    if (starts[idx]) {
+      constants.clear();
+      copies.clear();
+    }
+
+    if (!copies.empty()) {
+      bool replaced = false;
+      for (auto& rd : state.instrs[idx].read) {
+        auto it = copies.find(rd.id);
+        if (it != copies.end() &&
+            state.ir(idx)->replace_read(state.vals.at(rd.id), state.vals.at(it->second))) {
+          replaced = true;
+          state.stats.copies_propagated++;
+        }
+      }
+      if (replaced) {
+        state.instrs[idx] = state.ir(idx)->to_rai();
+      }
+    }
+
+    if (auto math = dynamic_cast<IR_IntegerMath*>(state.ir(idx))) {
+      fold_integer_math(state, idx, math, constants);
+    }
+
+    // forget anything about the variables that were just written.
+    for (auto& wr : state.instrs[idx].write) {
+      constants.erase(wr.id);
+      copies.erase(wr.id);
+      for (auto it = copies.begin(); it != copies.end();) {
+        if (it->second == wr.id) {
+          it = copies.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    auto ir = state.ir(idx);
+    if (auto load = dynamic_cast<IR_LoadConstant64*>(ir)) {
+      int dest = load->dest()->ireg().id;
+      if (!state.untracked[dest]) {
+        constants[dest] = load->value();
+      }
+    } else if (auto set = dynamic_cast<IR_RegSet*>(ir)) {
+      int dest = set->dest()->ireg().id;
+      int src = set->src()->ireg().id;
+      if (dest != src && set->dest()->ireg().reg_class == set->src()->ireg().reg_class &&
+          !state.untracked[dest] && !state.untracked[src]) {
+        auto constant = constants.find(src);
+        if (constant != constants.end()) {
+          constants[dest] = constant->second;
+        }
+        if (!state.fixed[dest] && !state.fixed[src]) {
+          copies[dest] = src;
+        }
+      }
+    }
+  }
+}
+
+ConditionKind invert_condition(ConditionKind kind) {
+  switch (kind) {
+    case ConditionKind::EQUAL:
+      return ConditionKind::NOT_EQUAL;
+    case ConditionKind::NOT_EQUAL:
+      return ConditionKind::EQUAL;
+    case ConditionKind::LT:
+      return ConditionKind::GEQ;
+    case ConditionKind::GEQ:
+      return ConditionKind::LT;
+    case ConditionKind::GT:
+      return ConditionKind::LEQ;
+    case ConditionKind::LEQ:
+      return ConditionKind::GT;
+    default:
+      return ConditionKind::INVALID_CONDITION;
+  }
+}
+
+/*!
+ * If a jump goes to an unconditional jump, find where that one goes.
+ */
+const Label* final_destination(const OptimizerState& state, const Label* dest) {
+  // limited, in case of an infinite loop of jumps.
+  for (int hops = 0; hops < 8; hops++) {
+    int target = next_real(state, dest->idx);
+    if (target >= state.size()) {
+      break;
+    }
+    auto next_goto = dynamic_cast<IR_GotoLabel*>(state.ir(target));
+    if (!next_goto || next_real(state, next_goto->dest()->idx) == target) {
+      break;
+    }
+    dest = next_goto->dest();
+  }
+  return dest;
+}
+
+/*!
+ * Thread jumps through unconditional jumps, remove jumps to the next instruction, turn a
+ * conditional jump over an unconditional jump into a single conditional jump, and remove code that
+ * can't be reached.
+ */
+bool simplify_branches(OptimizerState& state) {
+  bool changed = false;
+  std::vector<bool> targeted(state.size() + 1, false);
+  for (auto& instr : state.instrs) {
+    for (auto dest : instr.jumps) {
+      targeted.at(next_real(state, dest)) = true;
+    }
+  }
+
+  auto remove_branch = [&](int idx) {
+    remove(state, idx);
+    if (targeted[idx]) {
+      targeted.at(next_real(state, idx + 1)) = true;
+    }
+    state.stats.branches_simplified++;
+    changed = true;
+  };
+
+  for (int idx = 0; idx < state.size(); idx++) {
+    auto ir = state.ir(idx);
+    if (auto jump = dynamic_cast<IR_GotoLabel*>(ir)) {
+      auto dest = final_destination(state, jump->dest());
+      if (next_real(state, dest->idx) != next_real(state, jump->dest()->idx)) {
+        jump->retarget(dest);
+        state.instrs[idx] = jump->to_rai();
+        targeted.at(next_real(state, dest->idx)) = true;
+        state.stats.branches_simplified++;
+        changed = true;
+      }
+      if (next_real(state, jump->dest()->idx) == next_real(state, idx + 1)) {
+        remove_branch(idx);
+      }
+    } else if (auto branch = dynamic_cast<IR_ConditionalBranch*>(ir)) {
+      auto dest = final_destination(state, &branch->label);
+      if (next_real(state, dest->idx) != next_real(state, branch->label.idx)) {
+        branch->label = *dest;
+        state.instrs[idx] = branch->to_rai();
+        targeted.at(next_real(state, dest->idx)) = true;
+        state.stats.branches_simplified++;
+        changed = true;
+      }
+
+      int next = next_real(state, idx + 1);
+      if (next_real(state, branch->label.idx) == next) {
+        // the comparison doesn't have side effects, so it can go too.
+        remove_branch(idx);
+        continue;
+      }
+
+      // jcc over; jmp somewhere; over: ... becomes j!cc somewhere; over: ...
+      // Floating point comparisons can't be inverted because of NaN.
+      if (branch->condition.is_float || next >= state.size() || targeted[next]) {
+        continue;
+      }
+      auto jump_over = dynamic_cast<IR_GotoLabel*>(state.ir(next));
+      if (jump_over && next_real(state, branch->label.idx) == next_real(state, next + 1)) {
+        branch->condition.kind = invert_condition(branch->condition.kind);
+        branch->label = *jump_over->dest();
+        state.instrs[idx] = branch->to_rai();
+        targeted.at(next_real(state, branch->label.idx)) = true;
+        remove_branch(next);
+      }
+    }
+  }
+
+  // remove code that nothing jumps or falls through to.
+  std::vector<bool> reachable(state.size(), false);
+  std::vector<int> to_visit = {0};
+  while (!to_visit.empty()) {
+    int idx = to_visit.back();
+    to_visit.pop_back();
+    if (idx >= state.size() || reachable[idx]) {
+      continue;
+    }
+    reachable[idx] = true;
+    const auto& instr = state.instrs[idx];
+    for (auto dest : instr.jumps) {
+      to_visit.push_back(dest);
+    }
+    if (instr.fallthrough) {
+      to_visit.push_back(idx + 1);
+    }
+  }
+  for (int idx = 0; idx < state.size(); idx++) {
+    if (!reachable[idx] && !is_null(state, idx)) {
+      remove(state, idx);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+/*!
+ * Remove instructions that only write variables that are never read afterward.
+ */
+bool remove_dead_code(OptimizerState& state) {
+  find_fixed_vars(state);
+
+  // use the register allocator's liveliness analysis to find what is live out of each block.
+  AllocationInput input;
+  input.instructions = state.instrs;
+  input.max_vars = int(state.vals.size());
+  ControlFlowAnalysisCache cfa;
+  find_basic_blocks(&cfa, input);
+  auto& blocks = cfa.basic_blocks;
+  for (auto& block : blocks) {
+    block.analyze_liveliness_phase1(input.instructions);
+  }
+  bool blocks_changed = true;
+  while (blocks_changed) {
+    blocks_changed = false;
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+      if (it->analyze_liveliness_phase2(blocks, input.instructions)) {
+        blocks_changed = true;
+      }
+    }
+  }
+
+  bool removed = false;
+  IRegSet live;
+  for (auto& block : blocks) {
+    live.clear();
+    for (auto succ : block.succ) {
+      live.bitwise_or(blocks.at(succ).input);
+    }
+
+    for (auto it = block.instr_idx.rbegin(); it != block.instr_idx.rend(); ++it) {
+      int idx = *it;
+      const auto& instr = state.instrs[idx];
+      bool dead = !instr.write.empty() && state.ir(idx)->removable_if_unused();
+      for (auto& wr : instr.write) {
+        if (state.fixed[wr.id] || live.contains(wr.id)) {
+          dead = false;
+        }
+      }
+
+      if (dead) {
+        remove(state, idx);
+        removed = true;
+        continue;
+      }
+
+      for (auto& wr : instr.write) {
+        live.erase(wr.id);
+      }
+      for (auto& rd : instr.read) {
+        live.insert(rd.id);
+      }
+    }
+  }
+  return removed;
+}
+}  // namespace
+
+/*!
+ * Optimize the IR of a function. Level 0 does nothing.
+ */
+IROptimizerStats optimize_function_ir(FunctionEnv* env, int level) {
+  if (level <= 0 || env->is_asm_func) {
+    return {};
+  }
+
+  auto state = make_state(env);
+  if (has_unknown_control_flow(state)) {
+    return {};
+  }
+
+  if (level >= 2) {
+    propagate_copies_and_fold_constants(state);
+  }
+
+  // removing code can make more jumps go to the next instruction, and removing jumps can make more
+  // code unreachable or dead. A few rounds gets almost all of it.
+  for (int round = 0; round < 4; round++) {
+    bool changed = simplify_branches(state);
+    if (remove_dead_code(state)) {
+      changed = true;
+    }
+    if (!changed) {
+      break;
+    }
+  }
+
+  return state.stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+/*!
+ * @file IROptimizer.h
+ * Optional optimizations on the IR of a function, run before register allocation.
+ *
+ * Level 1 removes instructions that write variables nobody reads, unreachable code, and jumps that
+ * go to the next instruction or to another jump.
+ * Level 2 also propagates copies and folds constants into immediate operands within a basic block.
+ *
+ * Removed instructions are replaced with IR_Null so the index of every other instruction, which
+ * labels and constraints use, stays the same. Variables with register constraints or on the stack
+ * are left alone.
+ */
+
+class FunctionEnv;
+
+struct IROptimizerStats {
+  int instructions_removed = 0;
+  int copies_propagated = 0;
+  int constants_folded = 0;
+  int branches_simplified = 0;
+
+  IROptimizerStats& operator+=(const IROptimizerStats& other) {
+    instructions_removed += other.instructions_removed;
+    copies_propagated += other.copies_propagated;
+    constants_folded += other.constants_folded;
+    branches_simplified += other.branches_simplified;
+    return *this;
+  }
+};
+
+IROptimizerStats optimize_function_ir(FunctionEnv* env, int level);
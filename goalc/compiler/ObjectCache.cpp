@@ -0,0 +1,322 @@
+#include "ObjectCache.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "common/log/log.h"
+#include "common/util/Assert.h"
+#include "common/util/Hasher.h"
+#include "common/util/compress.h"
+#include "common/util/Serializer.h"
+
+#include "goalc/compiler/Lambda.h"
+#include "goalc/debugger/DebugInfo.h"
+
+#include "third-party/fmt/core.h"
+#include "third-party/json.hpp"
+
+// Increase this when the format of the entries changes, or when a change to the compiler changes
+// the code it generates.
+constexpr int OBJECT_CACHE_VERSION = 5;
+
+namespace {
+thread_local ObjectDependencyRecorder* g_current_dependency_recorder = nullptr;
+
+// hash used for constants, symbols and inline functions that don't exist.
+constexpr u64 UNDEFINED_HASH = 0;
+
+u64 hash_string(const std::string& str) {
+  return XXH64(str.data(), str.size(), 0);
+}
+
+std::string hash_to_string(u64 hash) {
+  return fmt::format("{:016x}", hash);
+}
+
+u64 hash_from_string(const std::string& str) {
+  return std::stoull(str, nullptr, 16);
+}
+
+nlohmann::json hashes_to_json(const std::map<std::string, u64>& hashes) {
+  auto result = nlohmann::json::object();
+  for (const auto& [name, hash] : hashes) {
+    result[name] = hash_to_string(hash);
+  }
+  return result;
+}
+
+std::map<std::string, u64> hashes_from_json(const nlohmann::json& json) {
+  std::map<std::string, u64> result;
+  for (const auto& [name, hash] : json.items()) {
+    result[name] = hash_from_string(hash.get<std::string>());
+  }
+  return result;
+}
+
+nlohmann::json stats_to_json(const emitter::ObjectGeneratorStats& stats) {
+  return {{"moves_eliminated", stats.moves_eliminated},
+          {"moves_kept", stats.moves_kept},
+          {"peephole_removed", stats.peephole_removed},
+          {"peephole_replaced", stats.peephole_replaced},
+          {"peephole_bytes_saved", stats.peephole_bytes_saved}};
+}
+
+emitter::ObjectGeneratorStats stats_from_json(const nlohmann::json& json) {
+  emitter::ObjectGeneratorStats stats;
+  stats.moves_eliminated = json.at("moves_eliminated").get<int>();
+  stats.moves_kept = json.at("moves_kept").get<int>();
+  stats.peephole_removed = json.at("peephole_removed").get<int>();
+  stats.peephole_replaced = json.at("peephole_replaced").get<int>();
+  stats.peephole_bytes_saved = json.at("peephole_bytes_saved").get<int>();
+  return stats;
+}
+
+/*!
+ * Find the first thing that is different between two sets of hashes, for printing.
+ */
+std::optional<std::string> find_difference(const std::string& kind,
+                                           const std::map<std::string, u64>& prev,
+                                           const std::map<std::string, u64>& current) {
+  for (const auto& [name, hash] : current) {
+    auto it = prev.find(name);
+    if (it == prev.end()) {
+      return fmt::format("now uses {} {}", kind, name);
+    }
+    if (it->second != hash) {
+      return fmt::format("{} {} changed", kind, name);
+    }
+  }
+  if (prev.size() != current.size()) {
+    return fmt::format("no longer uses some {}", kind);
+  }
+  return std::nullopt;
+}
+
+/*!
+ * Hash everything about a type that could change the generated code: the type and all of its
+ * parents, with their fields, methods and states.
+ */
+u64 type_fingerprint(const TypeSystem& ts,
+                     const std::string& type_name,
+                     std::unordered_map<std::string, u64>* own_hashes) {
+  Hasher h;
+  if (!ts.fully_defined_type_exists(type_name) && !ts.partially_defined_type_exists(type_name)) {
+    h.add("unknown type");
+    return h.result();
+  }
+
+  for (const auto& name : ts.get_path_up_tree(type_name)) {
+    auto it = own_hashes->find(name);
+    if (it == own_hashes->end()) {
+      Hasher own;
+      own.add(name);
+      if (!ts.fully_defined_type_exists(name)) {
+        own.add("forward declared");
+      } else {
+        auto* type = ts.lookup_type(name);
+        own.add(type->print());
+        own.add(type->print_method_info());
+        // these decide if method calls look up the runtime type.
+        own.add((s64)ts.has_child_types(name));
+        if (auto* as_basic = dynamic_cast<const BasicType*>(type)) {
+          own.add((s64)as_basic->final());
+          own.add((s64)as_basic->no_devirtualize());
+        }
+        for (const auto& [state, state_type] : type->get_states_declared_for_type()) {
+          own.add(state);
+          own.add(state_type.print());
+        }
+        if (auto* as_enum = dynamic_cast<const EnumType*>(type)) {
+          own.add((s64)as_enum->is_bitfield());
+          std::map<std::string, s64> entries(as_enum->entries().begin(),
+                                             as_enum->entries().end());
+          for (const auto& [entry, value] : entries) {
+            own.add(entry);
+            own.add(value);
+          }
+        }
+      }
+      it = own_hashes->emplace(name, own.result()).first;
+    }
+    h.add((s64)it->second);
+  }
+  return h.result();
+}
+}  // namespace
+
+ObjectDependencyRecorder::ObjectDependencyRecorder() : m_prev(g_current_dependency_recorder) {
+  g_current_dependency_recorder = this;
+}
+
+ObjectDependencyRecorder::~ObjectDependencyRecorder() {
+  ASSERT(g_current_dependency_recorder == this);
+  g_current_dependency_recorder = m_prev;
+}
+
+void ObjectDependencyRecorder::record_expansion(const std::string& macro_name,
+                                                const goos::Object* result) {
+  if (g_current_dependency_recorder) {
+    auto& hash = g_current_dependency_recorder->m_deps.expansions[macro_name];
+    if (result) {
+      auto str = result->print();
+      hash = XXH64(str.data(), str.size(), hash);
+    } else {
+      hash = XXH64(nullptr, 0, hash);
+    }
+  }
+}
+
+void ObjectDependencyRecorder::record_constant(const std::string& name,
+                                               const goos::Object* value) {
+  if (g_current_dependency_recorder) {
+    auto& constants = g_current_dependency_recorder->m_deps.constants;
+    if (constants.find(name) == constants.end()) {
+      // only the first use counts, the file may redefine it later.
+      constants[name] = value ? hash_string(value->print()) : UNDEFINED_HASH;
+    }
+  }
+}
+
+void ObjectDependencyRecorder::record_symbol(const std::string& name, const TypeSpec* type) {
+  if (g_current_dependency_recorder) {
+    auto& symbols = g_current_dependency_recorder->m_deps.symbols;
+    if (symbols.find(name) == symbols.end()) {
+      symbols[name] = type ? hash_string(type->print()) : UNDEFINED_HASH;
+    }
+  }
+}
+
+void ObjectDependencyRecorder::record_inline_function(const std::string& name,
+                                                      const InlineableFunction* func) {
+  if (g_current_dependency_recorder) {
+    auto& funcs = g_current_dependency_recorder->m_deps.inline_functions;
+    if (funcs.find(name) == funcs.end()) {
+      u64 result = UNDEFINED_HASH;
+      if (func) {
+        Hasher h;
+        h.add(func->type.print());
+        h.add((s64)func->inline_by_default);
+        for (const auto& param : func->lambda.params) {
+          h.add(param.name);
+          h.add(param.type.print());
+        }
+        h.add(func->lambda.body.print());
+        result = h.result();
+      }
+      funcs[name] = result;
+    }
+  }
+}
+
+ObjectDependencies ObjectDependencyRecorder::finish(const TypeSystem& ts) {
+  // copy the names: hashing looks up more types, which are added to the recorder.
+  std::vector<std::string> type_names(m_types.types().begin(), m_types.types().end());
+  std::sort(type_names.begin(), type_names.end());
+  std::unordered_map<std::string, u64> own_hashes;
+  for (const auto& name : type_names) {
+    m_deps.types[name] = type_fingerprint(ts, name, &own_hashes);
+  }
+  return m_deps;
+}
+
+std::optional<CachedObject> ObjectCache::lookup(const std::string& obj_name,
+                                                u64 key,
+                                                const ObjectDependencies& deps,
+                                                DebugInfo* debug_info) {
+  auto json_path = m_dir / (obj_name + ".json");
+  auto data_path = m_dir / (obj_name + ".o");
+  auto debug_path = m_dir / (obj_name + ".dbg");
+  if (!fs::exists(json_path) || !fs::exists(data_path) || !fs::exists(debug_path)) {
+    m_misses++;
+    return std::nullopt;
+  }
+
+  try {
+    auto json = nlohmann::json::parse(file_util::read_text_file(json_path));
+    if (json.at("version").get<int>() != OBJECT_CACHE_VERSION ||
+        hash_from_string(json.at("key").get<std::string>()) != key) {
+      m_misses++;
+      return std::nullopt;
+    }
+
+    std::optional<std::string> reason;
+    if (hash_from_string(json.at("source").get<std::string>()) != deps.source) {
+      reason = "source changed";
+    }
+    if (!reason) {
+      reason = find_difference("macro", hashes_from_json(json.at("expansions")), deps.expansions);
+    }
+    if (!reason) {
+      reason = find_difference("constant", hashes_from_json(json.at("constants")), deps.constants);
+    }
+    if (!reason) {
+      reason = find_difference("symbol", hashes_from_json(json.at("symbols")), deps.symbols);
+    }
+    if (!reason) {
+      reason = find_difference("inline function", hashes_from_json(json.at("inline_functions")),
+                               deps.inline_functions);
+    }
+    if (!reason) {
+      reason = find_difference("type", hashes_from_json(json.at("types")), deps.types);
+    }
+    if (reason) {
+      lg::debug("Object cache: regenerating {} because {}", obj_name, *reason);
+      m_misses++;
+      return std::nullopt;
+    }
+
+    CachedObject result;
+    result.data = file_util::read_binary_file(data_path);
+    auto debug_data = file_util::read_binary_file(debug_path);
+    if (hash_from_string(json.at("data").get<std::string>()) !=
+            XXH64(result.data.data(), result.data.size(), 0) ||
+        hash_from_string(json.at("debug").get<std::string>()) !=
+            XXH64(debug_data.data(), debug_data.size(), 0)) {
+      lg::warn("Object cache: ignoring modified entry {}", data_path.string());
+      m_misses++;
+      return std::nullopt;
+    }
+    result.stats = stats_from_json(json.at("stats"));
+    auto debug_bytes = compression::decompress_zstd(debug_data.data(), debug_data.size());
+    Serializer ser(debug_bytes.data(), debug_bytes.size(), Serializer::Ownership::BORROW);
+    debug_info->serialize(ser);
+    m_hits++;
+    return result;
+  } catch (const std::exception& e) {
+    lg::warn("Object cache: ignoring bad entry {}: {}", json_path.string(), e.what());
+    m_misses++;
+    return std::nullopt;
+  }
+}
+
+void ObjectCache::store(const std::string& obj_name,
+                        u64 key,
+                        const ObjectDependencies& deps,
+                        const std::vector<u8>& data,
+                        const emitter::ObjectGeneratorStats& stats,
+                        DebugInfo* debug_info) {
+  Serializer ser;
+  debug_info->serialize(ser);
+  auto [debug_bytes, debug_size] = ser.get_save_result();
+  // the debug info is several times larger than the object file, but compresses well.
+  auto debug_data = compression::compress_zstd(debug_bytes, debug_size);
+
+  nlohmann::json json;
+  json["version"] = OBJECT_CACHE_VERSION;
+  json["key"] = hash_to_string(key);
+  json["source"] = hash_to_string(deps.source);
+  json["data"] = hash_to_string(XXH64(data.data(), data.size(), 0));
+  json["debug"] = hash_to_string(XXH64(debug_data.data(), debug_data.size(), 0));
+  json["stats"] = stats_to_json(stats);
+  json["expansions"] = hashes_to_json(deps.expansions);
+  json["constants"] = hashes_to_json(deps.constants);
+  json["symbols"] = hashes_to_json(deps.symbols);
+  json["inline_functions"] = hashes_to_json(deps.inline_functions);
+  json["types"] = hashes_to_json(deps.types);
+
+  // if only the data gets written, the old description's data hash won't match it.
+  file_util::create_dir_if_needed(m_dir);
+  file_util::write_binary_file(m_dir / (obj_name + ".o"), data.data(), data.size());
+  file_util::write_binary_file(m_dir / (obj_name + ".dbg"), debug_data.data(), debug_data.size());
+  file_util::write_text_file(m_dir / (obj_name + ".json"), json.dump());
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+/*!
+ * @file ObjectCache.h
+ * An on-disk cache of the object files generated by the compiler.
+ *
+ * While a file is compiled, the compiler records everything it used that came from outside the
+ * file: the result of each macro expansion, the values of global constants, the types of global
+ * symbols, inlined functions, and every type it looked up. The cached object file is reused if the
+ * source and all of these are the same as last time, so changing a macro or a type only regenerates
+ * the object files that actually used it.
+ *
+ * Files still go through the front end of the compiler, because later files need the types, macros
+ * and constants that they define. Only register allocation and code generation are skipped. The
+ * debug info and code generation stats are cached with the data, so the debugger works the same
+ * either way, and the moves and peephole changes still show up in print-debug-compiler-stats.
+ */
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/goos/Object.h"
+#include "common/type_system/TypeSystem.h"
+#include "common/util/FileUtil.h"
+
+#include "goalc/emitter/ObjectGenerator.h"
+
+class DebugInfo;
+struct InlineableFunction;
+
+/*!
+ * Hashes of the things a single object file used while it was compiled.
+ */
+struct ObjectDependencies {
+  u64 source = 0;
+  std::map<std::string, u64> expansions;  // all expansions of each macro, in order
+  std::map<std::string, u64> constants;
+  std::map<std::string, u64> symbols;  // the type of each global symbol
+  std::map<std::string, u64> inline_functions;
+  std::map<std::string, u64> types;
+};
+
+/*!
+ * While one of these exists, the compiler records the dependencies of the code it compiles on the
+ * current thread. Like TypeLookupRecorder, these can be nested and only the innermost is used.
+ * Things that don't exist are recorded too, so defining them later is noticed.
+ */
+class ObjectDependencyRecorder {
+ public:
+  ObjectDependencyRecorder();
+  ~ObjectDependencyRecorder();
+  ObjectDependencyRecorder(const ObjectDependencyRecorder&) = delete;
+  ObjectDependencyRecorder& operator=(const ObjectDependencyRecorder&) = delete;
+
+  // result is null if the name was looked up as a macro, but isn't one.
+  static void record_expansion(const std::string& macro_name, const goos::Object* result);
+  static void record_constant(const std::string& name, const goos::Object* value);
+  static void record_symbol(const std::string& name, const TypeSpec* type);
+  static void record_inline_function(const std::string& name, const InlineableFunction* func);
+
+  /*!
+   * Get the recorded dependencies, including the types that were looked up. Types are hashed as
+   * they are now, so this should be called after the file is done compiling.
+   */
+  ObjectDependencies finish(const TypeSystem& ts);
+
+ private:
+  ObjectDependencyRecorder* m_prev = nullptr;
+  TypeLookupRecorder m_types;
+  ObjectDependencies m_deps;
+};
+
+/*!
+ * An object file from the cache.
+ */
+struct CachedObject {
+  std::vector<u8> data;
+  emitter::ObjectGeneratorStats stats;
+};
+
+class ObjectCache {
+ public:
+  /*!
+   * Set the folder for cache entries. Each object file has its data and dependencies stored there.
+   */
+  void set_dir(const fs::path& dir) { m_dir = dir; }
+
+  /*!
+   * Get the cached data for an object, if it was compiled with the same key (compiler version and
+   * settings) and dependencies. On a hit, the debug info is replaced with the cached one, which
+   * has no code sources.
+   */
+  std::optional<CachedObject> lookup(const std::string& obj_name,
+                                     u64 key,
+                                     const ObjectDependencies& deps,
+                                     DebugInfo* debug_info);
+  void store(const std::string& obj_name,
+             u64 key,
+             const ObjectDependencies& deps,
+             const std::vector<u8>& data,
+             const emitter::ObjectGeneratorStats& stats,
+             DebugInfo* debug_info);
+
+  int hits() const { return m_hits; }
+  int misses() const { return m_misses; }
+
+ private:
+  fs::path m_dir;
+  int m_hits = 0;
+  int m_misses = 0;
+};
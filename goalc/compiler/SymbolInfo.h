@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "common/goos/Object.h"
+#include "common/goos/ObjectSerializer.h"
 #include "common/util/Assert.h"
 #include "common/util/Trie.h"
 
@@ -147,6 +148,22 @@ class SymbolInfo {
   const Metadata& meta() const { return m_meta; }
   const std::vector<GoalArg>& args() const { return m_args; }
 
+  void serialize(goos::ObjectSerializer& ser) {
+    ser.ser().from_ptr(&m_kind);
+    ser.from_object(&m_def_form);
+    ser.ser().from_str(&m_name);
+    m_method_info.serialize(ser.ser());
+    ser.ser().from_str(&m_meta.docstring);
+    size_t arg_count = m_args.size();
+    ser.ser().from_ptr(&arg_count);
+    m_args.resize(arg_count);
+    for (auto& arg : m_args) {
+      ser.ser().from_str(&arg.name);
+      arg.type.serialize(ser.ser());
+    }
+    ser.ser().from_str(&m_return_type);
+  }
+
  private:
   Kind m_kind = Kind::INVALID;
   goos::Object m_def_form;
@@ -233,6 +250,26 @@ class SymbolInfoMap {
 
   int symbol_count() const { return m_map.size(); }
 
+  /*!
+   * Save or load all symbols. Loaded symbols are added to the ones that are already here.
+   */
+  void serialize(goos::ObjectSerializer& ser) {
+    if (ser.is_saving()) {
+      auto symbols = get_all_symbols();
+      ser.ser().save<size_t>(symbols.size());
+      for (auto& info : symbols) {
+        info.serialize(ser);
+      }
+    } else {
+      auto count = ser.ser().load<size_t>();
+      for (size_t i = 0; i < count; i++) {
+        SymbolInfo info;
+        info.serialize(ser);
+        m_map[info.name()]->push_back(std::move(info));
+      }
+    }
+  }
+
   std::vector<SymbolInfo> get_all_symbols() const {
     std::vector<SymbolInfo> info;
     auto lookup = m_map.get_all_nodes();
@@ -299,7 +299,11 @@ bool Compiler::is_local_symbol(const goos::Object& obj, Env* env) {
   }
 
   // check global constants
-  if (m_global_constants.find(obj.as_symbol()) != m_global_constants.end()) {
+  auto global_constant = m_global_constants.find(obj.as_symbol());
+  ObjectDependencyRecorder::record_constant(
+      obj.as_symbol()->name,
+      global_constant == m_global_constants.end() ? nullptr : &global_constant->second);
+  if (global_constant != m_global_constants.end()) {
     return true;
   }
 
@@ -223,6 +223,7 @@ Val* Compiler::compile_asm_load_sym(const goos::Object& form, const goos::Object
   if (sym_kv == m_symbol_types.end()) {
     throw_compiler_error(form, "Cannot find a symbol named {}.", sym_name);
   }
+  ObjectDependencyRecorder::record_symbol(sym_name, &sym_kv->second);
   auto ts = sym_kv->second;
   bool sext = m_ts.lookup_type(ts)->get_load_signed();
   if (args.has_named("sext")) {
@@ -159,6 +159,8 @@ const std::unordered_map<
         {"load-project", {"", &Compiler::compile_load_project}},
         {"make", {"", &Compiler::compile_make}},
         {"print-debug-compiler-stats", {"", &Compiler::compile_print_debug_compiler_stats}},
+        {"start-compile-profile", {"", &Compiler::compile_start_compile_profile}},
+        {"stop-compile-profile", {"", &Compiler::compile_stop_compile_profile}},
         {"gen-docs", {"", &Compiler::compile_gen_docs}},
         {"gc-text", {"", &Compiler::compile_gc_text}},
 
@@ -316,10 +318,9 @@ Val* Compiler::compile_pair(const goos::Object& code, Env* env) {
     }
 
     // next try as a goal compiler form
-    auto kv_gfs = g_goal_forms.find(head_sym->name);
-    if (kv_gfs != g_goal_forms.end()) {
-      auto& [docstring, func] = kv_gfs->second;
-      return ((*this).*(func))(code, rest, env);
+    auto kv_gfs = m_goal_forms.find(head_sym);
+    if (kv_gfs != m_goal_forms.end() && kv_gfs->second.compile) {
+      return ((*this).*(kv_gfs->second.compile))(code, rest, env);
     }
 
     // next try as an enum
@@ -386,6 +387,7 @@ Val* Compiler::compile_get_symbol_value(const goos::Object& form,
     throw_compiler_error(
         form, "The symbol {} was looked up as a global variable, but it does not exist.", name);
   }
+  ObjectDependencyRecorder::record_symbol(name, &existing_symbol->second);
 
   auto ts = existing_symbol->second;
   auto sext = m_ts.lookup_type_allow_partial_def(ts)->get_load_signed();
@@ -426,6 +428,8 @@ Val* Compiler::compile_symbol(const goos::Object& form, Env* env) {
 
   auto global_constant = m_global_constants.find(form.as_symbol());
   auto existing_symbol = m_symbol_types.find(form.as_symbol()->name);
+  ObjectDependencyRecorder::record_constant(
+      name, global_constant == m_global_constants.end() ? nullptr : &global_constant->second);
 
   // see if it's a constant
   if (global_constant != m_global_constants.end()) {
@@ -3,16 +3,43 @@
  * Compiler implementation for blocks / gotos / labels
  */
 
+#include <optional>
+
 #include "goalc/compiler/Compiler.h"
 #include "goalc/compiler/IR.h"
 
 using namespace goos;
 
+namespace {
+/*!
+ * A short name for a top-level form for the profiler, like (defun vector-dot) or
+ * (defmethod inspect vector): the head and up to two more symbols.
+ */
+std::string top_level_form_name(const Object& form) {
+  if (!form.is_pair()) {
+    return form.print();
+  }
+  std::string result = "(";
+  const Object* it = &form;
+  for (int i = 0; i < 3 && it->is_pair() && it->as_pair()->car.is_symbol(); i++) {
+    if (i > 0) {
+      result.push_back(' ');
+    }
+    result += it->as_pair()->car.as_symbol()->name;
+    it = &it->as_pair()->cdr;
+  }
+  result.push_back(')');
+  return result;
+}
+}  // namespace
+
 /*!
  * Compile "top-level" form, which is equivalent to a begin.
  */
 Val* Compiler::compile_top_level(const goos::Object& form, const goos::Object& rest, Env* env) {
-  return compile_begin(form, rest, env);
+  (void)form;
+  // like begin, but the profiler attributes the time to each form.
+  return compile_forms_in_order(rest, env, m_profiler.enabled());
 }
 
 /*!
@@ -21,8 +48,21 @@ Val* Compiler::compile_top_level(const goos::Object& form, const goos::Object& r
  */
 Val* Compiler::compile_begin(const goos::Object& form, const goos::Object& rest, Env* env) {
   (void)form;
+  return compile_forms_in_order(rest, env, false);
+}
+
+/*!
+ * Compile each form in a list, in order, and return the value of the last one.
+ */
+Val* Compiler::compile_forms_in_order(const goos::Object& forms,
+                                      Env* env,
+                                      bool profile_each_form) {
   Val* result = get_none();
-  for_each_in_list(rest, [&](const Object& o) {
+  for_each_in_list(forms, [&](const Object& o) {
+    std::optional<CompileProfiler::Scope> prof_scope;
+    if (profile_each_form) {
+      prof_scope.emplace(m_profiler, CompileProfiler::Kind::FORM, top_level_form_name(o));
+    }
     result = compile_error_guard(o, env);
     if (!dynamic_cast<None*>(result)) {
       result = result->to_reg(o, env);
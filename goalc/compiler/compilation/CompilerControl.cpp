@@ -3,6 +3,7 @@
  * Compiler implementation for forms which actually control the compiler.
  */
 
+#include <algorithm>
 #include <regex>
 #include <stack>
 
@@ -150,6 +151,8 @@ Val* Compiler::compile_asm_file(const goos::Object& form, const goos::Object& re
         options.no_code = true;
       } else if (setting == ":no-throw") {
         no_throw = true;
+      } else if (setting == ":linear-scan") {
+        options.linear_scan_regalloc = true;
       } else if (setting == ":disassemble") {
         options.disassemble = true;
         last_was_disasm = true;
@@ -627,14 +630,93 @@ Val* Compiler::compile_print_debug_compiler_stats(const goos::Object& form,
 
   lg::print("Spill operations (total): {}\n", m_debug_stats.num_spills);
   lg::print("Spill operations (v1 only): {}\n", m_debug_stats.num_spills_v1);
-  lg::print("Eliminated moves: {}\n", m_debug_stats.num_moves_eliminated);
+  lg::print("Eliminated moves: {} ({} kept)\n", m_debug_stats.num_moves_eliminated,
+            m_debug_stats.num_moves_kept);
+  lg::print("Callee-saved registers pushed: {}\n", m_debug_stats.num_saved_regs);
   lg::print("Total functions: {}\n", m_debug_stats.total_funcs);
   lg::print("Functions requiring v1: {}\n", m_debug_stats.funcs_requiring_v1_allocator);
+  lg::print("Functions where linear scan failed: {}\n", m_debug_stats.funcs_linear_scan_failed);
+  lg::print("Devirtualized method calls: {}\n", m_debug_stats.num_devirtualized_calls);
+  lg::print("Register allocation time (all threads): {:.1f} ms\n",
+            m_debug_stats.regalloc_ns / 1.e6);
+  lg::print("IR optimizer: {} instructions removed, {} copies propagated, {} constants folded, {} "
+            "branches simplified\n",
+            m_debug_stats.ir_opt.instructions_removed, m_debug_stats.ir_opt.copies_propagated,
+            m_debug_stats.ir_opt.constants_folded, m_debug_stats.ir_opt.branches_simplified);
+
+  std::vector<std::pair<std::string, emitter::ObjectGeneratorStats>> peephole_files(
+      m_debug_stats.peephole_by_file.begin(), m_debug_stats.peephole_by_file.end());
+  emitter::ObjectGeneratorStats peephole_total;
+  for (auto& [name, stats] : peephole_files) {
+    peephole_total.peephole_removed += stats.peephole_removed;
+    peephole_total.peephole_replaced += stats.peephole_replaced;
+    peephole_total.peephole_bytes_saved += stats.peephole_bytes_saved;
+  }
+  lg::print("Peephole: {} instructions removed, {} replaced, {} bytes saved\n",
+            peephole_total.peephole_removed, peephole_total.peephole_replaced,
+            peephole_total.peephole_bytes_saved);
+  std::sort(peephole_files.begin(), peephole_files.end(), [](const auto& a, const auto& b) {
+    return a.second.peephole_removed > b.second.peephole_removed;
+  });
+  for (size_t i = 0; i < std::min(peephole_files.size(), size_t(10)); i++) {
+    const auto& [name, stats] = peephole_files[i];
+    if (!stats.peephole_removed) {
+      break;
+    }
+    lg::print("  {}: {} removed, {} replaced\n", name, stats.peephole_removed,
+              stats.peephole_replaced);
+  }
+  lg::print("Object files reused from cache: {} (regenerated {})\n", m_object_cache.hits(),
+            m_object_cache.misses());
   lg::print("Size of autocomplete prefix tree: {}\n", m_symbol_info.symbol_count());
 
   return get_none();
 }
 
+/*!
+ * Start attributing compile time to files, passes, top-level forms, and macros.
+ */
+Val* Compiler::compile_start_compile_profile(const goos::Object& form,
+                                             const goos::Object& rest,
+                                             Env*) {
+  auto args = get_va(form, rest);
+  va_check(form, args, {}, {});
+  m_profiler.start();
+  return get_none();
+}
+
+/*!
+ * Stop profiling, print a summary, and save a Chrome trace (chrome://tracing) to the :file, or to
+ * out/<game>/compile-profile.json.
+ */
+Val* Compiler::compile_stop_compile_profile(const goos::Object& form,
+                                            const goos::Object& rest,
+                                            Env*) {
+  auto args = get_va(form, rest);
+  va_check(form, args, {},
+           {{"file", {false, {goos::ObjectType::STRING}}},
+            {"rows", {false, {goos::ObjectType::INTEGER}}}});
+  if (!m_profiler.enabled()) {
+    throw_compiler_error(form, "The compile profiler isn't running. Use (start-compile-profile).");
+  }
+
+  std::string trace_file;
+  if (args.has_named("file")) {
+    trace_file = args.get_named("file").as_string()->data;
+  } else {
+    trace_file = (file_util::get_jak_project_dir() / "out" / m_make.compiler_output_prefix() /
+                  "compile-profile.json")
+                     .string();
+  }
+  int rows = args.has_named("rows") ? args.get_named("rows").as_int() : 20;
+
+  file_util::create_dir_if_needed_for_file(trace_file);
+  m_profiler.stop(trace_file);
+  lg::print("{}", m_profiler.summary(rows));
+  lg::print("Saved trace to {}\n", trace_file);
+  return get_none();
+}
+
 Val* Compiler::compile_gen_docs(const goos::Object& form, const goos::Object& rest, Env*) {
   auto args = get_va(form, rest);
   va_check(form, args, {goos::ObjectType::STRING}, {});
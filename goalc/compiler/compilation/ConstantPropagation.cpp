@@ -98,6 +98,7 @@ Compiler::ConstPropResult Compiler::const_prop_gscond(const goos::Object& form,
       // check condition:
       goos::Object condition_result = m_goos.eval_with_rewind(
           current_case.as_pair()->car, m_goos.global_environment.as_env_ptr());
+      ObjectDependencyRecorder::record_expansion("#cond", &condition_result);
       if (m_goos.truthy(condition_result)) {
         if (current_case.as_pair()->cdr.is_empty_list()) {
           // would return none, let's just return that this has side effects and let the compiler
@@ -189,6 +190,9 @@ Compiler::ConstPropResult Compiler::constant_propagation_dispatch(const goos::Ob
       // it can either be a global or symbol
       const auto& global_constant = m_global_constants.find(expanded.as_symbol());
       const auto& existing_symbol = m_symbol_types.find(expanded.as_symbol()->name);
+      ObjectDependencyRecorder::record_constant(
+          expanded.as_symbol()->name,
+          global_constant == m_global_constants.end() ? nullptr : &global_constant->second);
 
       // see if it's a constant
       if (global_constant != m_global_constants.end()) {
@@ -225,13 +229,11 @@ Compiler::ConstPropResult Compiler::constant_propagation_dispatch(const goos::Ob
         // all are expanded, so we don't need to do it again.
 
         // first try as a goal compiler form
-        auto kv_gfs = g_const_prop_forms.find(head_sym->name);
-        if (kv_gfs != g_const_prop_forms.end()) {
-          return ((*this).*(kv_gfs->second))(expanded, rest, env);
-        }
-
-        const auto& kv_goal = g_goal_forms.find(head_sym->name);
-        if (kv_goal != g_goal_forms.end()) {
+        auto kv_gfs = m_goal_forms.find(head_sym);
+        if (kv_gfs != m_goal_forms.end()) {
+          if (kv_gfs->second.const_prop) {
+            return ((*this).*(kv_gfs->second.const_prop))(expanded, rest, env);
+          }
           // it's a compiler form that we can't constant propagate.
           return {expanded, true};
         }
@@ -41,6 +41,9 @@ Val* Compiler::compile_inline(const goos::Object& form, const goos::Object& rest
   va_check(form, args, {goos::ObjectType::SYMBOL}, {});
 
   auto kv = m_inlineable_functions.find(args.unnamed.at(0).as_symbol());
+  ObjectDependencyRecorder::record_inline_function(
+      symbol_string(args.unnamed.at(0)),
+      kv == m_inlineable_functions.end() ? nullptr : &kv->second);
   if (kv == m_inlineable_functions.end()) {
     throw_compiler_error(form, "Cannot inline {} because the function's code could not be found.",
                          args.unnamed.at(0).print());
@@ -326,6 +329,8 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
     // we can only auto-inline the function if its name is explicitly given.
     // look it up:
     auto kv = m_inlineable_functions.find(uneval_head.as_symbol());
+    ObjectDependencyRecorder::record_inline_function(
+        symbol_string(uneval_head), kv == m_inlineable_functions.end() ? nullptr : &kv->second);
     if (kv != m_inlineable_functions.end()) {
       // it's inlinable.  However, we do not always inline an inlinable function by default
       if (kv->second.inline_by_default) {  // inline when possible, so we should inline
@@ -344,8 +349,11 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
       if (uneval_head.as_symbol()->name == "inspect" || uneval_head.as_symbol()->name == "print") {
         is_method_call = true;
       } else {
-        if (is_local_symbol(uneval_head, env) ||
-            m_symbol_types.find(symbol_string(uneval_head)) != m_symbol_types.end()) {
+        auto existing_symbol = m_symbol_types.find(symbol_string(uneval_head));
+        ObjectDependencyRecorder::record_symbol(
+            symbol_string(uneval_head),
+            existing_symbol == m_symbol_types.end() ? nullptr : &existing_symbol->second);
+        if (is_local_symbol(uneval_head, env) || existing_symbol != m_symbol_types.end()) {
           // the local environment (mlets, lexicals, constants, globals) defines this symbol.
           // this will "win" over a method name lookup, so we should compile as normal
           head = compile_error_guard(args.unnamed.front(), env);
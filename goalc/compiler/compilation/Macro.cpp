@@ -19,6 +19,9 @@ bool Compiler::try_getting_macro_from_goos(const goos::Object& macro_name, goos:
 
   if (got_macro) {
     *dest = macro_obj;
+  } else if (macro_name.is_symbol()) {
+    // defining a macro with this name would change how the form is compiled.
+    ObjectDependencyRecorder::record_expansion(macro_name.as_symbol()->name, nullptr);
   }
   return got_macro;
 }
@@ -32,12 +35,11 @@ Val* Compiler::compile_goos_macro(const goos::Object& o,
                                   const goos::Object& name,
                                   Env* env) {
   auto macro = macro_obj.as_macro();
-  Arguments args = m_goos.get_args(o, rest, macro->args);
-  auto mac_env_obj = EnvironmentObject::make_new();
-  auto mac_env = mac_env_obj.as_env_ptr();
-  mac_env->parent_env = m_goos.global_environment.as_env_ptr();
-  m_goos.set_args_in_env(o, args, macro->args, mac_env);
-  auto goos_result = m_goos.eval_list_return_last(macro->body, macro->body, mac_env);
+  CompileProfiler::Scope prof_scope(m_profiler, CompileProfiler::Kind::MACRO,
+                                    name.as_symbol()->name);
+  auto goos_result =
+      m_goos.expand_macro(o, macro_obj, rest, m_goos.global_environment.as_env_ptr());
+  ObjectDependencyRecorder::record_expansion(name.as_symbol()->name, &goos_result);
   // make the macro expanded form point to the source where the macro was used for error messages.
   // m_goos.reader.db.inherit_info(o, goos_result);
 
@@ -105,6 +107,7 @@ Val* Compiler::compile_gscond(const goos::Object& form, const goos::Object& rest
       // check condition:
       Object condition_result = m_goos.eval_with_rewind(current_case.as_pair()->car,
                                                         m_goos.global_environment.as_env_ptr());
+      ObjectDependencyRecorder::record_expansion("#cond", &condition_result);
       if (m_goos.truthy(condition_result)) {
         if (current_case.as_pair()->cdr.is_empty_list()) {
           return get_none();
@@ -271,14 +274,9 @@ bool Compiler::expand_macro_once(const goos::Object& src, goos::Object* out, Env
     return false;
   }
 
-  auto macro = macro_obj.as_macro();
-  Arguments args = m_goos.get_args(src, rest, macro->args);
-  auto mac_env_obj = EnvironmentObject::make_new();
-  auto mac_env = mac_env_obj.as_env_ptr();
-  mac_env->parent_env = m_goos.global_environment.as_env_ptr();
-  m_goos.set_args_in_env(src, args, macro->args, mac_env);
-
-  auto goos_result = m_goos.eval_list_return_last(macro->body, macro->body, mac_env);
+  auto goos_result =
+      m_goos.expand_macro(src, macro_obj, rest, m_goos.global_environment.as_env_ptr());
+  ObjectDependencyRecorder::record_expansion(first.as_symbol()->name, &goos_result);
   // make the macro expanded form point to the source where the macro was used for error messages.
   // m_goos.reader.db.inherit_info(src, goos_result);
 
@@ -702,6 +702,8 @@ StaticResult Compiler::compile_static(const goos::Object& form_before_macro, Env
 
     // as a constant
     auto kv = m_global_constants.find(form.as_symbol());
+    ObjectDependencyRecorder::record_constant(
+        name, kv == m_global_constants.end() ? nullptr : &kv->second);
     if (kv != m_global_constants.end()) {
       // expand constant and compile again.
       return compile_static(kv->second, env);
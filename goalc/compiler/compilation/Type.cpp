@@ -92,8 +92,16 @@ RegVal* Compiler::compile_get_method_of_object(const goos::Object& form,
   method_info.type = method_info.type.substitute_for_method_call(compile_time_type.base_type());
   auto fe = env->function_env();
 
+  bool use_virtual = m_ts.should_use_virtual_methods(compile_time_type, method_info.id);
+  if (use_virtual && m_settings.devirtualize_leaf_types &&
+      m_ts.try_assume_leaf_type(compile_time_type.base_type())) {
+    // no child type can override the method, so the runtime type is always the compile time type.
+    use_virtual = false;
+    m_debug_stats.num_devirtualized_calls++;
+  }
+
   RegVal* runtime_type = nullptr;
-  if (m_ts.should_use_virtual_methods(compile_time_type, method_info.id)) {
+  if (use_virtual) {
     runtime_type = fe->make_gpr(m_ts.make_typespec("type"));
     MemLoadInfo info;
     info.size = 4;
@@ -1,7 +1,11 @@
 #include "DebugInfo.h"
 
+#include <algorithm>
+#include <type_traits>
 #include <utility>
 
+#include "common/util/Serializer.h"
+
 #include "third-party/fmt/core.h"
 
 DebugInfo::DebugInfo(std::string obj_name) : m_obj_name(std::move(obj_name)) {}
@@ -16,6 +20,33 @@ std::string FunctionDebugInfo::disassemble_debug_info(bool* had_failure,
   return result;
 }
 
+void FunctionDebugInfo::serialize(Serializer& ser) {
+  ser.from_ptr(&offset_in_seg);
+  ser.from_ptr(&length);
+  ser.from_ptr(&seg);
+  ser.from_str(&name);
+  ser.from_str(&obj_name);
+
+  // InstructionInfo has no default constructor, so this can't use from_pod_vector.
+  static_assert(std::is_trivially_copyable_v<InstructionInfo>);
+  size_t instruction_count = instructions.size();
+  ser.from_ptr(&instruction_count);
+  if (ser.is_loading()) {
+    instructions.clear();
+    instructions.reserve(instruction_count);
+    for (size_t i = 0; i < instruction_count; i++) {
+      instructions.emplace_back(emitter::Instruction(0), InstructionInfo::Kind::IR);
+      ser.from_ptr(&instructions.back());
+    }
+  } else {
+    ser.from_raw_data(instructions.data(), sizeof(InstructionInfo) * instruction_count);
+  }
+
+  ser.from_string_vector(&ir_strings);
+  ser.from_pod_vector(&generated_code);
+  ser.from_ptr(&stack_usage);
+}
+
 std::string DebugInfo::disassemble_all_functions(bool* had_failure, const goos::Reader* reader) {
   std::string result;
   for (auto& kv : m_functions) {
@@ -34,4 +65,28 @@ std::string DebugInfo::disassemble_function_by_name(const std::string& name,
     }
   }
   return result;
-}
\ No newline at end of file
+}
+void DebugInfo::serialize(Serializer& ser) {
+  ser.from_str(&m_obj_name);
+  size_t function_count = m_functions.size();
+  ser.from_ptr(&function_count);
+  if (ser.is_loading()) {
+    m_functions.clear();
+    for (size_t i = 0; i < function_count; i++) {
+      FunctionDebugInfo info;
+      info.serialize(ser);
+      auto name = info.name;
+      m_functions[name] = std::move(info);
+    }
+  } else {
+    // sorted, so the same functions are always saved the same way.
+    std::vector<std::string> names;
+    for (const auto& kv : m_functions) {
+      names.push_back(kv.first);
+    }
+    std::sort(names.begin(), names.end());
+    for (const auto& name : names) {
+      m_functions.at(name).serialize(ser);
+    }
+  }
+}
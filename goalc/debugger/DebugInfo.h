@@ -7,12 +7,14 @@
 #include <vector>
 
 #include "common/common_types.h"
+#include "common/goos/Object.h"
 #include "common/util/Assert.h"
 
 #include "goalc/debugger/disassemble.h"
 #include "goalc/emitter/Instruction.h"
 
 class FunctionEnv;
+class Serializer;
 
 namespace goos {
 class Object;
@@ -33,7 +35,7 @@ struct FunctionDebugInfo {
 
   std::vector<InstructionInfo> instructions;  // contains mapping to IRs
 
-  std::vector<std::shared_ptr<goos::HeapObject>> code_sources;
+  std::vector<goos::HeapPtr<goos::HeapObject>> code_sources;
   std::vector<std::string> ir_strings;
 
   // the actual bytes in the object file.
@@ -41,6 +43,11 @@ struct FunctionDebugInfo {
   std::optional<int> stack_usage;
 
   std::string disassemble_debug_info(bool* had_failure, const goos::Reader* reader);
+
+  /*!
+   * Save or load everything but the code sources, which point to forms in the reader.
+   */
+  void serialize(Serializer& ser);
 };
 
 class DebugInfo {
@@ -71,6 +78,10 @@ class DebugInfo {
   }
 
   FunctionDebugInfo& function_by_name(const std::string& name) { return m_functions.at(name); }
+  bool has_function(const std::string& name) const {
+    return m_functions.find(name) != m_functions.end();
+  }
+  size_t function_count() const { return m_functions.size(); }
 
   void clear() { m_functions.clear(); }
 
@@ -79,6 +90,8 @@ class DebugInfo {
                                            bool* had_failure,
                                            const goos::Reader* reader);
 
+  void serialize(Serializer& ser);
+
  private:
   std::string m_obj_name;
   std::unordered_map<std::string, FunctionDebugInfo> m_functions;
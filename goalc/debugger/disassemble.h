@@ -14,6 +14,8 @@ namespace goos {
 class Reader;
 class Object;
 class HeapObject;
+template <typename T>
+class HeapPtr;
 }  // namespace goos
 
 struct InstructionInfo {
@@ -39,7 +41,7 @@ std::string disassemble_x86_function(
     u64 base_addr,
     u64 highlight_addr,
     const std::vector<InstructionInfo>& x86_instructions,
-    const std::vector<std::shared_ptr<goos::HeapObject>>& code_sources,
+    const std::vector<goos::HeapPtr<goos::HeapObject>>& code_sources,
     const std::vector<std::string>& ir_strings,
     bool* had_failure,
     bool print_whole_function);
\ No newline at end of file
@@ -11,12 +11,21 @@
  *
  * Step 1 can be done with the add_.... and link_... functions
  * Steps 2 - 5 are done in generate_data_vX()
+ *
+ * Before step 2, a peephole pass can remove or shorten instructions in functions that allow it.
+ * Removed instructions are replaced with null instructions, which have no bytes, so instruction
+ * indices used by links and debug info stay valid.
  */
 
 #include "ObjectGenerator.h"
 
+#include <algorithm>
+
+#include "IGen.h"
+
 #include "common/goal_constants.h"
 #include "common/type_system/TypeSystem.h"
+#include "common/util/ThreadPool.h"
 #include "common/versions.h"
 
 #include "goalc/debugger/DebugInfo.h"
@@ -33,6 +42,29 @@ ObjectGenerator::ObjectGenerator(GameVersion version) : m_version(version) {}
 ObjectFileData ObjectGenerator::generate_data_v3(const TypeSystem* ts) {
   ObjectFileData out;
 
+  // clean up the instructions before anything depends on their size.
+  run_peephole();
+
+  // encode the instructions of each function. Functions don't depend on each other, so this is
+  // done in parallel, before they are laid out in order.
+  std::vector<FunctionData*> all_functions;
+  for (auto& seg_functions : m_function_data_by_seg) {
+    for (auto& function : seg_functions) {
+      all_functions.push_back(&function);
+    }
+  }
+  parallel_for("encode", all_functions.size(), [&](int i) {
+    auto& function = *all_functions[i];
+    function.encoded.reserve(function.instructions.size() * 4);
+    for (const auto& instr : function.instructions) {
+      u8 temp[128];
+      auto count = instr.emit(temp);
+      ASSERT(count < 128);
+      function.instruction_offsets.push_back(function.encoded.size());
+      function.encoded.insert(function.encoded.end(), temp, temp + count);
+    }
+  });
+
   // do functions (step 2, part 1)
   for (int seg = N_SEG; seg-- > 0;) {
     auto& data = m_data_by_seg.at(seg);
@@ -56,19 +88,13 @@ ObjectFileData ObjectGenerator::generate_data_v3(const TypeSystem* ts) {
       function.debug->seg = seg;
 
       // insert instructions!
-
+      auto function_start = data.size();
       for (size_t instr_idx = 0; instr_idx < function.instructions.size(); instr_idx++) {
-        const auto& instr = function.instructions[instr_idx];
-        u8 temp[128];
-        auto count = instr.emit(temp);
-        ASSERT(count < 128);
-        function.instruction_to_byte_in_data.push_back(data.size());
-        function.debug->instructions.at(instr_idx).offset =
-            data.size() - function.debug->offset_in_seg;
-        for (int i = 0; i < count; i++) {
-          insert_data<u8>(seg, temp[i]);
-        }
+        auto offset = function.instruction_offsets[instr_idx];
+        function.instruction_to_byte_in_data.push_back(function_start + offset);
+        function.debug->instructions.at(instr_idx).offset = offset;
       }
+      data.insert(data.end(), function.encoded.begin(), function.encoded.end());
 
       function.debug->length = m_data_by_seg.at(seg).size() - function.debug->offset_in_seg;
     }
@@ -629,6 +655,408 @@ std::vector<u8> ObjectGenerator::generate_header_v3() {
   return result;
 }
 
+namespace {
+bool is_null(const Instruction& instr) {
+  return instr.m_flags & Instruction::kIsNull;
+}
+
+bool same_encoding(const Instruction& a, const Instruction& b) {
+  u8 a_bytes[128];
+  u8 b_bytes[128];
+  auto a_count = a.emit(a_bytes);
+  auto b_count = b.emit(b_bytes);
+  return a_count == b_count && !memcmp(a_bytes, b_bytes, a_count);
+}
+
+/*!
+ * Find the register reg where make_instr(reg) encodes to the same bytes as instr. There is no
+ * decoder for Instructions, so this is how we recognize instructions generated by IGen.
+ */
+template <typename F>
+bool find_register(const Instruction& instr, int first_reg, F&& make_instr, Register* reg) {
+  for (int i = first_reg; i < first_reg + 16; i++) {
+    if (same_encoding(instr, make_instr(Register(i)))) {
+      *reg = Register(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_move_to_self(const Instruction& instr) {
+  // register to register, with the same register in both fields.
+  if (!(instr.m_flags & Instruction::kSetModrm) || (instr.m_modrm >> 6) != 3 ||
+      ((instr.m_modrm >> 3) & 7) != (instr.m_modrm & 7)) {
+    return false;
+  }
+  Register reg;
+  return find_register(
+             instr, RAX, [](Register r) { return IGen::mov_gpr64_gpr64(r, r); }, &reg) ||
+         find_register(
+             instr, XMM0, [](Register r) { return IGen::mov_xmm32_xmm32(r, r); }, &reg) ||
+         find_register(
+             instr, XMM0, [](Register r) { return IGen::mov_vf_vf(r, r); }, &reg);
+}
+
+enum class StackSlotKind { NONE, GPR64, XMM32, XMM128 };
+
+/*!
+ * A 64-bit gpr, 32-bit xmm or 128-bit xmm load or store to rsp + offset, as used for spills.
+ */
+struct StackAccess {
+  StackSlotKind kind = StackSlotKind::NONE;
+  Register reg;
+  s64 offset = 0;
+};
+
+StackAccess match_stack_access(const Instruction& instr, bool store) {
+  StackAccess result;
+  // rsp as a base needs a sib byte with no index.
+  if (!(instr.m_flags & Instruction::kSetSib) || instr.m_sib != 0x24) {
+    return result;
+  }
+  // some of the IGen loads and stores put an 8-bit displacement in the immediate field.
+  int disp_size = instr.get_disp_size();
+  u64 disp_value = instr.disp.value;
+  if (disp_size == 0 && instr.get_imm_size() != 0) {
+    disp_size = instr.get_imm_size();
+    disp_value = instr.imm.value;
+  }
+  switch (disp_size) {
+    case 0:
+      result.offset = 0;
+      break;
+    case 1:
+      result.offset = s8(disp_value);
+      break;
+    case 4:
+      result.offset = s32(disp_value);
+      break;
+    default:
+      return result;
+  }
+
+  auto offset = result.offset;
+  if (disp_size == 4 &&
+      find_register(
+          instr, RAX,
+          [&](Register r) {
+            return store ? IGen::store64_gpr64_plus_s32(RSP, offset, r)
+                         : IGen::load64_gpr64_plus_s32(r, offset, RSP);
+          },
+          &result.reg)) {
+    result.kind = StackSlotKind::GPR64;
+  } else if (disp_size != 0 &&
+             find_register(
+                 instr, XMM0,
+                 [&](Register r) {
+                   return store ? IGen::store_reg_offset_xmm32(RSP, r, offset)
+                                : IGen::load_reg_offset_xmm32(r, RSP, offset);
+                 },
+                 &result.reg)) {
+    result.kind = StackSlotKind::XMM32;
+  } else if (find_register(
+                 instr, XMM0,
+                 [&](Register r) {
+                   return store ? IGen::store128_xmm128_reg_offset(RSP, r, offset)
+                                : IGen::load128_xmm128_reg_offset(r, RSP, offset);
+                 },
+                 &result.reg)) {
+    result.kind = StackSlotKind::XMM128;
+  }
+  return result;
+}
+
+Instruction move_for_stack_slot(StackSlotKind kind, Register dst, Register src) {
+  switch (kind) {
+    case StackSlotKind::GPR64:
+      return IGen::mov_gpr64_gpr64(dst, src);
+    case StackSlotKind::XMM32:
+      return IGen::mov_xmm32_xmm32(dst, src);
+    case StackSlotKind::XMM128:
+      return IGen::mov_vf_vf(dst, src);
+    default:
+      ASSERT(false);
+      return IGen::null();
+  }
+}
+
+/*!
+ * A load of a symbol's value from the symbol table, as generated by IR_GetSymbolValue.
+ */
+bool match_symbol_load(const Instruction& instr, bool sext, Register* dst) {
+  if (instr.get_disp_size() != 4) {
+    return false;
+  }
+  s32 offset = instr.disp.value;
+  return find_register(
+      instr, RAX,
+      [&](Register r) {
+        auto st = gRegInfo.get_st_reg();
+        auto off = gRegInfo.get_offset_reg();
+        return sext ? IGen::load32s_gpr64_gpr64_plus_gpr64_plus_s32(r, st, off, offset)
+                    : IGen::load32u_gpr64_gpr64_plus_gpr64_plus_s32(r, st, off, offset);
+      },
+      dst);
+}
+
+bool is_jmp_32(const Instruction& instr) {
+  return !is_null(instr) && instr.op == 0xe9 && instr.get_imm_size() == 4;
+}
+
+bool is_jcc_32(const Instruction& instr) {
+  return !is_null(instr) && instr.op == 0x0f && (instr.m_flags & Instruction::kOp2Set) &&
+         (instr.op2 & 0xf0) == 0x80 && instr.get_imm_size() == 4;
+}
+}  // namespace
+
+/*!
+ * A function's instructions, with what the peephole pass needs to know about their links.
+ */
+struct ObjectGenerator::PeepholeFunction {
+  FunctionData* data = nullptr;
+  std::vector<JumpLink*> jumps;             // link of each jump instruction
+  std::vector<const std::string*> symbols;  // symbol of each instruction with a symbol mem link
+  std::vector<bool> pinned;                 // has a link that can't be updated, never change it
+  std::vector<bool> jump_target;            // may be reached by a jump
+  std::vector<bool> unlinked;               // its jump or symbol link should be dropped
+  ObjectGeneratorStats stats;
+
+  int size() const { return int(data->instructions.size()); }
+
+  /*!
+   * Index of the first non-null instruction at or after idx.
+   */
+  int real_at_or_after(int idx) const {
+    while (idx < size() && is_null(data->instructions.at(idx))) {
+      idx++;
+    }
+    return idx;
+  }
+
+  /*!
+   * Index of the instruction that actually runs when jumping with the given link.
+   */
+  int jump_destination(const JumpLink& link) const {
+    return real_at_or_after(data->ir_to_instruction.at(link.dest.ir_id));
+  }
+
+  /*!
+   * Is instruction b only reached by falling through from instruction a?
+   */
+  bool only_falls_through(int a, int b) const {
+    for (int i = a + 1; i <= b; i++) {
+      if (jump_target.at(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void set(int idx, const Instruction& instr) {
+    stats.peephole_bytes_saved += data->instructions.at(idx).length() - instr.length();
+    data->instructions.at(idx) = instr;
+    data->debug->instructions.at(idx).instruction = instr;
+  }
+
+  void remove(int idx) {
+    set(idx, IGen::null());
+    unlinked.at(idx) = true;
+    stats.peephole_removed++;
+  }
+
+  void replace(int idx, const Instruction& instr) {
+    set(idx, instr);
+    unlinked.at(idx) = true;
+    stats.peephole_replaced++;
+  }
+
+  /*!
+   * Try the patterns that start at instruction idx. Returns true if anything changed.
+   */
+  bool simplify(int idx) {
+    const auto& instr = data->instructions.at(idx);
+    if (is_null(instr) || pinned.at(idx)) {
+      return false;
+    }
+
+    // mov x, x
+    if (is_move_to_self(instr)) {
+      remove(idx);
+      return true;
+    }
+
+    int next = real_at_or_after(idx + 1);
+
+    // a jump to the instruction that would run next anyway.
+    if (jumps.at(idx) && jump_destination(*jumps.at(idx)) == next) {
+      remove(idx);
+      return true;
+    }
+
+    if (next >= size() || pinned.at(next) || !only_falls_through(idx, next)) {
+      return false;
+    }
+    const auto& next_instr = data->instructions.at(next);
+
+    // jcc a; jmp b; a: -> jncc b; a:
+    if (jumps.at(idx) && jumps.at(next) && is_jcc_32(instr) && is_jmp_32(next_instr) &&
+        jump_destination(*jumps.at(idx)) == real_at_or_after(next + 1)) {
+      auto inverted = instr;
+      inverted.op2 ^= 1;
+      set(idx, inverted);
+      jumps.at(idx)->dest = jumps.at(next)->dest;
+      remove(next);
+      return true;
+    }
+
+    // mov [rsp + x], a; mov b, [rsp + x] -> mov [rsp + x], a; mov b, a
+    auto store = match_stack_access(instr, true);
+    if (store.kind != StackSlotKind::NONE) {
+      auto load = match_stack_access(next_instr, false);
+      if (load.kind == store.kind && load.offset == store.offset) {
+        if (load.reg == store.reg) {
+          remove(next);
+        } else {
+          replace(next, move_for_stack_slot(load.kind, load.reg, store.reg));
+        }
+        return true;
+      }
+    }
+
+    // loading the same symbol twice in a row: mov the first result instead.
+    if (symbols.at(idx) && symbols.at(next) && *symbols.at(idx) == *symbols.at(next)) {
+      for (bool sext : {false, true}) {
+        Register first, second;
+        if (match_symbol_load(instr, sext, &first) &&
+            match_symbol_load(next_instr, sext, &second)) {
+          if (first == second) {
+            remove(next);
+          } else {
+            replace(next, IGen::mov_gpr64_gpr64(second, first));
+          }
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  void run() {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int i = 0; i < size(); i++) {
+        changed |= simplify(i);
+      }
+    }
+  }
+};
+
+/*!
+ * Remove instructions that do nothing and shorten loads of values that are already in a register,
+ * in functions that allow it. Only looks at instructions next to each other, ignoring nulls.
+ * Links to removed or replaced instructions are dropped.
+ */
+void ObjectGenerator::run_peephole() {
+  seg_vector<PeepholeFunction> functions;
+  std::vector<PeepholeFunction*> all_functions;
+  for (int seg = 0; seg < N_SEG; seg++) {
+    functions.at(seg).resize(m_function_data_by_seg.at(seg).size());
+    for (size_t i = 0; i < functions.at(seg).size(); i++) {
+      auto& data = m_function_data_by_seg.at(seg).at(i);
+      if (!data.allow_peephole) {
+        continue;
+      }
+      auto& f = functions.at(seg).at(i);
+      auto n = data.instructions.size();
+      f.data = &data;
+      f.jumps.resize(n, nullptr);
+      f.symbols.resize(n, nullptr);
+      f.pinned.resize(n, false);
+      f.jump_target.resize(n + 1, false);
+      f.unlinked.resize(n, false);
+      all_functions.push_back(&f);
+    }
+  }
+
+  if (all_functions.empty()) {
+    return;
+  }
+
+  for (int seg = 0; seg < N_SEG; seg++) {
+    auto& seg_functions = functions.at(seg);
+    for (auto& link : m_jump_temp_links_by_seg.at(seg)) {
+      auto& f = seg_functions.at(link.jump_instr.func_id);
+      if (f.data) {
+        f.jumps.at(link.jump_instr.instr_id) = &link;
+        f.jump_target.at(f.data->ir_to_instruction.at(link.dest.ir_id)) = true;
+      }
+    }
+    for (auto& [name, links] : m_symbol_instr_temp_links_by_seg.at(seg)) {
+      for (auto& link : links) {
+        auto& f = seg_functions.at(link.rec.func_id);
+        if (f.data) {
+          if (link.is_mem_access) {
+            f.symbols.at(link.rec.instr_id) = &name;
+          } else {
+            f.pinned.at(link.rec.instr_id) = true;
+          }
+        }
+      }
+    }
+    for (auto& link : m_rip_func_temp_links_by_seg.at(seg)) {
+      auto& f = seg_functions.at(link.instr.func_id);
+      if (f.data) {
+        f.pinned.at(link.instr.instr_id) = true;
+      }
+    }
+    for (auto& link : m_rip_data_temp_links_by_seg.at(seg)) {
+      auto& f = seg_functions.at(link.instr.func_id);
+      if (f.data) {
+        f.pinned.at(link.instr.instr_id) = true;
+      }
+    }
+  }
+
+  parallel_for("peephole", all_functions.size(), [&](int i) { all_functions[i]->run(); });
+
+  for (int seg = 0; seg < N_SEG; seg++) {
+    auto& seg_functions = functions.at(seg);
+    auto& jump_links = m_jump_temp_links_by_seg.at(seg);
+    jump_links.erase(std::remove_if(jump_links.begin(), jump_links.end(),
+                                    [&](const JumpLink& link) {
+                                      auto& f = seg_functions.at(link.jump_instr.func_id);
+                                      return f.data && f.unlinked.at(link.jump_instr.instr_id);
+                                    }),
+                     jump_links.end());
+    for (auto& sym_links : m_symbol_instr_temp_links_by_seg.at(seg)) {
+      auto& links = sym_links.second;
+      links.erase(std::remove_if(links.begin(), links.end(),
+                                 [&](const SymbolInstrLink& link) {
+                                   auto& f = seg_functions.at(link.rec.func_id);
+                                   return f.data && f.unlinked.at(link.rec.instr_id);
+                                 }),
+                  links.end());
+    }
+  }
+
+  for (auto* f : all_functions) {
+    m_stats.peephole_removed += f->stats.peephole_removed;
+    m_stats.peephole_replaced += f->stats.peephole_replaced;
+    m_stats.peephole_bytes_saved += f->stats.peephole_bytes_saved;
+  }
+}
+
+/*!
+ * Let the peephole pass change the instructions of this function. It shouldn't be used on functions
+ * where the programmer picked the instructions.
+ */
+void ObjectGenerator::allow_peephole(const FunctionRecord& func) {
+  m_function_data_by_seg.at(func.seg).at(func.func_id).allow_peephole = true;
+}
+
 ObjectGeneratorStats ObjectGenerator::get_stats() const {
   return m_stats;
 }
@@ -636,4 +1064,8 @@ ObjectGeneratorStats ObjectGenerator::get_stats() const {
 void ObjectGenerator::count_eliminated_move() {
   m_stats.moves_eliminated++;
 }
+
+void ObjectGenerator::count_kept_move() {
+  m_stats.moves_kept++;
+}
 }  // namespace emitter
\ No newline at end of file
@@ -59,6 +59,11 @@ struct StaticRecord {
 
 struct ObjectGeneratorStats {
   int moves_eliminated = 0;
+  int moves_kept = 0;  // register to register moves between registers of the same kind
+  // from the peephole pass: instructions removed, loads replaced with register moves
+  int peephole_removed = 0;
+  int peephole_replaced = 0;
+  int peephole_bytes_saved = 0;
 };
 
 class ObjectGenerator {
@@ -94,8 +99,10 @@ class ObjectGenerator {
                                int offset);
   void link_instruction_to_function(const InstructionRecord& instr,
                                     const FunctionRecord& target_func);
+  void allow_peephole(const FunctionRecord& func);
   ObjectGeneratorStats get_stats() const;
   void count_eliminated_move();
+  void count_kept_move();
 
   GameVersion version() const { return m_version; }
 
@@ -115,6 +122,9 @@ class ObjectGenerator {
   void emit_link_ptr(int seg);
   std::vector<u8> generate_header_v3();
 
+  struct PeepholeFunction;
+  void run_peephole();
+
   template <typename T>
   u64 insert_data(int seg, const T& x) {
     auto& data = m_data_by_seg.at(seg);
@@ -136,8 +146,11 @@ class ObjectGenerator {
     std::vector<Instruction> instructions;
     std::vector<int> ir_to_instruction;
     std::vector<int> instruction_to_byte_in_data;
+    std::vector<u8> encoded;               // the instructions, encoded
+    std::vector<int> instruction_offsets;  // offset of each instruction in encoded
     int min_align = 16;
     FunctionDebugInfo* debug = nullptr;
+    bool allow_peephole = false;
   };
 
   struct StaticData {
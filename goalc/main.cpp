@@ -32,7 +32,9 @@ int main(int argc, char** argv) {
   std::string username = "#f";
   std::string game = "jak1";
   int nrepl_port = 8181;
+  int make_jobs = 0;
   fs::path project_path_override;
+  fs::path snapshot_file;
 
   // TODO - a lot of these flags could be deprecated and moved into `repl-config.json`
   // TODO - auto-find the user if there is only one folder within `user/`
@@ -46,6 +48,11 @@ int main(int argc, char** argv) {
   app.add_option("-g,--game", game, "The game name: 'jak1' or 'jak2'");
   app.add_option("--proj-path", project_path_override,
                  "Specify the location of the 'data/' folder");
+  app.add_option("-j,--jobs", make_jobs,
+                 "Maximum number of build steps run at once by make. Defaults to one per core");
+  app.add_option("--snapshot", snapshot_file,
+                 "Load the compiler's startup state from this file. If it is missing or out of "
+                 "date, the GOAL library is compiled and the file is saved");
   app.validate_positionals();
   CLI11_PARSE(app, argc, argv);
 
@@ -88,7 +95,8 @@ int main(int argc, char** argv) {
   // if a command is provided on the command line, no REPL just run the compiler on it
   try {
     if (!cmd.empty()) {
-      compiler = std::make_unique<Compiler>(game_version);
+      compiler = std::make_unique<Compiler>(game_version, "#f", nullptr, snapshot_file);
+      compiler->make_system().set_jobs(make_jobs);
       compiler->run_front_end_on_string(cmd);
       return 0;
     }
@@ -116,7 +124,8 @@ int main(int argc, char** argv) {
   try {
     compiler = std::make_unique<Compiler>(
         game_version, username,
-        std::make_unique<REPL::Wrapper>(username, repl_config, startup_file));
+        std::make_unique<REPL::Wrapper>(username, repl_config, startup_file), snapshot_file);
+    compiler->make_system().set_jobs(make_jobs);
     // Start nREPL Server if it spun up successfully
     if (repl_server_ok) {
       nrepl_thread = std::thread([&]() {
@@ -144,7 +153,8 @@ int main(int argc, char** argv) {
         }
         compiler = std::make_unique<Compiler>(
             game_version, username,
-            std::make_unique<REPL::Wrapper>(username, repl_config, startup_file));
+            std::make_unique<REPL::Wrapper>(username, repl_config, startup_file), snapshot_file);
+        compiler->make_system().set_jobs(make_jobs);
         status = ReplStatus::OK;
       }
       // process user input
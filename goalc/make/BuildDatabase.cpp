@@ -0,0 +1,284 @@
+#include "BuildDatabase.h"
+
+#include <chrono>
+
+#include "common/log/log.h"
+
+#include "third-party/fmt/core.h"
+#include "third-party/json.hpp"
+#include "third-party/zstd/lib/common/xxhash.h"
+
+// Increase this when the meaning of the entries changes.
+constexpr int BUILD_DATABASE_VERSION = 1;
+
+namespace {
+// hash used for all directories, which are sometimes used as a dummy input.
+constexpr u64 DIRECTORY_HASH = 1;
+
+std::string hash_to_string(u64 hash) {
+  return fmt::format("{:016x}", hash);
+}
+
+u64 hash_from_string(const std::string& str) {
+  return std::stoull(str, nullptr, 16);
+}
+
+nlohmann::json hashes_to_json(const std::map<std::string, u64>& hashes) {
+  auto result = nlohmann::json::object();
+  for (const auto& [file, hash] : hashes) {
+    result[file] = hash_to_string(hash);
+  }
+  return result;
+}
+
+std::map<std::string, u64> hashes_from_json(const nlohmann::json& json) {
+  std::map<std::string, u64> result;
+  for (const auto& [file, hash] : json.items()) {
+    result[file] = hash_from_string(hash.get<std::string>());
+  }
+  return result;
+}
+
+// used instead of the modification time for files that should be hashed again next time.
+constexpr s64 UNTRUSTED_MTIME = -1;
+
+/*!
+ * Get the modification time of a file, if it is old enough to use to skip hashing. Timestamps may
+ * only have a resolution of a second, so a file written very recently could be written again
+ * without changing its timestamp.
+ */
+s64 trusted_mtime(const fs::path& path) {
+  auto mtime = fs::last_write_time(path);
+  if (mtime + std::chrono::seconds(2) > fs::file_time_type::clock::now()) {
+    return UNTRUSTED_MTIME;
+  }
+  return mtime.time_since_epoch().count();
+}
+}  // namespace
+
+void BuildDatabase::load(const fs::path& path) {
+  if (path == m_path) {
+    return;
+  }
+  m_path = path;
+  m_dirty = false;
+  m_files.clear();
+  m_steps.clear();
+  m_run_hashes.clear();
+
+  if (!fs::exists(path)) {
+    return;
+  }
+
+  try {
+    auto json = nlohmann::json::parse(file_util::read_text_file(path));
+    if (json.at("version").get<int>() != BUILD_DATABASE_VERSION) {
+      return;
+    }
+
+    for (const auto& [file, state] : json.at("files").items()) {
+      auto& entry = m_files[file];
+      entry.mtime = state.at(0).get<s64>();
+      entry.size = state.at(1).get<u64>();
+      entry.hash = hash_from_string(state.at(2).get<std::string>());
+    }
+
+    for (const auto& [key, step] : json.at("steps").items()) {
+      auto& entry = m_steps[key];
+      entry.arg_hash = hash_from_string(step.at("args").get<std::string>());
+      entry.inputs = hashes_from_json(step.at("inputs"));
+      entry.outputs = hashes_from_json(step.at("outputs"));
+    }
+  } catch (std::exception& e) {
+    lg::warn("Ignoring invalid build database {}: {}", path.string(), e.what());
+    m_files.clear();
+    m_steps.clear();
+  }
+}
+
+void BuildDatabase::begin_run() {
+  m_run_hashes.clear();
+}
+
+void BuildDatabase::save() {
+  if (!m_dirty || m_path.empty()) {
+    return;
+  }
+
+  // files checked during this make were already dropped if they were missing.
+  for (auto it = m_files.begin(); it != m_files.end();) {
+    if (m_run_hashes.find(it->first) == m_run_hashes.end() &&
+        !fs::exists(file_util::get_file_path({it->first}))) {
+      it = m_files.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  nlohmann::json json;
+  json["version"] = BUILD_DATABASE_VERSION;
+
+  auto files = nlohmann::json::object();
+  for (const auto& [file, state] : m_files) {
+    files[file] = {state.mtime, state.size, hash_to_string(state.hash)};
+  }
+  json["files"] = files;
+
+  auto steps = nlohmann::json::object();
+  for (const auto& [key, step] : m_steps) {
+    nlohmann::json entry;
+    entry["args"] = hash_to_string(step.arg_hash);
+    entry["inputs"] = hashes_to_json(step.inputs);
+    entry["outputs"] = hashes_to_json(step.outputs);
+    steps[key] = entry;
+  }
+  json["steps"] = steps;
+
+  file_util::create_dir_if_needed_for_file(m_path);
+  file_util::write_text_file(m_path, json.dump());
+  m_dirty = false;
+}
+
+u64 BuildDatabase::file_hash(const std::string& file) {
+  auto run_it = m_run_hashes.find(file);
+  if (run_it != m_run_hashes.end()) {
+    return run_it->second;
+  }
+  u64 hash = hash_file_now(file);
+  m_run_hashes[file] = hash;
+  return hash;
+}
+
+/*!
+ * Check a file on disk, and hash it if it looks different from the last time it was hashed.
+ */
+u64 BuildDatabase::hash_file_now(const std::string& file) {
+  auto path = fs::path(file_util::get_file_path({file}));
+  std::error_code ec;
+  auto status = fs::status(path, ec);
+  if (ec || !fs::exists(status)) {
+    if (m_files.erase(file)) {
+      m_dirty = true;
+    }
+    return MISSING_FILE;
+  }
+  if (fs::is_directory(status)) {
+    return DIRECTORY_HASH;
+  }
+
+  // only read the file if it looks different from the last time we hashed it.
+  s64 mtime = trusted_mtime(path);
+  u64 size = fs::file_size(path);
+  auto& state = m_files[file];
+  if (state.hash != MISSING_FILE && mtime != UNTRUSTED_MTIME && state.mtime == mtime &&
+      state.size == size) {
+    return state.hash;
+  }
+
+  auto data = file_util::read_binary_file(path);
+  u64 hash = XXH64(data.data(), data.size(), 0);
+  if (hash == MISSING_FILE || hash == DIRECTORY_HASH) {
+    hash += 2;
+  }
+  state.mtime = mtime;
+  state.size = size;
+  state.hash = hash;
+  m_dirty = true;
+  return hash;
+}
+
+BuildDatabase::StepRecord BuildDatabase::snapshot(const std::vector<std::string>& inputs,
+                                                  u64 arg_hash) {
+  StepRecord result;
+  result.arg_hash = arg_hash;
+  for (const auto& in : inputs) {
+    result.inputs[in] = file_hash(in);
+  }
+  return result;
+}
+
+/*!
+ * The old make system's check: all outputs exist, and are newer than all inputs. Used for steps
+ * that were built before there was a database.
+ */
+bool BuildDatabase::outputs_newer_than_inputs(const StepRecord& current,
+                                              const std::vector<std::string>& outputs) const {
+  fs::file_time_type newest_input = fs::file_time_type::min();
+  for (const auto& [in, hash] : current.inputs) {
+    if (hash == MISSING_FILE) {
+      return false;
+    }
+    if (hash != DIRECTORY_HASH) {
+      newest_input = std::max(newest_input, fs::last_write_time(file_util::get_file_path({in})));
+    }
+  }
+
+  for (const auto& out : outputs) {
+    auto out_path = fs::path(file_util::get_file_path({out}));
+    if (!fs::exists(out_path) || fs::last_write_time(out_path) < newest_input) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<std::string> BuildDatabase::stale_reason(const std::string& key,
+                                                       const StepRecord& current,
+                                                       const std::vector<std::string>& outputs) {
+  const auto& it = m_steps.find(key);
+  if (it == m_steps.end()) {
+    if (outputs_newer_than_inputs(current, outputs)) {
+      // built before the database existed, trust the timestamps once.
+      commit(key, StepRecord(current), outputs);
+      return std::nullopt;
+    }
+    return "never built";
+  }
+
+  const auto& prev = it->second;
+  if (prev.arg_hash != current.arg_hash) {
+    return "step definition changed";
+  }
+
+  for (const auto& [in, hash] : current.inputs) {
+    if (hash == MISSING_FILE) {
+      return fmt::format("{} is missing", in);
+    }
+    const auto& prev_it = prev.inputs.find(in);
+    if (prev_it == prev.inputs.end()) {
+      return fmt::format("new dependency {}", in);
+    }
+    if (prev_it->second != hash) {
+      return fmt::format("{} changed", in);
+    }
+  }
+  if (prev.inputs.size() != current.inputs.size()) {
+    return "dependency removed";
+  }
+
+  for (const auto& out : outputs) {
+    auto hash = file_hash(out);
+    if (hash == MISSING_FILE) {
+      return fmt::format("{} is missing", out);
+    }
+    const auto& prev_it = prev.outputs.find(out);
+    if (prev_it == prev.outputs.end() || prev_it->second != hash) {
+      return fmt::format("{} was modified", out);
+    }
+  }
+
+  return std::nullopt;
+}
+
+void BuildDatabase::commit(const std::string& key,
+                           StepRecord&& record,
+                           const std::vector<std::string>& outputs) {
+  record.outputs.clear();
+  for (const auto& out : outputs) {
+    // the step just wrote this file.
+    m_run_hashes.erase(out);
+    record.outputs[out] = file_hash(out);
+  }
+  m_steps[key] = std::move(record);
+  m_dirty = true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/*!
+ * @file BuildDatabase.h
+ * Remembers the content of the files used by each make step the last time it ran.
+ *
+ * A step is up to date if the hashes of its input files and its arguments are the same as when it
+ * last ran, and its outputs haven't been changed or deleted since then. Touching a file or
+ * switching branches back and forth doesn't cause a rebuild.
+ *
+ * Hashing every file on every make would be slow, so the database also stores the modification
+ * time and size of each file it has hashed. A file is only read again if one of these changes.
+ * Within one make, each file is only checked once, unless a step that outputs it runs.
+ */
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/util/FileUtil.h"
+
+class BuildDatabase {
+ public:
+  /*!
+   * The hashes of the files used by a step.
+   */
+  struct StepRecord {
+    u64 arg_hash = 0;
+    std::map<std::string, u64> inputs;
+    std::map<std::string, u64> outputs;
+  };
+
+  // hash used for files that don't exist.
+  static constexpr u64 MISSING_FILE = 0;
+
+  /*!
+   * Load the database from a file. If the path is the same as the currently loaded database, does
+   * nothing. A missing or out of date database file is treated as empty.
+   */
+  void load(const fs::path& path);
+
+  /*!
+   * Start a new make. Files are checked again the next time they are hashed.
+   */
+  void begin_run();
+
+  /*!
+   * Write the database to the file it was loaded from, if anything has changed. Files that no
+   * longer exist are dropped.
+   */
+  void save();
+
+  /*!
+   * Get the hash of a file, or MISSING_FILE if it doesn't exist. Directories all have the same
+   * hash.
+   */
+  u64 file_hash(const std::string& file);
+
+  /*!
+   * Hash the inputs of a step as they are right now.
+   */
+  StepRecord snapshot(const std::vector<std::string>& inputs, u64 arg_hash);
+
+  /*!
+   * Check if a step needs to run, given the current state of its inputs. Returns the reason it
+   * needs to run, or nullopt if it is up to date.
+   */
+  std::optional<std::string> stale_reason(const std::string& key,
+                                          const StepRecord& current,
+                                          const std::vector<std::string>& outputs);
+
+  /*!
+   * Remember that the step ran with these inputs. The outputs are hashed again now.
+   */
+  void commit(const std::string& key,
+              StepRecord&& record,
+              const std::vector<std::string>& outputs);
+
+ private:
+  struct FileState {
+    s64 mtime = 0;
+    u64 size = 0;
+    u64 hash = MISSING_FILE;
+  };
+
+  u64 hash_file_now(const std::string& file);
+  bool outputs_newer_than_inputs(const StepRecord& current,
+                                 const std::vector<std::string>& outputs) const;
+
+  fs::path m_path;
+  bool m_dirty = false;
+  std::unordered_map<std::string, FileState> m_files;
+  // hashes of the files checked during this make.
+  std::unordered_map<std::string, u64> m_run_hashes;
+  std::unordered_map<std::string, StepRecord> m_steps;
+};
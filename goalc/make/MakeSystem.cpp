@@ -1,8 +1,14 @@
 #include "MakeSystem.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
 #include "common/goos/ParseHelpers.h"
 #include "common/log/log.h"
 #include "common/util/FileUtil.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/Timer.h"
 #include "common/util/string_util.h"
 
@@ -10,6 +16,7 @@
 
 #include "third-party/fmt/color.h"
 #include "third-party/fmt/core.h"
+#include "third-party/zstd/lib/common/xxhash.h"
 
 std::string MakeStep::print() const {
   std::string result = fmt::format("Tool {} with inputs", tool);
@@ -40,44 +47,44 @@ std::string MakeStep::print() const {
 
 MakeSystem::MakeSystem(const std::string& username) : m_goos(username) {
   m_goos.register_form("defstep", [=](const goos::Object& obj, goos::Arguments& args,
-                                      const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                      const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_defstep(obj, args, env);
   });
 
   m_goos.register_form("basename", [=](const goos::Object& obj, goos::Arguments& args,
-                                       const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                       const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_basename(obj, args, env);
   });
 
   m_goos.register_form("stem", [=](const goos::Object& obj, goos::Arguments& args,
-                                   const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                   const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_stem(obj, args, env);
   });
 
   m_goos.register_form("get-gsrc-path", [=](const goos::Object& obj, goos::Arguments& args,
-                                            const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                            const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_get_gsrc_path(obj, args, env);
   });
 
   m_goos.register_form("map-path!", [=](const goos::Object& obj, goos::Arguments& args,
-                                        const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                        const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_map_path(obj, args, env);
   });
 
   m_goos.register_form("set-output-prefix",
                        [=](const goos::Object& obj, goos::Arguments& args,
-                           const std::shared_ptr<goos::EnvironmentObject>& env) {
+                           const goos::HeapPtr<goos::EnvironmentObject>& env) {
                          return handle_set_output_prefix(obj, args, env);
                        });
 
   m_goos.register_form("set-gsrc-folder!",
                        [=](const goos::Object& obj, goos::Arguments& args,
-                           const std::shared_ptr<goos::EnvironmentObject>& env) {
+                           const goos::HeapPtr<goos::EnvironmentObject>& env) {
                          return handle_set_gsrc_folder(obj, args, env);
                        });
 
   m_goos.register_form("get-gsrc-folder", [=](const goos::Object& obj, goos::Arguments& args,
-                                              const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                              const goos::HeapPtr<goos::EnvironmentObject>& env) {
     return handle_get_gsrc_folder(obj, args, env);
   });
 
@@ -104,6 +111,7 @@ void MakeSystem::load_project_file(const std::string& file_path) {
   timer.start(false);
   // clear the previous project
   clear_project();
+  m_project_file = file_path;
   // read the file
   auto data = m_goos.reader.read_from_file({file_path});
   // interpret it, which will call various handlers.
@@ -114,7 +122,7 @@ void MakeSystem::load_project_file(const std::string& file_path) {
 
 goos::Object MakeSystem::handle_defstep(const goos::Object& form,
                                         goos::Arguments& args,
-                                        const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                        const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {},
            {{"out", {true, {goos::ObjectType::PAIR}}},
@@ -177,6 +185,7 @@ goos::Object MakeSystem::handle_defstep(const goos::Object& form,
  */
 void MakeSystem::clear_project() {
   m_output_to_step.clear();
+  m_project_file.clear();
 }
 
 void MakeSystem::va_check(
@@ -193,7 +202,7 @@ void MakeSystem::va_check(
 
 goos::Object MakeSystem::handle_basename(const goos::Object& form,
                                          goos::Arguments& args,
-                                         const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                         const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {goos::ObjectType::STRING}, {});
   fs::path input(args.unnamed.at(0).as_string()->data);
@@ -203,7 +212,7 @@ goos::Object MakeSystem::handle_basename(const goos::Object& form,
 
 goos::Object MakeSystem::handle_stem(const goos::Object& form,
                                      goos::Arguments& args,
-                                     const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                     const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {goos::ObjectType::STRING}, {});
   fs::path input(args.unnamed.at(0).as_string()->data);
@@ -213,7 +222,7 @@ goos::Object MakeSystem::handle_stem(const goos::Object& form,
 
 goos::Object MakeSystem::handle_get_gsrc_path(const goos::Object& form,
                                               goos::Arguments& args,
-                                              const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                              const goos::HeapPtr<goos::EnvironmentObject>& env) {
   if (m_gsrc_folder.empty()) {
     throw std::runtime_error("`set-gsrc-folder!` was not called before a `get-gsrc-path`");
   }
@@ -231,7 +240,7 @@ goos::Object MakeSystem::handle_get_gsrc_path(const goos::Object& form,
 
 goos::Object MakeSystem::handle_map_path(const goos::Object& form,
                                          goos::Arguments& args,
-                                         const std::shared_ptr<goos::EnvironmentObject>& env) {
+                                         const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {goos::ObjectType::STRING, goos::ObjectType::STRING}, {});
   auto old_path = args.unnamed.at(0).as_string()->data;
@@ -246,7 +255,7 @@ goos::Object MakeSystem::handle_map_path(const goos::Object& form,
 goos::Object MakeSystem::handle_set_output_prefix(
     const goos::Object& form,
     goos::Arguments& args,
-    const std::shared_ptr<goos::EnvironmentObject>& env) {
+    const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {goos::ObjectType::STRING}, {});
   m_path_map.output_prefix = args.unnamed.at(0).as_string()->data;
@@ -256,7 +265,7 @@ goos::Object MakeSystem::handle_set_output_prefix(
 goos::Object MakeSystem::handle_set_gsrc_folder(
     const goos::Object& form,
     goos::Arguments& args,
-    const std::shared_ptr<goos::EnvironmentObject>& env) {
+    const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {goos::ObjectType::STRING}, {});
 
@@ -282,7 +291,7 @@ goos::Object MakeSystem::handle_set_gsrc_folder(
 goos::Object MakeSystem::handle_get_gsrc_folder(
     const goos::Object& form,
     goos::Arguments& args,
-    const std::shared_ptr<goos::EnvironmentObject>& env) {
+    const goos::HeapPtr<goos::EnvironmentObject>& env) {
   m_goos.eval_args(&args, env);
   va_check(form, args, {}, {});
 
@@ -350,54 +359,105 @@ void MakeSystem::add_tool(std::shared_ptr<Tool> tool) {
   m_tools[name] = tool;
 }
 
-std::vector<std::string> MakeSystem::filter_dependencies(const std::vector<std::string>& all_deps) {
+namespace {
+/*!
+ * Hash the parts of a step's definition that aren't files, so changing them rebuilds the step.
+ */
+u64 step_arg_hash(const MakeStep& rule) {
+  std::string data = rule.tool;
+  data.push_back('\0');
+  data += rule.arg.print();
+  for (auto& out : rule.outputs) {
+    data.push_back('\0');
+    data += out;
+  }
+  return XXH64(data.data(), data.size(), 0);
+}
+}  // namespace
+
+/*!
+ * Hash all the input files of a step, as they are right now.
+ */
+BuildDatabase::StepRecord MakeSystem::snapshot_step(MakeStep& rule, Tool& tool) {
+  for (auto& in : rule.input) {
+    if (!fs::exists(file_util::get_file_path({in}))) {
+      throw std::runtime_error(fmt::format("Input file {} does not exist.", in));
+    }
+  }
+  const ToolInput task = {rule.input, rule.deps, rule.outputs, rule.arg};
+  return m_db.snapshot(tool.get_input_files(task, m_path_map), step_arg_hash(rule));
+}
+
+std::vector<std::string> MakeSystem::filter_dependencies(const std::vector<std::string>& all_deps,
+                                                         bool verbose) {
   Timer timer;
   timer.start(false);
   std::vector<std::string> result;
-  std::unordered_set<std::string> stale_deps;
+  std::unordered_set<std::string> stale_outputs;
 
-  std::unordered_set<std::string> compiler_sym_needed;
+  // reasons for rebuilding. Those caused by another target being rebuilt are only printed in
+  // verbose mode.
+  std::vector<std::pair<std::string, std::string>> reasons;
+  int transitive_count = 0;
 
   for (auto& to_make : all_deps) {
     auto& rule = m_output_to_step.at(to_make);
     auto& tool = m_tools.at(rule->tool);
     const ToolInput task = {rule->input, rule->deps, rule->outputs, rule->arg};
 
-    bool added = false;
-
-    if (tool->needs_run(task, m_path_map)) {
-      result.push_back(to_make);
-      stale_deps.insert(to_make);
-      added = true;
+    auto reason = tool->forced_run_reason(task, m_path_map);
+    if (!reason) {
+      reason = m_db.stale_reason(rule->outputs.at(0), snapshot_step(*rule, *tool), rule->outputs);
     }
 
-    if (!added) {
+    bool transitive = false;
+    if (!reason) {
       // check transitive dependencies
-      for (auto& dep : rule->deps) {
-        if (stale_deps.find(dep) != stale_deps.end()) {
-          result.push_back(to_make);
-          stale_deps.insert(to_make);
-          added = true;
+      auto additional_deps = tool->get_additional_dependencies(task, m_path_map);
+      for (auto* dep_list : {&rule->deps, &additional_deps}) {
+        for (auto& dep : *dep_list) {
+          if (stale_outputs.find(dep) != stale_outputs.end()) {
+            reason = fmt::format("{} will be rebuilt", dep);
+            transitive = true;
+            break;
+          }
+        }
+        if (reason) {
           break;
         }
       }
     }
 
-    if (!added) {
-      // check transitive dependencies
-      for (auto& dep : tool->get_additional_dependencies(task, m_path_map)) {
-        if (stale_deps.find(dep) != stale_deps.end()) {
-          result.push_back(to_make);
-          stale_deps.insert(to_make);
-          added = true;
-          break;
-        }
+    if (reason) {
+      result.push_back(to_make);
+      stale_outputs.insert(rule->outputs.begin(), rule->outputs.end());
+      if (transitive) {
+        transitive_count++;
+      }
+      if (verbose || !transitive) {
+        reasons.emplace_back(to_make, *reason);
       }
     }
   }
 
   lg::print("Found that {} of {} targets do need rebuilding in {:.3f}s\n", result.size(),
             all_deps.size(), timer.getSeconds());
+
+  constexpr size_t kMaxReasons = 10;
+  for (size_t i = 0; i < reasons.size(); i++) {
+    if (!verbose && i == kMaxReasons) {
+      lg::print("  ... and {} more\n", reasons.size() - kMaxReasons);
+      break;
+    }
+    lg::print("  {}: {}\n", reasons[i].first, reasons[i].second);
+  }
+  if (!verbose && transitive_count > 0) {
+    lg::print("  {} targets depend on these\n", transitive_count);
+  }
+
+  // save hashes of files that were touched but not changed, and targets that were built before
+  // there was a database.
+  m_db.save();
   return result;
 }
 
@@ -419,15 +479,44 @@ void print_input(const std::vector<std::string>& in, char end) {
 }
 }  // namespace
 
+int MakeSystem::jobs() const {
+  if (m_jobs > 0) {
+    return m_jobs;
+  }
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+namespace {
+struct StepNode {
+  MakeStep* rule = nullptr;
+  Tool* tool = nullptr;
+  int waiting_on = 0;          // number of unfinished steps this step depends on
+  std::vector<int> dependents;  // steps that depend on this step
+};
+
+struct FinishedStep {
+  int idx = 0;
+  bool success = false;
+  double seconds = 0;
+};
+}  // namespace
+
+/*!
+ * Build a target. Stale steps are run as soon as all the steps they depend on are done. Steps with
+ * a thread safe tool run on a pool of jobs() - 1 threads, and all other steps (GOAL compilation)
+ * run on the calling thread. With one job, steps run one at a time in dependency order.
+ */
 bool MakeSystem::make(const std::string& target_in, bool force, bool verbose) {
   std::string target = m_path_map.apply_remaps(target_in);
+  m_db.load(file_util::get_file_path({"out", m_path_map.output_prefix + "obj", "build-db.json"}));
+  m_db.begin_run();
   auto deps = get_dependencies(target);
   //  lg::print("All deps:\n");
   //  for (auto& dep : deps) {
   //    lg::print("{}\n", dep);
   //  }
   if (!force) {
-    deps = filter_dependencies(deps);
+    deps = filter_dependencies(deps, verbose);
   }
 
   //  lg::print("Filt deps:\n");
@@ -435,54 +524,227 @@ bool MakeSystem::make(const std::string& target_in, bool force, bool verbose) {
   //    lg::print("{}\n", dep);
   //  }
 
+  // build the graph of stale steps. Steps that are up to date are not in deps, and don't need to
+  // be waited on.
+  std::vector<StepNode> nodes(deps.size());
+  std::unordered_map<std::string, int> output_to_node;
+  for (size_t i = 0; i < deps.size(); i++) {
+    auto& node = nodes[i];
+    node.rule = m_output_to_step.at(deps[i]).get();
+    node.tool = m_tools.at(node.rule->tool).get();
+    for (auto& out : node.rule->outputs) {
+      output_to_node[out] = i;
+    }
+  }
+
+  for (size_t i = 0; i < deps.size(); i++) {
+    auto& node = nodes[i];
+    auto* rule = node.rule;
+    auto additional_deps = node.tool->get_additional_dependencies(
+        {rule->input, rule->deps, rule->outputs, rule->arg}, m_path_map);
+    std::vector<int> preds;
+    for (auto* dep_list : {&rule->deps, &additional_deps}) {
+      for (auto& dep : *dep_list) {
+        auto it = output_to_node.find(dep);
+        if (it != output_to_node.end()) {
+          preds.push_back(it->second);
+        }
+      }
+    }
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+    for (auto pred : preds) {
+      nodes[pred].dependents.push_back(i);
+      node.waiting_on++;
+    }
+  }
+
+  const int job_count = std::min(jobs(), std::max(1, (int)deps.size()));
+  const bool parallel = job_count > 1;
+  std::unique_ptr<ThreadPool> pool;
+  if (parallel) {
+    pool = std::make_unique<ThreadPool>(job_count - 1);
+  }
+  ThreadPool::TaskGroup group(pool.get());
+
   Timer make_timer;
   make_timer.start(false);
-  lg::print("Building {} targets...\n", deps.size());
-  int i = 0;
-  for (auto& to_make : deps) {
+  if (parallel) {
+    lg::print("Building {} targets with {} jobs...\n", deps.size(), job_count);
+  } else {
+    lg::print("Building {} targets...\n", deps.size());
+  }
+
+  auto run_step = [&](int idx) {
+    const auto& node = nodes[idx];
+    auto* rule = node.rule;
+    FinishedStep result;
+    result.idx = idx;
     Timer step_timer;
     step_timer.start(false);
-    auto& rule = m_output_to_step.at(to_make);
-    auto& tool = m_tools.at(rule->tool);
-    int percent = (100.0 * (1 + (i++)) / (deps.size())) + 0.5;
+    try {
+      result.success = node.tool->run({rule->input, rule->deps, rule->outputs, rule->arg},
+                                      m_path_map);
+    } catch (std::exception& e) {
+      lg::print("\n");
+      lg::print("Error: {}\n", e.what());
+    }
+    result.seconds = step_timer.getSeconds();
+    return result;
+  };
+
+  // percentages are based on the number of finished steps, so they only go up when steps finish
+  // out of order.
+  int done = 0;
+  auto percent_done = [&]() { return (int)((100.0 * (1 + done) / (deps.size())) + 0.5); };
+
+  auto print_start = [&](int idx) {
+    const auto& rule = *nodes[idx].rule;
+    const auto& tool = *nodes[idx].tool;
     if (verbose) {
-      lg::print("[{:3d}%] [{:8s}] {}{}\n", percent, tool->name(), rule->input.at(0),
-                rule->input.size() > 1 ? ", ..." : "");
+      lg::print("[{:3d}%] [{:8s}] {}{}\n", percent_done(), tool.name(), rule.input.at(0),
+                rule.input.size() > 1 ? ", ..." : "");
+    } else if (!parallel) {
+      // the line is overwritten when the step is done. Other steps finishing would mix this up,
+      // so it's only done in serial builds.
+      lg::print("[{:3d}%] [{:8s}]       ", percent_done(), tool.name());
+      print_input(rule.input, '\r');
+    }
+  };
+
+  auto print_done = [&](const FinishedStep& result) {
+    const auto& rule = *nodes[result.idx].rule;
+    const auto& tool = *nodes[result.idx].tool;
+    int percent = percent_done();
+    if (verbose && !parallel) {
+      if (result.seconds > 0.05) {
+        lg::print(fg(fmt::color::yellow), " {:.3f}\n", result.seconds);
+      } else {
+        lg::print(" {:.3f}\n", result.seconds);
+      }
     } else {
-      lg::print("[{:3d}%] [{:8s}]       ", percent, tool->name());
-      print_input(rule->input, '\r');
+      if (result.seconds > 0.05) {
+        lg::print("[{:3d}%] [{:8s}] ", percent, tool.name());
+        lg::print(fg(fmt::color::yellow), "{:.3f} ", result.seconds);
+        print_input(rule.input, '\n');
+      } else {
+        lg::print("[{:3d}%] [{:8s}] {:.3f} ", percent, tool.name(), result.seconds);
+        print_input(rule.input, '\n');
+      }
     }
+  };
 
-    bool success = false;
+  // steps that can run, lowest index first, so a serial build runs in dependency order.
+  std::set<int> ready;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].waiting_on == 0) {
+      ready.insert(i);
+    }
+  }
+
+  std::mutex finished_mutex;
+  std::condition_variable finished_cv;
+  std::vector<FinishedStep> finished;  // steps done on the pool, not yet handled here
+  int in_flight = 0;                   // steps running on the pool
+  bool failed = false;
+
+  // hashes of the inputs of each step, taken right before it runs. These are saved to the build
+  // database if the step succeeds.
+  std::vector<BuildDatabase::StepRecord> snapshots(nodes.size());
+  auto take_snapshot = [&](int idx) {
     try {
-      success = tool->run({rule->input, rule->deps, rule->outputs, rule->arg}, m_path_map);
+      snapshots[idx] = snapshot_step(*nodes[idx].rule, *nodes[idx].tool);
+      return true;
     } catch (std::exception& e) {
-      lg::print("\n");
       lg::print("Error: {}\n", e.what());
-    }
-    if (!success) {
-      lg::print("Build failed on {}{}\n", rule->input.at(0), rule->input.size() > 1 ? ", ..." : "");
-      throw std::runtime_error("Build failed.");
+      failed = true;
       return false;
     }
+  };
+
+  auto handle_finished = [&](const FinishedStep& result) {
+    auto& rule = *nodes[result.idx].rule;
+    if (!result.success) {
+      lg::print("Build failed on {}{}\n", rule.input.at(0), rule.input.size() > 1 ? ", ..." : "");
+      failed = true;
+      return;
+    }
+    m_db.commit(rule.outputs.at(0), std::move(snapshots[result.idx]), rule.outputs);
+    print_done(result);
+    done++;
+    for (auto dependent : nodes[result.idx].dependents) {
+      if (--nodes[dependent].waiting_on == 0) {
+        ready.insert(dependent);
+      }
+    }
+  };
 
-    if (verbose) {
-      if (step_timer.getSeconds() > 0.05) {
-        lg::print(fg(fmt::color::yellow), " {:.3f}\n", step_timer.getSeconds());
-      } else {
-        lg::print(" {:.3f}\n", step_timer.getSeconds());
+  while (true) {
+    std::vector<FinishedStep> newly_finished;
+    {
+      std::lock_guard<std::mutex> lk(finished_mutex);
+      std::swap(newly_finished, finished);
+    }
+    for (auto& result : newly_finished) {
+      in_flight--;
+      handle_finished(result);
+    }
+
+    if (failed || done == (int)deps.size()) {
+      if (in_flight == 0) {
+        break;
       }
     } else {
-      if (step_timer.getSeconds() > 0.05) {
-        lg::print("[{:3d}%] [{:8s}] ", percent, tool->name());
-        lg::print(fg(fmt::color::yellow), "{:.3f} ", step_timer.getSeconds());
-        print_input(rule->input, '\n');
-      } else {
-        lg::print("[{:3d}%] [{:8s}] {:.3f} ", percent, tool->name(), step_timer.getSeconds());
-        print_input(rule->input, '\n');
+      // hand out as many thread safe steps as we can, and pick one step for this thread.
+      int local_step = -1;
+      for (auto it = ready.begin(); it != ready.end() && !failed;) {
+        int idx = *it;
+        if (parallel && nodes[idx].tool->thread_safe()) {
+          if (in_flight < pool->num_threads()) {
+            it = ready.erase(it);
+            if (!take_snapshot(idx)) {
+              break;
+            }
+            in_flight++;
+            print_start(idx);
+            group.run(nodes[idx].rule->outputs.at(0), [&, idx]() {
+              auto result = run_step(idx);
+              std::lock_guard<std::mutex> lk(finished_mutex);
+              finished.push_back(result);
+              finished_cv.notify_one();
+            });
+            continue;
+          }
+        } else if (local_step == -1) {
+          local_step = idx;
+          it = ready.erase(it);
+          continue;
+        }
+        ++it;
+      }
+
+      if (local_step != -1 && !failed && take_snapshot(local_step)) {
+        print_start(local_step);
+        handle_finished(run_step(local_step));
+      }
+      if (local_step != -1 || failed) {
+        continue;
       }
     }
+
+    // nothing to do here, wait for the pool.
+    ASSERT(in_flight > 0);
+    std::unique_lock<std::mutex> lk(finished_mutex);
+    finished_cv.wait(lk, [&]() { return !finished.empty(); });
   }
+  group.wait();
+  m_db.save();
+
+  if (failed) {
+    throw std::runtime_error("Build failed.");
+    return false;
+  }
+
   lg::print("\nSuccessfully built all {} targets in {:.3f}s\n", deps.size(),
             make_timer.getSeconds());
   return true;
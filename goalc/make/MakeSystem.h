@@ -2,6 +2,7 @@
 
 #include "common/goos/Interpreter.h"
 
+#include "goalc/make/BuildDatabase.h"
 #include "goalc/make/Tool.h"
 
 struct MakeStep {
@@ -20,41 +21,48 @@ class MakeSystem {
 
   goos::Object handle_defstep(const goos::Object& obj,
                               goos::Arguments& args,
-                              const std::shared_ptr<goos::EnvironmentObject>& env);
+                              const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_basename(const goos::Object& obj,
                                goos::Arguments& args,
-                               const std::shared_ptr<goos::EnvironmentObject>& env);
+                               const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_stem(const goos::Object& obj,
                            goos::Arguments&,
-                           const std::shared_ptr<goos::EnvironmentObject>& env);
+                           const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_get_gsrc_path(const goos::Object& obj,
                                     goos::Arguments&,
-                                    const std::shared_ptr<goos::EnvironmentObject>& env);
+                                    const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_map_path(const goos::Object& obj,
                                goos::Arguments& args,
-                               const std::shared_ptr<goos::EnvironmentObject>& env);
+                               const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_set_output_prefix(const goos::Object& obj,
                                         goos::Arguments& args,
-                                        const std::shared_ptr<goos::EnvironmentObject>& env);
+                                        const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_set_gsrc_folder(const goos::Object& obj,
                                       goos::Arguments& args,
-                                      const std::shared_ptr<goos::EnvironmentObject>& env);
+                                      const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   goos::Object handle_get_gsrc_folder(const goos::Object& obj,
                                       goos::Arguments& args,
-                                      const std::shared_ptr<goos::EnvironmentObject>& env);
+                                      const goos::HeapPtr<goos::EnvironmentObject>& env);
 
   std::vector<std::string> get_dependencies(const std::string& target) const;
-  std::vector<std::string> filter_dependencies(const std::vector<std::string>& all_deps);
+  std::vector<std::string> filter_dependencies(const std::vector<std::string>& all_deps,
+                                               bool verbose = false);
 
   bool make(const std::string& target, bool force, bool verbose);
 
+  /*!
+   * Set the maximum number of steps that make will run at the same time. 0 uses one per core.
+   */
+  void set_jobs(int jobs) { m_jobs = jobs; }
+  int jobs() const;
+
   void add_tool(std::shared_ptr<Tool> tool);
   void set_constant(const std::string& name, const std::string& value);
   void set_constant(const std::string& name, bool value);
@@ -71,6 +79,11 @@ class MakeSystem {
    */
   const std::string& compiler_output_prefix() const { return m_path_map.output_prefix; }
 
+  /*!
+   * Get the project file that was loaded most recently, or an empty string if there isn't one.
+   */
+  const std::string& project_file() const { return m_project_file; }
+
  private:
   void va_check(const goos::Object& form,
                 const goos::Arguments& args,
@@ -83,6 +96,8 @@ class MakeSystem {
                         std::vector<std::string>* result_order,
                         std::unordered_set<std::string>* result_set) const;
 
+  BuildDatabase::StepRecord snapshot_step(MakeStep& rule, Tool& tool);
+
   goos::Interpreter m_goos;
 
   std::unordered_map<std::string, std::shared_ptr<MakeStep>> m_output_to_step;
@@ -90,4 +105,7 @@ class MakeSystem {
   PathMap m_path_map;
   std::vector<std::string> m_gsrc_folder;
   std::map<std::string, std::string> m_gsrc_files = {};
+  std::string m_project_file;
+  int m_jobs = 0;
+  BuildDatabase m_db;
 };
@@ -16,7 +16,7 @@ struct ToolInput {
   std::vector<std::string>& input;   // the input file
   std::vector<std::string>& deps;    // explicit dependencies
   std::vector<std::string>& output;  // produced output files.
-  goos::Object arg;                  // optional argument
+  const goos::Object& arg;           // optional argument
 };
 
 class Tool {
@@ -27,7 +27,20 @@ class Tool {
                                                                const PathMap& /*path_map*/) {
     return {};
   }
-  virtual bool needs_run(const ToolInput& task, const PathMap& path_map);
+  /*!
+   * All files that the outputs of this step are made from. By default, the inputs, deps, and
+   * additional dependencies.
+   */
+  virtual std::vector<std::string> get_input_files(const ToolInput& task, const PathMap& path_map);
+  /*!
+   * A reason to run this step even if none of its files have changed, or nullopt.
+   */
+  virtual std::optional<std::string> forced_run_reason(const ToolInput&,
+                                                       const PathMap& /*path_map*/) {
+    return std::nullopt;
+  }
+  // if true, run may be called from any thread, at the same time as other steps.
+  virtual bool thread_safe() const { return false; }
   virtual ~Tool() = default;
 
   const std::string& name() const { return m_name; }
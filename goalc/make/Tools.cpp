@@ -14,15 +14,16 @@
 
 CompilerTool::CompilerTool(Compiler* compiler) : Tool("goalc"), m_compiler(compiler) {}
 
-bool CompilerTool::needs_run(const ToolInput& task, const PathMap& path_map) {
+std::optional<std::string> CompilerTool::forced_run_reason(const ToolInput& task,
+                                                           const PathMap& /*path_map*/) {
   if (task.input.size() != 1) {
     throw std::runtime_error(fmt::format("Invalid amount of inputs to {} tool", name()));
   }
 
   if (!m_compiler->knows_object_file(fs::path(task.input.at(0)).stem().u8string())) {
-    return true;
+    return "not loaded in the compiler";
   }
-  return Tool::needs_run(task, path_map);
+  return std::nullopt;
 }
 
 bool CompilerTool::run(const ToolInput& task, const PathMap& /*path_map*/) {
@@ -85,7 +86,12 @@ bool DgoTool::run(const ToolInput& task, const PathMap& path_map) {
   if (task.input.size() != 1) {
     throw std::runtime_error(fmt::format("Invalid amount of inputs to {} tool", name()));
   }
-  auto desc = parse_desc_file(task.input.at(0), m_reader);
+  DgoDescription desc;
+  {
+    // the reader's symbol table is shared, but building the DGO can run in parallel.
+    std::lock_guard<std::mutex> lk(m_reader_mutex);
+    desc = parse_desc_file(task.input.at(0), m_reader);
+  }
   build_dgo(desc, path_map.output_prefix);
   return true;
 }
@@ -93,6 +99,7 @@ bool DgoTool::run(const ToolInput& task, const PathMap& path_map) {
 std::vector<std::string> DgoTool::get_additional_dependencies(const ToolInput& task,
                                                               const PathMap& path_map) {
   std::vector<std::string> result;
+  std::lock_guard<std::mutex> lk(m_reader_mutex);
   auto desc = parse_desc_file(task.input.at(0), m_reader);
   for (auto& x : desc.entries) {
     // todo out
@@ -136,7 +143,8 @@ bool GameCntTool::run(const ToolInput& task, const PathMap& path_map) {
 
 TextTool::TextTool() : Tool("text") {}
 
-bool TextTool::needs_run(const ToolInput& task, const PathMap& path_map) {
+std::vector<std::string> TextTool::get_input_files(const ToolInput& task,
+                                                   const PathMap& path_map) {
   if (task.input.size() != 1) {
     throw std::runtime_error(fmt::format("Invalid amount of inputs to {} tool", name()));
   }
@@ -146,7 +154,9 @@ bool TextTool::needs_run(const ToolInput& task, const PathMap& path_map) {
   for (auto& dep : deps) {
     dep = path_map.apply_remaps(dep);
   }
-  return Tool::needs_run({task.input, deps, task.output, task.arg}, path_map);
+  auto result = Tool::get_input_files(task, path_map);
+  result.insert(result.end(), deps.begin(), deps.end());
+  return result;
 }
 
 bool TextTool::run(const ToolInput& task, const PathMap& path_map) {
@@ -168,7 +178,8 @@ bool GroupTool::run(const ToolInput&, const PathMap& /*path_map*/) {
 
 SubtitleTool::SubtitleTool() : Tool("subtitle") {}
 
-bool SubtitleTool::needs_run(const ToolInput& task, const PathMap& path_map) {
+std::vector<std::string> SubtitleTool::get_input_files(const ToolInput& task,
+                                                       const PathMap& path_map) {
   if (task.input.size() != 1) {
     throw std::runtime_error(fmt::format("Invalid amount of inputs to {} tool", name()));
   }
@@ -178,7 +189,9 @@ bool SubtitleTool::needs_run(const ToolInput& task, const PathMap& path_map) {
   for (auto& dep : deps) {
     dep = path_map.apply_remaps(dep);
   }
-  return Tool::needs_run({task.input, deps, task.output, task.arg}, path_map);
+  auto result = Tool::get_input_files(task, path_map);
+  result.insert(result.end(), deps.begin(), deps.end());
+  return result;
 }
 
 bool SubtitleTool::run(const ToolInput& task, const PathMap& path_map) {
@@ -196,12 +209,15 @@ bool SubtitleTool::run(const ToolInput& task, const PathMap& path_map) {
 
 BuildLevelTool::BuildLevelTool() : Tool("build-level") {}
 
-bool BuildLevelTool::needs_run(const ToolInput& task, const PathMap& path_map) {
+std::vector<std::string> BuildLevelTool::get_input_files(const ToolInput& task,
+                                                         const PathMap& path_map) {
   if (task.input.size() != 1) {
     throw std::runtime_error(fmt::format("Invalid amount of inputs to {} tool", name()));
   }
   auto deps = get_build_level_deps(task.input.at(0));
-  return Tool::needs_run({task.input, deps, task.output, task.arg}, path_map);
+  auto result = Tool::get_input_files(task, path_map);
+  result.insert(result.end(), deps.begin(), deps.end());
+  return result;
 }
 
 bool BuildLevelTool::run(const ToolInput& task, const PathMap& path_map) {
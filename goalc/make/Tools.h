@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "common/goos/Reader.h"
 
 #include "goalc/make/Tool.h"
@@ -10,7 +12,8 @@ class CompilerTool : public Tool {
  public:
   CompilerTool(Compiler* compiler);
   bool run(const ToolInput& task, const PathMap& path_map) override;
-  bool needs_run(const ToolInput& task, const PathMap& path_map) override;
+  std::optional<std::string> forced_run_reason(const ToolInput& task,
+                                               const PathMap& path_map) override;
 
  private:
   Compiler* m_compiler = nullptr;
@@ -20,10 +23,12 @@ class DgoTool : public Tool {
  public:
   DgoTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
   std::vector<std::string> get_additional_dependencies(const ToolInput&,
                                                        const PathMap& path_map) override;
 
  private:
+  std::mutex m_reader_mutex;
   goos::Reader m_reader;
 };
 
@@ -37,6 +42,7 @@ class CopyTool : public Tool {
  public:
   CopyTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
 };
 
 class GameCntTool : public Tool {
@@ -49,25 +55,32 @@ class TextTool : public Tool {
  public:
   TextTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
-  bool needs_run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
+  std::vector<std::string> get_input_files(const ToolInput& task,
+                                           const PathMap& path_map) override;
 };
 
 class GroupTool : public Tool {
  public:
   GroupTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
 };
 
 class SubtitleTool : public Tool {
  public:
   SubtitleTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
-  bool needs_run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
+  std::vector<std::string> get_input_files(const ToolInput& task,
+                                           const PathMap& path_map) override;
 };
 
 class BuildLevelTool : public Tool {
  public:
   BuildLevelTool();
   bool run(const ToolInput& task, const PathMap& path_map) override;
-  bool needs_run(const ToolInput& task, const PathMap& path_map) override;
+  bool thread_safe() const override { return true; }
+  std::vector<std::string> get_input_files(const ToolInput& task,
+                                           const PathMap& path_map) override;
 };
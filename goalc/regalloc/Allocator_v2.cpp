@@ -1,6 +1,7 @@
 #include "Allocator_v2.h"
 
 #include <algorithm>
+#include <array>
 #include <optional>
 #include <unordered_map>
 
@@ -33,6 +34,13 @@
   - (repeat the above step until no more are found)
   - Allocate remaining variables
 
+ Move coalescing is done with hints: each variable tries the registers of the variables it is moved
+ to or from before anything else (including constrained ones, like arguments and return values).
+ When a variable with unassigned move partners has to pick a register from the order, it picks one
+ that a partner could also use, if there is one and it doesn't add a callee-saved register that the
+ first free one wouldn't. A hint is only taken if the register is free for the entire live range,
+ so it never causes a spill of its own.
+
  Third: We have a new approach for spilling.
  In the old allocator we had to reserve registers for use only in spill loads/stores.
  In this design, we don't do this, but instead demote variables to the stack when we run out.
@@ -43,6 +51,11 @@
  - Move Eliminator (try to eliminate move instructions)
  - Allow Read Write Same Reg
 
+ There is also a linear scan mode (AllocationInput::linear_scan), which is faster but spills more.
+ It only finds the range where each variable is live, not the liveliness at each instruction, and
+ assigns each variable once in order of where its range starts. Holes in live ranges are ignored, so
+ it is similar to Allocator v1 without fancy coloring. If it fails, the normal passes can be used.
+
  Future improvements:
  - Within a basic block, try to drop load/store instructions for stack ops.
  */
@@ -81,6 +94,12 @@ class VarAssignment {
     m_seen = true;
   }
 
+  // mark the entire live range as live, when we only know the range.
+  void mark_range_live() {
+    std::fill(m_live.begin(), m_live.end(), true);
+    m_seen = true;
+  }
+
   // mark this variable as having a function call inside its live range.
   // this will make it prefer saved registers.
   void mark_crossing_function() { m_crosses_function_call = true; }
@@ -256,6 +275,51 @@ struct RACache {
   std::vector<std::vector<s32>> live_per_instruction;
 
   std::vector<IRegSet> liveout_per_instr;
+
+  // per var, the variables it is moved to or from, the ones with the most moves first.
+  std::vector<std::vector<s32>> move_partners;
+
+  // linear scan only finds live ranges, not the liveliness at each instruction. Then
+  // live_per_instruction and liveout_per_instr are empty, and we use the variables that are live
+  // out of each block instead.
+  bool ranges_only = false;
+  std::vector<int> block_ending_at;     // per instr, the block ending there or -1.
+  std::vector<IRegSet> block_live_out;  // per block
+
+  /*!
+   * Is the variable live after the given instruction? If we only know the live range, this is
+   * true anywhere before the end of the range, even if the variable isn't actually live there.
+   */
+  bool live_out(int var_idx, int instr_idx) const {
+    if (!ranges_only) {
+      return liveout_per_instr.at(instr_idx).contains(var_idx);
+    }
+    const auto& var = vars.at(var_idx);
+    if (!var.has_info_at(instr_idx)) {
+      return false;
+    }
+    if (instr_idx < var.last_live()) {
+      return true;
+    }
+    int block = block_ending_at.at(instr_idx);
+    return block != -1 && block_live_out.at(block).contains(var_idx);
+  }
+
+  // per instruction, masks of hardware registers (see reg_bit), so register checks can skip
+  // instructions that can't possibly conflict.
+  struct InstrRegs {
+    u32 clobber = 0;
+    u32 exclude = 0;
+    // registers used by assigned variables that are live at this instruction. Registers stay here
+    // after a variable is demoted to the stack, so this may have extras, but it never misses one.
+    u32 maybe_used = 0;
+  };
+  std::vector<InstrRegs> regs_per_instr;
+  // every register any variable has been put in so far. Like maybe_used, this may have extras.
+  u32 regs_used_anywhere = 0;
+  // instructions with any clobbers or excludes, in order.
+  std::vector<int> clobber_or_exclude_instrs;
+
   int current_stack_slot = 0;
   bool used_stack = false;
   bool failed_alloc = false;
@@ -268,6 +332,39 @@ struct RACache {
   } stats;
 };
 
+u32 reg_bit(emitter::Register reg) {
+  return 1u << reg.id();
+}
+
+/*!
+ * Record that the variable, which was just assigned to a register, uses it where it is live.
+ */
+void mark_reg_used(RACache* cache, const VarAssignment& var) {
+  u32 bit = reg_bit(var.reg());
+  cache->regs_used_anywhere |= bit;
+  for (int instr = var.first_live(); instr <= var.last_live(); instr++) {
+    if (var.live(instr)) {
+      cache->regs_per_instr.at(instr).maybe_used |= bit;
+    }
+  }
+}
+
+/*!
+ * Use the given register as a temporary for a stack variable at the given instruction.
+ */
+void set_stack_slot_reg(RACache* cache, VarAssignment& var, emitter::Register reg, int instr_idx) {
+  var.set_stack_slot_reg(reg, instr_idx);
+  cache->regs_per_instr.at(instr_idx).maybe_used |= reg_bit(reg);
+  cache->regs_used_anywhere |= reg_bit(reg);
+}
+
+/*!
+ * Would using this register make the function save and restore another callee-saved register?
+ */
+bool adds_saved_reg(const RACache& cache, emitter::Register reg) {
+  return emitter::gRegInfo.get_info(reg).saved && !(cache.regs_used_anywhere & reg_bit(reg));
+}
+
 struct AssignmentOrder {
   std::vector<emitter::Register> xmms, gprs;
 };
@@ -362,13 +459,11 @@ std::vector<Range<s32>> find_live_range_instr(const AllocationInput& input,
 
     ASSERT(block.live.size() == block.instr_idx.size());
     for (uint32_t i = 0; i < block.live.size(); i++) {
-      for (int j = 0; j < block.live[i].size(); j++) {
-        if (block.live[i][j]) {
-          int instr_idx = block.instr_idx.at(i);
-          result.at(j).first() = std::min(result.at(j).first(), instr_idx);
-          result.at(j).last() = std::max(result.at(j).last(), instr_idx);
-        }
-      }
+      int instr_idx = block.instr_idx.at(i);
+      block.live[i].for_each([&](int j) {
+        result.at(j).first() = std::min(result.at(j).first(), instr_idx);
+        result.at(j).last() = std::max(result.at(j).last(), instr_idx);
+      });
     }
   }
 
@@ -414,15 +509,14 @@ std::vector<VarAssignment> initialize_unassigned(const std::vector<Range<s32>>&
     // and liveliness analysis
     ASSERT(block.live.size() == block.instr_idx.size());
     for (uint32_t instr = 0; instr < block.live.size(); instr++) {
-      for (int var = 0; var < block.live[instr].size(); var++) {
-        if (block.live[instr][var]) {
-          result.at(var).mark_live(block.instr_idx.at(instr));
-          auto& i = input.instructions.at(block.instr_idx.at(instr));
-          if (!i.clobber.empty()) {
-            result.at(var).mark_crossing_function();
-          }
+      int instr_idx = block.instr_idx.at(instr);
+      bool has_clobber = !input.instructions.at(instr_idx).clobber.empty();
+      block.live[instr].for_each([&](int var) {
+        result.at(var).mark_live(instr_idx);
+        if (has_clobber) {
+          result.at(var).mark_crossing_function();
         }
-      }
+      });
     }
   }
 
@@ -437,12 +531,13 @@ std::vector<VarAssignment> initialize_unassigned(const std::vector<Range<s32>>&
 }
 
 /*!
- * Populates the control flow analysis cache and:
+ * Populates the control flow analysis cache with the liveliness in and out of each block and:
  * - iregs
  * - used_var
  * - initializes was allocated.
+ * If per_instr is set, the blocks also get the liveliness at each instruction.
  */
-void do_liveliness_analysis(const AllocationInput& input, RACache* cache) {
+void do_block_liveliness_analysis(const AllocationInput& input, RACache* cache, bool per_instr) {
   find_basic_blocks(&cache->control_flow, input);
   cache->stats.var_count = input.max_vars;
   cache->was_allocated.resize(input.max_vars, false);
@@ -464,21 +559,52 @@ void do_liveliness_analysis(const AllocationInput& input, RACache* cache) {
 
   // phase 1
   for (auto& block : cache->control_flow.basic_blocks) {
-    block.live.resize(block.instr_idx.size());
-    block.dead.resize(block.instr_idx.size());
+    if (per_instr) {
+      block.live.resize(block.instr_idx.size());
+      block.dead.resize(block.instr_idx.size());
+    }
     block.analyze_liveliness_phase1(input.instructions);
   }
 
   // phase 2
+  // liveliness flows backward, so visiting blocks in reverse order takes fewer iterations.
+  auto& blocks = cache->control_flow.basic_blocks;
   bool changed = false;
   do {
     changed = false;
-    for (auto& block : cache->control_flow.basic_blocks) {
-      if (block.analyze_liveliness_phase2(cache->control_flow.basic_blocks, input.instructions)) {
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+      if (it->analyze_liveliness_phase2(blocks, input.instructions)) {
         changed = true;
       }
     }
   } while (changed);
+}
+
+/*!
+ * Find the registers clobbered and excluded by each instruction.
+ */
+void find_clobbers_and_excludes(const AllocationInput& input, RACache* cache) {
+  cache->regs_per_instr.resize(input.instructions.size());
+  for (size_t i = 0; i < input.instructions.size(); i++) {
+    const auto& instr = input.instructions[i];
+    auto& regs = cache->regs_per_instr[i];
+    for (auto& reg : instr.clobber) {
+      regs.clobber |= reg_bit(reg);
+    }
+    for (auto& reg : instr.exclude) {
+      regs.exclude |= reg_bit(reg);
+    }
+    if (regs.clobber || regs.exclude) {
+      cache->clobber_or_exclude_instrs.push_back(i);
+    }
+  }
+}
+
+/*!
+ * Populates the cache with the liveliness of each variable at each instruction.
+ */
+void do_liveliness_analysis(const AllocationInput& input, RACache* cache) {
+  do_block_liveliness_analysis(input, cache, true);
 
   // phase 3
   for (auto& block : cache->control_flow.basic_blocks) {
@@ -507,15 +633,114 @@ void do_liveliness_analysis(const AllocationInput& input, RACache* cache) {
     // print_analysis(input, &cache); TODO
   }
 
+  // the blocks aren't used after this, so their live sets can be moved.
   cache->liveout_per_instr.resize(input.instructions.size());
-  for (const auto& block : cache->control_flow.basic_blocks) {
+  for (auto& block : cache->control_flow.basic_blocks) {
     for (int idx_in_block = 0; idx_in_block < (int)block.instr_idx.size(); idx_in_block++) {
       int intsr_idx = block.instr_idx.at(idx_in_block);
-      cache->liveout_per_instr.at(intsr_idx) = block.live.at(idx_in_block);
+      cache->liveout_per_instr.at(intsr_idx) = std::move(block.live.at(idx_in_block));
+    }
+  }
+
+  find_clobbers_and_excludes(input, cache);
+}
+
+/*!
+ * Find the move partners of each variable. Putting a variable in the same register as a partner
+ * eliminates a move.
+ */
+void find_move_partners(const AllocationInput& input, RACache* cache) {
+  std::vector<std::pair<s32, s32>> pairs;
+  for (auto& instr : input.instructions) {
+    if (instr.is_move && instr.read.size() == 1 && instr.write.size() == 1) {
+      auto a = instr.read.front().id;
+      auto b = instr.write.front().id;
+      if (a != b) {
+        pairs.emplace_back(a, b);
+        pairs.emplace_back(b, a);
+      }
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  cache->move_partners.resize(input.max_vars);
+  std::vector<std::pair<int, s32>> counts;  // (move count, partner) for one variable
+  for (size_t i = 0; i < pairs.size();) {
+    auto var = pairs[i].first;
+    counts.clear();
+    while (i < pairs.size() && pairs[i].first == var) {
+      size_t end = i;
+      while (end < pairs.size() && pairs[end] == pairs[i]) {
+        end++;
+      }
+      counts.emplace_back(int(end - i), pairs[i].second);
+      i = end;
+    }
+    std::stable_sort(counts.begin(), counts.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (auto& count : counts) {
+      cache->move_partners.at(var).push_back(count.second);
     }
   }
 }
 
+/*!
+ * Populates the cache with just the range of instructions where each variable is live, which is
+ * all linear scan needs. These ranges are the same as the ones from do_liveliness_analysis, but are
+ * found from the liveliness in and out of blocks.
+ */
+void do_live_range_analysis(const AllocationInput& input, RACache* cache) {
+  do_block_liveliness_analysis(input, cache, false);
+  cache->ranges_only = true;
+
+  std::vector<Range<s32>> live_ranges(input.max_vars, Range<s32>(INT32_MAX, INT32_MIN));
+  auto extend = [&](int var_idx, int instr_idx) {
+    auto& range = live_ranges.at(var_idx);
+    range.first() = std::min(range.first(), instr_idx);
+    range.last() = std::max(range.last(), instr_idx);
+  };
+
+  auto& blocks = cache->control_flow.basic_blocks;
+  cache->block_ending_at.resize(input.instructions.size(), -1);
+  cache->block_live_out.resize(blocks.size());
+  for (auto& block : blocks) {
+    cache->block_ending_at.at(block.instr_idx.back()) = block.idx;
+    auto& live_out = cache->block_live_out.at(block.idx);
+    for (auto succ : block.succ) {
+      live_out.bitwise_or(blocks.at(succ).input);
+    }
+    block.input.for_each([&](int var_idx) { extend(var_idx, block.instr_idx.front()); });
+    live_out.for_each([&](int var_idx) { extend(var_idx, block.instr_idx.back()); });
+
+    for (auto instr_idx : block.instr_idx) {
+      const auto& instr = input.instructions.at(instr_idx);
+      for (auto& rd : instr.read) {
+        extend(rd.id, instr_idx);
+      }
+      for (auto& wr : instr.write) {
+        extend(wr.id, instr_idx);
+      }
+    }
+  }
+
+  for (auto& con : input.constraints) {
+    if (!con.contrain_everywhere) {
+      extend(con.ireg.id, con.instr_idx);
+    }
+  }
+
+  cache->vars.reserve(input.max_vars);
+  for (int var_idx = 0; var_idx < input.max_vars; var_idx++) {
+    const auto& range = live_ranges.at(var_idx);
+    auto& var = cache->vars.emplace_back(range.first(), range.last(), var_idx);
+    if (range.first() <= range.last()) {
+      var.mark_range_live();
+    }
+  }
+
+  find_clobbers_and_excludes(input, cache);
+}
+
 /*!
  * Assign variables with registers constraints to registers.
  */
@@ -526,6 +751,7 @@ void do_constrained_alloc(RACache* cache, const AllocationInput& input, bool tra
       lg::print("[RA] Apply constraint {}\n", constr.to_string());
     }
     cache->vars.at(var_id).constrain_to_register(constr.desired_register);
+    mark_reg_used(cache, cache->vars.at(var_id));
   }
 }
 
@@ -541,7 +767,7 @@ bool safe_overlap_reads_first(const AllocationInput& in,
   // add var_a, var_b and put var_a and var_b in the same.
   auto& instr = in.instructions.at(instr_idx);
   // should read a, then a goes dead.
-  if (!cache.liveout_per_instr.at(instr_idx)[a.var()] && instr.reads(a.var()) &&
+  if (!cache.live_out(a.var(), instr_idx) && instr.reads(a.var()) &&
       !instr.writes(a.var()) && instr.writes(b.var()) && !instr.reads(b.var())) {
     return true;
   }
@@ -588,24 +814,30 @@ bool check_constrained_alloc(RACache* cache, const AllocationInput& in) {
   // - programmer actually asked for this.
   // In the second case, rlet will put both rletted variables into the same ireg, so we won't
   // see it from the register allocation.
+  std::vector<s32> in_reg;
   for (uint32_t i = 0; i < in.instructions.size(); i++) {
-    for (auto idx1 : cache->live_per_instruction.at(i)) {
+    // only the constrained variables are assigned, so just look at pairs of those.
+    in_reg.clear();
+    for (auto idx : cache->live_per_instruction.at(i)) {
+      if (cache->vars.at(idx).assigned_to_reg()) {
+        in_reg.push_back(idx);
+      }
+    }
+    for (auto idx1 : in_reg) {
       auto& lr1 = cache->vars.at(idx1);
-      for (auto idx2 : cache->live_per_instruction.at(i)) {
+      for (auto idx2 : in_reg) {
         if (idx1 == idx2) {
           continue;
         }
         auto& lr2 = cache->vars.at(idx2);
-        if (lr1.assigned_to_reg() && lr2.assigned_to_reg()) {
-          if (lr1.reg() == lr2.reg() && !safe_overlap(in, *cache, lr1, lr2, i)) {
-            // todo, this error won't be helpful
-            lg::print(
-                "[RegAlloc Error] {} Cannot satisfy constraints at instruction {} due to "
-                "constraints "
-                "on {} and {}, both are assigned to register {}\n",
-                in.function_name, i, lr1.var(), lr2.var(), lr1.reg().print());
-            ok = false;
-          }
+        if (lr1.reg() == lr2.reg() && !safe_overlap(in, *cache, lr1, lr2, i)) {
+          // todo, this error won't be helpful
+          lg::print(
+              "[RegAlloc Error] {} Cannot satisfy constraints at instruction {} due to "
+              "constraints "
+              "on {} and {}, both are assigned to register {}\n",
+              in.function_name, i, lr1.var(), lr2.var(), lr1.reg().print());
+          ok = false;
         }
       }
     }
@@ -642,30 +874,29 @@ bool vector_contains(const std::vector<T>& vec, const T& obj) {
 }
 
 /*!
- * Is it okay to assign the given variable to the register?
+ * Do the other variables live at this instruction allow us to use the register here?
  */
-bool check_register_assign_at(const AllocationInput& input,
-                              RACache& cache,
-                              int var_idx,
-                              int instr_idx,
-                              emitter::Register reg) {
-  // Step 1: check other assignments
-
+bool other_vars_allow_reg_at(const AllocationInput& input,
+                             RACache& cache,
+                             const VarAssignment& this_var,
+                             int instr_idx,
+                             emitter::Register reg) {
   // look at everybody else in the interference graph
   for (int other_idx : cache.live_per_instruction.at(instr_idx)) {
     // don't check ourselves
-    if (other_idx == var_idx) {
+    if (other_idx == this_var.var()) {
       continue;
     }
 
     // we are both live here.
     const auto& other_var = cache.vars.at(other_idx);
     if (other_var.unassigned()) {
-      // okay!
+      // skip unassigned.
+      continue;
     } else if (other_var.assigned_to_reg()) {
       if (other_var.assigned_to_reg(reg)) {
         // assigned to the same register as us!
-        if (!safe_overlap(input, cache, cache.vars.at(var_idx), other_var, instr_idx)) {
+        if (!safe_overlap(input, cache, this_var, other_var, instr_idx)) {
           return false;
         }
       }
@@ -676,19 +907,33 @@ bool check_register_assign_at(const AllocationInput& input,
       }
     }
   }
+  return true;
+}
+
+/*!
+ * Is it okay to assign the given variable to the register?
+ */
+bool check_register_assign_at(const AllocationInput& input,
+                              RACache& cache,
+                              int var_idx,
+                              int instr_idx,
+                              emitter::Register reg) {
+  const auto& regs = cache.regs_per_instr.at(instr_idx);
+  u32 bit = reg_bit(reg);
+
+  // Step 1: check other assignments
+  if ((regs.maybe_used & bit) &&
+      !other_vars_allow_reg_at(input, cache, cache.vars.at(var_idx), instr_idx, reg)) {
+    return false;
+  }
 
   // Step 2: check clobbers and excludes.
   // The model for clobber is that each instruction reads, clobbers, then writes.
   // so in some cases it's okay to clobber.
-
-  // loop over our live range
-
-  const auto& instr = input.instructions.at(instr_idx);
-
-  if (vector_contains(instr.clobber, reg)) {
+  if (regs.clobber & bit) {
     // there's two cases where this is okay.
     // 1: if we aren't live-out. The clobber won't clobber anything.
-    if (!cache.liveout_per_instr.at(instr_idx)[var_idx]) {
+    if (!cache.live_out(var_idx, instr_idx)) {
       // ok
     } else {
       // otherwise, we need to write it.
@@ -699,7 +944,7 @@ bool check_register_assign_at(const AllocationInput& input,
     }
   }
 
-  if (vector_contains(instr.exclude, reg)) {
+  if (regs.exclude & bit) {
     return false;
   }
 
@@ -714,53 +959,17 @@ bool check_register_assign(const AllocationInput& input,
                            int var_idx,
                            emitter::Register reg) {
   auto& this_var = cache.vars.at(var_idx);
-
-  // Step 1: check other assignments
+  u32 bit = reg_bit(reg);
 
   // loop over our live range
-  for (int instr = this_var.first_live(); instr <= this_var.last_live(); instr++) {
-    // and leave out the ones where we're dead
-    if (!this_var.live(instr)) {
+  for (int instr_idx = this_var.first_live(); instr_idx <= this_var.last_live(); instr_idx++) {
+    const auto& regs = cache.regs_per_instr[instr_idx];
+    if (!((regs.maybe_used | regs.clobber | regs.exclude) & bit)) {
+      // nothing here could use the register.
       continue;
     }
 
-    // look at everybody else in the interference graph
-    for (int other_idx : cache.live_per_instruction.at(instr)) {
-      // don't check ourselves
-      if (other_idx == var_idx) {
-        continue;
-      }
-
-      // we are both live here.
-      const auto& other_var = cache.vars.at(other_idx);
-      if (other_var.unassigned()) {
-        // skip unassigned.
-        continue;
-      } else if (other_var.assigned_to_reg()) {
-        if (other_var.assigned_to_reg(reg)) {
-          // assigned to the same register as us!
-          if (!safe_overlap(input, cache, this_var, other_var, instr)) {
-            ;
-            return false;
-          }
-        }
-      } else {
-        // assigned to stack TODO
-        if (other_var.stack_bonus_op_needs_reg(reg, instr)) {
-          return false;
-        }
-      }
-    }
-  }
-
-  // Step 2: check clobbers and excludes.
-  // The model for clobber is that each instruction reads, clobbers, then writes.
-  // so in some cases it's okay to clobber.
-
-  // loop over our live range
-  for (int instr_idx = this_var.first_live(); instr_idx <= this_var.last_live(); instr_idx++) {
-    const auto& instr = input.instructions.at(instr_idx);
-    if (vector_contains(instr.exclude, reg)) {
+    if (regs.exclude & bit) {
       return false;
     }
 
@@ -769,17 +978,22 @@ bool check_register_assign(const AllocationInput& input,
       continue;
     }
 
-    if (vector_contains(instr.clobber, reg)) {
+    // Step 1: check other assignments
+    if ((regs.maybe_used & bit) &&
+        !other_vars_allow_reg_at(input, cache, this_var, instr_idx, reg)) {
+      return false;
+    }
+
+    // Step 2: check clobbers.
+    // The model for clobber is that each instruction reads, clobbers, then writes.
+    // so in some cases it's okay to clobber.
+    if (regs.clobber & bit) {
       // there's two cases where this is okay.
       // 1: if we aren't live-out. The clobber won't clobber anything.
-      if (!cache.liveout_per_instr.at(instr_idx)[var_idx]) {
-        continue;
-      } else {
-        // otherwise, we need to write it.
-        if (!instr.writes(var_idx)) {
-          return false;
-        }
-        // 2: we write it after the clobber.
+      // 2: we write it after the clobber.
+      if (cache.live_out(var_idx, instr_idx) &&
+          !input.instructions.at(instr_idx).writes(var_idx)) {
+        return false;
       }
     }
   }
@@ -892,7 +1106,7 @@ loop_top:
         auto reg = check_other_var.reg();
         if (vector_contains(allowable_local_var_move_elim, reg)) {
           if (check_register_assign_at(input, *cache, var_idx, instr_idx, reg)) {
-            var.set_stack_slot_reg(reg, instr_idx);
+            set_stack_slot_reg(cache, var, reg, instr_idx);
             bonus.reg = reg;
             bonus.slot = my_slot;
             success = true;
@@ -904,7 +1118,7 @@ loop_top:
 
     for (auto reg : order) {
       if (check_register_assign_at(input, *cache, var_idx, instr_idx, reg)) {
-        var.set_stack_slot_reg(reg, instr_idx);
+        set_stack_slot_reg(cache, var, reg, instr_idx);
         bonus.reg = reg;
         bonus.slot = my_slot;
         success = true;
@@ -1021,6 +1235,7 @@ bool run_assignment_on_var(const AllocationInput& input,
 
           if (worked) {
             var.assign_to_register(other_var.reg());
+            mark_reg_used(cache, var);
             assigned_to_reg = true;
           }
         }
@@ -1049,14 +1264,48 @@ bool run_assignment_on_var(const AllocationInput& input,
 
           if (worked) {
             var.assign_to_register(other_var.reg());
+            mark_reg_used(cache, var);
             assigned_to_reg = true;
           }
         }
       }
     }
 
+    // then the other variables we are moved to or from.
+    if (!assigned_to_reg && can_be_in_register) {
+      for (auto partner_idx : cache->move_partners.at(var_idx)) {
+        const auto& partner = cache->vars.at(partner_idx);
+        if (partner.assigned_to_reg() &&
+            vector_contains(allowable_local_var_move_elim, partner.reg())) {
+          bool worked = check_register_assign(input, *cache, var_idx, partner.reg());
+          if (trace) {
+            lg::print("m3 trying var {} in {}: {}\n", cache->iregs.at(var_idx).to_string(),
+                      partner.reg().print(), worked);
+          }
+          if (worked) {
+            var.assign_to_register(partner.reg());
+            mark_reg_used(cache, var);
+            assigned_to_reg = true;
+            break;
+          }
+        }
+      }
+    }
+
     if (!assigned_to_reg && !settings.only_move_eliminate_assigns && can_be_in_register) {
+      // partners that will pick a register later. If we can, leave them a way to use ours.
+      std::vector<s32> waiting_partners;
+      for (auto partner_idx : cache->move_partners.at(var_idx)) {
+        const auto& partner = cache->vars.at(partner_idx);
+        if (partner.seen() && partner.unassigned() &&
+            input.force_on_stack_regs.find(partner_idx) == input.force_on_stack_regs.end()) {
+          waiting_partners.push_back(partner_idx);
+        }
+      }
+
       const auto& assign_order = get_alloc_order(var_idx, input, *cache, settings.prefer_saved);
+      std::optional<emitter::Register> first_ok;
+      std::optional<emitter::Register> shared_ok;
       for (auto& reg : assign_order) {
         bool worked = check_register_assign(input, *cache, var_idx, reg);
         if (trace) {
@@ -1064,11 +1313,34 @@ bool run_assignment_on_var(const AllocationInput& input,
                     reg.print(), worked);
         }
         if (worked) {
-          var.assign_to_register(reg);
-          assigned_to_reg = true;
-          break;
+          if (!first_ok) {
+            first_ok = reg;
+          }
+          if (waiting_partners.empty() || !vector_contains(allowable_local_var_move_elim, reg)) {
+            break;
+          }
+          if (adds_saved_reg(*cache, reg) && !adds_saved_reg(*cache, *first_ok)) {
+            // saving one move isn't worth a push and pop in the prologue and epilogue.
+            continue;
+          }
+          for (auto partner_idx : waiting_partners) {
+            if (check_register_assign(input, *cache, partner_idx, reg)) {
+              shared_ok = reg;
+              break;
+            }
+          }
+          if (shared_ok) {
+            break;
+          }
         }
       }
+
+      auto reg = shared_ok ? shared_ok : first_ok;
+      if (reg) {
+        var.assign_to_register(*reg);
+        mark_reg_used(cache, var);
+        assigned_to_reg = true;
+      }
     }
 
     if (!assigned_to_reg && !settings.only_move_eliminate_assigns) {
@@ -1111,6 +1383,356 @@ int run_assignment_on_all_vars(const AllocationInput& input,
   }
   return assigned_count;
 }
+
+/*!
+ * Get the registers the variable can't use anywhere in its live range because of clobbers and
+ * excludes. This uses the same rules as check_register_assign. Also returns if a clobber applied,
+ * meaning the variable is live across a function call.
+ */
+u32 forbidden_regs(const AllocationInput& input,
+                   RACache& cache,
+                   const VarAssignment& var,
+                   bool* crosses_function) {
+  u32 result = 0;
+  *crosses_function = false;
+  auto& instrs = cache.clobber_or_exclude_instrs;
+  for (auto it = std::lower_bound(instrs.begin(), instrs.end(), var.first_live());
+       it != instrs.end() && *it <= var.last_live(); ++it) {
+    int instr_idx = *it;
+    const auto& regs = cache.regs_per_instr.at(instr_idx);
+    result |= regs.exclude;
+    if (regs.clobber && var.live(instr_idx) && cache.live_out(var.var(), instr_idx) &&
+        !input.instructions.at(instr_idx).writes(var.var())) {
+      result |= regs.clobber;
+      *crosses_function = true;
+    }
+  }
+  return result;
+}
+
+/*!
+ * Would putting these two variables in the same register be a problem?
+ * This only looks at the ends of their live ranges, so it's conservative if there are holes.
+ */
+bool ranges_conflict(const AllocationInput& input,
+                     RACache& cache,
+                     const VarAssignment& a,
+                     const VarAssignment& b) {
+  int lo = std::max(a.first_live(), b.first_live());
+  int hi = std::min(a.last_live(), b.last_live());
+  if (lo > hi) {
+    return false;
+  }
+  // it's fine if one ends at the instruction where the other begins, like a move.
+  return lo != hi || !safe_overlap(input, cache, a, b, lo);
+}
+
+/*!
+ * The variables with constraints, which have a register for their entire live range.
+ * Other variables can't overlap them, even if they start later.
+ */
+class FixedRanges {
+ public:
+  explicit FixedRanges(RACache& cache) {
+    for (auto& var : cache.vars) {
+      if (var.seen() && var.assigned_to_reg()) {
+        m_by_reg.at(var.reg().id()).push_back(var.var());
+      }
+    }
+
+    for (size_t reg = 0; reg < m_by_reg.size(); reg++) {
+      auto& vars = m_by_reg[reg];
+      std::stable_sort(vars.begin(), vars.end(), [&](int a, int b) {
+        return cache.vars.at(a).first_live() < cache.vars.at(b).first_live();
+      });
+      // these can overlap each other a little, so track the furthest end so far.
+      auto& max_last = m_max_last_live[reg];
+      for (auto var_idx : vars) {
+        int last = cache.vars.at(var_idx).last_live();
+        max_last.push_back(max_last.empty() ? last : std::max(last, max_last.back()));
+      }
+    }
+  }
+
+  /*!
+   * Does the variable conflict with a constrained variable in the given register?
+   */
+  bool conflicts(const AllocationInput& input,
+                 RACache& cache,
+                 const VarAssignment& var,
+                 emitter::Register reg) const {
+    auto& vars = m_by_reg.at(reg.id());
+    auto& max_last = m_max_last_live.at(reg.id());
+    // the first that starts after we end, then walk back until none can reach our start.
+    auto end = std::upper_bound(
+        vars.begin(), vars.end(), var.last_live(),
+        [&](int instr, int other) { return instr < cache.vars.at(other).first_live(); });
+    for (int i = int(end - vars.begin()); i-- > 0 && max_last[i] >= var.first_live();) {
+      if (vars[i] != var.var() && ranges_conflict(input, cache, var, cache.vars.at(vars[i]))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*!
+   * Do any of the constrained variables conflict with each other?
+   */
+  bool any_conflicts(const AllocationInput& input, RACache& cache) const {
+    for (auto& vars : m_by_reg) {
+      for (auto var_idx : vars) {
+        const auto& var = cache.vars.at(var_idx);
+        if (conflicts(input, cache, var, var.reg())) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::array<std::vector<int>, 32> m_by_reg;
+  std::array<std::vector<int>, 32> m_max_last_live;
+};
+
+/*!
+ * Find temporary registers for the variables that linear scan put on the stack, and add their loads
+ * and stores. A register can be a temporary at an instruction if no register variable's live range
+ * includes that instruction. When there isn't one, a register variable is moved to the stack too.
+ */
+bool setup_linear_scan_spills(const AllocationInput& input,
+                              RACache* cache,
+                              std::vector<int> to_spill) {
+  // per instruction, the number of register variables in each register.
+  std::vector<std::array<u8, 32>> reg_users(input.instructions.size());
+  // per instruction, the registers used as temporaries.
+  std::vector<u32> temps(input.instructions.size());
+
+  auto add_users = [&](const VarAssignment& var, int count) {
+    for (int instr_idx = var.first_live(); instr_idx <= var.last_live(); instr_idx++) {
+      reg_users[instr_idx][var.reg().id()] += count;
+    }
+  };
+  for (auto& var : cache->vars) {
+    if (var.seen() && var.assigned_to_reg()) {
+      add_users(var, 1);
+    }
+  }
+
+  // this may grow as we go.
+  for (size_t spill_idx = 0; spill_idx < to_spill.size(); spill_idx++) {
+    int var_idx = to_spill[spill_idx];
+    int slot = get_stack_slot_for_var(var_idx, cache);
+    const auto& order = get_alloc_order(var_idx, input, *cache, false);
+
+    for (int instr_idx = cache->vars.at(var_idx).first_live();
+         instr_idx <= cache->vars.at(var_idx).last_live(); instr_idx++) {
+      const auto& instr = input.instructions.at(instr_idx);
+      bool is_read = instr.reads(var_idx);
+      bool is_written = instr.writes(var_idx);
+      if (!is_read && !is_written) {
+        continue;
+      }
+
+      const auto& regs = cache->regs_per_instr.at(instr_idx);
+      u32 unavailable = temps[instr_idx] | regs.exclude;
+      if (cache->live_out(var_idx, instr_idx)) {
+        unavailable |= regs.clobber;
+      }
+      const auto& users = reg_users[instr_idx];
+
+      std::optional<emitter::Register> temp;
+      for (auto reg : order) {
+        if (!(unavailable & reg_bit(reg)) && !users[reg.id()]) {
+          temp = reg;
+          break;
+        }
+      }
+
+      if (!temp) {
+        // move the register variable here that stays live the longest to the stack.
+        int victim = -1;
+        for (auto& other : cache->vars) {
+          if (other.seen() && other.assigned_to_reg() && !other.locked() &&
+              other.has_info_at(instr_idx) && !(unavailable & reg_bit(other.reg())) &&
+              users[other.reg().id()] == 1 && vector_contains(order, other.reg()) &&
+              (victim == -1 || other.last_live() > cache->vars.at(victim).last_live())) {
+            victim = other.var();
+          }
+        }
+        if (victim == -1) {
+          return false;
+        }
+
+        auto& victim_var = cache->vars.at(victim);
+        temp = victim_var.reg();
+        add_users(victim_var, -1);
+        victim_var.demote_to_stack(get_stack_slot_for_var(victim, cache));
+        to_spill.push_back(victim);
+      }
+
+      cache->vars.at(var_idx).set_stack_slot_reg(*temp, instr_idx);
+      temps[instr_idx] |= reg_bit(*temp);
+
+      StackOp::Op op;
+      op.reg_class = cache->iregs.at(var_idx).reg_class;
+      op.reg = *temp;
+      op.slot = slot;
+      op.load = is_read;
+      op.store = is_written;
+      cache->stack_ops.at(instr_idx).ops.push_back(op);
+      cache->stats.num_spill_ops += int(is_read) + int(is_written);
+    }
+    cache->stats.num_spilled_vars++;
+  }
+  return true;
+}
+
+/*!
+ * Assign registers with linear scan. Variables are visited in order of where they become live and
+ * get a register that is free for their entire live range. If there isn't one, whichever
+ * variable's range ends last goes on the stack.
+ *
+ * This looks at each variable once, and only needs live ranges, not liveliness at each
+ * instruction. But it ignores holes in live ranges and only tries to eliminate the moves at the
+ * ends of a range, so it spills more and eliminates fewer moves than the normal passes.
+ */
+bool run_linear_scan(const AllocationInput& input, RACache* cache) {
+  cache->stats.assign_passes++;
+  FixedRanges fixed(*cache);
+  if (fixed.any_conflicts(input, *cache)) {
+    // this might be okay if the overlap is in a hole. Let the normal passes figure it out.
+    return false;
+  }
+
+  std::vector<int> order;
+  for (auto& var : cache->vars) {
+    if (var.seen() && var.unassigned()) {
+      order.push_back(var.var());
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return cache->vars.at(a).first_live() < cache->vars.at(b).first_live();
+  });
+
+  // variables in a register that are still live.
+  std::vector<int> active;
+  // variables that went on the stack. Their temporary registers are picked at the end, once the
+  // registers of everything else are known.
+  std::vector<int> spilled;
+
+  auto spill = [&](int var_idx) {
+    auto& var = cache->vars.at(var_idx);
+    int slot = get_stack_slot_for_var(var_idx, cache);
+    if (var.assigned_to_reg()) {
+      var.demote_to_stack(slot);
+    } else {
+      var.assign_to_stack(slot);
+    }
+    spilled.push_back(var_idx);
+  };
+
+  for (auto var_idx : order) {
+    auto& var = cache->vars.at(var_idx);
+
+    // free the registers of variables that are dead before we start.
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&](int other) {
+                                  return cache->vars.at(other).last_live() < var.first_live();
+                                }),
+                 active.end());
+
+    if (input.force_on_stack_regs.find(var_idx) != input.force_on_stack_regs.end()) {
+      spill(var_idx);
+      continue;
+    }
+
+    bool crosses_function = false;
+    u32 forbidden = forbidden_regs(input, *cache, var, &crosses_function);
+    u32 unavailable = forbidden;
+    for (auto other : active) {
+      const auto& other_var = cache->vars.at(other);
+      if (ranges_conflict(input, *cache, var, other_var)) {
+        unavailable |= reg_bit(other_var.reg());
+      }
+    }
+
+    auto reg_ok = [&](emitter::Register reg) {
+      return !(unavailable & reg_bit(reg)) && !fixed.conflicts(input, *cache, var, reg);
+    };
+
+    const auto& assign_order = get_alloc_order(var_idx, input, *cache, crosses_function);
+    std::optional<emitter::Register> assigned;
+
+    // try to eliminate a move at either end of the range.
+    auto try_move_elim = [&](int other_idx) {
+      const auto& other_var = cache->vars.at(other_idx);
+      if (!assigned && other_var.assigned_to_reg() &&
+          vector_contains(assign_order, other_var.reg()) && reg_ok(other_var.reg())) {
+        assigned = other_var.reg();
+      }
+    };
+    auto& first_instr = input.instructions.at(var.first_live());
+    auto& last_instr = input.instructions.at(var.last_live());
+    if (first_instr.is_move && first_instr.writes(var_idx)) {
+      try_move_elim(first_instr.read.front().id);
+    }
+    if (last_instr.is_move && last_instr.reads(var_idx)) {
+      try_move_elim(last_instr.write.front().id);
+    }
+
+    for (auto& reg : assign_order) {
+      if (assigned) {
+        break;
+      }
+      if (reg_ok(reg)) {
+        assigned = reg;
+      }
+    }
+
+    if (!assigned) {
+      // out of registers. Take one from the active variable that stays live the longest, if it
+      // ends after us.
+      int victim = -1;
+      for (auto other : active) {
+        const auto& other_var = cache->vars.at(other);
+        if (!vector_contains(assign_order, other_var.reg()) ||
+            (forbidden & reg_bit(other_var.reg())) ||
+            fixed.conflicts(input, *cache, var, other_var.reg())) {
+          continue;
+        }
+        bool shared = false;
+        for (auto third : active) {
+          const auto& third_var = cache->vars.at(third);
+          if (third != other && third_var.assigned_to_reg(other_var.reg()) &&
+              ranges_conflict(input, *cache, var, third_var)) {
+            shared = true;
+            break;
+          }
+        }
+        if (!shared &&
+            (victim == -1 || other_var.last_live() > cache->vars.at(victim).last_live())) {
+          victim = other;
+        }
+      }
+
+      if (victim != -1 && cache->vars.at(victim).last_live() > var.last_live()) {
+        assigned = cache->vars.at(victim).reg();
+        active.erase(std::find(active.begin(), active.end(), victim));
+        spill(victim);
+      }
+    }
+
+    if (assigned) {
+      var.assign_to_register(*assigned);
+      active.push_back(var_idx);
+    } else {
+      spill(var_idx);
+    }
+  }
+
+  return spilled.empty() || setup_linear_scan_spills(input, cache, spilled);
+}
 }  // namespace
 
 AllocationResult allocate_registers_v2(const AllocationInput& input) {
@@ -1125,39 +1747,54 @@ AllocationResult allocate_registers_v2(const AllocationInput& input) {
   }
 
   // STEP 1: Analysis:
-  do_liveliness_analysis(input, &cache);
+  if (input.linear_scan) {
+    do_live_range_analysis(input, &cache);
+  } else {
+    do_liveliness_analysis(input, &cache);
+  }
 
   // STEP 2: Constrained allocation.
   do_constrained_alloc(&cache, input, input.debug_settings.trace_debug_constraints);
-  check_constrained_alloc(&cache, input);
-  if (!check_constrained_alloc(&cache, input)) {
-    result.ok = false;
-    lg::print("[RegAlloc Error] Register allocation has failed due to bad constraints.\n");
-    return result;
-  }
 
-  if (torture_test_spills) {
-    AssignmentSettings pick_up_new_settings;
-    run_assignment_on_all_vars(input, &cache, pick_up_new_settings);
+  if (input.linear_scan) {
+    // STEP 3: Linear scan, which checks the constraints itself. If it fails, the caller can try
+    // again with the normal passes.
+    if (!run_linear_scan(input, &cache)) {
+      result.ok = false;
+      return result;
+    }
   } else {
-    // STEP 3: Function Crossing Allocation.
-    AssignmentSettings function_cross_settings;
-    function_cross_settings.only_move_eliminate_assigns = false;
-    function_cross_settings.prefer_saved = true;
-    auto func_cross_vars = var_indices_of_function_crossers_large_to_small(input, cache);
-    run_assignment_on_some_vars(input, &cache, func_cross_vars, function_cross_settings);
+    if (!check_constrained_alloc(&cache, input)) {
+      result.ok = false;
+      lg::print("[RegAlloc Error] Register allocation has failed due to bad constraints.\n");
+      return result;
+    }
+
+    find_move_partners(input, &cache);
 
-    AssignmentSettings branch_out_settings;
-    branch_out_settings.only_move_eliminate_assigns = true;
+    if (torture_test_spills) {
+      AssignmentSettings pick_up_new_settings;
+      run_assignment_on_all_vars(input, &cache, pick_up_new_settings);
+    } else {
+      // STEP 3: Function Crossing Allocation.
+      AssignmentSettings function_cross_settings;
+      function_cross_settings.only_move_eliminate_assigns = false;
+      function_cross_settings.prefer_saved = true;
+      auto func_cross_vars = var_indices_of_function_crossers_large_to_small(input, cache);
+      run_assignment_on_some_vars(input, &cache, func_cross_vars, function_cross_settings);
 
-    AssignmentSettings pick_up_new_settings;
+      AssignmentSettings branch_out_settings;
+      branch_out_settings.only_move_eliminate_assigns = true;
 
-    int loop_count = 1;
-    while (loop_count) {
-      loop_count = run_assignment_on_all_vars(input, &cache, branch_out_settings);
-    }
+      AssignmentSettings pick_up_new_settings;
+
+      int loop_count = 1;
+      while (loop_count) {
+        loop_count = run_assignment_on_all_vars(input, &cache, branch_out_settings);
+      }
 
-    run_assignment_on_all_vars(input, &cache, pick_up_new_settings);
+      run_assignment_on_all_vars(input, &cache, pick_up_new_settings);
+    }
   }
 
   result.ok = true;
@@ -1180,27 +1817,26 @@ AllocationResult allocate_registers_v2(const AllocationInput& input) {
   result.stack_slots_for_vars = input.stack_slots_for_stack_vars;
 
   // check for use of saved registers
-  for (auto sr : emitter::gRegInfo.get_all_saved()) {
-    bool uses_sr = false;
-    for (auto& lr : cache.vars) {
+  const auto& saved_regs = emitter::gRegInfo.get_all_saved();
+  u32 used_regs = 0;
+  for (auto& lr : cache.vars) {
+    if (lr.first_live() > lr.last_live()) {
+      continue;
+    }
+    if (lr.assigned_to_reg()) {
+      used_regs |= reg_bit(lr.reg());
+    } else if (lr.assigned_to_stack()) {
       for (int instr_idx = lr.first_live(); instr_idx <= lr.last_live(); instr_idx++) {
-        if (lr.assigned_to_reg()) {
-          if (lr.assigned_to_reg(sr)) {
-            uses_sr = true;
-            break;
-          }
-        } else if (lr.assigned_to_stack()) {
+        for (auto sr : saved_regs) {
           if (lr.stack_bonus_op_needs_reg(sr, instr_idx)) {
-            uses_sr = true;
-            break;
+            used_regs |= reg_bit(sr);
           }
         }
       }
-      if (uses_sr) {
-        break;
-      }
     }
-    if (uses_sr) {
+  }
+  for (auto sr : saved_regs) {
+    if (used_regs & reg_bit(sr)) {
       result.used_saved_regs.push_back(sr);
     }
   }
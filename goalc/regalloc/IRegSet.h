@@ -17,6 +17,7 @@
 
 #include "common/common_types.h"
 #include "common/util/Assert.h"
+#include "common/util/BitUtils.h"
 
 class IRegSet {
  public:
@@ -34,6 +35,16 @@ class IRegSet {
     m_data.at(word) |= (1ll << bit);
   }
 
+  /*!
+   * Remove the given ireg from the set.
+   * Doesn't resize.
+   */
+  void erase(int x) {
+    if (x < m_bits) {
+      m_data[x / 64] &= ~(1ull << (x % 64));
+    }
+  }
+
   /*!
    * Remove everything from the set.
    */
@@ -54,6 +65,32 @@ class IRegSet {
     return m_data.at(word) & (1ll << bit);
   }
 
+  /*!
+   * Is the given register in the set?
+   * Doesn't resize.
+   */
+  bool contains(int x) const {
+    if (x >= m_bits) {
+      return false;
+    }
+    return m_data[x / 64] & (1ll << (x % 64));
+  }
+
+  /*!
+   * Call f on each register in the set, in increasing order.
+   * This skips over empty words, so it is much faster than checking each bit.
+   */
+  template <typename F>
+  void for_each(F&& f) const {
+    for (size_t word = 0; word < m_data.size(); word++) {
+      u64 bits = m_data[word];
+      while (bits) {
+        f(int(word * 64 + count_trailing_zeros_u64(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+
   /*!
    * The size is (maximum value we can access with operator[] without resizing) - 1
    */
@@ -113,7 +150,7 @@ class IRegSet {
     make_max_size(other);
 
     for (size_t i = 0; i < m_data.size(); i++) {
-      m_data.at(i) &= ~other.m_data.at(i);
+      m_data[i] &= ~other.m_data[i];
     }
   }
 
@@ -125,7 +162,7 @@ class IRegSet {
     make_max_size(other);
 
     for (size_t i = 0; i < m_data.size(); i++) {
-      m_data.at(i) |= other.m_data.at(i);
+      m_data[i] |= other.m_data[i];
     }
   }
 
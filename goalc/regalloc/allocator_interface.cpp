@@ -6,6 +6,7 @@
 #include "allocator_interface.h"
 
 #include <algorithm>
+#include <utility>
 
 #include "common/log/log.h"
 
@@ -130,17 +131,16 @@ void find_basic_blocks(ControlFlowAnalysisCache* cache, const AllocationInput& i
     cache->basic_blocks.back().is_exit = true;
   }
 
+  // the block starting at each instruction, or -1 if no block starts there.
+  std::vector<int> block_starting_at(in.instructions.size() + 1, -1);
+  for (uint32_t i = 0; i < cache->basic_blocks.size(); i++) {
+    block_starting_at.at(cache->basic_blocks[i].instr_idx.front()) = i;
+  }
+
   auto find_basic_block_to_target = [&](int instr) {
-    bool found = false;
-    uint32_t result = -1;
-    for (uint32_t i = 0; i < cache->basic_blocks.size(); i++) {
-      if (!cache->basic_blocks[i].instr_idx.empty() &&
-          cache->basic_blocks[i].instr_idx.front() == instr) {
-        ASSERT(!found);
-        found = true;
-        result = i;
-      }
-    }
+    bool found = instr >= 0 && instr < (int)block_starting_at.size() &&
+                 block_starting_at[instr] != -1;
+    uint32_t result = found ? block_starting_at[instr] : -1;
     if (!found) {
       printf("[RegAlloc Error] couldn't find basic block beginning with instr %d of %d\n", instr,
              int(in.instructions.size()));
@@ -169,31 +169,44 @@ void find_basic_blocks(ControlFlowAnalysisCache* cache, const AllocationInput& i
 }
 
 void RegAllocBasicBlock::analyze_liveliness_phase1(const std::vector<RegAllocInstr>& instructions) {
+  // the per-instruction live and dead sets are only filled in if they have been sized.
+  // linear scan only needs use and defs.
+  bool per_instr = live.size() == instr_idx.size();
   for (int i = instr_idx.size(); i-- > 0;) {
     auto ii = instr_idx.at(i);
     auto& instr = instructions.at(ii);
-    auto& lv = live.at(i);
-    auto& dd = dead.at(i);
 
-    // make all read live out
-    lv.clear();
-    for (auto& x : instr.read) {
-      lv.insert(x.id);
+    if (per_instr) {
+      auto& lv = live.at(i);
+      auto& dd = dead.at(i);
+
+      // make all read live out
+      lv.clear();
+      for (auto& x : instr.read) {
+        lv.insert(x.id);
+      }
+
+      // kill things which are overwritten
+      dd.clear();
+      for (auto& x : instr.write) {
+        if (!lv[x.id]) {
+          dd.insert(x.id);
+        }
+      }
     }
 
-    // kill things which are overwritten
-    dd.clear();
+    // use = (use & !dd) | lv and defs = (defs & !lv) | dd.
+    // lv and dd only have the iregs used by this instruction, so just update those.
     for (auto& x : instr.write) {
-      if (!lv[x.id]) {
-        dd.insert(x.id);
+      if (!instr.reads(x.id)) {
+        use.erase(x.id);
+        defs.insert(x.id);
       }
     }
-
-    use.bitwise_and_not(dd);
-    use.bitwise_or(lv);
-
-    defs.bitwise_and_not(lv);
-    defs.bitwise_or(dd);
+    for (auto& x : instr.read) {
+      use.insert(x.id);
+      defs.erase(x.id);
+    }
   }
 }
 
@@ -229,16 +242,19 @@ void RegAllocBasicBlock::analyze_liveliness_phase3(std::vector<RegAllocBasicBloc
     live_local.bitwise_or(blocks.at(s).input);
   }
 
+  // reuse the same sets for each instruction, rather than allocating new ones.
+  IRegSet new_live;
   for (int i = instr_idx.size(); i-- > 0;) {
     auto& lv = live.at(i);
     auto& dd = dead.at(i);
 
-    IRegSet new_live = live_local;
-    new_live.bitwise_and_not(dd);
-    new_live.bitwise_or(lv);
+    // new_live = (live_local & !dd) | lv, where dd and lv are small.
+    new_live = live_local;
+    dd.for_each([&](int x) { new_live.erase(x); });
+    lv.for_each([&](int x) { new_live.insert(x); });
 
     lv = live_local;
-    live_local = new_live;
+    std::swap(live_local, new_live);
   }
 }
 
@@ -165,6 +165,8 @@ struct AllocationInput {
   std::string function_name;
 
   int allocator_version = 1;
+  // pick registers with linear scan instead of the usual passes. This is faster, but spills more.
+  bool linear_scan = false;
 
   struct {
     bool print_input = false;
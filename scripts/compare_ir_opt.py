@@ -0,0 +1,84 @@
+# this script builds all of the game code at two values of the compiler's ir-opt-level setting
+# and compares the object files and compiler stats.
+#
+# The object files from each build are kept in out/<game>/obj-opt<level>. To compare frame times,
+# copy one of those over out/<game>/obj, boot the game, and check the frame time with the in-game
+# profiler, then do the same with the other.
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+
+def build(goalc, proj_path, game, level):
+	obj_dir = os.path.join(proj_path, "out", game, "obj")
+	# the object cache is keyed by the setting, but turn it off anyway so both builds do all the work.
+	cmd = "(begin (set-config! ir-opt-level {}) (set-config! object-cache #f) (make-group \"all-code\") (print-debug-compiler-stats))".format(level)
+	result = subprocess.run([goalc, "-g", game, "--proj-path", proj_path, "-c", cmd],
+		stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+	if result.returncode != 0:
+		print(result.stdout)
+		raise RuntimeError("build at ir-opt-level {} failed".format(level))
+
+	kept_dir = os.path.join(proj_path, "out", game, "obj-opt{}".format(level))
+	shutil.rmtree(kept_dir, ignore_errors=True)
+	shutil.copytree(obj_dir, kept_dir)
+
+	stats = dict()
+	for line in result.stdout.splitlines():
+		m = re.match("(Spill operations \\(total\\)|Eliminated moves|Register allocation time \\(all threads\\)|IR optimizer): (.*)", line)
+		if m:
+			stats[m.group(1)] = m.group(2)
+	return kept_dir, stats
+
+def object_sizes(obj_dir):
+	sizes = dict()
+	for name in os.listdir(obj_dir):
+		if name.endswith(".o"):
+			sizes[name] = os.path.getsize(os.path.join(obj_dir, name))
+	return sizes
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--goalc", required = True, help = "Path to the goalc executable.")
+	parser.add_argument("--proj-path", default = ".", help = "Path to the jak-project folder.")
+	parser.add_argument("--game", default = "jak1")
+	parser.add_argument("--a", type = int, default = 0, help = "First ir-opt-level.")
+	parser.add_argument("--b", type = int, default = 2, help = "Second ir-opt-level.")
+	parser.add_argument("--rows", type = int, default = 20, help = "Number of files to list.")
+	args = parser.parse_args()
+
+	proj_path = os.path.abspath(args.proj_path)
+	dir_a, stats_a = build(args.goalc, proj_path, args.game, args.a)
+	dir_b, stats_b = build(args.goalc, proj_path, args.game, args.b)
+
+	for key in stats_a:
+		print("{}:".format(key))
+		print("  level {}: {}".format(args.a, stats_a[key]))
+		print("  level {}: {}".format(args.b, stats_b.get(key, "")))
+
+	sizes_a = object_sizes(dir_a)
+	sizes_b = object_sizes(dir_b)
+	total_a = sum(sizes_a.values())
+	total_b = sum(sizes_b.values())
+	print("Object file bytes: {} -> {} ({:+.2f}%)".format(total_a, total_b, 100.0 * (total_b - total_a) / total_a))
+
+	diffs = []
+	for name, size_a in sizes_a.items():
+		if name in sizes_b:
+			diffs.append((sizes_b[name] - size_a, name, size_a, sizes_b[name]))
+	diffs.sort()
+	print("-----------------------------------")
+	print("Files that got the most smaller:")
+	for diff, name, size_a, size_b in diffs[:args.rows]:
+		print("{}, {} -> {} ({:+})".format(name, size_a, size_b, diff))
+	print("-----------------------------------")
+	print("Files that got larger:")
+	for diff, name, size_a, size_b in reversed(diffs):
+		if diff <= 0:
+			break
+		print("{}, {} -> {} ({:+})".format(name, size_a, size_b, diff))
+
+if __name__ == "__main__":
+	main()
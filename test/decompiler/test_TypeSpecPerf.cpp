@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "common/util/Timer.h"
+
+#include "decompiler/util/DecompilerTypeSystem.h"
+#include "gtest/gtest.h"
+
+#include "third-party/fmt/core.h"
+
+using namespace decompiler;
+
+namespace {
+std::vector<TypeSpec> all_typespecs(DecompilerTypeSystem& dts) {
+  auto names = dts.ts.get_all_type_names();
+  std::sort(names.begin(), names.end());
+  std::vector<TypeSpec> result;
+  for (const auto& name : names) {
+    // skip object, none, and special types like _varargs_, these can't be used with lca.
+    if (dts.ts.lookup_type(name)->has_parent()) {
+      result.push_back(dts.ts.make_typespec(name));
+    }
+  }
+  return result;
+}
+}  // namespace
+
+TEST(TypeSpecPerf, InternedNames) {
+  EXPECT_EQ(TypeSpec("vector").base_type_name(), TypeName::intern("vector"));
+  EXPECT_NE(TypeSpec("vector").base_type_id(), TypeSpec("matrix").base_type_id());
+  EXPECT_EQ(TypeSpec().base_type(), "");
+  EXPECT_EQ(TypeSpec("pointer", {TypeSpec("uint8")}).print(), "(pointer uint8)");
+
+  TypeSpec moved("pointer", {TypeSpec("uint8")});
+  TypeSpec target = std::move(moved);
+  EXPECT_EQ(target.print(), "(pointer uint8)");
+}
+
+TEST(TypeSpecPerf, LcaAndTypecheckAgree) {
+  DecompilerTypeSystem dts(GameVersion::Jak1);
+  dts.parse_type_defs({"decompiler", "config", "jak1", "all-types.gc"});
+  auto types = all_typespecs(dts);
+  std::vector<TypeSpec> common = {TypeSpec("object"),  TypeSpec("basic"),   TypeSpec("structure"),
+                                  TypeSpec("process"), TypeSpec("int"),     TypeSpec("float"),
+                                  TypeSpec("vector"),  TypeSpec("uint128"), TypeSpec("none")};
+
+  for (const auto& a : types) {
+    for (const auto& b : common) {
+      auto lca = dts.ts.lowest_common_ancestor(a, b);
+      EXPECT_EQ(lca, dts.ts.lowest_common_ancestor(b, a));
+      if (lca != TypeSpec("none")) {
+        EXPECT_TRUE(dts.ts.tc(lca, a));
+        EXPECT_TRUE(dts.ts.tc(lca, b));
+      }
+    }
+  }
+}
+
+// Times the type system operations used by the decompiler's type pass.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=TypeSpecPerf.*
+TEST(TypeSpecPerf, DISABLED_Benchmark) {
+  for (auto game : {"jak1", "jak2"}) {
+    Timer parse_timer;
+    parse_timer.start(false);
+    DecompilerTypeSystem dts(game == std::string("jak1") ? GameVersion::Jak1 : GameVersion::Jak2);
+    dts.parse_type_defs({"decompiler", "config", game, "all-types.gc"});
+    double parse_ms = parse_timer.getMs();
+
+    auto types = all_typespecs(dts);
+
+    Timer tc_timer;
+    tc_timer.start(false);
+    int tc_count = 0;
+    for (const auto& a : types) {
+      for (const auto& b : types) {
+        tc_count += dts.ts.tc(a, b);
+      }
+    }
+    double tc_ms = tc_timer.getMs();
+
+    Timer lca_timer;
+    lca_timer.start(false);
+    size_t lca_hash = 0;
+    for (const auto& a : types) {
+      for (const auto& b : types) {
+        lca_hash += dts.ts.lowest_common_ancestor(a, b).base_type_id();
+      }
+    }
+    double lca_ms = lca_timer.getMs();
+
+    size_t pairs = types.size() * types.size();
+    fmt::print("{}: parse all-types.gc {:.1f} ms, {} types\n", game, parse_ms, types.size());
+    fmt::print("  tc:  {:.1f} ms for {} pairs ({:.1f} ns each, {} passed)\n", tc_ms, pairs,
+               tc_ms * 1e6 / pairs, tc_count);
+    fmt::print("  lca: {:.1f} ms for {} pairs ({:.1f} ns each, {})\n", lca_ms, pairs,
+               lca_ms * 1e6 / pairs, lca_hash);
+  }
+}
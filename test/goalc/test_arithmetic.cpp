@@ -142,7 +142,11 @@ class ArithmeticTests : public testing::TestWithParam<IntegerParam> {
   }
 
   // You can define per-test tear-down logic as usual.
-  void TearDown() {}
+  // The compiler is shared, so put back any settings a test changed, even if it failed.
+  void TearDown() {
+    compiler->run_front_end_on_string("(set-config! ir-opt-level 0)");
+    compiler->run_front_end_on_string("(set-config! linear-scan-regalloc #f)");
+  }
 
   // Common Resources Across all Tests in the Suite
   static std::unique_ptr<std::thread> runtime_thread;
@@ -294,4 +298,34 @@ TEST_F(ArithmeticTests, DivideSigns) {
 
 TEST_F(ArithmeticTests, ModUnsigned) {
   runner->run_static_test(env, testCategory, "mod-unsigned.static.gc", {"ffffffffffffffff 5\n0\n"});
+}
+
+TEST_F(ArithmeticTests, IROptimizer) {
+  // some of the tests above again, with the IR optimizer turned on.
+  compiler->run_front_end_on_string("(set-config! ir-opt-level 2)");
+  runner->run_static_test(env, testCategory, "shiftvs.static.gc", {"11\n"});
+  runner->run_static_test(env, testCategory, "subtract-let.static.gc", {"3\n"});
+  runner->run_static_test(env, testCategory, "multiply-let.static.gc", {"3\n"});
+  runner->run_static_test(env, testCategory, "nested-function.static.gc", {"10\n"});
+  runner->run_static_test(env, testCategory, "signed-int-compare.static.gc", {"12\n"});
+  runner->run_static_test(env, testCategory, "divide-signs.static.gc",
+                          {"fffffffffffffffb 7ffffffffffffffb fffffffffffffffd 55555552\n0\n"});
+}
+
+TEST_F(ArithmeticTests, LinearScanRegalloc) {
+  // some of the tests above again, with the linear scan register allocator. These cover fixed
+  // registers for shifts and division, calls, and floats.
+  compiler->run_front_end_on_string("(set-config! linear-scan-regalloc #t)");
+  runner->run_static_test(env, testCategory, "add-function.static.gc", {"21\n"});
+  runner->run_static_test(env, testCategory, "multiply64.static.gc", {"93270638141856400\n"});
+  runner->run_static_test(env, testCategory, "shiftvs.static.gc", {"11\n"});
+  runner->run_static_test(env, testCategory, "nested-function.static.gc", {"10\n"});
+  runner->run_static_test(env, testCategory, "signed-int-compare.static.gc", {"12\n"});
+  runner->run_static_test(env, testCategory, "divide-signs.static.gc",
+                          {"fffffffffffffffb 7ffffffffffffffb fffffffffffffffd 55555552\n0\n"});
+  runner->run_static_test(env, testCategory, "mod-unsigned.static.gc", {"ffffffffffffffff 5\n0\n"});
+  runner->run_static_test(env, testCategory, "float-product.static.gc", {"120.0000\n0\n"});
+  runner->run_static_test(
+      env, testCategory, "nested-float-functions.static.gc",
+      {"i 1.4400 3.4000\nr 10.1523\ni 1.2000 10.1523\nr 17.5432\n17.543 10.152\n0\n"});
 }
\ No newline at end of file
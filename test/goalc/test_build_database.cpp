@@ -0,0 +1,135 @@
+#include "common/util/FileUtil.h"
+
+#include "goalc/make/BuildDatabase.h"
+#include "gtest/gtest.h"
+
+namespace {
+class BuildDatabaseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_dir = fs::temp_directory_path() / "build-database-test";
+    fs::remove_all(m_dir);
+    fs::create_directories(m_dir);
+    m_input = (m_dir / "input.gc").string();
+    m_output = (m_dir / "output.o").string();
+    m_db_path = m_dir / "build-db.json";
+  }
+
+  void TearDown() override { fs::remove_all(m_dir); }
+
+  // write a file with a timestamp old enough that the database trusts it.
+  void write(const std::string& path, const std::string& contents, int hours_ago = 1) {
+    file_util::write_text_file(path, contents);
+    fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(hours_ago));
+  }
+
+  // run the step in a fresh database, like a new make would.
+  std::optional<std::string> check(BuildDatabase& db) {
+    db.load(m_db_path);
+    db.begin_run();
+    return db.stale_reason(m_output, db.snapshot({m_input}, 0), {m_output});
+  }
+
+  void build() {
+    BuildDatabase db;
+    db.load(m_db_path);
+    db.begin_run();
+    auto record = db.snapshot({m_input}, 0);
+    write(m_output, "built from " + file_util::read_text_file(m_input));
+    db.commit(m_output, std::move(record), {m_output});
+    db.save();
+  }
+
+  fs::path m_dir;
+  std::string m_input;
+  std::string m_output;
+  fs::path m_db_path;
+};
+}  // namespace
+
+TEST_F(BuildDatabaseTest, UpToDateAfterBuild) {
+  write(m_input, "(defun foo () 1)");
+  BuildDatabase db;
+  EXPECT_EQ(check(db), "never built");
+  build();
+  BuildDatabase db2;
+  EXPECT_EQ(check(db2), std::nullopt);
+}
+
+TEST_F(BuildDatabaseTest, TimestampChangeOnly) {
+  write(m_input, "(defun foo () 1)", 3);
+  build();
+  // same contents, different timestamp: the file is hashed again, and nothing needs to run.
+  write(m_input, "(defun foo () 1)", 2);
+  BuildDatabase db;
+  EXPECT_EQ(check(db), std::nullopt);
+}
+
+TEST_F(BuildDatabaseTest, ContentsChange) {
+  write(m_input, "(defun foo () 1)");
+  build();
+  write(m_input, "(defun foo () 2)", 2);
+  BuildDatabase db;
+  EXPECT_EQ(check(db), m_input + " changed");
+}
+
+TEST_F(BuildDatabaseTest, OutputMissing) {
+  write(m_input, "(defun foo () 1)");
+  build();
+  fs::remove(m_output);
+  BuildDatabase db;
+  EXPECT_EQ(check(db), m_output + " is missing");
+}
+
+TEST_F(BuildDatabaseTest, OutputModified) {
+  write(m_input, "(defun foo () 1)");
+  build();
+  write(m_output, "something else", 2);
+  BuildDatabase db;
+  EXPECT_EQ(check(db), m_output + " was modified");
+}
+
+TEST_F(BuildDatabaseTest, HashOncePerRun) {
+  write(m_input, "(defun foo () 1)");
+  BuildDatabase db;
+  db.load(m_db_path);
+  db.begin_run();
+  auto first = db.file_hash(m_input);
+  write(m_input, "(defun foo () 2)", 2);
+  // the file was already checked in this make.
+  EXPECT_EQ(db.file_hash(m_input), first);
+  db.begin_run();
+  EXPECT_NE(db.file_hash(m_input), first);
+}
+
+TEST_F(BuildDatabaseTest, CommitRehashesOutputs) {
+  write(m_input, "(defun foo () 1)");
+  write(m_output, "old output");
+  BuildDatabase db;
+  db.load(m_db_path);
+  db.begin_run();
+  auto old_hash = db.file_hash(m_output);
+  auto record = db.snapshot({m_input}, 0);
+  write(m_output, "new output", 2);
+  db.commit(m_output, std::move(record), {m_output});
+  EXPECT_NE(db.file_hash(m_output), old_hash);
+  EXPECT_EQ(db.stale_reason(m_output, db.snapshot({m_input}, 0), {m_output}), std::nullopt);
+}
+
+TEST_F(BuildDatabaseTest, DropsDeletedFiles) {
+  auto other = (m_dir / "other.gc").string();
+  write(m_input, "(defun foo () 1)");
+  write(other, "(defun bar () 1)");
+  {
+    BuildDatabase db;
+    db.load(m_db_path);
+    db.begin_run();
+    db.file_hash(other);
+    db.save();
+  }
+  EXPECT_NE(file_util::read_text_file(m_db_path).find("other.gc"), std::string::npos);
+
+  fs::remove(other);
+  build();
+  EXPECT_EQ(file_util::read_text_file(m_db_path).find("other.gc"), std::string::npos);
+}
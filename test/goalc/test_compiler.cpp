@@ -1,3 +1,5 @@
+#include "common/util/FileUtil.h"
+
 #include "goalc/compiler/Compiler.h"
 #include "gtest/gtest.h"
 
@@ -5,3 +7,75 @@ TEST(CompilerAndRuntime, ConstructCompiler) {
   Compiler compiler1(GameVersion::Jak1);
   Compiler compiler2(GameVersion::Jak2);
 }
+
+namespace {
+CompilationOptions options_for_source(const std::string& name, const std::string& source) {
+  CompilationOptions options;
+  options.filename = (fs::temp_directory_path() / (name + ".gc")).string();
+  options.color = true;
+  file_util::write_text_file(options.filename, source);
+  return options;
+}
+}  // namespace
+
+TEST(CompilerAndRuntime, ObjectCacheKeepsDebugInfo) {
+  Compiler compiler(GameVersion::Jak1);
+  auto options =
+      options_for_source("object-cache-test", "(defun object-cache-test-fn ((x int)) (+ x 12))");
+  const auto& reader = compiler.get_goos().reader;
+  auto get_debug_info = [&]() {
+    return compiler.get_debugger()
+        .get_debug_info_for_object("object-cache-test")
+        .function_by_name("object-cache-test-fn");
+  };
+
+  // start with a miss, even if an earlier run left an entry.
+  fs::remove(file_util::get_jak_project_dir() / "out" / "jak1" / "obj" / "cache" /
+             "object-cache-test.json");
+  int misses = compiler.get_object_cache().misses();
+  compiler.asm_file(options);
+  EXPECT_EQ(compiler.get_object_cache().misses(), misses + 1);
+  auto first = get_debug_info();
+
+  // the second compile is the same, so it comes from the cache.
+  int hits = compiler.get_object_cache().hits();
+  compiler.asm_file(options);
+  EXPECT_EQ(compiler.get_object_cache().hits(), hits + 1);
+  EXPECT_TRUE(compiler.knows_object_file("object-cache-test"));
+  auto second = get_debug_info();
+
+  EXPECT_EQ(first.offset_in_seg, second.offset_in_seg);
+  EXPECT_EQ(first.length, second.length);
+  EXPECT_EQ(first.generated_code, second.generated_code);
+  EXPECT_EQ(first.ir_strings, second.ir_strings);
+  ASSERT_EQ(first.instructions.size(), second.instructions.size());
+  for (size_t i = 0; i < first.instructions.size(); i++) {
+    EXPECT_EQ(first.instructions[i].offset, second.instructions[i].offset);
+    EXPECT_EQ(first.instructions[i].ir_idx, second.instructions[i].ir_idx);
+  }
+  // the forms come from the second compile, so the debugger can show the source.
+  ASSERT_EQ(first.code_sources.size(), second.code_sources.size());
+  for (size_t i = 0; i < first.code_sources.size(); i++) {
+    auto first_source = reader.db.try_get_short_info(first.code_sources[i]);
+    auto second_source = reader.db.try_get_short_info(second.code_sources[i]);
+    ASSERT_TRUE(second_source);
+    EXPECT_EQ(first_source->line_text, second_source->line_text);
+    EXPECT_EQ(first_source->pos_in_line, second_source->pos_in_line);
+  }
+
+  bool ok = true;
+  EXPECT_EQ(first.disassemble_debug_info(&ok, &reader),
+            second.disassemble_debug_info(&ok, &reader));
+}
+
+TEST(CompilerAndRuntime, ObjectCachePrintAsm) {
+  Compiler compiler(GameVersion::Jak1);
+  auto options = options_for_source(
+      "object-cache-asm-test", "(defun object-cache-asm-fn ((x int)) (declare (print-asm)) x)");
+  compiler.asm_file(options);
+
+  testing::internal::CaptureStdout();
+  compiler.asm_file(options);
+  auto output = testing::internal::GetCapturedStdout();
+  EXPECT_NE(output.find("[object-cache-asm-fn]"), std::string::npos);
+}
@@ -0,0 +1,74 @@
+#include "goalc/regalloc/Allocator_v2.h"
+#include "gtest/gtest.h"
+
+namespace {
+IRegister gpr(int id) {
+  IRegister result;
+  result.reg_class = RegClass::GPR_64;
+  result.id = id;
+  return result;
+}
+
+emitter::Register reg_at(const AllocationResult& result, int var, int instr) {
+  const auto& ass = result.ass_as_ranges.at(var).get(instr);
+  EXPECT_EQ(ass.kind, Assignment::Kind::REGISTER);
+  return ass.reg;
+}
+}  // namespace
+
+TEST(Allocator, MoveCoalesced) {
+  // a = ...; b = a; use b
+  AllocationInput in;
+  in.max_vars = 2;
+  in.allocator_version = 2;
+  RegAllocInstr def_a;
+  def_a.write = {gpr(0)};
+  in.add_instruction(def_a);
+  RegAllocInstr move;
+  move.is_move = true;
+  move.read = {gpr(0)};
+  move.write = {gpr(1)};
+  in.add_instruction(move);
+  RegAllocInstr use_b;
+  use_b.read = {gpr(1)};
+  in.add_instruction(use_b);
+
+  auto result = allocate_registers_v2(in);
+  ASSERT_TRUE(result.ok);
+  EXPECT_EQ(reg_at(result, 0, 1), reg_at(result, 1, 1));
+  EXPECT_TRUE(result.used_saved_regs.empty());
+}
+
+TEST(Allocator, MoveHintDoesNotAddSavedRegister) {
+  // a can only use r9 of the temporary registers, and b can use any of them but r9. Both could
+  // share rbx, but that would need a push and pop to save one move.
+  AllocationInput in;
+  in.max_vars = 2;
+  in.allocator_version = 2;
+  RegAllocInstr def_a;
+  def_a.write = {gpr(0)};
+  in.add_instruction(def_a);
+  RegAllocInstr use_a;
+  use_a.read = {gpr(0)};
+  use_a.exclude = {emitter::R8, emitter::RCX, emitter::RDX, emitter::RSI, emitter::RDI,
+                   emitter::RAX};
+  in.add_instruction(use_a);
+  RegAllocInstr move;
+  move.is_move = true;
+  move.read = {gpr(0)};
+  move.write = {gpr(1)};
+  in.add_instruction(move);
+  RegAllocInstr use_b;
+  use_b.read = {gpr(1)};
+  use_b.exclude = {emitter::R9};
+  in.add_instruction(use_b);
+  RegAllocInstr use_b_again;
+  use_b_again.read = {gpr(1)};
+  in.add_instruction(use_b_again);
+
+  auto result = allocate_registers_v2(in);
+  ASSERT_TRUE(result.ok);
+  EXPECT_EQ(reg_at(result, 0, 1), emitter::R9);
+  EXPECT_TRUE(emitter::gRegInfo.get_info(reg_at(result, 1, 3)).temp());
+  EXPECT_TRUE(result.used_saved_regs.empty());
+}
@@ -1,14 +1,18 @@
+#include <atomic>
 #include <limits>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "common/custom_data/fr3_file.h"
 #include "common/util/Assert.h"
 #include "common/util/BitUtils.h"
 #include "common/util/CopyOnWrite.h"
 #include "common/util/FileUtil.h"
 #include "common/util/Range.h"
+#include "common/util/Serializer.h"
 #include "common/util/SmallVector.h"
+#include "common/util/ThreadPool.h"
 #include "common/util/Trie.h"
 #include "common/util/crc32.h"
 #include "common/util/json_util.h"
@@ -396,6 +400,129 @@ TEST(SmallVector, Construction) {
   EXPECT_FALSE(one.empty());
 }
 
+TEST(ThreadPool, RunsAllTasks) {
+  ThreadPool pool(4);
+  std::vector<int> results(1000);
+  ThreadPool::TaskGroup group(&pool);
+  for (int i = 0; i < (int)results.size(); i++) {
+    group.run("square", [&results, i]() { results[i] = i * i; });
+  }
+  group.wait();
+  for (int i = 0; i < (int)results.size(); i++) {
+    EXPECT_EQ(results[i], i * i);
+  }
+  EXPECT_EQ(group.timings().size(), results.size());
+}
+
+TEST(ThreadPool, NestedGroups) {
+  // more nested waits than threads, this deadlocks if waiting threads don't help.
+  ThreadPool pool(2);
+  std::atomic<int> count = 0;
+  ThreadPool::TaskGroup outer(&pool);
+  for (int i = 0; i < 8; i++) {
+    outer.run("outer", [&]() {
+      EXPECT_EQ(ThreadPool::current(), &pool);
+      parallel_for("inner", 16, [&](int) { count++; });
+    });
+  }
+  outer.wait();
+  EXPECT_EQ(count, 8 * 16);
+}
+
+TEST(ThreadPool, NoPoolRunsInline) {
+  EXPECT_EQ(ThreadPool::current(), nullptr);
+  std::vector<int> order;
+  parallel_for("serial", 5, [&](int i) { order.push_back(i); });
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+}
+
+TEST(ThreadPool, ScopedCurrentAndExceptions) {
+  ThreadPool pool(2);
+  {
+    ThreadPool::ScopedCurrent use_pool(&pool);
+    EXPECT_EQ(ThreadPool::current(), &pool);
+    std::atomic<int> count = 0;
+    parallel_for("count", 10, [&](int) { count++; });
+    EXPECT_EQ(count, 10);
+    EXPECT_THROW(parallel_for("throw", 4,
+                              [&](int i) {
+                                if (i == 2) {
+                                  throw std::runtime_error("task failed");
+                                }
+                              }),
+                 std::runtime_error);
+  }
+  EXPECT_EQ(ThreadPool::current(), nullptr);
+}
+
+TEST(Serializer, BorrowAndPodVectors) {
+  std::vector<u32> words = {1, 2, 3, 4, 5};
+  std::string str = "hello";
+  Serializer saver;
+  saver.save<u8>(7);  // so the next vector is unaligned in the buffer
+  saver.from_pod_vector(&words);
+  saver.save_str(&str);
+  auto saved = saver.get_save_result();
+
+  for (auto ownership : {Serializer::Ownership::COPY, Serializer::Ownership::BORROW}) {
+    Serializer loader(saved.first, saved.second, ownership);
+    EXPECT_EQ(loader.load<u8>(), 7);
+    std::vector<u32> loaded_words;
+    loader.from_pod_vector(&loaded_words);
+    EXPECT_EQ(loaded_words, words);
+    EXPECT_EQ(loader.load_string(), str);
+    EXPECT_TRUE(loader.get_load_finished());
+  }
+}
+
+TEST(Fr3File, SectionedRoundTrip) {
+  tfrag3::Level level;
+  level.level_name = "test-level";
+  for (int i = 0; i < 10; i++) {
+    auto& tex = level.textures.emplace_back();
+    tex.w = 512;
+    tex.h = 512;
+    tex.combo_id = i;
+    tex.debug_name = fmt::format("tex-{}", i);
+    tex.data.resize(tex.w * tex.h, i);
+  }
+  level.tfrag_trees[1].emplace_back().colors.resize(3);
+  level.tfrag_trees[1].emplace_back().kind = tfrag3::TFragmentTreeKind::WATER;
+  level.tie_trees[3].emplace_back().colors.resize(5);
+  level.collision.vertices.resize(7);
+  level.merc_data.models.emplace_back().name = "merc-model";
+
+  auto v1_bytes = [](tfrag3::Level& lev) {
+    Serializer ser;
+    lev.serialize(ser);
+    auto result = ser.get_save_result();
+    return std::vector<u8>(result.first, result.first + result.second);
+  };
+
+  auto file = tfrag3::write_fr3(level, {});
+  tfrag3::Fr3Reader reader(file.data(), file.size());
+  EXPECT_TRUE(reader.is_sectioned());
+  // 10 textures (3 batches), 3 trees, collision, merc
+  EXPECT_EQ(reader.sections().size(), 8);
+
+  // load the sections in reverse, they shouldn't depend on each other.
+  tfrag3::Level loaded;
+  reader.load_info(&loaded);
+  for (auto it = reader.sections().rbegin(); it != reader.sections().rend(); ++it) {
+    reader.load_section(*it, &loaded);
+  }
+  EXPECT_EQ(v1_bytes(loaded), v1_bytes(level));
+
+  // old files still load
+  auto old_bytes = v1_bytes(level);
+  auto old_file = compression::compress_zstd(old_bytes.data(), old_bytes.size());
+  tfrag3::Fr3Reader old_reader(old_file.data(), old_file.size());
+  EXPECT_FALSE(old_reader.is_sectioned());
+  tfrag3::Level old_loaded;
+  old_reader.load_all(&old_loaded);
+  EXPECT_EQ(v1_bytes(old_loaded), old_bytes);
+}
+
 #ifndef NO_ASSERT
 TEST(Assert, Death) {
   EXPECT_DEATH(private_assert_failed("foo", "bar", 12, "aaa"), "");
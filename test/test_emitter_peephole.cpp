@@ -0,0 +1,227 @@
+#include <functional>
+
+#include "common/type_system/TypeSystem.h"
+
+#include "goalc/debugger/DebugInfo.h"
+#include "goalc/emitter/CodeTester.h"
+#include "goalc/emitter/IGen.h"
+#include "goalc/emitter/ObjectGenerator.h"
+#include "gtest/gtest.h"
+
+using namespace emitter;
+
+namespace {
+/*!
+ * Generates a single function, with or without the peephole pass.
+ */
+class PeepholeTester {
+ public:
+  explicit PeepholeTester(bool peephole) : m_gen(GameVersion::Jak1), m_debug("peephole-test") {
+    m_ts.add_builtin_types(GameVersion::Jak1);
+    m_func = m_gen.add_function_to_seg(MAIN_SEGMENT, &m_debug.add_function("f", "peephole-test"));
+    if (peephole) {
+      m_gen.allow_peephole(m_func);
+    }
+  }
+
+  IR_Record ir() { return m_gen.add_ir(m_func); }
+  IR_Record future_ir(int id) { return m_gen.get_future_ir_record(m_func, id); }
+  ObjectGenerator& gen() { return m_gen; }
+
+  std::vector<u8> generate() {
+    m_gen.generate_data_v3(&m_ts);
+    return m_debug.function_by_name("f").generated_code;
+  }
+
+ private:
+  TypeSystem m_ts;
+  ObjectGenerator m_gen;
+  DebugInfo m_debug;
+  FunctionRecord m_func;
+};
+
+std::vector<u8> encode(const std::vector<Instruction>& instrs) {
+  std::vector<u8> result;
+  for (auto& instr : instrs) {
+    u8 buffer[16];
+    int len = instr.emit(buffer);
+    result.insert(result.end(), buffer, buffer + len);
+  }
+  return result;
+}
+
+/*!
+ * Add each instruction as its own IR, run the peephole pass, and check the output and stats.
+ */
+void check_simplified(const std::vector<Instruction>& in,
+                      const std::vector<Instruction>& expected,
+                      int removed,
+                      int replaced) {
+  PeepholeTester tester(true);
+  for (auto& instr : in) {
+    tester.gen().add_instr(instr, tester.ir());
+  }
+  EXPECT_EQ(tester.generate(), encode(expected));
+  auto stats = tester.gen().get_stats();
+  EXPECT_EQ(stats.peephole_removed, removed);
+  EXPECT_EQ(stats.peephole_replaced, replaced);
+  EXPECT_EQ(stats.peephole_bytes_saved, int(encode(in).size() - encode(expected).size()));
+}
+
+/*!
+ * Build the same function with and without the peephole pass and check that nothing changed.
+ */
+void check_unchanged(const std::function<void(PeepholeTester&)>& build) {
+  PeepholeTester with(true), without(false);
+  build(with);
+  build(without);
+  EXPECT_EQ(with.generate(), without.generate());
+  auto stats = with.gen().get_stats();
+  EXPECT_EQ(stats.peephole_removed, 0);
+  EXPECT_EQ(stats.peephole_replaced, 0);
+}
+}  // namespace
+
+TEST(EmitterPeephole, MoveToSelf) {
+  check_simplified({IGen::mov_gpr64_gpr64(RAX, RAX), IGen::mov_gpr64_gpr64(RBX, RAX),
+                    IGen::mov_vf_vf(XMM3, XMM3), IGen::ret()},
+                   {IGen::mov_gpr64_gpr64(RBX, RAX), IGen::ret()}, 2, 0);
+}
+
+TEST(EmitterPeephole, StackSlotGpr) {
+  check_simplified({IGen::store64_gpr64_plus_s32(RSP, 8, RAX),
+                    IGen::load64_gpr64_plus_s32(RBX, 8, RSP), IGen::ret()},
+                   {IGen::store64_gpr64_plus_s32(RSP, 8, RAX), IGen::mov_gpr64_gpr64(RBX, RAX),
+                    IGen::ret()},
+                   0, 1);
+  check_simplified({IGen::store64_gpr64_plus_s32(RSP, 8, RAX),
+                    IGen::load64_gpr64_plus_s32(RAX, 8, RSP), IGen::ret()},
+                   {IGen::store64_gpr64_plus_s32(RSP, 8, RAX), IGen::ret()}, 1, 0);
+}
+
+TEST(EmitterPeephole, StackSlotXmm32) {
+  check_simplified({IGen::store_reg_offset_xmm32(RSP, XMM1, 16),
+                    IGen::load_reg_offset_xmm32(XMM2, RSP, 16), IGen::ret()},
+                   {IGen::store_reg_offset_xmm32(RSP, XMM1, 16), IGen::mov_xmm32_xmm32(XMM2, XMM1),
+                    IGen::ret()},
+                   0, 1);
+}
+
+TEST(EmitterPeephole, StackSlotXmm128) {
+  check_simplified({IGen::store128_xmm128_reg_offset(RSP, XMM1, 32),
+                    IGen::load128_xmm128_reg_offset(XMM9, RSP, 32), IGen::ret()},
+                   {IGen::store128_xmm128_reg_offset(RSP, XMM1, 32), IGen::mov_vf_vf(XMM9, XMM1),
+                    IGen::ret()},
+                   0, 1);
+}
+
+TEST(EmitterPeephole, StackSlotMismatch) {
+  // different slots, or a different kind of access to the same slot.
+  check_simplified({IGen::store64_gpr64_plus_s32(RSP, 8, RAX),
+                    IGen::load64_gpr64_plus_s32(RBX, 16, RSP),
+                    IGen::store_reg_offset_xmm32(RSP, XMM1, 16),
+                    IGen::load128_xmm128_reg_offset(XMM2, RSP, 16), IGen::ret()},
+                   {IGen::store64_gpr64_plus_s32(RSP, 8, RAX),
+                    IGen::load64_gpr64_plus_s32(RBX, 16, RSP),
+                    IGen::store_reg_offset_xmm32(RSP, XMM1, 16),
+                    IGen::load128_xmm128_reg_offset(XMM2, RSP, 16), IGen::ret()},
+                   0, 0);
+}
+
+TEST(EmitterPeephole, SymbolLoadedTwice) {
+  auto st = gRegInfo.get_st_reg();
+  auto off = gRegInfo.get_offset_reg();
+  PeepholeTester tester(true);
+  auto first = IGen::load32u_gpr64_gpr64_plus_gpr64_plus_s32(RAX, st, off, 0);
+  auto second = IGen::load32u_gpr64_gpr64_plus_gpr64_plus_s32(RBX, st, off, 0);
+  tester.gen().link_instruction_symbol_mem(tester.gen().add_instr(first, tester.ir()), "foo");
+  tester.gen().link_instruction_symbol_mem(tester.gen().add_instr(second, tester.ir()), "foo");
+  tester.gen().add_instr(IGen::ret(), tester.ir());
+  EXPECT_EQ(tester.generate(), encode({first, IGen::mov_gpr64_gpr64(RBX, RAX), IGen::ret()}));
+  EXPECT_EQ(tester.gen().get_stats().peephole_replaced, 1);
+}
+
+TEST(EmitterPeephole, DifferentSymbols) {
+  auto st = gRegInfo.get_st_reg();
+  auto off = gRegInfo.get_offset_reg();
+  check_unchanged([&](PeepholeTester& tester) {
+    auto& gen = tester.gen();
+    gen.link_instruction_symbol_mem(
+        gen.add_instr(IGen::load32u_gpr64_gpr64_plus_gpr64_plus_s32(RAX, st, off, 0), tester.ir()),
+        "foo");
+    gen.link_instruction_symbol_mem(
+        gen.add_instr(IGen::load32u_gpr64_gpr64_plus_gpr64_plus_s32(RBX, st, off, 0), tester.ir()),
+        "bar");
+    gen.add_instr(IGen::ret(), tester.ir());
+  });
+}
+
+TEST(EmitterPeephole, JumpToNext) {
+  PeepholeTester tester(true);
+  auto& gen = tester.gen();
+  auto ir0 = tester.ir();
+  gen.link_instruction_jump(gen.add_instr(IGen::jmp_32(), ir0), tester.future_ir(1));
+  gen.add_instr(IGen::ret(), tester.ir());
+  EXPECT_EQ(tester.generate(), encode({IGen::ret()}));
+  EXPECT_EQ(gen.get_stats().peephole_removed, 1);
+}
+
+TEST(EmitterPeephole, InvertJcc) {
+  // return arg0 == 0 ? 3 : 2
+  CodeTester code;
+  auto arg = code.get_c_abi_arg_reg(0);
+  auto build = [&](PeepholeTester& tester) {
+    auto& gen = tester.gen();
+    auto ir0 = tester.ir();
+    gen.add_instr(IGen::mov_gpr64_u32(RAX, 0), ir0);
+    gen.add_instr(IGen::cmp_gpr64_gpr64(arg, RAX), ir0);
+    gen.link_instruction_jump(gen.add_instr(IGen::jne_32(), ir0), tester.future_ir(1));
+    gen.link_instruction_jump(gen.add_instr(IGen::jmp_32(), ir0), tester.future_ir(2));
+    auto ir1 = tester.ir();
+    gen.add_instr(IGen::mov_gpr64_u32(RAX, 2), ir1);
+    gen.add_instr(IGen::ret(), ir1);
+    auto ir2 = tester.ir();
+    gen.add_instr(IGen::mov_gpr64_u32(RAX, 3), ir2);
+    gen.add_instr(IGen::ret(), ir2);
+  };
+
+  PeepholeTester with(true), without(false);
+  build(with);
+  build(without);
+  auto simplified = with.generate();
+  auto original = without.generate();
+  EXPECT_EQ(simplified.size() + IGen::jmp_32().length(), original.size());
+  EXPECT_EQ(with.gen().get_stats().peephole_removed, 1);
+
+  for (auto* bytes : {&original, &simplified}) {
+    code.init_code_buffer(256);
+    for (auto b : *bytes) {
+      code.emit_data<u8>(b);
+    }
+    EXPECT_EQ(code.execute(0, 0, 0, 0), 3);
+    EXPECT_EQ(code.execute(7, 0, 0, 0), 2);
+  }
+}
+
+TEST(EmitterPeephole, SecondIsJumpTarget) {
+  check_unchanged([](PeepholeTester& tester) {
+    auto& gen = tester.gen();
+    gen.add_instr(IGen::store64_gpr64_plus_s32(RSP, 8, RAX), tester.ir());
+    auto load = tester.ir();
+    gen.add_instr(IGen::load64_gpr64_plus_s32(RBX, 8, RSP), load);
+    gen.link_instruction_jump(gen.add_instr(IGen::jmp_32(), tester.ir()), load);
+    gen.add_instr(IGen::ret(), tester.ir());
+  });
+}
+
+TEST(EmitterPeephole, SecondHasRipLink) {
+  check_unchanged([](PeepholeTester& tester) {
+    auto& gen = tester.gen();
+    auto data = gen.add_static_to_seg(MAIN_SEGMENT);
+    gen.get_static_data(data).resize(16);
+    gen.add_instr(IGen::store64_gpr64_plus_s32(RSP, 8, RAX), tester.ir());
+    auto load = gen.add_instr(IGen::load64_gpr64_plus_s32(RBX, 8, RSP), tester.ir());
+    gen.link_instruction_static(load, data, 0);
+    gen.add_instr(IGen::ret(), tester.ir());
+  });
+}
@@ -4,6 +4,7 @@
  */
 
 #include "common/goos/Interpreter.h"
+#include "common/goos/ObjectSerializer.h"
 
 #include "gtest/gtest.h"
 
@@ -855,6 +856,41 @@ TEST(GoosIntegrated, WhileLoop) {
             "4950");
 }
 
+/*!
+ * Lambda and macro bodies are compiled when they are first called, check that they still behave
+ * like the interpreter.
+ */
+TEST(GoosIntegrated, CompiledBodies) {
+  Interpreter i;
+  e(i, R"(
+(desfun compiled-test (a &key (b (+ 2 2)) &rest c)
+  (define total 0)
+  (while (< total a)
+    (set! total (+ total 1)))
+  (cond ((and (> total 10) (or #f b)) `(big ,total ,@c))
+        (#t `(small (,b) ,@c done))))
+)");
+  EXPECT_EQ(e(i, "(compiled-test 3 4 5)"), "(small (4) 4 5 done)");
+  EXPECT_EQ(e(i, "(compiled-test 3 :b 7)"), "(small (7) done)");
+  EXPECT_EQ(e(i, "(compiled-test 12 1 2)"), "(big 12 1 2)");
+
+  // macros used in a body are expanded again if they are redefined.
+  e(i, "(defsmacro scale (x) `(* 2 ,x))");
+  e(i, "(desfun use-scale (y) (scale y))");
+  EXPECT_EQ(e(i, "(use-scale 3)"), "6");
+  e(i, "(defsmacro scale (x) `(* 3 ,x))");
+  EXPECT_EQ(e(i, "(use-scale 3)"), "9");
+
+  // bad code is only an error when it runs.
+  e(i, "(desfun bad-code (x) (if x (cond) 1))");
+  EXPECT_EQ(e(i, "(bad-code #f)"), "1");
+  i.disable_printfs();
+  for (const auto& x : {"(bad-code #t)", "(bad-code)", "(bad-code 1 2)", "(use-scale :y 2)",
+                        "(compiled-test 1 :b)"}) {
+    EXPECT_ANY_THROW(e(i, x));
+  }
+}
+
 TEST(GoosLib, Desfun) {
   Interpreter i;
   EXPECT_EQ(e(i, R"(
@@ -1329,4 +1365,53 @@ TEST(GoosBuiltins, HashTable) {
   EXPECT_EQ(e(i, "(cdr (hash-table-try-ref ht \"foo\"))"), "123");
   e(i, "(hash-table-set! ht \"foo\" 456)");
   EXPECT_EQ(e(i, "(cdr (hash-table-try-ref ht \"foo\"))"), "456");
-}
\ No newline at end of file
+}
+TEST(GoosSerialize, RoundTrip) {
+  Interpreter i;
+  // the lambdas refer to the environments they were defined in, which refer back to them.
+  e(i, "(define double (lambda (x) (* x 2)))");
+  e(i, "(define make-adder (lambda (n) (lambda (x) (+ x n))))");
+  e(i, "(define add3 (make-adder 3))");
+  e(i, "(define shared (cons 1 2))");
+  e(i, "(define two-refs (cons shared shared))");
+  e(i, "(define loop (cons 1 (cons 2 '())))");
+  e(i, "(begin (set-cdr! (cdr loop) loop) #t)");
+  e(i, "(define ht (make-string-hash-table))");
+  e(i, "(hash-table-set! ht \"foo\" \"bar\")");
+  e(i, "(define counter 0)");
+  e(i, "(define bump (lambda () (set! counter (+ counter 1)) counter))");
+
+  Serializer saver;
+  {
+    ObjectSerializer ser(saver, i.reader);
+    i.serialize_environments(ser);
+  }
+  auto [data, size] = saver.get_save_result();
+
+  Interpreter j;
+  Serializer loader(data, size);
+  {
+    ObjectSerializer ser(loader, j.reader);
+    j.serialize_environments(ser);
+  }
+  EXPECT_TRUE(loader.get_load_finished());
+
+  EXPECT_EQ(e(j, "(double 21)"), "42");
+  EXPECT_EQ(e(j, "(add3 4)"), "7");
+  EXPECT_EQ(e(j, "(cdr (hash-table-try-ref ht \"foo\"))"), "\"bar\"");
+
+  // shared objects are still shared, and cycles are kept. eq? compares pairs by value, so check
+  // by changing one reference and looking at the other.
+  e(j, "(begin (set-car! (car two-refs) 10) #t)");
+  EXPECT_EQ(e(j, "(car (cdr two-refs))"), "10");
+  EXPECT_EQ(e(j, "(car shared)"), "10");
+  EXPECT_EQ(e(j, "(car (cdr (cdr (cdr loop))))"), "2");
+  e(j, "(begin (set-car! loop 5) #t)");
+  EXPECT_EQ(e(j, "(car (cdr (cdr loop)))"), "5");
+
+  // the loaded function still changes the loaded global, and symbols are interned in j's reader.
+  EXPECT_EQ(e(j, "(bump)"), "1");
+  EXPECT_EQ(e(j, "counter"), "1");
+  EXPECT_EQ(e(j, "(eq? 'shared (car '(shared)))"), "#t");
+  EXPECT_EQ(e(i, "counter"), "0");
+}
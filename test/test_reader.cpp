@@ -6,9 +6,12 @@
 
 #include "common/goos/Reader.h"
 #include "common/util/FileUtil.h"
+#include "common/util/Timer.h"
 
 #include "gtest/gtest.h"
 
+#include "third-party/fmt/core.h"
+
 using namespace goos;
 
 TEST(GoosReader, Construction) {
@@ -353,3 +356,46 @@ TEST(GoosReader, TextDb) {
   std::string expected = "test/test_data/test_reader_file0.gc:5\n(1 2 3 4)\n ^\n";
   EXPECT_EQ(expected, reader.db.get_info_for(result));
 }
+
+TEST(GoosReader, LongTokensAndComments) {
+  // tokens, strings and comments longer than the reader's scanning chunks.
+  Reader reader;
+  std::string long_name(100, 'a');
+  std::string long_string(100, 'b');
+  std::string text = "; " + std::string(70, ';') + "\n#| " + std::string(70, 'c') + " |# (" +
+                     long_name + " \"" + long_string + "\\n\\\"" + long_string +
+                     "\" ; trailing\n  #| a | b # |#\t3)";
+  EXPECT_EQ(reader.read_from_string(text).print(),
+            "(top-level (" + long_name + " \"" + long_string + "\n\\\"" + long_string + "\" 3))");
+
+  // line numbers are still found after skipping comments in bulk.
+  std::string bad = "; comment\n#| block\n comment |#\n(a b\n c \x01)";
+  try {
+    reader.read_from_string(bad);
+    EXPECT_TRUE(false);
+  } catch (std::runtime_error& e) {
+    EXPECT_EQ(std::string(e.what()), "Invalid character found on line 5 of Program string: 0x1");
+  }
+}
+
+// Measures how quickly the reader gets through the game source and the type definitions.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=GoosReader.*
+TEST(GoosReader, DISABLED_ReadThroughput) {
+  auto project = file_util::get_jak_project_dir();
+  auto files =
+      file_util::find_files_recursively(project / "goal_src" / "jak1", std::regex(".*\\.gc"));
+  files.push_back(project / "decompiler" / "config" / "jak1" / "all-types.gc");
+
+  Reader reader;
+  size_t bytes = 0;
+  Timer timer;
+  timer.start(false);
+  for (const auto& file : files) {
+    auto rel = fs::relative(file, project).string();
+    reader.read_from_file({rel});
+    bytes += fs::file_size(file);
+  }
+  double seconds = timer.getSeconds();
+  fmt::print("read {} files, {:.2f} MB in {:.1f} ms: {:.1f} MB/s\n", files.size(), bytes / 1.e6,
+             seconds * 1000., bytes / 1.e6 / seconds);
+}
@@ -2,6 +2,7 @@
 #include "common/goos/Reader.h"
 #include "common/type_system/TypeSystem.h"
 #include "common/type_system/deftype.h"
+#include "common/util/Serializer.h"
 
 #include "gtest/gtest.h"
 
@@ -363,6 +364,8 @@ TEST(TypeSystem, get_path_up_tree) {
   ts.add_builtin_types(GameVersion::Jak1);
   EXPECT_EQ(ts.get_path_up_tree("type"),
             std::vector<std::string>({"type", "basic", "structure", "object"}));
+  EXPECT_EQ(ts.get_path_up_tree("object"), std::vector<std::string>({"object"}));
+  EXPECT_EQ(ts.get_path_up_tree("none"), std::vector<std::string>({"none"}));
 }
 
 TEST(TypeSystem, lca) {
@@ -395,6 +398,44 @@ TEST(TypeSystem, lca) {
             "(pointer object)");
 }
 
+TEST(TypeSystem, Serialize) {
+  TypeSystem ts;
+  ts.add_builtin_types(GameVersion::Jak1);
+  ts.forward_declare_type_as("my-forward-type", "basic");
+  for (int i = 0; i < 20; i++) {
+    ts.forward_declare_type_as("my-forward-type-" + std::to_string(i), "structure");
+    ts.forward_declare_type_method_count("my-forward-type-" + std::to_string(i), 9 + i);
+  }
+
+  Serializer saver;
+  ts.serialize(saver);
+  auto [data, size] = saver.get_save_result();
+
+  TypeSystem loaded;
+  Serializer loader(data, size);
+  loaded.serialize(loader);
+  EXPECT_TRUE(loader.get_load_finished());
+
+  auto names = ts.get_all_type_names();
+  EXPECT_EQ(loaded.get_all_type_names().size(), names.size());
+  for (const auto& name : names) {
+    EXPECT_EQ(loaded.lookup_type(name)->print(), ts.lookup_type(name)->print());
+    EXPECT_EQ(loaded.lookup_type(name)->print_method_info(),
+              ts.lookup_type(name)->print_method_info());
+  }
+  EXPECT_EQ(loaded.get_path_up_tree("type"), ts.get_path_up_tree("type"));
+  EXPECT_TRUE(loaded.partially_defined_type_exists("my-forward-type"));
+  EXPECT_TRUE(loaded.has_child_types("basic"));
+
+  // saving the loaded copy gives the same bytes, even though it was built in a different order.
+  Serializer resaver;
+  loaded.serialize(resaver);
+  auto [redata, resize] = resaver.get_save_result();
+  EXPECT_EQ(std::vector<u8>(data, data + size), std::vector<u8>(redata, redata + resize));
+  EXPECT_EQ(loaded.lookup_method("type", "print").type.print(),
+            ts.lookup_method("type", "print").type.print());
+}
+
 TEST(TypeSystem, DecompLookupsTypeOfBasic) {
   TypeSystem ts;
   ts.add_builtin_types(GameVersion::Jak1);
@@ -525,4 +566,30 @@ TEST(Deftype, deftype) {
   EXPECT_EQ(f5.is_inline(), false);
 }
 
+TEST(TypeSystem, AssumeLeafType) {
+  TypeSystem ts;
+  ts.add_builtin_types(GameVersion::Jak1);
+  goos::Reader reader;
+  auto deftype = [&](const std::string& input) {
+    auto& in = reader.read_from_string(input).as_pair()->cdr.as_pair()->car.as_pair()->cdr;
+    parse_deftype(in, &ts);
+  };
+
+  deftype("(deftype leaf-parent (basic) ((f1 int32)))");
+  deftype("(deftype leaf-open (basic) ((f1 int32)) :no-devirtualize)");
+  EXPECT_TRUE(ts.has_child_types("basic"));
+  EXPECT_FALSE(ts.has_child_types("leaf-parent"));
+
+  // types with children, structures, and types that opt out can't be leaves.
+  EXPECT_FALSE(ts.try_assume_leaf_type("basic"));
+  EXPECT_FALSE(ts.try_assume_leaf_type("vector"));
+  EXPECT_FALSE(ts.try_assume_leaf_type("leaf-open"));
+  EXPECT_TRUE(ts.try_assume_leaf_type("leaf-parent"));
+
+  // once a type is assumed to be a leaf, it can't get children.
+  deftype("(deftype leaf-open-child (leaf-open) ())");
+  EXPECT_ANY_THROW(deftype("(deftype leaf-child (leaf-parent) ())"));
+  EXPECT_ANY_THROW(ts.forward_declare_type_as("leaf-child-2", "leaf-parent"));
+}
+
 // TODO - a big test to make sure all the builtin types are what we expect.
@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 
 #include "common/common_types.h"
+#include "common/util/Serializer.h"
 #include "common/util/compress.h"
 
 #include "gtest/gtest.h"
@@ -56,4 +59,37 @@ TEST(ZSTD, CommonLibrary) {
   }
 
   EXPECT_TRUE(compressed.size() < 0.5 * all.size());
-}
\ No newline at end of file
+}
+TEST(ZSTD, Stream) {
+  std::string all;
+  for (int i = 0; i < 20; i++) {
+    for (auto& x : all_syms) {
+      all.append(x);
+      all.append("\n");
+    }
+  }
+
+  for (int workers : {0, 2}) {
+    compression::ZstdOptions options;
+    options.level = 3;
+    options.workers = workers;
+    compression::ZstdStreamCompressor compressor(options);
+    // feed it in uneven pieces, through a serializer.
+    Serializer ser([&](const u8* data, size_t size) { compressor.add(data, size); }, 1000);
+    for (size_t i = 0; i < all.size(); i += 777) {
+      ser.from_raw_data(all.data() + i, std::min(all.size() - i, (size_t)777));
+    }
+    std::string big(5000, 'a');
+    ser.save_str(&big);
+    ser.flush();
+    EXPECT_EQ(ser.saved_size(), all.size() + sizeof(size_t) + big.size());
+    EXPECT_EQ(compressor.uncompressed_size(), ser.saved_size());
+
+    auto compressed = compressor.finish();
+    auto decompressed = compression::decompress_zstd(compressed.data(), compressed.size());
+    ASSERT_EQ(decompressed.size(), ser.saved_size());
+    EXPECT_EQ(0, memcmp(decompressed.data(), all.data(), all.size()));
+    Serializer loader(decompressed.data() + all.size(), decompressed.size() - all.size());
+    EXPECT_EQ(loader.load_string(), big);
+  }
+}
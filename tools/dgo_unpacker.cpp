@@ -40,7 +40,7 @@ int run(int argc, char** argv) {
     // write files:
     for (auto& entry : dgo.entries()) {
       file_util::write_binary_file(file_util::combine_path(out_path, entry.unique_name),
-                                   (const void*)entry.data.data(), entry.data.size());
+                                   (const void*)entry.data, entry.size);
     }
   }
 